@@ -0,0 +1,447 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <ResourceKit/ResourceKit.h>
+
+#pragma mark - Helpers
+
+// Expand any directories in the paths to the files inside them. Directory contents are
+// sorted so that overrides are applied in the same order every time.
+static NSArray <NSString *> *RKToolExpandPaths(NSArray <NSString *> *paths)
+{
+    NSMutableArray <NSString *> *filePaths = [NSMutableArray new];
+    for (NSString *path in paths) {
+        BOOL isDir = NO;
+        if ([[NSFileManager defaultManager] fileExistsAtPath:path isDirectory:&isDir] && isDir) {
+            NSArray *files = [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:path error:nil] sortedArrayUsingSelector:@selector(compare:)];
+            for (NSString *file in files) {
+                [filePaths addObject:[path stringByAppendingPathComponent:file]];
+            }
+        }
+        else {
+            [filePaths addObject:path];
+        }
+    }
+    return filePaths;
+}
+
+static BOOL RKToolPixelFormatNamed(NSString *name, RKPixelFormat *format)
+{
+    NSDictionary <NSString *, NSNumber *> *formats = @{
+        @"rgba8888": @(RKPixelFormat_RGBA8888),
+        @"bgra8888": @(RKPixelFormat_BGRA8888),
+        @"rgb565": @(RKPixelFormat_RGB565),
+        @"rgba5551": @(RKPixelFormat_RGBA5551),
+    };
+    NSNumber *value = formats[name.lowercaseString];
+    if (!value) {
+        return NO;
+    }
+    *format = value.unsignedIntValue;
+    return YES;
+}
+
+
+#pragma mark - Commands
+
+static int RKToolBake(NSArray <NSString *> *arguments)
+{
+    NSString *outputPath = nil;
+    RKPixelFormat format = RKPixelFormat_RGBA8888;
+    NSMutableArray <NSString *> *inputPaths = [NSMutableArray new];
+    
+    for (NSUInteger i = 0; i < arguments.count; ++i) {
+        NSString *argument = arguments[i];
+        if ([argument isEqualToString:@"-o"] && i + 1 < arguments.count) {
+            outputPath = arguments[++i];
+        }
+        else if ([argument isEqualToString:@"--format"] && i + 1 < arguments.count) {
+            if (!RKToolPixelFormatNamed(arguments[++i], &format)) {
+                fprintf(stderr, "rktool: unknown pixel format '%s'\n", arguments[i].UTF8String);
+                return 1;
+            }
+        }
+        else {
+            [inputPaths addObject:argument];
+        }
+    }
+    
+    if (!outputPath || inputPaths.count == 0) {
+        return -1;
+    }
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    NSArray <NSString *> *filePaths = RKToolExpandPaths(inputPaths);
+    NSArray *files = [resourceFork addResourceFilesAtPaths:filePaths];
+    if (files.count == 0) {
+        fprintf(stderr, "rktool: no resource files were found\n");
+        return 1;
+    }
+    
+    NSError *error = nil;
+    if (![RKArchiveResourceFile bakeResourceFork:resourceFork toPath:outputPath pixelFormat:format error:&error]) {
+        fprintf(stderr, "rktool: failed to bake %s: %s\n", outputPath.UTF8String, error.localizedDescription.UTF8String);
+        return 1;
+    }
+    
+    printf("Baked %lu resource files into %s\n", (unsigned long)files.count, outputPath.UTF8String);
+    return 0;
+}
+
+static void RKToolPrintDecodeRow(NSString *label, RKBulkDecodeSummary summary)
+{
+    double elapsed = summary.elapsedTime / 1e9;
+    printf("%s %8lu %8lu %12llu %12.2f %12.2f %12.0f %10.2f\n",
+           [label stringByPaddingToLength:6 withString:@" " startingAtIndex:0].UTF8String,
+           (unsigned long)summary.count,
+           (unsigned long)summary.failures,
+           (unsigned long long)summary.bytes,
+           summary.decodeTime / 1e6,
+           summary.elapsedTime / 1e6,
+           elapsed > 0 ? summary.count / elapsed : 0,
+           elapsed > 0 ? summary.bytes / elapsed / (1024 * 1024) : 0);
+}
+
+static int RKToolDecode(NSArray <NSString *> *arguments)
+{
+    NSMutableArray <NSString *> *types = [NSMutableArray new];
+    NSUInteger jobs = NSProcessInfo.processInfo.activeProcessorCount;
+    BOOL verbose = NO;
+    NSMutableArray <NSString *> *inputPaths = [NSMutableArray new];
+    
+    for (NSUInteger i = 0; i < arguments.count; ++i) {
+        NSString *argument = arguments[i];
+        if ([argument isEqualToString:@"--type"] && i + 1 < arguments.count) {
+            [types addObject:arguments[++i]];
+        }
+        else if ([argument isEqualToString:@"--jobs"] && i + 1 < arguments.count) {
+            jobs = (NSUInteger)MAX(arguments[++i].integerValue, 1);
+        }
+        else if ([argument isEqualToString:@"-v"]) {
+            verbose = YES;
+        }
+        else {
+            [inputPaths addObject:argument];
+        }
+    }
+    
+    if (inputPaths.count == 0) {
+        return -1;
+    }
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    NSArray *files = [resourceFork addResourceFilesAtPaths:RKToolExpandPaths(inputPaths)];
+    if (files.count == 0) {
+        fprintf(stderr, "rktool: no resource files were found\n");
+        return 1;
+    }
+    
+    printf("%-6s %8s %8s %12s %12s %12s %12s %10s\n", "Type", "Count", "Failed", "Bytes", "Decode ms", "Wall ms", "Items/s", "MB/s");
+    
+    RKBulkDecodeSummary total = { 0 };
+    for (NSString *type in (types.count ? types : resourceFork.allTypes)) {
+        RKBulkDecodeSummary summary = [resourceFork decodeResourcesOfType:type maximumConcurrency:jobs handler:^(RKResource *resource, id object, uint64_t duration) {
+            if (!object) {
+                fprintf(stderr, "rktool: failed to decode '%s' %d\n", type.UTF8String, resource.id);
+            }
+            else if (verbose) {
+                fprintf(stderr, "'%s' %d decoded in %.3fms\n", type.UTF8String, resource.id, duration / 1e6);
+            }
+        }];
+        RKToolPrintDecodeRow(type, summary);
+        
+        total.count += summary.count;
+        total.failures += summary.failures;
+        total.bytes += summary.bytes;
+        total.decodeTime += summary.decodeTime;
+        total.elapsedTime += summary.elapsedTime;
+    }
+    
+    RKToolPrintDecodeRow(@"total", total);
+    return total.failures ? 1 : 0;
+}
+
+static void RKToolPrintMemoryRow(NSString *label, RKResourceMapUsage usage)
+{
+    double count = MAX(usage.resourceCount, 1);
+    printf("%s %10lu %8lu %10lu %14.1f %14.1f %10.1f\n",
+           [label stringByPaddingToLength:24 withString:@" " startingAtIndex:0].UTF8String,
+           (unsigned long)usage.resourceCount,
+           (unsigned long)usage.nameCount,
+           (unsigned long)usage.internedStringCount,
+           usage.inlineNameBytes / count,
+           usage.bytes / count,
+           ((double)usage.inlineNameBytes - (double)usage.bytes) / 1024);
+}
+
+static int RKToolMemory(NSArray <NSString *> *arguments)
+{
+    if (arguments.count == 0) {
+        return -1;
+    }
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    NSArray <id <RKResourceFileProtocol>> *files = [resourceFork addResourceFilesAtPaths:RKToolExpandPaths(arguments)];
+    if (files.count == 0) {
+        fprintf(stderr, "rktool: no resource files were found\n");
+        return 1;
+    }
+    
+    // Listing every resource creates the name strings, just as loading the game would.
+    for (NSString *type in resourceFork.allTypes) {
+        [resourceFork resourcesOfType:type];
+    }
+    
+    printf("%-24s %10s %8s %10s %14s %14s %10s\n", "File", "Resources", "Names", "Strings", "Inline B/res", "Pooled B/res", "Saved KB");
+    
+    RKResourceMapUsage total = { 0 };
+    for (id <RKResourceFileProtocol> file in files) {
+        if (![file respondsToSelector:@selector(resourceMapUsage)]) {
+            continue;
+        }
+        RKResourceMapUsage usage = file.resourceMapUsage;
+        RKToolPrintMemoryRow(file.filePath.lastPathComponent, usage);
+        
+        total.resourceCount += usage.resourceCount;
+        total.nameCount += usage.nameCount;
+        total.bytes += usage.bytes;
+        total.inlineNameBytes += usage.inlineNameBytes;
+        total.internedStringCount += usage.internedStringCount;
+    }
+    
+    RKToolPrintMemoryRow(@"total", total);
+    return 0;
+}
+
+static void RKToolPrintDedupeRow(NSString *label, RKDuplicationSummary summary)
+{
+    printf("%s %10lu %10lu %12.1f %12.1f %8.1f%%\n",
+           [label stringByPaddingToLength:8 withString:@" " startingAtIndex:0].UTF8String,
+           (unsigned long)summary.count,
+           (unsigned long)summary.uniqueCount,
+           summary.bytes / 1024.0,
+           summary.duplicateBytes / 1024.0,
+           summary.bytes > 0 ? 100.0 * summary.duplicateBytes / summary.bytes : 0.0);
+}
+
+static int RKToolDedupe(NSArray <NSString *> *arguments)
+{
+    if (arguments.count == 0) {
+        return -1;
+    }
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    if ([resourceFork addResourceFilesAtPaths:RKToolExpandPaths(arguments)].count == 0) {
+        fprintf(stderr, "rktool: no resource files were found\n");
+        return 1;
+    }
+    
+    // Only the resources the merged fork provides are counted, as those are the ones that
+    // would be decoded. Copies shadowed by a later file are never decoded at all.
+    printf("%-8s %10s %10s %12s %12s %9s\n", "Type", "Resources", "Unique", "Data KB", "Saved KB", "Saved");
+    
+    RKDuplicationSummary total = { 0 };
+    for (NSString *type in resourceFork.allTypes) {
+        RKDuplicationSummary summary = [resourceFork duplicationSummaryOfTypeCode:RKFourCCFromString(type)];
+        if (summary.duplicateBytes > 0) {
+            RKToolPrintDedupeRow(type, summary);
+        }
+        
+        total.count += summary.count;
+        total.uniqueCount += summary.uniqueCount;
+        total.bytes += summary.bytes;
+        total.duplicateBytes += summary.duplicateBytes;
+    }
+    
+    RKToolPrintDedupeRow(@"total", total);
+    return 0;
+}
+
+static RKResourceFork *RKToolLoadFork(NSString *path)
+{
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    if ([resourceFork addResourceFilesAtPaths:RKToolExpandPaths(@[path])].count == 0) {
+        fprintf(stderr, "rktool: no resource files were found at %s\n", path.UTF8String);
+        return nil;
+    }
+    return resourceFork;
+}
+
+static void RKToolPrintDiffRows(char marker, NSData *keys, RKResourceFork *oldFork, RKResourceFork *newFork)
+{
+    const RKResourceKey *key = keys.bytes;
+    for (NSUInteger i = 0; i < keys.length / sizeof(*key); ++i) {
+        uint32_t oldSize = [oldFork sizeOfResource:[oldFork handleOfResourceOfTypeCode:key[i].type id:key[i].id]];
+        uint32_t newSize = [newFork sizeOfResource:[newFork handleOfResourceOfTypeCode:key[i].type id:key[i].id]];
+        printf("%c '%s' %6d  ", marker, NSStringFromFourCC(key[i].type).UTF8String, key[i].id);
+        switch (marker) {
+            case '+': printf("%u bytes\n", newSize); break;
+            case '-': printf("%u bytes\n", oldSize); break;
+            default: printf("%u -> %u bytes\n", oldSize, newSize); break;
+        }
+    }
+}
+
+static int RKToolDiff(NSArray <NSString *> *arguments)
+{
+    BOOL quiet = NO;
+    NSMutableArray <NSString *> *inputPaths = [NSMutableArray new];
+    for (NSString *argument in arguments) {
+        if ([argument isEqualToString:@"-q"]) {
+            quiet = YES;
+        }
+        else {
+            [inputPaths addObject:argument];
+        }
+    }
+    
+    if (inputPaths.count != 2) {
+        return -1;
+    }
+    
+    // Each side is loaded as a fork, so a directory of plug-ins compares as the merged
+    // result of loading it, and a single file as itself.
+    RKResourceFork *oldFork = RKToolLoadFork(inputPaths[0]);
+    RKResourceFork *newFork = RKToolLoadFork(inputPaths[1]);
+    if (!oldFork || !newFork) {
+        return 1;
+    }
+    
+    uint64_t start = RKDecodeClock();
+    RKResourceChangeSet *changes = [RKResourceDiff changesFromResourceFork:oldFork toResourceFork:newFork];
+    uint64_t elapsed = RKDecodeClock() - start;
+    
+    if (!quiet) {
+        RKToolPrintDiffRows('+', changes.addedResources, oldFork, newFork);
+        RKToolPrintDiffRows('-', changes.removedResources, oldFork, newFork);
+        RKToolPrintDiffRows('M', changes.changedResources, oldFork, newFork);
+    }
+    printf("%lu added, %lu removed, %lu modified, compared in %.2fms\n",
+           (unsigned long)(changes.addedResources.length / sizeof(RKResourceKey)),
+           (unsigned long)(changes.removedResources.length / sizeof(RKResourceKey)),
+           (unsigned long)(changes.changedResources.length / sizeof(RKResourceKey)),
+           elapsed / 1e6);
+    return changes.empty ? 0 : 1;
+}
+
+static int RKToolRepack(NSArray <NSString *> *arguments)
+{
+    NSString *outputPath = nil;
+    RKRezLayout layout = RKRezLayoutByTypeAndId;
+    uint32_t alignment = 1;
+    NSMutableArray <NSString *> *inputPaths = [NSMutableArray new];
+    
+    for (NSUInteger i = 0; i < arguments.count; ++i) {
+        NSString *argument = arguments[i];
+        if ([argument isEqualToString:@"-o"] && i + 1 < arguments.count) {
+            outputPath = arguments[++i];
+        }
+        else if ([argument isEqualToString:@"--keep-order"]) {
+            layout = RKRezLayoutAsAdded;
+        }
+        else if ([argument isEqualToString:@"--align"] && i + 1 < arguments.count) {
+            alignment = (uint32_t)arguments[++i].integerValue;
+        }
+        else {
+            [inputPaths addObject:argument];
+        }
+    }
+    
+    if (!outputPath || inputPaths.count != 1) {
+        return -1;
+    }
+    
+    id <RKResourceFileProtocol> file = [[RKResourceFork emptyResourceFork] addResourceFilesAtPaths:inputPaths].firstObject;
+    if (!file) {
+        fprintf(stderr, "rktool: %s is not a resource file\n", inputPaths[0].UTF8String);
+        return 1;
+    }
+    
+    RKRezWriter *writer = [RKRezWriter new];
+    writer.layout = layout;
+    writer.alignment = alignment;
+    [writer addResourcesFromResourceFile:file];
+    if (![writer writeToFile:outputPath]) {
+        fprintf(stderr, "rktool: failed to write %s\n", outputPath.UTF8String);
+        return 1;
+    }
+    
+    printf("Repacked %lu resources into %s\n", (unsigned long)writer.resourceCount, outputPath.UTF8String);
+    return 0;
+}
+
+
+#pragma mark - Command Table
+
+typedef struct {
+    const char *name;
+    const char *usage;
+    int (*run)(NSArray <NSString *> *arguments);
+} RKToolCommand;
+
+static const RKToolCommand RKToolCommands[] = {
+    { "bake", "bake [--format rgba8888|bgra8888|rgb565|rgba5551] -o <archive.rka> <file or directory>...", RKToolBake },
+    { "decode", "decode [--type <code>]... [--jobs <count>] [-v] <file or directory>...", RKToolDecode },
+    { "memory", "memory <file or directory>...", RKToolMemory },
+    { "dedupe", "dedupe <file or directory>...", RKToolDedupe },
+    { "diff", "diff [-q] <old file or directory> <new file or directory>", RKToolDiff },
+    { "repack", "repack [--keep-order] [--align <bytes>] -o <output.rez> <resource file>", RKToolRepack },
+};
+
+static void RKToolPrintUsage(void)
+{
+    fprintf(stderr, "usage:\n");
+    for (size_t i = 0; i < sizeof(RKToolCommands) / sizeof(*RKToolCommands); ++i) {
+        fprintf(stderr, "    rktool %s\n", RKToolCommands[i].usage);
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    @autoreleasepool {
+        if (argc < 2) {
+            RKToolPrintUsage();
+            return 1;
+        }
+        
+        NSMutableArray <NSString *> *arguments = [NSMutableArray arrayWithCapacity:argc - 2];
+        for (int i = 2; i < argc; ++i) {
+            [arguments addObject:@(argv[i])];
+        }
+        
+        for (size_t i = 0; i < sizeof(RKToolCommands) / sizeof(*RKToolCommands); ++i) {
+            if (strcmp(argv[1], RKToolCommands[i].name) == 0) {
+                int status = RKToolCommands[i].run(arguments);
+                if (status < 0) {
+                    fprintf(stderr, "usage: rktool %s\n", RKToolCommands[i].usage);
+                    return 1;
+                }
+                return status;
+            }
+        }
+        
+        RKToolPrintUsage();
+        return 1;
+    }
+}
@@ -51,8 +51,8 @@
 - (NSInteger)outlineView:(NSOutlineView *)outlineView numberOfChildrenOfItem:(nullable id)item
 {
     if (item && [item isKindOfClass:NSString.class]) {
-        // Child Item
-        return [[_resourceFork resourcesOfType:item] count];
+        // Child Item. Only the resources of rows that are actually shown are created.
+        return [_resourceFork handlesOfTypeCode:RKFourCCFromString(item)].length / sizeof(RKResourceHandle);
     }
     else {
         // Root Item
@@ -64,7 +64,8 @@
 {
     if (item && [item isKindOfClass:NSString.class]) {
         // Child of Item
-        return [_resourceFork resourcesOfType:item][index];
+        const RKResourceHandle *handles = [_resourceFork handlesOfTypeCode:RKFourCCFromString(item)].bytes;
+        return [_resourceFork resourceForHandle:handles[index]];
     }
     else {
         // Child of Root Item
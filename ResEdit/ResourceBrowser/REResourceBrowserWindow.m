@@ -29,6 +29,9 @@
 #import "REPICTEditor.h"
 #import "REStringListEditor.h"
 #import "RESpinEditor.h"
+#import "RERLEEditor.h"
+#import "REBoomEditor.h"
+#import "REColrEditor.h"
 #import "REResourceEditorProtocol.h"
 
 static void *REResourceEditorsKey = &REResourceEditorsKey;
@@ -67,11 +70,14 @@ static void *REResourceEditorsKey = &REResourceEditorsKey;
     RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
     
     if ([[NSFileManager defaultManager] fileExistsAtPath:filePath isDirectory:&isDir] && isDir) {
-        // Opening all files in directory...
-        NSArray *files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:filePath error:nil];
+        // Opening all files in directory. They are sorted so that overrides are applied in
+        // the same order every time.
+        NSArray *files = [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:filePath error:nil] sortedArrayUsingSelector:@selector(compare:)];
+        NSMutableArray *filePaths = [NSMutableArray arrayWithCapacity:files.count];
         for (NSString *file in files) {
-            [resourceFork addResourceFileAtPath:[filePath stringByAppendingPathComponent:file]];
+            [filePaths addObject:[filePath stringByAppendingPathComponent:file]];
         }
+        [resourceFork addResourceFilesAtPaths:filePaths];
     }
     else {
         // Opening a single file.
@@ -152,22 +158,21 @@ static void *REResourceEditorsKey = &REResourceEditorsKey;
 {
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        int classCount = 0;
-        classCount = objc_getClassList(NULL, classCount);
-        if (classCount) {
-            Class *classes = (__unsafe_unretained Class *)calloc(classCount, sizeof(*classes));
-            objc_getClassList(classes, classCount);
-            
-            // Step through the classes and search for ones that conform to RKResourceParserProtocol
-            for (int i = 0; i < classCount; ++i) {
-                Method method = class_getClassMethod(classes[i], @selector(registerEditor));
-                if (method) {
-                    [classes[i] registerEditor];
-                }
-            }
-            
-            free(classes);
-        }
+        // The editors that ship with the app. Searching the runtime for them instead would
+        // mean messaging every class in the process.
+        NSDictionary <NSString *, Class> *editors = @{
+            @"PICT": REPICTEditor.class,
+            @"STR#": REStringListEditor.class,
+            @"RLËD": RERLEEditor.class,
+            @"rlëD": RERLEEditor.class,
+            @"spïn": RESpinEditor.class,
+            @"bööm": REBoomEditor.class,
+            @"cölr": REColrEditor.class,
+        };
+        
+        [editors enumerateKeysAndObjectsUsingBlock:^(NSString *type, Class editor, BOOL *stop) {
+            [REResourceBrowserWindow registerEditorClass:editor forType:type];
+        }];
     });
 }
 
@@ -194,8 +199,6 @@ static void *REResourceEditorsKey = &REResourceEditorsKey;
         return;
     }
     
-    [self.resourceEditor.resource flushCache];
-    
     self.resourceIdLabel.hidden = NO;
     self.resourceNameLabel.hidden = NO;
     
@@ -36,11 +36,6 @@
 
 @synthesize resource = _resource;
 
-+ (void)registerEditor
-{
-    [REResourceBrowserWindow registerEditorClass:self forType:@"PICT"];
-}
-
 - (nonnull instancetype)initWithResource:(nonnull RKResource *)resource
 {
     if (self = [super init]) {
@@ -33,8 +33,4 @@
 
 - (nonnull instancetype)initWithResource:(nonnull RKResource *)resource;
 
-@optional
-
-+ (void)registerEditor;
-
 @end
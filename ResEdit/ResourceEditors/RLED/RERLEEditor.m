@@ -37,12 +37,6 @@
 @implementation RERLEEditor
 @synthesize resource = _resource;
 
-+ (void)registerEditor
-{
-    [REResourceBrowserWindow registerEditorClass:self forType:@"RLËD"];
-    [REResourceBrowserWindow registerEditorClass:self forType:@"rlëD"];
-}
-
 - (nonnull instancetype)initWithResource:(nonnull RKResource *)resource
 {
     if (self = [super init]) {
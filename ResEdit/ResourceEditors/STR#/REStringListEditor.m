@@ -36,11 +36,6 @@
 
 @synthesize resource = _resource;
 
-+ (void)registerEditor
-{
-    [REResourceBrowserWindow registerEditorClass:self forType:@"STR#"];
-}
-
 - (nonnull instancetype)initWithResource:(nonnull RKResource *)resource
 {
     if (self = [super init]) {
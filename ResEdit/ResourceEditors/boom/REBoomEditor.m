@@ -28,11 +28,6 @@
 
 @implementation REBoomEditor
 
-+ (void)registerEditor
-{
-    [REResourceBrowserWindow registerEditorClass:self forType:@"bööm"];
-}
-
 - (NSArray<RENovaTypeProperty *> *)properties
 {
     return @[[RENovaTypeProperty withDisplayName:@"Frame Advance" forProperty:@"frameAdvance" ofType:EVNovaTypeDataType_DWRD],
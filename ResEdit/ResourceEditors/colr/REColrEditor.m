@@ -28,11 +28,6 @@
 
 @implementation REColrEditor
 
-+ (void)registerEditor
-{
-    [REResourceBrowserWindow registerEditorClass:self forType:@"cölr"];
-}
-
 - (NSArray<RENovaTypeProperty *> *)properties
 {
     return @[
@@ -28,11 +28,6 @@
 
 @implementation RESpinEditor
 
-+ (void)registerEditor
-{
-    [REResourceBrowserWindow registerEditorClass:self forType:@"spïn"];
-}
-
 - (NSArray<RENovaTypeProperty *> *)properties
 {
     return @[[RENovaTypeProperty withDisplayName:@"Sprites ID" forProperty:@"spritesId" ofType:EVNovaTypeDataType_DWRD],
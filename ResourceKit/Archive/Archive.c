@@ -0,0 +1,480 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Archive.h"
+
+#pragma mark - Archive Configuration
+
+#define ARCHIVE_MAGIC                   0x524B4152  // 'RKAR'
+#define ARCHIVE_VERSION                 2
+
+// Archives are aligned to the largest page size in use, so that they map cleanly on
+// every machine.
+#define ARCHIVE_PAGE_SIZE               16384
+
+#define ARCHIVE_DATA_ALIGNMENT          16
+#define ARCHIVE_FRAME_ALIGNMENT         64
+#define ARCHIVE_ROW_ALIGNMENT           16
+
+#define ARCHIVE_ALIGN(_value, _alignment)   (((_value) + (_alignment) - 1) & ~((uint64_t)(_alignment) - 1))
+
+
+#pragma mark - Reading
+
+static bool ArchiveVerify(const Archive *archive)
+{
+    const ArchiveHeader *header = archive->header;
+    
+    // Every type must refer to resources that exist, every resource to a name in the pool,
+    // data before the index and frames that exist, and every frame to pixels before the
+    // index.
+    uint64_t expectedResource = 0;
+    for (uint32_t i = 0; i < header->typeCount; ++i) {
+        const ArchiveType *type = &archive->types[i];
+        if (type->firstResource != expectedResource || (uint64_t)type->firstResource + type->resourceCount > header->resourceCount) {
+            return false;
+        }
+        expectedResource += type->resourceCount;
+    }
+    if (expectedResource != header->resourceCount) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < header->resourceCount; ++i) {
+        const ArchiveResource *resource = &archive->resources[i];
+        if ((uint64_t)resource->nameOffset + resource->nameLength > header->namesLength) {
+            return false;
+        }
+        else if (resource->dataOffset + resource->size > header->indexOffset) {
+            return false;
+        }
+        else if ((uint64_t)resource->firstFrame + resource->frameCount > header->frameCount) {
+            return false;
+        }
+    }
+    
+    for (uint32_t i = 0; i < header->frameCount; ++i) {
+        const ArchiveFrame *frame = &archive->frames[i];
+        if (frame->offset % ARCHIVE_FRAME_ALIGNMENT != 0 || frame->offset + (uint64_t)frame->stride * frame->height > header->indexOffset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Archive *ArchiveOpen(const char *path)
+{
+    Archive *archive = NULL;
+    void *mapping = MAP_FAILED;
+    struct stat info;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ArchiveHeader)) {
+        goto ARCHIVE_OPEN_ERROR;
+    }
+    
+    // Pages are shared with every other process mapping the archive. Nothing ever writes to
+    // an archive once it has been baked, so the mapping is read only.
+    size_t length = (size_t)info.st_size;
+    if ((mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        goto ARCHIVE_OPEN_ERROR;
+    }
+    
+    const ArchiveHeader *header = mapping;
+    if (header->magic != ARCHIVE_MAGIC || header->version != ARCHIVE_VERSION || header->pageSize != ARCHIVE_PAGE_SIZE) {
+        goto ARCHIVE_OPEN_ERROR;
+    }
+    else if (header->fileLength != length || header->indexOffset % ARCHIVE_PAGE_SIZE != 0) {
+        goto ARCHIVE_OPEN_ERROR;
+    }
+    
+    uint64_t expectedLength = header->indexOffset
+                            + (uint64_t)header->resourceCount * sizeof(ArchiveResource)
+                            + (uint64_t)header->typeCount * sizeof(ArchiveType)
+                            + (uint64_t)header->frameCount * sizeof(ArchiveFrame)
+                            + header->namesLength;
+    if (expectedLength != length) {
+        goto ARCHIVE_OPEN_ERROR;
+    }
+    
+    archive = calloc(1, sizeof(*archive));
+    archive->mapping = mapping;
+    archive->length = length;
+    archive->header = header;
+    archive->resources = (const ArchiveResource *)(archive->mapping + header->indexOffset);
+    archive->types = (const ArchiveType *)(archive->resources + header->resourceCount);
+    archive->frames = (const ArchiveFrame *)(archive->types + header->typeCount);
+    archive->names = (const char *)(archive->frames + header->frameCount);
+    
+    if (!ArchiveVerify(archive)) {
+        goto ARCHIVE_OPEN_ERROR;
+    }
+    
+    goto ARCHIVE_OPEN_DONE;
+    
+ARCHIVE_OPEN_ERROR:
+    if (mapping != MAP_FAILED) {
+        munmap(mapping, (size_t)info.st_size);
+    }
+    free(archive);
+    archive = NULL;
+    
+ARCHIVE_OPEN_DONE:
+    close(fd);
+    return archive;
+}
+
+void ArchiveClose(Archive *archive)
+{
+    if (archive) {
+        munmap(archive->mapping, archive->length);
+        free(archive);
+    }
+}
+
+const ArchiveType *ArchiveGetTypeForCode(const Archive *archive, RKFourCC code)
+{
+    for (uint32_t i = 0; i < archive->header->typeCount; ++i) {
+        if (RKFourCCMake(archive->types[i].code) == code) {
+            return &archive->types[i];
+        }
+    }
+    return NULL;
+}
+
+const ArchiveResource *ArchiveGetResourceOfTypeWithId(const Archive *archive, const ArchiveType *type, int16_t id)
+{
+    // Resources are sorted by id within their type.
+    const ArchiveResource *resources = &archive->resources[type->firstResource];
+    uint32_t low = 0;
+    uint32_t high = type->resourceCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (resources[middle].id < id) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return (low < type->resourceCount && resources[low].id == id) ? &resources[low] : NULL;
+}
+
+
+#pragma mark - Writing
+
+typedef struct _ArchiveWriterResource {
+    uint32_t type;
+    ArchiveResource resource;
+} ArchiveWriterResource;
+
+struct _ArchiveWriter {
+    int fd;
+    char *path;
+    char *temporaryPath;
+    uint32_t pixelFormat;
+    uint64_t position;
+    
+    ArchiveType *types;
+    uint32_t typeCount;
+    uint32_t typeCapacity;
+    
+    ArchiveWriterResource *resources;
+    uint32_t resourceCount;
+    uint32_t resourceCapacity;
+    
+    ArchiveFrame *frames;
+    uint32_t frameCount;
+    uint32_t frameCapacity;
+    
+    char *names;
+    uint32_t namesLength;
+    uint32_t namesCapacity;
+    
+    bool failed;
+};
+
+static bool ArchiveWriterGrow(void **array, uint32_t *capacity, uint32_t required, size_t elementSize)
+{
+    if (required <= *capacity) {
+        return true;
+    }
+    
+    uint32_t newCapacity = *capacity ?: 16;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    
+    void *newArray = realloc(*array, newCapacity * elementSize);
+    if (!newArray) {
+        return false;
+    }
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Write bytes at the specified offset of the archive. Gaps left between writes for
+// alignment are read back as zeros.
+static bool ArchiveWriterWriteAt(ArchiveWriter *writer, const void *bytes, size_t length, uint64_t offset)
+{
+    const uint8_t *p = bytes;
+    while (length > 0) {
+        ssize_t written = pwrite(writer->fd, p, length, (off_t)offset);
+        if (written <= 0) {
+            writer->failed = true;
+            return false;
+        }
+        p += written;
+        offset += (uint64_t)written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+ArchiveWriter *ArchiveWriterCreate(const char *path, uint32_t pixelFormat)
+{
+    ArchiveWriter *writer = calloc(1, sizeof(ArchiveWriter));
+    if (!writer) {
+        return NULL;
+    }
+    
+    writer->fd = -1;
+    writer->pixelFormat = pixelFormat;
+    writer->position = ARCHIVE_PAGE_SIZE;
+    writer->path = strdup(path);
+    if (!writer->path || asprintf(&writer->temporaryPath, "%s.XXXXXX", path) < 0) {
+        writer->temporaryPath = NULL;
+        goto ARCHIVE_WRITER_CREATE_ERROR;
+    }
+    
+    // mkstemp gives the temporary file a unique name, but only lets its owner read it, and
+    // an archive is meant to be shared by every process that loads it.
+    if ((writer->fd = mkstemp(writer->temporaryPath)) < 0 || fchmod(writer->fd, 0644) != 0) {
+        goto ARCHIVE_WRITER_CREATE_ERROR;
+    }
+    return writer;
+    
+ARCHIVE_WRITER_CREATE_ERROR:
+    ArchiveWriterDestroy(writer);
+    return NULL;
+}
+
+void ArchiveWriterDestroy(ArchiveWriter *writer)
+{
+    if (writer) {
+        if (writer->fd >= 0) {
+            close(writer->fd);
+            unlink(writer->temporaryPath);
+        }
+        free(writer->path);
+        free(writer->temporaryPath);
+        free(writer->types);
+        free(writer->resources);
+        free(writer->frames);
+        free(writer->names);
+        free(writer);
+    }
+}
+
+uint32_t ArchiveWriterAddType(ArchiveWriter *writer, RKFourCC code)
+{
+    if (!ArchiveWriterGrow((void **)&writer->types, &writer->typeCapacity, writer->typeCount + 1, sizeof(*writer->types))) {
+        writer->failed = true;
+        return UINT32_MAX;
+    }
+    
+    ArchiveType *type = &writer->types[writer->typeCount];
+    type->code[0] = (char)(code >> 24);
+    type->code[1] = (char)(code >> 16);
+    type->code[2] = (char)(code >> 8);
+    type->code[3] = (char)code;
+    type->firstResource = 0;
+    type->resourceCount = 0;
+    return writer->typeCount++;
+}
+
+void ArchiveWriterAddResource(ArchiveWriter *writer, uint32_t type, int16_t id, const char *name, const void *data, uint32_t size)
+{
+    if (writer->failed || type >= writer->typeCount) {
+        writer->failed = true;
+        return;
+    }
+    
+    // Names are held in the pool as a length byte followed by the bytes of the name.
+    size_t nameLength = strnlen(name ?: "", UINT8_MAX);
+    if (!ArchiveWriterGrow((void **)&writer->names, &writer->namesCapacity, writer->namesLength + (uint32_t)nameLength + 1, 1)) {
+        writer->failed = true;
+        return;
+    }
+    writer->names[writer->namesLength] = (char)nameLength;
+    memcpy(writer->names + writer->namesLength + 1, name ?: "", nameLength);
+    
+    if (!ArchiveWriterGrow((void **)&writer->resources, &writer->resourceCapacity, writer->resourceCount + 1, sizeof(*writer->resources))) {
+        writer->failed = true;
+        return;
+    }
+    
+    uint64_t offset = ARCHIVE_ALIGN(writer->position, ARCHIVE_DATA_ALIGNMENT);
+    if (size && !ArchiveWriterWriteAt(writer, data, size, offset)) {
+        return;
+    }
+    writer->position = offset + size;
+    
+    ArchiveWriterResource *entry = &writer->resources[writer->resourceCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->type = type;
+    entry->resource.dataOffset = offset;
+    entry->resource.size = size;
+    entry->resource.nameOffset = writer->namesLength + 1;
+    entry->resource.nameLength = (uint8_t)nameLength;
+    entry->resource.firstFrame = writer->frameCount;
+    entry->resource.id = id;
+    entry->resource.kind = ArchiveImageKind_None;
+    writer->namesLength += (uint32_t)nameLength + 1;
+    writer->types[type].resourceCount++;
+}
+
+void ArchiveWriterAddFrame(ArchiveWriter *writer, ArchiveImageKind kind, uint32_t defaultPixelFormat, uint32_t width, uint32_t height, size_t bytesPerPixel, const void *pixels, size_t stride)
+{
+    if (writer->failed || writer->resourceCount == 0) {
+        writer->failed = true;
+        return;
+    }
+    
+    if (!ArchiveWriterGrow((void **)&writer->frames, &writer->frameCapacity, writer->frameCount + 1, sizeof(*writer->frames))) {
+        writer->failed = true;
+        return;
+    }
+    
+    size_t rowLength = (size_t)width * bytesPerPixel;
+    size_t paddedStride = ARCHIVE_ALIGN(rowLength, ARCHIVE_ROW_ALIGNMENT);
+    uint64_t offset = ARCHIVE_ALIGN(writer->position, ARCHIVE_FRAME_ALIGNMENT);
+    
+    // Frames that are already laid out as they will be stored are written in one go, and
+    // any others are repacked a row at a time.
+    if (stride == paddedStride) {
+        if (!ArchiveWriterWriteAt(writer, pixels, paddedStride * height, offset)) {
+            return;
+        }
+    }
+    else {
+        for (uint32_t row = 0; row < height; ++row) {
+            if (!ArchiveWriterWriteAt(writer, (const uint8_t *)pixels + row * stride, rowLength, offset + row * paddedStride)) {
+                return;
+            }
+        }
+    }
+    writer->position = offset + paddedStride * height;
+    
+    ArchiveFrame *frame = &writer->frames[writer->frameCount++];
+    memset(frame, 0, sizeof(*frame));
+    frame->offset = offset;
+    frame->width = width;
+    frame->height = height;
+    frame->stride = (uint32_t)paddedStride;
+    
+    ArchiveResource *resource = &writer->resources[writer->resourceCount - 1].resource;
+    resource->frameCount++;
+    resource->kind = kind;
+    resource->defaultPixelFormat = (uint8_t)defaultPixelFormat;
+}
+
+static int ArchiveWriterCompareResources(const void *lhs, const void *rhs)
+{
+    const ArchiveWriterResource *a = lhs;
+    const ArchiveWriterResource *b = rhs;
+    if (a->type != b->type) {
+        return a->type < b->type ? -1 : 1;
+    }
+    return (a->resource.id > b->resource.id) - (a->resource.id < b->resource.id);
+}
+
+bool ArchiveWriterFinish(ArchiveWriter *writer)
+{
+    if (writer->failed || writer->fd < 0) {
+        return false;
+    }
+    
+    qsort(writer->resources, writer->resourceCount, sizeof(*writer->resources), ArchiveWriterCompareResources);
+    
+    uint32_t firstResource = 0;
+    for (uint32_t i = 0; i < writer->typeCount; ++i) {
+        writer->types[i].firstResource = firstResource;
+        firstResource += writer->types[i].resourceCount;
+    }
+    
+    uint64_t indexOffset = ARCHIVE_ALIGN(writer->position, ARCHIVE_PAGE_SIZE);
+    uint64_t offset = indexOffset;
+    for (uint32_t i = 0; i < writer->resourceCount; ++i) {
+        ArchiveWriterWriteAt(writer, &writer->resources[i].resource, sizeof(ArchiveResource), offset);
+        offset += sizeof(ArchiveResource);
+    }
+    ArchiveWriterWriteAt(writer, writer->types, writer->typeCount * sizeof(ArchiveType), offset);
+    offset += writer->typeCount * sizeof(ArchiveType);
+    ArchiveWriterWriteAt(writer, writer->frames, writer->frameCount * sizeof(ArchiveFrame), offset);
+    offset += writer->frameCount * sizeof(ArchiveFrame);
+    ArchiveWriterWriteAt(writer, writer->names, writer->namesLength, offset);
+    offset += writer->namesLength;
+    
+    // The header is written last, so an archive that failed part way is never valid.
+    ArchiveHeader header = {
+        .magic = ARCHIVE_MAGIC,
+        .version = ARCHIVE_VERSION,
+        .pageSize = ARCHIVE_PAGE_SIZE,
+        .pixelFormat = writer->pixelFormat,
+        .typeCount = writer->typeCount,
+        .resourceCount = writer->resourceCount,
+        .frameCount = writer->frameCount,
+        .namesLength = writer->namesLength,
+        .indexOffset = indexOffset,
+        .fileLength = offset,
+    };
+    ArchiveWriterWriteAt(writer, &header, sizeof(header), 0);
+    
+    // An archive with an empty index would otherwise stop short of the index offset.
+    if (!writer->failed && ftruncate(writer->fd, (off_t)offset) != 0) {
+        writer->failed = true;
+    }
+    
+    bool written = (close(writer->fd) == 0) && !writer->failed;
+    writer->fd = -1;
+    if (!written || rename(writer->temporaryPath, writer->path) != 0) {
+        unlink(writer->temporaryPath);
+        return false;
+    }
+    return true;
+}
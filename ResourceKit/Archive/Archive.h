@@ -0,0 +1,162 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_Archive_h
+#define ResourceKit_Archive_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ClassicMacTypes.h"
+
+/// An Archive is a baked copy of a set of resource files. Alongside the raw data of every
+/// resource it holds the already decoded pixels of each image, so that loading an image
+/// from it is nothing more than touching the pages it lives on.
+///
+/// The archive is laid out to be mapped directly:
+///
+///     page 0          ArchiveHeader
+///     page 1...       resource data and decoded frames
+///     page aligned    index: resources, types, frames, then the name pool
+///
+/// Raw data is aligned to 16 bytes and decoded frames to 64 bytes. Every row of a frame
+/// is padded to 16 bytes, which is the same layout as an RKPixelBuffer, so frames are
+/// wrapped in place rather than copied.
+///
+/// Pixels are only meaningful to the platform that decoded them, so all values are stored
+/// in host byte order and an archive is baked for the platform that loads it.
+
+/// How the decoded frames of a resource are assembled back into an object.
+typedef enum {
+    ArchiveImageKind_None = 0,
+    ArchiveImageKind_Picture = 1,
+    ArchiveImageKind_Sprites = 2,
+} ArchiveImageKind;
+
+/// The header at the start of an archive.
+typedef struct _ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageSize;
+    uint32_t pixelFormat;
+    uint32_t typeCount;
+    uint32_t resourceCount;
+    uint32_t frameCount;
+    uint32_t namesLength;
+    uint64_t indexOffset;
+    uint64_t fileLength;
+} ArchiveHeader;
+
+/// A resource type in the archive. The resources of each type are stored contiguously
+/// and sorted by id.
+typedef struct _ArchiveType {
+    char code[4];
+    uint32_t firstResource;
+    uint32_t resourceCount;
+} ArchiveType;
+
+/// A single resource in the archive. The data offset is an absolute offset into the
+/// archive, and the name offset is into the name pool at the end of the index. Resources
+/// with frames record the pixel format their parser produces when no format is requested,
+/// so that the frames are only used in its place when they are in that format.
+typedef struct _ArchiveResource {
+    uint64_t dataOffset;
+    uint32_t size;
+    uint32_t nameOffset;
+    uint32_t firstFrame;
+    uint32_t frameCount;
+    int16_t id;
+    uint8_t nameLength;
+    uint8_t kind;
+    uint8_t defaultPixelFormat;
+    uint8_t reserved[3];
+} ArchiveResource;
+
+/// A single decoded frame of an image, in the pixel format of the archive.
+typedef struct _ArchiveFrame {
+    uint64_t offset;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t reserved;
+} ArchiveFrame;
+
+/// A mapped and verified archive.
+typedef struct _Archive {
+    uint8_t *mapping;
+    size_t length;
+    const ArchiveHeader *header;
+    const ArchiveResource *resources;
+    const ArchiveType *types;
+    const ArchiveFrame *frames;
+    const char *names;
+} Archive;
+
+
+/// Map the archive at the specified path and verify its index. Returns NULL if the file
+/// is not an archive, was baked for a different platform, or is damaged.
+///
+/// The archive is mapped shared and read-only, so every process loading the same archive
+/// shares its pages with the others.
+Archive *ArchiveOpen(const char *path);
+
+/// Unmap the archive.
+void ArchiveClose(Archive *archive);
+
+/// Returns the type with the specified code, or NULL if the archive has none.
+const ArchiveType *ArchiveGetTypeForCode(const Archive *archive, RKFourCC code);
+
+/// Returns the resource of the specified type with the specified id, or NULL.
+const ArchiveResource *ArchiveGetResourceOfTypeWithId(const Archive *archive, const ArchiveType *type, int16_t id);
+
+
+/// An ArchiveWriter bakes an archive. Data and frames are written out as they are added,
+/// so only the index is held in memory.
+typedef struct _ArchiveWriter ArchiveWriter;
+
+/// Begin baking an archive to the specified path, holding frames in the specified pixel
+/// format. Nothing appears at the path until the archive has been finished.
+ArchiveWriter *ArchiveWriterCreate(const char *path, uint32_t pixelFormat);
+
+/// Discard the writer, along with the archive if it was never finished.
+void ArchiveWriterDestroy(ArchiveWriter *writer);
+
+/// Add a type to the archive, returning the index used to add resources of that type.
+uint32_t ArchiveWriterAddType(ArchiveWriter *writer, RKFourCC code);
+
+/// Add a resource of the specified type to the archive, copying its raw data. Names
+/// longer than 255 bytes are truncated.
+void ArchiveWriterAddResource(ArchiveWriter *writer, uint32_t type, int16_t id, const char *name, const void *data, uint32_t size);
+
+/// Add a decoded frame to the resource that was added most recently, and record how its
+/// frames are to be assembled and the pixel format its parser defaults to. Rows are read
+/// from the pixels at the specified stride and written padded to 16 bytes.
+void ArchiveWriterAddFrame(ArchiveWriter *writer, ArchiveImageKind kind, uint32_t defaultPixelFormat, uint32_t width, uint32_t height, size_t bytesPerPixel, const void *pixels, size_t stride);
+
+/// Write the index and move the archive into place. Returns false if anything that was
+/// added could not be written.
+bool ArchiveWriterFinish(ArchiveWriter *writer);
+
+#endif
@@ -0,0 +1,134 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <string.h>
+#include <libkern/OSByteOrder.h>
+
+#include "ContentHash.h"
+
+#pragma mark - Constants
+
+#define CONTENT_HASH_PRIME_1    0x9E3779B185EBCA87ull
+#define CONTENT_HASH_PRIME_2    0xC2B2AE3D27D4EB4Full
+#define CONTENT_HASH_PRIME_3    0x165667B19E3779F9ull
+#define CONTENT_HASH_PRIME_4    0x85EBCA77C2B2AE63ull
+#define CONTENT_HASH_PRIME_5    0x27D4EB2F165667C5ull
+
+
+#pragma mark - Helpers
+
+static inline uint64_t ContentHashRotate(uint64_t value, int count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+// Unaligned little endian reads. The hash is defined over little endian lanes, so that it
+// is the same on every machine.
+static inline uint64_t ContentHashRead64(const uint8_t *bytes)
+{
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return OSSwapLittleToHostInt64(value);
+}
+
+static inline uint32_t ContentHashRead32(const uint8_t *bytes)
+{
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return OSSwapLittleToHostInt32(value);
+}
+
+static inline uint64_t ContentHashRound(uint64_t accumulator, uint64_t lane)
+{
+    accumulator += lane * CONTENT_HASH_PRIME_2;
+    accumulator = ContentHashRotate(accumulator, 31);
+    return accumulator * CONTENT_HASH_PRIME_1;
+}
+
+static inline uint64_t ContentHashMergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= ContentHashRound(0, accumulator);
+    return hash * CONTENT_HASH_PRIME_1 + CONTENT_HASH_PRIME_4;
+}
+
+
+#pragma mark - Hashing
+
+uint64_t ContentHash(const void *bytes, size_t length, uint64_t seed)
+{
+    const uint8_t *input = bytes;
+    const uint8_t *end = input + length;
+    uint64_t hash;
+    
+    // Large payloads are consumed 32 bytes at a time by four independent accumulators,
+    // which keeps several multiplies in flight at once.
+    if (length >= 32) {
+        uint64_t v1 = seed + CONTENT_HASH_PRIME_1 + CONTENT_HASH_PRIME_2;
+        uint64_t v2 = seed + CONTENT_HASH_PRIME_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - CONTENT_HASH_PRIME_1;
+        const uint8_t *limit = end - 32;
+        do {
+            v1 = ContentHashRound(v1, ContentHashRead64(input));
+            v2 = ContentHashRound(v2, ContentHashRead64(input + 8));
+            v3 = ContentHashRound(v3, ContentHashRead64(input + 16));
+            v4 = ContentHashRound(v4, ContentHashRead64(input + 24));
+            input += 32;
+        } while (input <= limit);
+        
+        hash = ContentHashRotate(v1, 1) + ContentHashRotate(v2, 7) + ContentHashRotate(v3, 12) + ContentHashRotate(v4, 18);
+        hash = ContentHashMergeRound(hash, v1);
+        hash = ContentHashMergeRound(hash, v2);
+        hash = ContentHashMergeRound(hash, v3);
+        hash = ContentHashMergeRound(hash, v4);
+    }
+    else {
+        hash = seed + CONTENT_HASH_PRIME_5;
+    }
+    hash += (uint64_t)length;
+    
+    // The remaining bytes are folded in eight, then four, then one at a time.
+    while (input + 8 <= end) {
+        hash ^= ContentHashRound(0, ContentHashRead64(input));
+        hash = ContentHashRotate(hash, 27) * CONTENT_HASH_PRIME_1 + CONTENT_HASH_PRIME_4;
+        input += 8;
+    }
+    if (input + 4 <= end) {
+        hash ^= (uint64_t)ContentHashRead32(input) * CONTENT_HASH_PRIME_1;
+        hash = ContentHashRotate(hash, 23) * CONTENT_HASH_PRIME_2 + CONTENT_HASH_PRIME_3;
+        input += 4;
+    }
+    while (input < end) {
+        hash ^= (uint64_t)(*input++) * CONTENT_HASH_PRIME_5;
+        hash = ContentHashRotate(hash, 11) * CONTENT_HASH_PRIME_1;
+    }
+    
+    // A final avalanche spreads every input bit across the whole hash.
+    hash ^= hash >> 33;
+    hash *= CONTENT_HASH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= CONTENT_HASH_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,38 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_ContentHash_h
+#define ResourceKit_ContentHash_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Compute a 64-bit hash of the specified bytes, which is used to recognise resources
+/// with identical data without comparing the data itself. This is the XXH64 algorithm,
+/// which runs at several gigabytes a second and is well distributed in all 64 bits, so
+/// the chance of two different payloads sharing a hash is negligible. The seed selects an
+/// independent hash, so that identical bytes under different types can hash differently.
+uint64_t ContentHash(const void *bytes, size_t length, uint64_t seed);
+
+#endif
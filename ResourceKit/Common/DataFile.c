@@ -24,6 +24,10 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "DataFile.h"
 
@@ -143,3 +147,53 @@ void FileGetBytes(FILE *file, size_t count, void *bytes)
     assert(FileCanReadData(file, count));
     fread(bytes, sizeof(*bytes), count, file);
 }
+
+
+#pragma mark - Mapping
+
+int FileMap(const char *path, FileMapping *mapping)
+{
+    assert(path);
+    assert(mapping);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat info;
+    void *bytes = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        bytes = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    if (bytes == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+
+    // The descriptor is kept to check the length of the file before each read.
+    *mapping = (FileMapping){ bytes, (size_t)info.st_size, fd };
+    return 1;
+}
+
+int FileMappingCanReadData(const FileMapping *mapping, uint64_t offset, size_t count)
+{
+    assert(mapping);
+    if (!mapping->bytes || offset + count > mapping->length) {
+        return 0;
+    }
+
+    struct stat info;
+    return fstat(mapping->fd, &info) == 0 && (uint64_t)info.st_size >= offset + count;
+}
+
+void FileUnmap(FileMapping *mapping)
+{
+    assert(mapping);
+    if (mapping->bytes) {
+        munmap((void *)mapping->bytes, mapping->length);
+        close(mapping->fd);
+    }
+    *mapping = (FileMapping){ NULL, 0, -1 };
+}
@@ -81,4 +81,25 @@ uint8_t *FileReadData(FILE *file, size_t count);
 /// advance the cursor. Data will be read in an endian agnostic fashion.
 void FileGetBytes(FILE *file, size_t count, void *bytes);
 
+
+/// A read only mapping of the whole of a file. The file is kept open for as long as it is
+/// mapped, so that reads can be checked against its current length first.
+typedef struct FileMapping {
+    const uint8_t *bytes;
+    size_t length;
+    int fd;
+} FileMapping;
+
+/// Map the whole of the file at the specified path into memory, read only. Returns 0 if
+/// the file could not be mapped. The mapping must be released with FileUnmap.
+int FileMap(const char *path, FileMapping *mapping);
+
+/// Test to see if the specified range of a mapping can be read. A file that has been
+/// truncated since it was mapped no longer backs the pages past its end, and reading them
+/// raises SIGBUS, so this checks the range against the current length of the file.
+int FileMappingCanReadData(const FileMapping *mapping, uint64_t offset, size_t count);
+
+/// Release a mapping created by FileMap. Releasing an empty mapping has no effect.
+void FileUnmap(FileMapping *mapping);
+
 #endif
@@ -0,0 +1,461 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "IndexCache.h"
+
+#pragma mark - Cache Configuration
+
+#define INDEX_CACHE_MAGIC               0x524B4958  // 'RKIX'
+#define INDEX_CACHE_VERSION             1
+
+// The number of bytes from the start of a resource file that contribute to its key.
+#define INDEX_CACHE_HASHED_LENGTH       4096
+
+// Names are interned through a small open addressed table whilst writing.
+#define INDEX_CACHE_NAME_TABLE_MIN      64
+
+
+#pragma mark - Hashing
+
+static uint64_t IndexCacheHash(const void *bytes, size_t length)
+{
+    // 64-bit FNV-1a
+    const uint8_t *p = bytes;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ p[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+
+#pragma mark - Cache Keys
+
+bool IndexCacheKeyForFile(const char *path, IndexCacheKey *key)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat info;
+    uint8_t buffer[INDEX_CACHE_HASHED_LENGTH];
+    ssize_t length = -1;
+    if (fstat(fd, &info) == 0) {
+        length = pread(fd, buffer, sizeof(buffer), 0);
+    }
+    close(fd);
+    
+    if (length < 0) {
+        return false;
+    }
+    
+    memset(key, 0, sizeof(*key));
+    key->fileSize = (uint64_t)info.st_size;
+    key->mtimeSeconds = info.st_mtimespec.tv_sec;
+    key->mtimeNanoseconds = info.st_mtimespec.tv_nsec;
+    key->headerHash = IndexCacheHash(buffer, (size_t)length);
+    return true;
+}
+
+
+#pragma mark - Reading
+
+static bool IndexCacheVerify(const IndexCache *cache)
+{
+    const IndexCacheHeader *header = cache->header;
+    
+    // Every type must refer to resources that exist, and every resource must refer to a
+    // name in the pool and data that lies within the resource file.
+    uint64_t expectedResource = 0;
+    for (uint32_t i = 0; i < header->typeCount; ++i) {
+        const IndexCacheType *type = &cache->types[i];
+        if (type->firstResource != expectedResource || (uint64_t)type->firstResource + type->resourceCount > header->resourceCount) {
+            return false;
+        }
+        expectedResource += type->resourceCount;
+    }
+    if (expectedResource != header->resourceCount) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < header->resourceCount; ++i) {
+        const IndexCacheResource *resource = &cache->resources[i];
+        if ((uint64_t)resource->nameOffset + resource->nameLength > header->namesLength) {
+            return false;
+        }
+        else if (resource->dataOffset + resource->size > header->key.fileSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+IndexCache *IndexCacheOpen(const char *path, const IndexCacheKey *key)
+{
+    IndexCache *cache = NULL;
+    void *mapping = MAP_FAILED;
+    struct stat info;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(IndexCacheHeader)) {
+        goto INDEX_CACHE_OPEN_ERROR;
+    }
+    
+    size_t length = (size_t)info.st_size;
+    if ((mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        goto INDEX_CACHE_OPEN_ERROR;
+    }
+    
+    const IndexCacheHeader *header = mapping;
+    if (header->magic != INDEX_CACHE_MAGIC || header->version != INDEX_CACHE_VERSION) {
+        goto INDEX_CACHE_OPEN_ERROR;
+    }
+    else if (memcmp(&header->key, key, sizeof(*key)) != 0) {
+        goto INDEX_CACHE_OPEN_ERROR;
+    }
+    
+    uint64_t expectedLength = sizeof(IndexCacheHeader)
+                            + (uint64_t)header->resourceCount * sizeof(IndexCacheResource)
+                            + (uint64_t)header->typeCount * sizeof(IndexCacheType)
+                            + header->namesLength;
+    if (expectedLength != length) {
+        goto INDEX_CACHE_OPEN_ERROR;
+    }
+    
+    cache = calloc(1, sizeof(*cache));
+    cache->mapping = mapping;
+    cache->length = length;
+    cache->header = header;
+    cache->resources = (const IndexCacheResource *)(header + 1);
+    cache->types = (const IndexCacheType *)(cache->resources + header->resourceCount);
+    cache->names = (const char *)(cache->types + header->typeCount);
+    
+    if (!IndexCacheVerify(cache)) {
+        goto INDEX_CACHE_OPEN_ERROR;
+    }
+    
+    goto INDEX_CACHE_OPEN_DONE;
+    
+INDEX_CACHE_OPEN_ERROR:
+    if (mapping != MAP_FAILED) {
+        munmap(mapping, (size_t)info.st_size);
+    }
+    free(cache);
+    cache = NULL;
+    
+INDEX_CACHE_OPEN_DONE:
+    close(fd);
+    return cache;
+}
+
+void IndexCacheClose(IndexCache *cache)
+{
+    if (cache) {
+        munmap(cache->mapping, cache->length);
+        free(cache);
+    }
+}
+
+const IndexCacheType *IndexCacheGetTypeForCode(const IndexCache *cache, RKFourCC code)
+{
+    for (uint32_t i = 0; i < cache->header->typeCount; ++i) {
+        if (RKFourCCMake(cache->types[i].code) == code) {
+            return &cache->types[i];
+        }
+    }
+    return NULL;
+}
+
+const IndexCacheResource *IndexCacheGetResourceOfTypeWithId(const IndexCache *cache, const IndexCacheType *type, int16_t id)
+{
+    // Resources are sorted by id within their type.
+    const IndexCacheResource *resources = &cache->resources[type->firstResource];
+    uint32_t low = 0;
+    uint32_t high = type->resourceCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (resources[middle].id < id) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return (low < type->resourceCount && resources[low].id == id) ? &resources[low] : NULL;
+}
+
+
+#pragma mark - Writing
+
+typedef struct _IndexCacheWriterResource {
+    uint32_t type;
+    IndexCacheResource resource;
+} IndexCacheWriterResource;
+
+struct _IndexCacheWriter {
+    IndexCacheType *types;
+    uint32_t typeCount;
+    uint32_t typeCapacity;
+    
+    IndexCacheWriterResource *resources;
+    uint32_t resourceCount;
+    uint32_t resourceCapacity;
+    
+    char *names;
+    uint32_t namesLength;
+    uint32_t namesCapacity;
+    
+    // Interned names, as offsets into the pool plus one (so that zero is empty).
+    uint32_t *nameTable;
+    uint32_t nameTableCapacity;
+    uint32_t nameTableCount;
+    
+    bool failed;
+};
+
+static bool IndexCacheWriterGrow(void **array, uint32_t *capacity, uint32_t required, size_t elementSize)
+{
+    if (required <= *capacity) {
+        return true;
+    }
+    
+    uint32_t newCapacity = *capacity ?: 16;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    
+    void *newArray = realloc(*array, newCapacity * elementSize);
+    if (!newArray) {
+        return false;
+    }
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+IndexCacheWriter *IndexCacheWriterCreate(void)
+{
+    return calloc(1, sizeof(IndexCacheWriter));
+}
+
+void IndexCacheWriterDestroy(IndexCacheWriter *writer)
+{
+    if (writer) {
+        free(writer->types);
+        free(writer->resources);
+        free(writer->names);
+        free(writer->nameTable);
+        free(writer);
+    }
+}
+
+uint32_t IndexCacheWriterAddType(IndexCacheWriter *writer, RKFourCC code)
+{
+    if (!IndexCacheWriterGrow((void **)&writer->types, &writer->typeCapacity, writer->typeCount + 1, sizeof(*writer->types))) {
+        writer->failed = true;
+        return UINT32_MAX;
+    }
+    
+    IndexCacheType *type = &writer->types[writer->typeCount];
+    type->code[0] = (char)(code >> 24);
+    type->code[1] = (char)(code >> 16);
+    type->code[2] = (char)(code >> 8);
+    type->code[3] = (char)code;
+    type->firstResource = 0;
+    type->resourceCount = 0;
+    return writer->typeCount++;
+}
+
+static bool IndexCacheWriterGrowNameTable(IndexCacheWriter *writer)
+{
+    uint32_t capacity = writer->nameTableCapacity ? writer->nameTableCapacity * 2 : INDEX_CACHE_NAME_TABLE_MIN;
+    uint32_t *table = calloc(capacity, sizeof(*table));
+    if (!table) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < writer->nameTableCapacity; ++i) {
+        uint32_t entry = writer->nameTable[i];
+        if (entry == 0) {
+            continue;
+        }
+        const char *name = writer->names + entry - 1;
+        uint32_t slot = (uint32_t)IndexCacheHash(name + 1, (uint8_t)name[0]) & (capacity - 1);
+        while (table[slot]) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = entry;
+    }
+    
+    free(writer->nameTable);
+    writer->nameTable = table;
+    writer->nameTableCapacity = capacity;
+    return true;
+}
+
+// Names are held in the pool as a length byte followed by the bytes of the name. The
+// offset returned is that of the bytes themselves.
+static bool IndexCacheWriterInternName(IndexCacheWriter *writer, const char *name, uint8_t length, uint32_t *offset)
+{
+    if (writer->nameTableCount * 2 >= writer->nameTableCapacity && !IndexCacheWriterGrowNameTable(writer)) {
+        return false;
+    }
+    
+    uint32_t slot = (uint32_t)IndexCacheHash(name, length) & (writer->nameTableCapacity - 1);
+    while (writer->nameTable[slot]) {
+        const char *existing = writer->names + writer->nameTable[slot] - 1;
+        if ((uint8_t)existing[0] == length && memcmp(existing + 1, name, length) == 0) {
+            *offset = writer->nameTable[slot];
+            return true;
+        }
+        slot = (slot + 1) & (writer->nameTableCapacity - 1);
+    }
+    
+    if (!IndexCacheWriterGrow((void **)&writer->names, &writer->namesCapacity, writer->namesLength + length + 1, 1)) {
+        return false;
+    }
+    
+    writer->names[writer->namesLength] = (char)length;
+    memcpy(writer->names + writer->namesLength + 1, name, length);
+    writer->nameTable[slot] = writer->namesLength + 1;
+    writer->nameTableCount++;
+    
+    *offset = writer->namesLength + 1;
+    writer->namesLength += length + 1;
+    return true;
+}
+
+void IndexCacheWriterAddResource(IndexCacheWriter *writer, uint32_t type, int16_t id, const char *name, uint64_t dataOffset, uint32_t size)
+{
+    if (writer->failed || type >= writer->typeCount) {
+        writer->failed = true;
+        return;
+    }
+    
+    size_t nameLength = strnlen(name ?: "", UINT8_MAX);
+    uint32_t nameOffset = 0;
+    if (!IndexCacheWriterInternName(writer, name ?: "", (uint8_t)nameLength, &nameOffset)) {
+        writer->failed = true;
+        return;
+    }
+    
+    if (!IndexCacheWriterGrow((void **)&writer->resources, &writer->resourceCapacity, writer->resourceCount + 1, sizeof(*writer->resources))) {
+        writer->failed = true;
+        return;
+    }
+    
+    IndexCacheWriterResource *entry = &writer->resources[writer->resourceCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->type = type;
+    entry->resource.dataOffset = dataOffset;
+    entry->resource.size = size;
+    entry->resource.nameOffset = nameOffset;
+    entry->resource.nameLength = (uint8_t)nameLength;
+    entry->resource.id = id;
+    writer->types[type].resourceCount++;
+}
+
+static int IndexCacheWriterCompareResources(const void *lhs, const void *rhs)
+{
+    const IndexCacheWriterResource *a = lhs;
+    const IndexCacheWriterResource *b = rhs;
+    if (a->type != b->type) {
+        return a->type < b->type ? -1 : 1;
+    }
+    return (a->resource.id > b->resource.id) - (a->resource.id < b->resource.id);
+}
+
+bool IndexCacheWriterWrite(IndexCacheWriter *writer, const char *path, const IndexCacheKey *key)
+{
+    if (writer->failed) {
+        return false;
+    }
+    
+    qsort(writer->resources, writer->resourceCount, sizeof(*writer->resources), IndexCacheWriterCompareResources);
+    
+    uint32_t firstResource = 0;
+    for (uint32_t i = 0; i < writer->typeCount; ++i) {
+        writer->types[i].firstResource = firstResource;
+        firstResource += writer->types[i].resourceCount;
+    }
+    
+    IndexCacheHeader header = {
+        .magic = INDEX_CACHE_MAGIC,
+        .version = INDEX_CACHE_VERSION,
+        .key = *key,
+        .typeCount = writer->typeCount,
+        .resourceCount = writer->resourceCount,
+        .namesLength = writer->namesLength,
+    };
+    
+    // The temporary file is created with a unique name, so that writers racing to cache
+    // the same file, even from the same process, never write into each other's file.
+    // mkstemp creates it readable only by its owner, which is too strict for a cache.
+    char temporaryPath[1024];
+    if (snprintf(temporaryPath, sizeof(temporaryPath), "%s.XXXXXX", path) >= (int)sizeof(temporaryPath)) {
+        return false;
+    }
+    
+    int fd = mkstemp(temporaryPath);
+    if (fd < 0) {
+        return false;
+    }
+    FILE *handle = (fchmod(fd, 0644) == 0) ? fdopen(fd, "wb") : NULL;
+    if (!handle) {
+        close(fd);
+        unlink(temporaryPath);
+        return false;
+    }
+    
+    bool written = fwrite(&header, sizeof(header), 1, handle) == 1;
+    for (uint32_t i = 0; written && i < writer->resourceCount; ++i) {
+        written = fwrite(&writer->resources[i].resource, sizeof(IndexCacheResource), 1, handle) == 1;
+    }
+    if (written && writer->typeCount) {
+        written = fwrite(writer->types, sizeof(*writer->types), writer->typeCount, handle) == writer->typeCount;
+    }
+    if (written && writer->namesLength) {
+        written = fwrite(writer->names, 1, writer->namesLength, handle) == writer->namesLength;
+    }
+    
+    written = (fclose(handle) == 0) && written;
+    if (!written || rename(temporaryPath, path) != 0) {
+        unlink(temporaryPath);
+        return false;
+    }
+    return true;
+}
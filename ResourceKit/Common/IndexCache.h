@@ -0,0 +1,130 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_IndexCache_h
+#define ResourceKit_IndexCache_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ClassicMacTypes.h"
+
+/// An IndexCache is a compact, memory mappable copy of the resource map of a resource
+/// file. It is written alongside the file the first time the file is parsed, and on later
+/// opens is mapped and used directly rather than parsing the resource map again.
+///
+/// The cache is only ever read on the machine that wrote it, so all values are stored in
+/// host byte order.
+
+/// The values identifying the exact version of a resource file that a cache describes.
+/// A cache is only used when every one of these matches the file being opened.
+typedef struct _IndexCacheKey {
+    uint64_t fileSize;
+    int64_t mtimeSeconds;
+    int64_t mtimeNanoseconds;
+    uint64_t headerHash;
+} IndexCacheKey;
+
+/// The header at the start of a cache file.
+typedef struct _IndexCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    IndexCacheKey key;
+    uint32_t typeCount;
+    uint32_t resourceCount;
+    uint32_t namesLength;
+    uint32_t reserved;
+} IndexCacheHeader;
+
+/// A resource type in the cache. The resources of each type are stored contiguously and
+/// sorted by id.
+typedef struct _IndexCacheType {
+    char code[4];
+    uint32_t firstResource;
+    uint32_t resourceCount;
+} IndexCacheType;
+
+/// A single resource in the cache. The data offset is an absolute offset into the
+/// resource file. Names are stored once in a shared pool, so resources with the same name
+/// refer to the same bytes.
+typedef struct _IndexCacheResource {
+    uint64_t dataOffset;
+    uint32_t size;
+    uint32_t nameOffset;
+    int16_t id;
+    uint8_t nameLength;
+    uint8_t reserved[5];
+} IndexCacheResource;
+
+/// A mapped and verified cache.
+typedef struct _IndexCache {
+    void *mapping;
+    size_t length;
+    const IndexCacheHeader *header;
+    const IndexCacheType *types;
+    const IndexCacheResource *resources;
+    const char *names;
+} IndexCache;
+
+
+/// Determine the key of the resource file at the specified path. This uses the size and
+/// modification time of the file, and a hash of the first few kilobytes of it, which
+/// cover the headers of both the Rez and Ndat formats. Returns false if the file could not
+/// be read.
+bool IndexCacheKeyForFile(const char *path, IndexCacheKey *key);
+
+/// Map the cache at the specified path and verify it against the key. Returns NULL if the
+/// cache does not exist, was written for a different version of the file, or is damaged.
+IndexCache *IndexCacheOpen(const char *path, const IndexCacheKey *key);
+
+/// Unmap the cache.
+void IndexCacheClose(IndexCache *cache);
+
+/// Returns the type with the specified code, or NULL if the resource file has none.
+const IndexCacheType *IndexCacheGetTypeForCode(const IndexCache *cache, RKFourCC code);
+
+/// Returns the resource of the specified type with the specified id, or NULL.
+const IndexCacheResource *IndexCacheGetResourceOfTypeWithId(const IndexCache *cache, const IndexCacheType *type, int16_t id);
+
+
+/// An IndexCacheWriter collects the types and resources of a parsed resource file, and
+/// writes them out as a cache.
+typedef struct _IndexCacheWriter IndexCacheWriter;
+
+IndexCacheWriter *IndexCacheWriterCreate(void);
+void IndexCacheWriterDestroy(IndexCacheWriter *writer);
+
+/// Add a type to the cache, returning the index used to add resources of that type.
+uint32_t IndexCacheWriterAddType(IndexCacheWriter *writer, RKFourCC code);
+
+/// Add a resource of the specified type to the cache. Names longer than 255 bytes are
+/// truncated.
+void IndexCacheWriterAddResource(IndexCacheWriter *writer, uint32_t type, int16_t id, const char *name, uint64_t dataOffset, uint32_t size);
+
+/// Write the cache to the specified path. The cache is written to a temporary file first
+/// and then moved into place, so a reader will never map a partially written cache.
+bool IndexCacheWriterWrite(IndexCacheWriter *writer, const char *path, const IndexCacheKey *key);
+
+#endif
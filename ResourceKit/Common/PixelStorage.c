@@ -0,0 +1,189 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <os/lock.h>
+
+#include "PixelStorage.h"
+
+#pragma mark - Pool Configuration
+
+// Buckets start at 1KiB and double in size up to 64MiB. Anything larger than that is
+// allocated directly and freed as soon as it is released.
+#define PIXEL_STORAGE_MIN_BUCKET_SHIFT  10
+#define PIXEL_STORAGE_MAX_BUCKET_SHIFT  26
+#define PIXEL_STORAGE_BUCKET_COUNT      (PIXEL_STORAGE_MAX_BUCKET_SHIFT - PIXEL_STORAGE_MIN_BUCKET_SHIFT + 1)
+#define PIXEL_STORAGE_UNPOOLED          UINT32_MAX
+#define PIXEL_STORAGE_EXTERNAL          (UINT32_MAX - 1)
+
+// The number of unused blocks each bucket will hold on to before releasing them back to
+// the system.
+#define PIXEL_STORAGE_BUCKET_DEPTH      16
+
+// Storage headers and their bytes are carved from a single allocation. The bytes are
+// placed after the header at this alignment.
+#define PIXEL_STORAGE_ALIGNMENT         64
+#define PIXEL_STORAGE_HEADER_SIZE       ((sizeof(PixelStorage) + PIXEL_STORAGE_ALIGNMENT - 1) & ~(PIXEL_STORAGE_ALIGNMENT - 1))
+
+static struct {
+    os_unfair_lock lock;
+    PixelStorage *free[PIXEL_STORAGE_BUCKET_COUNT];
+    uint32_t count[PIXEL_STORAGE_BUCKET_COUNT];
+} PixelStoragePool = { OS_UNFAIR_LOCK_INIT };
+
+
+#pragma mark - Helpers
+
+static uint32_t PixelStorageBucketForSize(size_t size)
+{
+    uint32_t shift = PIXEL_STORAGE_MIN_BUCKET_SHIFT;
+    while (shift <= PIXEL_STORAGE_MAX_BUCKET_SHIFT && ((size_t)1 << shift) < size) {
+        ++shift;
+    }
+    return shift > PIXEL_STORAGE_MAX_BUCKET_SHIFT ? PIXEL_STORAGE_UNPOOLED : shift - PIXEL_STORAGE_MIN_BUCKET_SHIFT;
+}
+
+static PixelStorage *PixelStorageAllocate(size_t capacity, uint32_t bucket)
+{
+    void *block = NULL;
+    if (posix_memalign(&block, PIXEL_STORAGE_ALIGNMENT, PIXEL_STORAGE_HEADER_SIZE + capacity) != 0) {
+        return NULL;
+    }
+
+    PixelStorage *storage = block;
+    storage->bucket = bucket;
+    storage->capacity = capacity;
+    storage->bytes = (uint8_t *)block + PIXEL_STORAGE_HEADER_SIZE;
+    storage->next = NULL;
+    storage->releaseBytes = NULL;
+    storage->context = NULL;
+    return storage;
+}
+
+
+#pragma mark - Storage Lifecycle
+
+PixelStorage *PixelStorageCreate(size_t size)
+{
+    uint32_t bucket = PixelStorageBucketForSize(size);
+    PixelStorage *storage = NULL;
+
+    if (bucket != PIXEL_STORAGE_UNPOOLED) {
+        os_unfair_lock_lock(&PixelStoragePool.lock);
+        if ((storage = PixelStoragePool.free[bucket])) {
+            PixelStoragePool.free[bucket] = storage->next;
+            PixelStoragePool.count[bucket]--;
+            storage->next = NULL;
+        }
+        os_unfair_lock_unlock(&PixelStoragePool.lock);
+    }
+
+    if (!storage) {
+        size_t capacity = (bucket == PIXEL_STORAGE_UNPOOLED) ? size : (size_t)1 << (bucket + PIXEL_STORAGE_MIN_BUCKET_SHIFT);
+        if ((storage = PixelStorageAllocate(capacity, bucket)) == NULL) {
+            return NULL;
+        }
+    }
+
+    // Only the requested portion is cleared. Decoders never read beyond what they asked
+    // for, so there is no need to touch the remainder of the bucket.
+    memset(storage->bytes, 0, size);
+    atomic_init(&storage->retainCount, 1);
+    return storage;
+}
+
+PixelStorage *PixelStorageCreateWithBytes(uint8_t *bytes, size_t length, void (*releaseBytes)(void *context), void *context)
+{
+    assert(((uintptr_t)bytes & (PIXEL_STORAGE_ALIGNMENT - 1)) == 0);
+    
+    PixelStorage *storage = malloc(sizeof(PixelStorage));
+    if (!storage) {
+        return NULL;
+    }
+    
+    storage->bucket = PIXEL_STORAGE_EXTERNAL;
+    storage->capacity = length;
+    storage->bytes = bytes;
+    storage->next = NULL;
+    storage->releaseBytes = releaseBytes;
+    storage->context = context;
+    atomic_init(&storage->retainCount, 1);
+    return storage;
+}
+
+PixelStorage *PixelStorageRetain(PixelStorage *storage)
+{
+    assert(storage);
+    atomic_fetch_add_explicit(&storage->retainCount, 1, memory_order_relaxed);
+    return storage;
+}
+
+void PixelStorageRelease(PixelStorage *storage)
+{
+    if (!storage || atomic_fetch_sub_explicit(&storage->retainCount, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    uint32_t bucket = storage->bucket;
+    if (bucket == PIXEL_STORAGE_EXTERNAL) {
+        if (storage->releaseBytes) {
+            storage->releaseBytes(storage->context);
+        }
+    }
+    else if (bucket != PIXEL_STORAGE_UNPOOLED) {
+        os_unfair_lock_lock(&PixelStoragePool.lock);
+        if (PixelStoragePool.count[bucket] < PIXEL_STORAGE_BUCKET_DEPTH) {
+            storage->next = PixelStoragePool.free[bucket];
+            PixelStoragePool.free[bucket] = storage;
+            PixelStoragePool.count[bucket]++;
+            storage = NULL;
+        }
+        os_unfair_lock_unlock(&PixelStoragePool.lock);
+    }
+
+    free(storage);
+}
+
+void PixelStoragePoolDrain(void)
+{
+    PixelStorage *unused[PIXEL_STORAGE_BUCKET_COUNT];
+
+    os_unfair_lock_lock(&PixelStoragePool.lock);
+    for (uint32_t i = 0; i < PIXEL_STORAGE_BUCKET_COUNT; ++i) {
+        unused[i] = PixelStoragePool.free[i];
+        PixelStoragePool.free[i] = NULL;
+        PixelStoragePool.count[i] = 0;
+    }
+    os_unfair_lock_unlock(&PixelStoragePool.lock);
+
+    for (uint32_t i = 0; i < PIXEL_STORAGE_BUCKET_COUNT; ++i) {
+        while (unused[i]) {
+            PixelStorage *next = unused[i]->next;
+            free(unused[i]);
+            unused[i] = next;
+        }
+    }
+}
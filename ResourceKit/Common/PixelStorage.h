@@ -0,0 +1,85 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_PixelStorage_h
+#define ResourceKit_PixelStorage_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/// PixelStorage is a reference counted block of memory used to hold decoded image
+/// data. Storage is handed out from a process wide pool that is bucketed by size
+/// (powers of two), so that decoding many similarly sized sprites recycles the same
+/// few allocations rather than going back to the system allocator for each one.
+typedef struct _PixelStorage {
+
+    /// The number of owners of the storage. When this drops to zero the storage is
+    /// returned to the pool.
+    _Atomic(uint32_t) retainCount;
+
+    /// The index of the pool bucket that the storage belongs to, UINT32_MAX if the
+    /// storage was too large to be pooled, or UINT32_MAX - 1 if the bytes belong to
+    /// someone else.
+    uint32_t bucket;
+
+    /// The number of usable bytes in the storage. This will be at least the size that
+    /// was requested, rounded up to the size of the bucket.
+    size_t capacity;
+
+    /// The start of the usable bytes. This is always aligned to 64 bytes.
+    uint8_t *bytes;
+
+    /// Link to the next free storage block whilst the storage is sitting in the pool.
+    struct _PixelStorage *next;
+
+    /// For storage wrapping external bytes, the function that is called with the context
+    /// once the last owner has released the storage.
+    void (*releaseBytes)(void *context);
+    void *context;
+
+} PixelStorage;
+
+
+/// Acquire a block of storage with at least the specified number of bytes. The contents
+/// of the storage will be zeroed. The returned storage has a retain count of 1.
+PixelStorage *PixelStorageCreate(size_t size);
+
+/// Wrap bytes that are owned elsewhere, such as pixels in a mapped file, as storage. The
+/// bytes are not copied or cleared, and must be aligned to 64 bytes. Once the last owner
+/// has released the storage the release function is called with the context, and the
+/// storage itself is freed rather than pooled. The returned storage has a retain count of 1.
+PixelStorage *PixelStorageCreateWithBytes(uint8_t *bytes, size_t length, void (*releaseBytes)(void *context), void *context);
+
+/// Increment the retain count of the storage and return it.
+PixelStorage *PixelStorageRetain(PixelStorage *storage);
+
+/// Decrement the retain count of the storage. Once the last owner has released the
+/// storage it is returned to the pool for reuse.
+void PixelStorageRelease(PixelStorage *storage);
+
+/// Release all storage currently sitting unused in the pool back to the system.
+void PixelStoragePoolDrain(void);
+
+#endif
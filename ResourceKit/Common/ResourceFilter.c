@@ -0,0 +1,187 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#include <stdlib.h>
+#include <string.h>
+
+#include "ResourceFilter.h"
+
+#pragma mark - Filter Configuration
+
+// Ten bits and seven probes per resource give a false positive rate of about 1%. The bit
+// count is rounded up to a power of two, which only ever lowers the rate.
+#define RESOURCE_FILTER_BITS_PER_RESOURCE   10
+#define RESOURCE_FILTER_PROBE_COUNT         7
+#define RESOURCE_FILTER_MIN_BITS            64
+
+struct _ResourceFilter {
+    // The type codes of the file, kept sorted. Files rarely have more than a few dozen.
+    uint32_t *types;
+    uint32_t typeCount;
+    uint32_t typeCapacity;
+    
+    uint64_t *bits;
+    uint64_t bitMask;
+};
+
+
+#pragma mark - Helpers
+
+static inline uint64_t ResourceFilterHash(uint64_t key)
+{
+    // The splitmix64 finaliser. Keys of a single type differ only in their low bits, and
+    // every bit of the key needs to affect every bit of the hash.
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+// Each probe is derived from the two halves of a single hash (Kirsch and Mitzenmacher),
+// which does as well as independent hashes for a Bloom filter.
+static inline uint64_t ResourceFilterProbe(const ResourceFilter *filter, uint64_t hash, uint32_t probe)
+{
+    return ((uint32_t)hash + probe * ((hash >> 32) | 1)) & filter->bitMask;
+}
+
+// Finds the position of the type in the sorted types, or where it would be inserted.
+static uint32_t ResourceFilterTypePosition(const ResourceFilter *filter, uint32_t type)
+{
+    uint32_t lower = 0;
+    uint32_t upper = filter->typeCount;
+    while (lower < upper) {
+        uint32_t middle = lower + (upper - lower) / 2;
+        if (filter->types[middle] < type) {
+            lower = middle + 1;
+        }
+        else {
+            upper = middle;
+        }
+    }
+    return lower;
+}
+
+
+#pragma mark - Filter Lifecycle
+
+ResourceFilter *ResourceFilterCreate(uint32_t typeCount, uint32_t resourceCount)
+{
+    ResourceFilter *filter = calloc(1, sizeof(*filter));
+    if (!filter) {
+        return NULL;
+    }
+    
+    uint64_t bitCount = RESOURCE_FILTER_MIN_BITS;
+    while (bitCount < (uint64_t)resourceCount * RESOURCE_FILTER_BITS_PER_RESOURCE) {
+        bitCount <<= 1;
+    }
+    
+    filter->typeCapacity = typeCount ?: 1;
+    filter->types = malloc(sizeof(*filter->types) * filter->typeCapacity);
+    filter->bits = calloc((size_t)(bitCount / 64), sizeof(*filter->bits));
+    filter->bitMask = bitCount - 1;
+    if (!filter->types || !filter->bits) {
+        ResourceFilterDestroy(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+void ResourceFilterDestroy(ResourceFilter *filter)
+{
+    if (!filter) {
+        return;
+    }
+    free(filter->types);
+    free(filter->bits);
+    free(filter);
+}
+
+size_t ResourceFilterGetSize(const ResourceFilter *filter)
+{
+    return sizeof(*filter) + sizeof(*filter->types) * filter->typeCapacity + (size_t)(filter->bitMask + 1) / 8;
+}
+
+
+#pragma mark - Types
+
+bool ResourceFilterAddType(ResourceFilter *filter, uint32_t type)
+{
+    uint32_t position = ResourceFilterTypePosition(filter, type);
+    if (position < filter->typeCount && filter->types[position] == type) {
+        return true;
+    }
+    
+    if (filter->typeCount == filter->typeCapacity) {
+        uint32_t capacity = filter->typeCapacity * 2;
+        uint32_t *types = realloc(filter->types, sizeof(*types) * capacity);
+        if (!types) {
+            return false;
+        }
+        filter->types = types;
+        filter->typeCapacity = capacity;
+    }
+    
+    memmove(&filter->types[position + 1], &filter->types[position], sizeof(*filter->types) * (filter->typeCount - position));
+    filter->types[position] = type;
+    filter->typeCount++;
+    return true;
+}
+
+bool ResourceFilterContainsType(const ResourceFilter *filter, uint32_t type)
+{
+    uint32_t position = ResourceFilterTypePosition(filter, type);
+    return position < filter->typeCount && filter->types[position] == type;
+}
+
+
+#pragma mark - Resources
+
+bool ResourceFilterAddResource(ResourceFilter *filter, uint64_t key)
+{
+    if (!ResourceFilterAddType(filter, (uint32_t)(key >> 16))) {
+        return false;
+    }
+    
+    uint64_t hash = ResourceFilterHash(key);
+    for (uint32_t probe = 0; probe < RESOURCE_FILTER_PROBE_COUNT; ++probe) {
+        uint64_t bit = ResourceFilterProbe(filter, hash, probe);
+        filter->bits[bit / 64] |= 1ull << (bit % 64);
+    }
+    return true;
+}
+
+bool ResourceFilterMayContainResource(const ResourceFilter *filter, uint64_t key)
+{
+    if (!ResourceFilterContainsType(filter, (uint32_t)(key >> 16))) {
+        return false;
+    }
+    
+    uint64_t hash = ResourceFilterHash(key);
+    for (uint32_t probe = 0; probe < RESOURCE_FILTER_PROBE_COUNT; ++probe) {
+        uint64_t bit = ResourceFilterProbe(filter, hash, probe);
+        if ((filter->bits[bit / 64] & (1ull << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
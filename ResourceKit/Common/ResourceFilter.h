@@ -0,0 +1,64 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#ifndef ResourceKit_ResourceFilter_h
+#define ResourceKit_ResourceFilter_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/// A ResourceFilter records which resources a single file contains, in a fraction of the
+/// memory its resource map needs. It holds the set of type codes of the file, and a Bloom
+/// filter over the index keys (see ResourceIndexKey) of its resources. A filter never
+/// reports a resource the file has as missing, but may report a resource the file does not
+/// have as present, about one time in a hundred, so a file can be skipped without looking
+/// at its map whenever the filter says no.
+typedef struct _ResourceFilter ResourceFilter;
+
+
+/// Create a new, empty filter sized for the specified number of types and resources.
+/// Adding more than that still works, but makes false positives more likely.
+ResourceFilter *ResourceFilterCreate(uint32_t typeCount, uint32_t resourceCount);
+
+/// Destroy the filter, releasing all of its memory.
+void ResourceFilterDestroy(ResourceFilter *filter);
+
+/// Returns the number of bytes of memory held by the filter.
+size_t ResourceFilterGetSize(const ResourceFilter *filter);
+
+/// Add a type code to the filter. Returns false if the type could not be added, in which
+/// case the filter should not be used.
+bool ResourceFilterAddType(ResourceFilter *filter, uint32_t type);
+
+/// Add the resource with the specified index key to the filter. Its type is added as well.
+bool ResourceFilterAddResource(ResourceFilter *filter, uint64_t key);
+
+/// Returns whether the file has any resources of the specified type. This is exact.
+bool ResourceFilterContainsType(const ResourceFilter *filter, uint32_t type);
+
+/// Returns false if the file certainly does not contain the resource with the specified
+/// index key, and true if it might.
+bool ResourceFilterMayContainResource(const ResourceFilter *filter, uint64_t key);
+
+#endif
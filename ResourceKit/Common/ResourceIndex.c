@@ -0,0 +1,245 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ResourceIndex.h"
+
+#pragma mark - Table Configuration
+
+// Keys only ever use the low 48 bits, so an all ones key can never be a real resource and
+// is used to mark empty slots.
+#define RESOURCE_INDEX_EMPTY_KEY        UINT64_MAX
+
+// The table is kept at most half full, which keeps probe sequences short.
+#define RESOURCE_INDEX_MIN_CAPACITY     16
+#define RESOURCE_INDEX_MAX_LOAD(c)      ((c) / 2)
+
+struct _ResourceIndex {
+    uint64_t *keys;
+    uint32_t *values;
+    uint32_t capacity;
+    uint32_t count;
+};
+
+
+#pragma mark - Helpers
+
+static inline uint32_t ResourceIndexSlotForKey(uint64_t key, uint32_t capacity)
+{
+    // Fibonacci hashing spreads the ids of a single type, which are usually consecutive,
+    // across the whole table. The capacity is always a power of two.
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+static bool ResourceIndexAllocate(ResourceIndex *index, uint32_t capacity)
+{
+    uint64_t *keys = malloc(sizeof(*keys) * capacity);
+    uint32_t *values = malloc(sizeof(*values) * capacity);
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return false;
+    }
+    
+    memset(keys, 0xFF, sizeof(*keys) * capacity);
+    index->keys = keys;
+    index->values = values;
+    index->capacity = capacity;
+    return true;
+}
+
+static bool ResourceIndexResize(ResourceIndex *index, uint32_t capacity)
+{
+    uint64_t *oldKeys = index->keys;
+    uint32_t *oldValues = index->values;
+    uint32_t oldCapacity = index->capacity;
+    
+    if (!ResourceIndexAllocate(index, capacity)) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < oldCapacity; ++i) {
+        if (oldKeys[i] == RESOURCE_INDEX_EMPTY_KEY) {
+            continue;
+        }
+        uint32_t slot = ResourceIndexSlotForKey(oldKeys[i], capacity);
+        while (index->keys[slot] != RESOURCE_INDEX_EMPTY_KEY) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        index->keys[slot] = oldKeys[i];
+        index->values[slot] = oldValues[i];
+    }
+    
+    free(oldKeys);
+    free(oldValues);
+    return true;
+}
+
+
+#pragma mark - Index Lifecycle
+
+ResourceIndex *ResourceIndexCreate(uint32_t capacity)
+{
+    ResourceIndex *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    
+    if (!ResourceIndexReserve(index, capacity)) {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+void ResourceIndexDestroy(ResourceIndex *index)
+{
+    if (!index) {
+        return;
+    }
+    free(index->keys);
+    free(index->values);
+    free(index);
+}
+
+ResourceIndex *ResourceIndexCopy(const ResourceIndex *index, uint32_t additional)
+{
+    ResourceIndex *copy = calloc(1, sizeof(*copy));
+    if (!copy) {
+        return NULL;
+    }
+    
+    // A copy at the same capacity keeps every key in the same slot, so the tables can be
+    // copied wholesale. It is only grown afterwards if it has to be.
+    if (!ResourceIndexAllocate(copy, index->capacity)) {
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy->keys, index->keys, sizeof(*copy->keys) * index->capacity);
+    memcpy(copy->values, index->values, sizeof(*copy->values) * index->capacity);
+    copy->count = index->count;
+    
+    if (!ResourceIndexReserve(copy, additional)) {
+        ResourceIndexDestroy(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+
+#pragma mark - Entries
+
+uint32_t ResourceIndexGetCount(const ResourceIndex *index)
+{
+    return index->count;
+}
+
+bool ResourceIndexReserve(ResourceIndex *index, uint32_t additional)
+{
+    uint64_t required = (uint64_t)index->count + additional;
+    uint64_t capacity = index->capacity ?: RESOURCE_INDEX_MIN_CAPACITY;
+    while (RESOURCE_INDEX_MAX_LOAD(capacity) < required) {
+        capacity <<= 1;
+    }
+    
+    if (capacity > UINT32_MAX) {
+        return false;
+    }
+    else if (capacity == index->capacity) {
+        return true;
+    }
+    return index->keys ? ResourceIndexResize(index, (uint32_t)capacity) : ResourceIndexAllocate(index, (uint32_t)capacity);
+}
+
+bool ResourceIndexInsert(ResourceIndex *index, uint64_t key, uint32_t value, uint32_t *previous)
+{
+    if (!ResourceIndexReserve(index, 1)) {
+        return false;
+    }
+    
+    uint32_t slot = ResourceIndexSlotForKey(key, index->capacity);
+    while (index->keys[slot] != RESOURCE_INDEX_EMPTY_KEY) {
+        if (index->keys[slot] == key) {
+            if (previous) {
+                *previous = index->values[slot];
+            }
+            index->values[slot] = value;
+            return true;
+        }
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    
+    index->keys[slot] = key;
+    index->values[slot] = value;
+    index->count++;
+    return false;
+}
+
+bool ResourceIndexLookup(const ResourceIndex *index, uint64_t key, uint32_t *value)
+{
+    uint32_t slot = ResourceIndexSlotForKey(key, index->capacity);
+    while (index->keys[slot] != RESOURCE_INDEX_EMPTY_KEY) {
+        if (index->keys[slot] == key) {
+            if (value) {
+                *value = index->values[slot];
+            }
+            return true;
+        }
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return false;
+}
+
+bool ResourceIndexRemove(ResourceIndex *index, uint64_t key, uint32_t *value)
+{
+    uint32_t mask = index->capacity - 1;
+    uint32_t slot = ResourceIndexSlotForKey(key, index->capacity);
+    while (index->keys[slot] != key) {
+        if (index->keys[slot] == RESOURCE_INDEX_EMPTY_KEY) {
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (value) {
+        *value = index->values[slot];
+    }
+    
+    // Rather than leaving a tombstone, later keys in the same run are shifted back into the
+    // hole whenever their home slot does not lie between the hole and where they are now,
+    // so lookups still stop at the first empty slot.
+    uint32_t hole = slot;
+    for (uint32_t next = (hole + 1) & mask; index->keys[next] != RESOURCE_INDEX_EMPTY_KEY; next = (next + 1) & mask) {
+        uint32_t home = ResourceIndexSlotForKey(index->keys[next], index->capacity);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->keys[hole] = index->keys[next];
+            index->values[hole] = index->values[next];
+            hole = next;
+        }
+    }
+    index->keys[hole] = RESOURCE_INDEX_EMPTY_KEY;
+    index->count--;
+    return true;
+}
@@ -0,0 +1,84 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_ResourceIndex_h
+#define ResourceKit_ResourceIndex_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// A ResourceIndex is an open addressed hash table mapping a resource, identified by its
+/// packed type code and id, to a 32-bit value chosen by the owner of the index. It is
+/// used to merge the resources of many files into a single lookup, where a resource added
+/// later replaces any earlier resource with the same type and id.
+typedef struct _ResourceIndex ResourceIndex;
+
+/// Pack a four character type code and resource id into a single index key.
+static inline uint64_t ResourceIndexKey(uint32_t type, int16_t id)
+{
+    return ((uint64_t)type << 16) | (uint16_t)id;
+}
+
+/// Returns the type code of the specified index key.
+static inline uint32_t ResourceIndexKeyType(uint64_t key)
+{
+    return (uint32_t)(key >> 16);
+}
+
+/// Returns the resource id of the specified index key.
+static inline int16_t ResourceIndexKeyId(uint64_t key)
+{
+    return (int16_t)(uint16_t)key;
+}
+
+
+/// Create a new, empty index with room for at least the specified number of entries.
+ResourceIndex *ResourceIndexCreate(uint32_t capacity);
+
+/// Destroy the index, releasing all of its memory.
+void ResourceIndexDestroy(ResourceIndex *index);
+
+/// Create a copy of the index with room for at least the specified number of additional
+/// entries. The copy shares nothing with the original.
+ResourceIndex *ResourceIndexCopy(const ResourceIndex *index, uint32_t additional);
+
+/// Returns the number of entries in the index.
+uint32_t ResourceIndexGetCount(const ResourceIndex *index);
+
+/// Ensure that the specified number of additional entries can be added to the index
+/// without it needing to grow.
+bool ResourceIndexReserve(ResourceIndex *index, uint32_t additional);
+
+/// Add the value for the specified key, replacing any existing value. If a value was
+/// replaced then true is returned and the old value is written to previous (if provided).
+bool ResourceIndexInsert(ResourceIndex *index, uint64_t key, uint32_t value, uint32_t *previous);
+
+/// Look up the value of the specified key. Returns false if the key is not in the index.
+bool ResourceIndexLookup(const ResourceIndex *index, uint64_t key, uint32_t *value);
+
+/// Remove the specified key from the index. Returns false if the key is not in the index,
+/// otherwise its value is written to value (if provided).
+bool ResourceIndexRemove(ResourceIndex *index, uint64_t key, uint32_t *value);
+
+#endif
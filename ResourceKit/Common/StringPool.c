@@ -0,0 +1,183 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "StringPool.h"
+
+#pragma mark - Pool Configuration
+
+#define STRING_POOL_INITIAL_CAPACITY    1024
+#define STRING_POOL_MIN_SLOTS           64
+
+// Slots hold the offset of a string plus one, leaving zero free to mark an empty slot.
+#define STRING_POOL_EMPTY_SLOT          0
+
+
+#pragma mark - Helpers
+
+static inline uint32_t StringPoolHash(const char *bytes, size_t length)
+{
+    // FNV-1a, which is plenty for strings of at most a few hundred bytes.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t)bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool StringPoolReserveBytes(StringPool *pool, size_t additional)
+{
+    size_t required = (size_t)pool->length + additional;
+    if (required <= pool->capacity) {
+        return true;
+    }
+    else if (required > UINT32_MAX) {
+        return false;
+    }
+    
+    size_t capacity = pool->capacity ?: STRING_POOL_INITIAL_CAPACITY;
+    while (capacity < required) {
+        capacity <<= 1;
+    }
+    capacity = capacity > UINT32_MAX ? UINT32_MAX : capacity;
+    
+    char *bytes = realloc(pool->bytes, capacity);
+    if (!bytes) {
+        return false;
+    }
+    pool->bytes = bytes;
+    pool->capacity = (uint32_t)capacity;
+    return true;
+}
+
+static bool StringPoolReserveSlots(StringPool *pool)
+{
+    // The table is kept at most half full.
+    if (pool->slots && pool->stringCount + 1 <= pool->slotCount / 2) {
+        return true;
+    }
+    
+    uint32_t slotCount = pool->slotCount ? pool->slotCount << 1 : STRING_POOL_MIN_SLOTS;
+    uint32_t *slots = calloc(slotCount, sizeof(*slots));
+    if (!slots) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < pool->slotCount; ++i) {
+        if (pool->slots[i] == STRING_POOL_EMPTY_SLOT) {
+            continue;
+        }
+        const char *string = pool->bytes + pool->slots[i] - 1;
+        uint32_t slot = StringPoolHash(string, strlen(string)) & (slotCount - 1);
+        while (slots[slot] != STRING_POOL_EMPTY_SLOT) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = pool->slots[i];
+    }
+    
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slotCount = slotCount;
+    return true;
+}
+
+
+#pragma mark - Pool Lifecycle
+
+bool StringPoolInit(StringPool *pool)
+{
+    memset(pool, 0, sizeof(*pool));
+    if (!StringPoolReserveBytes(pool, 1)) {
+        return false;
+    }
+    
+    // The empty string.
+    pool->bytes[pool->length++] = '\0';
+    return true;
+}
+
+void StringPoolFree(StringPool *pool)
+{
+    free(pool->bytes);
+    free(pool->slots);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void StringPoolFinish(StringPool *pool)
+{
+    free(pool->slots);
+    pool->slots = NULL;
+    pool->slotCount = 0;
+    
+    char *bytes = realloc(pool->bytes, pool->length);
+    if (bytes) {
+        pool->bytes = bytes;
+        pool->capacity = pool->length;
+    }
+}
+
+
+#pragma mark - Strings
+
+uint32_t StringPoolAdd(StringPool *pool, const char *bytes, size_t length)
+{
+    // Names are read from fixed size fields, so stop at the first zero byte.
+    length = strnlen(bytes, length);
+    if (length == 0 || !pool->bytes) {
+        return 0;
+    }
+    
+    uint32_t hash = StringPoolHash(bytes, length);
+    uint32_t slot = 0;
+    if (pool->slots || pool->stringCount == 0) {
+        if (!StringPoolReserveSlots(pool)) {
+            return 0;
+        }
+        slot = hash & (pool->slotCount - 1);
+        while (pool->slots[slot] != STRING_POOL_EMPTY_SLOT) {
+            const char *string = pool->bytes + pool->slots[slot] - 1;
+            if (strncmp(string, bytes, length) == 0 && string[length] == '\0') {
+                return pool->slots[slot] - 1;
+            }
+            slot = (slot + 1) & (pool->slotCount - 1);
+        }
+    }
+    
+    if (!StringPoolReserveBytes(pool, length + 1)) {
+        return 0;
+    }
+    
+    uint32_t offset = pool->length;
+    memcpy(pool->bytes + offset, bytes, length);
+    pool->bytes[offset + length] = '\0';
+    pool->length += (uint32_t)length + 1;
+    
+    if (pool->slots) {
+        pool->slots[slot] = offset + 1;
+    }
+    pool->stringCount++;
+    return offset;
+}
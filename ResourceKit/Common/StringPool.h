@@ -0,0 +1,74 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_StringPool_h
+#define ResourceKit_StringPool_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/// A StringPool stores the names of the resources in a file back to back in a single
+/// buffer. Each string is referred to by its offset into the buffer, and identical
+/// strings are only stored once so that two resources with the same name also share the
+/// same offset. Every string is followed by a zero byte, so an offset can be used directly
+/// as a C string.
+///
+/// The empty string is always at offset 0, and costs nothing to add.
+typedef struct _StringPool {
+    char *bytes;
+    uint32_t length;
+    uint32_t capacity;
+    
+    /// An open addressed table of the offsets of each string, used to find strings that
+    /// have already been added. It is released once the pool is finished with.
+    uint32_t *slots;
+    uint32_t slotCount;
+    uint32_t stringCount;
+} StringPool;
+
+
+/// Prepare an empty pool. Returns false if the pool could not be allocated.
+bool StringPoolInit(StringPool *pool);
+
+/// Release all of the memory of the pool.
+void StringPoolFree(StringPool *pool);
+
+/// Add the specified string to the pool, returning its offset. If an identical string is
+/// already in the pool then its offset is returned instead. Returns 0, the offset of the
+/// empty string, if the pool could not be grown.
+uint32_t StringPoolAdd(StringPool *pool, const char *bytes, size_t length);
+
+/// Called once every string has been added to the pool. This releases the lookup table
+/// and trims the buffer down to the strings it contains. Strings can still be added
+/// afterwards, but will no longer be shared with identical strings.
+void StringPoolFinish(StringPool *pool);
+
+/// Returns the string at the specified offset.
+static inline const char *StringPoolGetString(const StringPool *pool, uint32_t offset)
+{
+    return pool->bytes + offset;
+}
+
+#endif
@@ -48,6 +48,11 @@ NdatResourceFile *NdatOpenFile(const char *restrict path)
     NdatResourceFile *file = New(sizeof(*file));
     file->path = NewString(path);
     
+    if ( !StringPoolInit(&file->names) ) {
+        fprintf(stderr, "*** Failed to allocate the names of the ndat file: %s\n", file->path);
+        goto NDAT_OPEN_FILE_ERROR;
+    }
+    
     errno = 0;
     if ( (file->handle = fopen(file->path, "r")) == NULL ) {
         fprintf(stderr, "*** Failed to open ndat file (code: %d): %s\n", errno, file->path);
@@ -61,6 +66,7 @@ NdatResourceFile *NdatOpenFile(const char *restrict path)
         fprintf(stderr, "*** Failed to parse resource map for ndat file: %s\n", file->path);
         goto NDAT_OPEN_FILE_ERROR;
     }
+    StringPoolFinish(&file->names);
     
     goto NDAT_OPEN_FILE_DONE;
     
@@ -76,6 +82,7 @@ void NdatCloseFile(NdatResourceFile *file)
 {
     if (file) {
         fclose(file->handle);
+        StringPoolFree(&file->names);
         free((void *)file->path);
         free(file);
     }
@@ -188,6 +195,7 @@ NdatType *ParseNdatResourceType(NdatResourceFile *file)
     
     NdatType *type = New(sizeof(*type));
     FileGetBytes(file->handle, 4, (void *)type->code);
+    type->fourCC = RKFourCCMake(type->code);
     type->resourceCount = FileReadWord(file->handle, DataBigEndian) + 1;
     type->resourceListOffset = FileReadWord(file->handle, DataBigEndian);
     
@@ -230,7 +238,10 @@ NdatResource *ParseNdatResource(NdatResourceFile *file)
         fpos_t currentOffset = FileGetCursorPosition(file->handle);
         FileSetCursorPosition(file->handle, nameListOffset + nameOffset);
         uint8_t length = FileReadByte(file->handle, DataBigEndian);
-        FileGetBytes(file->handle, length, (void *)resource->name);
+        char name[UINT8_MAX];
+        FileGetBytes(file->handle, length, name);
+        resource->nameOffset = StringPoolAdd(&file->names, name, length);
+        resource->nameLength = (uint8_t)strnlen(name, length);
         FileSetCursorPosition(file->handle, currentOffset);
     }
     
@@ -269,24 +280,23 @@ NdatType *NdatGetResourceTypeAtIndex(NdatResourceFile *file, int32_t index)
     return type;
 }
 
-NdatType *NdatGetResourceTypeForCode(NdatResourceFile *file, const char *code)
+NdatType *NdatGetResourceTypeForCode(NdatResourceFile *file, RKFourCC code)
 {
     assert(file);
-    assert(code);
     
     NdatType *type = file->types;
-    while (type && strncmp(type->code, code, 4) != 0) {
+    while (type && type->fourCC != code) {
         type = type->next;
     }
     return type;
 }
 
-NdatResource *NdatGetResourceHeaderOfTypeAtIndex(NdatResourceFile *file, const char *typeCode, int32_t index)
+NdatResource *NdatGetResourceHeaderOfTypeAtIndex(NdatResourceFile *file, RKFourCC typeCode, int32_t index)
 {
     assert(file);
     
     NdatType *type = NdatGetResourceTypeForCode(file, typeCode);
-    if (index >= type->resourceCount || index < 0) {
+    if (!type || index >= type->resourceCount || index < 0) {
         return NULL;
     }
     
@@ -300,13 +310,12 @@ NdatResource *NdatGetResourceHeaderOfTypeAtIndex(NdatResourceFile *file, const c
     return resource;
 }
 
-NdatResource *NdatGetResourceHeaderOfTypeAtId(NdatResourceFile *file, const char *typeCode, int16_t id)
+NdatResource *NdatGetResourceHeaderOfTypeAtId(NdatResourceFile *file, RKFourCC typeCode, int16_t id)
 {
     assert(file);
-    assert(typeCode);
     
     NdatType *type = NdatGetResourceTypeForCode(file, typeCode);
-    NdatResource *resource = type->resources;
+    NdatResource *resource = type ? type->resources : NULL;
     while (resource) {
         if (resource->id == id) {
             break;
@@ -317,13 +326,26 @@ NdatResource *NdatGetResourceHeaderOfTypeAtId(NdatResourceFile *file, const char
     return resource;
 }
 
-void NdatGetResourceDataOfTypeAndId(NdatResourceFile *file, const char *type, int16_t id, uint8_t **dst, size_t *size)
+const char *NdatGetResourceName(NdatResourceFile *file, NdatResource *resource)
+{
+    assert(file);
+    assert(resource);
+    
+    return StringPoolGetString(&file->names, resource->nameOffset);
+}
+
+void NdatGetResourceDataOfTypeAndId(NdatResourceFile *file, RKFourCC type, int16_t id, uint8_t **dst, size_t *size)
 {
     assert(dst);
     assert(file);
     assert(size);
     
     NdatResource *resource = NdatGetResourceHeaderOfTypeAtId(file, type, id);
+    if (!resource) {
+        *dst = NULL;
+        *size = 0;
+        return;
+    }
     *dst = calloc(resource->size, sizeof(**dst));
     *size = resource->size;
     
@@ -26,6 +26,8 @@
 #define ResourceKit_Ndat_h
 
 #include "DataFile.h"
+#include "ClassicMacTypes.h"
+#include "StringPool.h"
 
 /// The Ndat Attributes denote information about the data of a particular resource.
 /// This is information on how the data should be handled by the program reading
@@ -61,6 +63,7 @@ typedef struct _NdatHeader {
 typedef struct _NdatType {
     struct _NdatType *next;
     char code[5];
+    RKFourCC fourCC;
     uint16_t resourceCount;
     uint16_t resourceListOffset;
     struct _NdatResource *resources;
@@ -68,10 +71,11 @@ typedef struct _NdatType {
 
 /// The Ndat resource structure contains information about a particular resource
 /// instance. It contains information such as the id, name and the offset of
-/// the resource data.
+/// the resource data. The name is kept in the names pool of the owning file.
 typedef struct _NdatResource {
     struct _NdatResource *next;
-    char name[256];
+    uint32_t nameOffset;
+    uint8_t nameLength;
     int16_t id;
     uint8_t attributes;
     uint32_t dataOffset;
@@ -90,6 +94,7 @@ typedef struct _Ndat {
     int16_t nameListOffset;
     int16_t typeCount;
     NdatType *types;
+    StringPool names;
 } NdatResourceFile;
 
 
@@ -104,9 +109,10 @@ NdatResourceFile *NdatOpenFile(const char *restrict path);
 void NdatCloseFile(NdatResourceFile *file);
 
 NdatType *NdatGetResourceTypeAtIndex(NdatResourceFile *file, int32_t index);
-NdatType *NdatGetResourceTypeForCode(NdatResourceFile *file, const char *code);
-NdatResource *NdatGetResourceHeaderOfTypeAtIndex(NdatResourceFile *file, const char *typeCode, int32_t index);
-NdatResource *NdatGetResourceHeaderOfTypeAtId(NdatResourceFile *file, const char *typeCode, int16_t id);
-void NdatGetResourceDataOfTypeAndId(NdatResourceFile *file, const char *type, int16_t id, uint8_t **dst, size_t *size);
+NdatType *NdatGetResourceTypeForCode(NdatResourceFile *file, RKFourCC code);
+NdatResource *NdatGetResourceHeaderOfTypeAtIndex(NdatResourceFile *file, RKFourCC typeCode, int32_t index);
+NdatResource *NdatGetResourceHeaderOfTypeAtId(NdatResourceFile *file, RKFourCC typeCode, int16_t id);
+const char *NdatGetResourceName(NdatResourceFile *file, NdatResource *resource);
+void NdatGetResourceDataOfTypeAndId(NdatResourceFile *file, RKFourCC type, int16_t id, uint8_t **dst, size_t *size);
 
 #endif /* Ndat_h */
@@ -0,0 +1,69 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/// A file watcher calls its handler whenever one of the files it watches changes on disk.
+/// Each file is watched by a dispatch vnode source, so the kernel reports writes, renames
+/// and deletions as they happen, and nothing is read until then. Files that can not be
+/// opened for events, or that have been removed and not yet replaced, are polled instead.
+///
+/// A file is only reported once its size, modification date or inode differs from when it
+/// was last reported, and events are coalesced for a short latency first, so a file that
+/// is written in several steps or saved by replacing it is reported once. Files that no
+/// longer exist are not reported until they are back.
+///
+/// All methods are safe to call from any thread.
+@interface RKFileWatcher : NSObject
+
+/// Instantiates a watcher that calls the handler with the path of each changed file. The
+/// handler is called on the specified queue, or on a global queue if none is given.
+- (nonnull instancetype)initWithQueue:(nullable dispatch_queue_t)queue
+                              handler:(nonnull void (^)(NSString *_Nonnull filePath))handler;
+
+/// Whether files are always polled instead of being watched by the kernel. This only
+/// affects files that are watched after it is set. Defaults to NO.
+@property (atomic) BOOL usesPolling;
+
+/// The interval, in seconds, at which polled files are checked. Defaults to one second.
+@property (atomic) NSTimeInterval pollingInterval;
+
+/// The time, in seconds, to wait after an event before checking the file, so that bursts
+/// of events are reported together. Defaults to a tenth of a second.
+@property (atomic) NSTimeInterval latency;
+
+/// The paths of every file being watched.
+@property (nonnull, readonly) NSArray <NSString *> *watchedFilePaths;
+
+/// Start watching the file at the specified path. Watching a file that is already being
+/// watched has no effect.
+- (void)watchFileAtPath:(nonnull NSString *)filePath;
+
+/// Stop watching the file at the specified path.
+- (void)stopWatchingFileAtPath:(nonnull NSString *)filePath;
+
+/// Stop watching every file.
+- (void)stopWatchingAllFiles;
+
+@end
@@ -0,0 +1,302 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKFileWatcher.h"
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+// The parts of the status of a file that tell whether it has changed. A file that was
+// saved by replacing it has a new inode even if its size and date happen to match.
+typedef struct {
+    BOOL exists;
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec modified;
+} RKFileSignature;
+
+static RKFileSignature RKFileSignatureOfFileAtPath(NSString *filePath)
+{
+    RKFileSignature signature = { 0 };
+    struct stat info;
+    if (stat(filePath.fileSystemRepresentation, &info) == 0) {
+        signature.exists = YES;
+        signature.device = info.st_dev;
+        signature.inode = info.st_ino;
+        signature.size = info.st_size;
+        signature.modified = info.st_mtimespec;
+    }
+    return signature;
+}
+
+static BOOL RKFileSignatureEqual(RKFileSignature lhs, RKFileSignature rhs)
+{
+    return lhs.exists == rhs.exists && lhs.device == rhs.device && lhs.inode == rhs.inode && lhs.size == rhs.size
+        && lhs.modified.tv_sec == rhs.modified.tv_sec && lhs.modified.tv_nsec == rhs.modified.tv_nsec;
+}
+
+
+#pragma mark - Watched Files
+
+// The state of a single watched file. It is only ever touched on the queue of the watcher.
+@interface RKWatchedFile : NSObject {
+@public
+    NSString *_path;
+    RKFileSignature _signature;
+    dispatch_source_t _source;
+    BOOL _polled;
+    BOOL _checkScheduled;
+}
+@end
+
+@implementation RKWatchedFile
+@end
+
+
+@implementation RKFileWatcher {
+@private
+    dispatch_queue_t _queue;
+    dispatch_queue_t _handlerQueue;
+    void (^_handler)(NSString *);
+    NSMutableDictionary <NSString *, RKWatchedFile *> *_files;
+    dispatch_source_t _pollTimer;
+}
+
+#pragma mark - Constructors
+
+- (nonnull instancetype)initWithQueue:(nullable dispatch_queue_t)queue
+                              handler:(nonnull void (^)(NSString *_Nonnull filePath))handler
+{
+    if (self = [super init]) {
+        _queue = dispatch_queue_create("com.resourcekit.file-watcher", DISPATCH_QUEUE_SERIAL);
+        _handlerQueue = queue ?: dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+        _handler = [handler copy];
+        _files = [NSMutableDictionary new];
+        _pollingInterval = 1.0;
+        _latency = 0.1;
+    }
+    return self;
+}
+
+
+#pragma mark - Destruction
+
+- (void)dealloc
+{
+    for (RKWatchedFile *file in _files.allValues) {
+        if (file->_source) {
+            dispatch_source_cancel(file->_source);
+        }
+    }
+    if (_pollTimer) {
+        dispatch_source_cancel(_pollTimer);
+    }
+}
+
+
+#pragma mark - Watching Files
+
+- (NSArray<NSString *> *)watchedFilePaths
+{
+    __block NSArray <NSString *> *paths = nil;
+    dispatch_sync(_queue, ^{
+        paths = self->_files.allKeys;
+    });
+    return paths;
+}
+
+- (void)watchFileAtPath:(nonnull NSString *)filePath
+{
+    dispatch_sync(_queue, ^{
+        if (self->_files[filePath]) {
+            return;
+        }
+        
+        RKWatchedFile *file = [RKWatchedFile new];
+        file->_path = filePath.copy;
+        file->_signature = RKFileSignatureOfFileAtPath(filePath);
+        self->_files[filePath] = file;
+        [self armWatchedFile:file];
+    });
+}
+
+- (void)stopWatchingFileAtPath:(nonnull NSString *)filePath
+{
+    dispatch_sync(_queue, ^{
+        RKWatchedFile *file = self->_files[filePath];
+        if (file) {
+            [self disarmWatchedFile:file];
+            [self->_files removeObjectForKey:filePath];
+            [self updatePollTimer];
+        }
+    });
+}
+
+- (void)stopWatchingAllFiles
+{
+    dispatch_sync(_queue, ^{
+        for (RKWatchedFile *file in self->_files.allValues) {
+            [self disarmWatchedFile:file];
+        }
+        [self->_files removeAllObjects];
+        [self updatePollTimer];
+    });
+}
+
+
+#pragma mark - Sources
+
+// Watches the file with a vnode source, falling back to polling if it can not be opened.
+- (void)armWatchedFile:(RKWatchedFile *)file
+{
+    file->_polled = YES;
+    int fd = self.usesPolling ? -1 : open(file->_path.fileSystemRepresentation, O_EVTONLY);
+    if (fd >= 0) {
+        unsigned long mask = DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_ATTRIB
+                           | DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME | DISPATCH_VNODE_REVOKE;
+        dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, (uintptr_t)fd, mask, _queue);
+        if (source) {
+            __weak RKFileWatcher *weakSelf = self;
+            __weak RKWatchedFile *weakFile = file;
+            dispatch_source_set_event_handler(source, ^{
+                RKFileWatcher *watcher = weakSelf;
+                RKWatchedFile *watchedFile = weakFile;
+                if (!watcher || !watchedFile || watchedFile->_source != source) {
+                    return;
+                }
+                
+                // Once the file has been moved or removed the source is watching a file
+                // that is no longer at the path, so it is dropped and the path is armed
+                // again when the file is checked.
+                if (dispatch_source_get_data(source) & (DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME | DISPATCH_VNODE_REVOKE)) {
+                    [watcher disarmWatchedFile:watchedFile];
+                }
+                [watcher scheduleCheckOfWatchedFile:watchedFile];
+            });
+            dispatch_source_set_cancel_handler(source, ^{
+                close(fd);
+            });
+            file->_source = source;
+            file->_polled = NO;
+            dispatch_resume(source);
+        }
+        else {
+            close(fd);
+        }
+    }
+    [self updatePollTimer];
+}
+
+- (void)disarmWatchedFile:(RKWatchedFile *)file
+{
+    if (file->_source) {
+        dispatch_source_cancel(file->_source);
+        file->_source = nil;
+    }
+    file->_polled = NO;
+}
+
+// Runs a single timer for every polled file, for as long as there are any.
+- (void)updatePollTimer
+{
+    BOOL polling = NO;
+    for (RKWatchedFile *file in _files.allValues) {
+        polling = polling || file->_polled;
+    }
+    
+    if (polling && !_pollTimer) {
+        uint64_t interval = (uint64_t)(MAX(self.pollingInterval, 0.01) * NSEC_PER_SEC);
+        _pollTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+        dispatch_source_set_timer(_pollTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+        
+        __weak RKFileWatcher *weakSelf = self;
+        dispatch_source_set_event_handler(_pollTimer, ^{
+            RKFileWatcher *watcher = weakSelf;
+            if (!watcher) {
+                return;
+            }
+            for (RKWatchedFile *file in watcher->_files.allValues) {
+                if (file->_polled) {
+                    [watcher checkWatchedFile:file];
+                }
+            }
+        });
+        dispatch_resume(_pollTimer);
+    }
+    else if (!polling && _pollTimer) {
+        dispatch_source_cancel(_pollTimer);
+        _pollTimer = nil;
+    }
+}
+
+
+#pragma mark - Checking Files
+
+- (void)scheduleCheckOfWatchedFile:(RKWatchedFile *)file
+{
+    if (file->_checkScheduled) {
+        return;
+    }
+    
+    file->_checkScheduled = YES;
+    __weak RKFileWatcher *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.latency * NSEC_PER_SEC)), _queue, ^{
+        file->_checkScheduled = NO;
+        [weakSelf checkWatchedFile:file];
+    });
+}
+
+- (void)checkWatchedFile:(RKWatchedFile *)file
+{
+    if (_files[file->_path] != file) {
+        return;
+    }
+    
+    // A file that lost its source, or that is polled only because it could not be opened,
+    // is watched by the kernel again as soon as it can be.
+    RKFileSignature signature = RKFileSignatureOfFileAtPath(file->_path);
+    if (!file->_source && signature.exists && !self.usesPolling) {
+        [self disarmWatchedFile:file];
+        [self armWatchedFile:file];
+    }
+    else if (!file->_source && !file->_polled) {
+        file->_polled = YES;
+        [self updatePollTimer];
+    }
+    
+    if (RKFileSignatureEqual(signature, file->_signature)) {
+        return;
+    }
+    file->_signature = signature;
+    if (signature.exists) {
+        void (^handler)(NSString *) = _handler;
+        NSString *path = file->_path;
+        dispatch_async(_handlerQueue, ^{
+            handler(path);
+        });
+    }
+}
+
+@end
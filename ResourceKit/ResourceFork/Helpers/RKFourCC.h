@@ -0,0 +1,35 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "ClassicMacTypes.h"
+
+/// Returns the four character code of the specified type string. Type strings are
+/// encoded as Mac OS Roman, so that types such as "rlëD" pack to the same value as the
+/// raw bytes in a resource file. Returns 0 if the string is not a valid type code. As
+/// every invalid string has the same code, lookups of the code 0 never find anything.
+FOUNDATION_EXPORT RKFourCC RKFourCCFromString(NSString * _Nonnull string);
+
+/// Returns the type string for the specified four character code.
+FOUNDATION_EXPORT NSString * _Nonnull NSStringFromFourCC(RKFourCC code);
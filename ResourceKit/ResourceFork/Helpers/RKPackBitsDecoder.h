@@ -29,3 +29,8 @@
 + (NSData *)decodeData:(NSData *)packedData withValueSize:(uint32_t)valueSize;
 
 @end
+
+/// Decode a run of PackBits data directly into the supplied buffer, without producing
+/// any intermediate objects. Decoding stops when either the source is exhausted or the
+/// destination is full. Returns the number of bytes written to the destination.
+FOUNDATION_EXPORT size_t RKPackBitsDecode(const uint8_t *src, size_t srcLength, uint8_t *dst, size_t dstCapacity, uint32_t valueSize);
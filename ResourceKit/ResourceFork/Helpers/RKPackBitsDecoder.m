@@ -58,3 +58,35 @@
 }
 
 @end
+
+
+size_t RKPackBitsDecode(const uint8_t *src, size_t srcLength, uint8_t *dst, size_t dstCapacity, uint32_t valueSize)
+{
+    size_t in = 0;
+    size_t out = 0;
+    
+    while (in < srcLength && out < dstCapacity) {
+        uint8_t count = src[in++];
+        
+        if (count < 128) {
+            // A literal run of values.
+            size_t run = MIN((size_t)(1 + count) * valueSize, MIN(srcLength - in, dstCapacity - out));
+            memcpy(dst + out, src + in, run);
+            in += (1 + count) * valueSize;
+            out += run;
+        }
+        else {
+            // A single value repeated.
+            if (in + valueSize > srcLength) {
+                break;
+            }
+            for (uint32_t i = 256 - count + 1; i > 0 && out + valueSize <= dstCapacity; --i) {
+                memcpy(dst + out, src + in, valueSize);
+                out += valueSize;
+            }
+            in += valueSize;
+        }
+    }
+    
+    return out;
+}
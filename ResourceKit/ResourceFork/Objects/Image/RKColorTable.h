@@ -0,0 +1,51 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/// The number of entries in every color table.
+#define RKColorTableCapacity 256
+
+/// An RKColorTable is the palette used by indexed pixel buffers. Tables are immutable
+/// once created, which allows a single table to be shared between every image that uses
+/// it.
+@interface RKColorTable : NSObject
+
+/// The number of colors that were defined when the table was created. Any remaining
+/// entries of the table are black.
+@property (readonly) NSUInteger count;
+
+/// The entries of the table as RKColorTableCapacity consecutive RGBA 8888 values.
+@property (nonnull, readonly) const uint8_t *entries;
+
+/// An indexed CoreGraphics color space that uses the table.
+@property (nonnull, readonly) CGColorSpaceRef colorSpace;
+
+/// The standard 256 color palette of the classic Mac OS, used by 8-bit sprites.
++ (nonnull instancetype)standardColorTable;
+
+/// Create a new color table from the specified RGBA 8888 values.
++ (nonnull instancetype)colorTableWithEntries:(nonnull const uint8_t *)entries count:(NSUInteger)count;
+
+@end
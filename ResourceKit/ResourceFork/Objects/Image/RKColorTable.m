@@ -0,0 +1,124 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKColorTable.h"
+#import <CoreGraphics/CoreGraphics.h>
+
+@implementation RKColorTable {
+@private
+    uint8_t _entries[RKColorTableCapacity * 4];
+    CGColorSpaceRef _colorSpace;
+    dispatch_once_t _colorSpaceOnceToken;
+}
+
+#pragma mark - Creation
+
++ (instancetype)standardColorTable
+{
+    static RKColorTable *table = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        uint8_t entries[RKColorTableCapacity * 4];
+        uint8_t *p = entries;
+        
+        // The first 215 entries are a 6x6x6 color cube running from white down to black,
+        // with red changing the slowest.
+        for (int i = 0; i < 215; ++i) {
+            *p++ = (5 - i / 36) * 0x33;
+            *p++ = (5 - (i / 6) % 6) * 0x33;
+            *p++ = (5 - i % 6) * 0x33;
+            *p++ = UINT8_MAX;
+        }
+        
+        // They are followed by ramps of red, green, blue and grey using the intensities that
+        // are missing from the cube, and finally black.
+        static const uint8_t ramp[10] = { 0xEE, 0xDD, 0xBB, 0xAA, 0x88, 0x77, 0x55, 0x44, 0x22, 0x11 };
+        for (int component = 0; component < 4; ++component) {
+            for (int i = 0; i < 10; ++i) {
+                *p++ = (component == 0 || component == 3) ? ramp[i] : 0;
+                *p++ = (component == 1 || component == 3) ? ramp[i] : 0;
+                *p++ = (component == 2 || component == 3) ? ramp[i] : 0;
+                *p++ = UINT8_MAX;
+            }
+        }
+        
+        *p++ = 0; *p++ = 0; *p++ = 0; *p++ = UINT8_MAX;
+        
+        table = [self colorTableWithEntries:entries count:RKColorTableCapacity];
+    });
+    return table;
+}
+
++ (instancetype)colorTableWithEntries:(const uint8_t *)entries count:(NSUInteger)count
+{
+    return [[self alloc] initWithEntries:entries count:count];
+}
+
+- (instancetype)initWithEntries:(const uint8_t *)entries count:(NSUInteger)count
+{
+    if (self = [super init]) {
+        _count = MIN(count, RKColorTableCapacity);
+        memcpy(_entries, entries, _count * 4);
+        
+        for (NSUInteger i = _count; i < RKColorTableCapacity; ++i) {
+            _entries[i * 4 + 3] = UINT8_MAX;
+        }
+    }
+    return self;
+}
+
+
+#pragma mark - Destruction
+
+- (void)dealloc
+{
+    CGColorSpaceRelease(_colorSpace);
+}
+
+
+#pragma mark - Accessors
+
+- (const uint8_t *)entries
+{
+    return _entries;
+}
+
+- (CGColorSpaceRef)colorSpace
+{
+    dispatch_once(&_colorSpaceOnceToken, ^{
+        // Indexed color spaces take a packed table of the base color space components,
+        // which for RGB means dropping the alpha of each entry.
+        uint8_t rgb[RKColorTableCapacity * 3];
+        for (NSUInteger i = 0; i < RKColorTableCapacity; ++i) {
+            memcpy(rgb + i * 3, self->_entries + i * 4, 3);
+        }
+        
+        CGColorSpaceRef base = CGColorSpaceCreateDeviceRGB();
+        self->_colorSpace = CGColorSpaceCreateIndexed(base, RKColorTableCapacity - 1, rgb);
+        CGColorSpaceRelease(base);
+    });
+    return _colorSpace;
+}
+
+@end
@@ -0,0 +1,187 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class RKColorTable;
+
+/// The layout of the pixels stored in an RKPixelBuffer.
+typedef NS_ENUM(uint32_t, RKPixelFormat)
+{
+    /// 8 bits per component, premultiplied alpha, stored R G B A in memory.
+    RKPixelFormat_RGBA8888,
+    
+    /// 8 bits per component, premultiplied alpha, stored B G R A in memory.
+    RKPixelFormat_BGRA8888,
+    
+    /// A 16-bit host endian value with 5 bits of red, 6 of green and 5 of blue. There is
+    /// no alpha, so transparent pixels become black.
+    RKPixelFormat_RGB565,
+    
+    /// A 16-bit host endian value with 5 bits each of red, green and blue, followed by a
+    /// single bit of alpha in the least significant bit. Pixels with an alpha of 0x80 or
+    /// more are stored opaque in their straight color, and anything less as transparent.
+    RKPixelFormat_RGBA5551,
+    
+    /// An 8-bit index into the color table of the buffer. Transparency is held in an
+    /// optional 1-bit mask alongside the indices. The colors are only looked up when the
+    /// buffer is drawn.
+    RKPixelFormat_Indexed8,
+};
+
+/// Returns whether the value is one of the pixel formats above.
+FOUNDATION_EXPORT BOOL RKPixelFormatIsValid(RKPixelFormat format);
+
+/// Returns the number of bytes a single pixel occupies in the specified format, or 0 if
+/// the format is not valid.
+FOUNDATION_EXPORT size_t RKPixelFormatBytesPerPixel(RKPixelFormat format);
+
+/// Returns the pixel format requested by the value of RKResourceParserOptionPixelFormat,
+/// or nil if the value is nil. Anything that is not a number holding a valid format is
+/// treated as a request for RKPixelFormat_RGBA8888.
+FOUNDATION_EXPORT NSNumber * _Nullable RKPixelFormatFromParserOption(id _Nullable value);
+
+/// The greatest number of levels a mipmapped pixel buffer can have. This is enough for
+/// a chain all the way down to 1x1 from the largest possible buffer.
+#define RKPixelBufferMaxLevels 32
+
+
+/// An RKPixelBuffer is the common destination for all of the image decoders in
+/// ResourceKit. Decoders write straight into the buffer's storage, which is taken from
+/// a size-bucketed pool and reference counted so that it can be shared with CoreGraphics
+/// without being copied.
+@interface RKPixelBuffer : NSObject
+
+/// The width of the buffer in pixels.
+@property (readonly) uint32_t width;
+
+/// The height of the buffer in pixels.
+@property (readonly) uint32_t height;
+
+/// The size of the buffer in pixels.
+@property (readonly) CGSize size;
+
+/// The number of bytes between the start of one row and the start of the next.
+@property (readonly) size_t stride;
+
+/// The layout of the pixels in the buffer.
+@property (readonly) RKPixelFormat format;
+
+/// The raw pixel storage of the receiver.
+@property (nonnull, readonly) uint8_t *bytes;
+
+/// The number of bytes of storage held by the buffer, including its mask and any mip
+/// levels.
+@property (readonly) size_t byteLength;
+
+/// The palette used to look up the colors of an indexed buffer.
+@property (nullable, readonly) RKColorTable *colorTable;
+
+/// The transparency mask of an indexed buffer, if it has one. The mask holds one bit per
+/// pixel, most significant bit first, set for each pixel that is opaque.
+@property (nullable, readonly) uint8_t *maskBytes;
+
+/// The number of bytes between the start of one row of the mask and the start of the next.
+@property (readonly) size_t maskStride;
+
+/// A CGImage that wraps the storage of the receiver. The image is only created the
+/// first time it is requested, and shares the storage of the buffer rather than copying
+/// it. For this reason the buffer should not be written to once the image has been
+/// requested.
+///
+/// CoreGraphics is unable to represent the 16-bit formats, so for those the image is
+/// backed by a separate RGBA 8888 expansion of the buffer instead.
+@property (nullable, readonly) CGImageRef imageValue;
+
+/// The number of levels in the buffer. This is 1 unless the buffer was created as
+/// mipmapped, in which case it covers every level down to 1x1. Level 0 is the buffer
+/// itself, and each further level is half the size of the one before it, rounded down.
+@property (readonly) uint32_t levelCount;
+
+/// Create a new pixel buffer of the specified dimensions. The contents of the buffer
+/// will be zeroed (fully transparent). Returns nil if the format is not valid.
++ (nullable instancetype)pixelBufferWithWidth:(uint32_t)width
+                                       height:(uint32_t)height
+                                       format:(RKPixelFormat)format;
+
+/// Create a new pixel buffer of the specified dimensions, optionally with room for a
+/// complete mip chain. The levels are stored contiguously after the base level in the
+/// same storage, and are only filled in when -generateMipmaps is called.
+///
+/// Indexed buffers can not be averaged, and so are never mipmapped.
++ (nullable instancetype)pixelBufferWithWidth:(uint32_t)width
+                                       height:(uint32_t)height
+                                       format:(RKPixelFormat)format
+                                   mipmapped:(BOOL)mipmapped;
+
+/// Create a pixel buffer around pixels that have already been decoded elsewhere, such as
+/// those in a baked archive. The pixels are not copied, must be aligned to 64 bytes, and
+/// should not be written to. The owner of the pixels is kept alive for as long as the
+/// buffer, or any image created from it, is still using them. Indexed formats can not be
+/// wrapped in this way.
++ (nullable instancetype)pixelBufferWithBytes:(nonnull uint8_t *)bytes
+                                        width:(uint32_t)width
+                                       height:(uint32_t)height
+                                       stride:(size_t)stride
+                                       format:(RKPixelFormat)format
+                                        owner:(nonnull id)owner;
+
+/// Create a new indexed pixel buffer of the specified dimensions that uses the specified
+/// color table. Every index will be zero, and if the buffer is masked every pixel will
+/// start out transparent.
++ (nullable instancetype)indexedPixelBufferWithWidth:(uint32_t)width
+                                              height:(uint32_t)height
+                                          colorTable:(nonnull RKColorTable *)colorTable
+                                              masked:(BOOL)masked;
+
+/// Returns a pointer to the first pixel of the specified row.
+- (nonnull uint8_t *)rowAtIndex:(uint32_t)row;
+
+/// Returns a pointer to the first byte of the specified row of the mask. This is only
+/// valid for masked buffers.
+- (nonnull uint8_t *)maskRowAtIndex:(uint32_t)row;
+
+/// Returns the width in pixels of the specified level.
+- (uint32_t)widthOfLevel:(uint32_t)level;
+
+/// Returns the height in pixels of the specified level.
+- (uint32_t)heightOfLevel:(uint32_t)level;
+
+/// Returns the number of bytes between rows of the specified level.
+- (size_t)strideOfLevel:(uint32_t)level;
+
+/// Returns a pointer to the first pixel of the specified level.
+- (nonnull uint8_t *)bytesOfLevel:(uint32_t)level;
+
+/// Returns a CGImage that wraps the storage of the specified level, under the same rules
+/// as imageValue. Level 0 returns imageValue itself.
+- (nullable CGImageRef)imageValueForLevel:(uint32_t)level;
+
+/// Fill in every level after the first by averaging each 2x2 block of the level above
+/// it. As the buffer already holds premultiplied values the averages need no further
+/// correction for alpha. Call this once the base level has been written, and before any
+/// image is requested.
+- (void)generateMipmaps;
+
+@end
@@ -0,0 +1,380 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKPixelBuffer.h"
+#import "RKPixelConverter.h"
+#import "RKColorTable.h"
+#import "PixelStorage.h"
+#import <CoreGraphics/CoreGraphics.h>
+
+#pragma mark - Pixel Formats
+
+BOOL RKPixelFormatIsValid(RKPixelFormat format)
+{
+    return format <= RKPixelFormat_Indexed8;
+}
+
+size_t RKPixelFormatBytesPerPixel(RKPixelFormat format)
+{
+    if (format == RKPixelFormat_Indexed8) {
+        return 1;
+    }
+    const RKPixelConverter *converter = RKPixelConverterForFormat(format);
+    return converter ? converter->bytesPerPixel : 0;
+}
+
+NSNumber *RKPixelFormatFromParserOption(id value)
+{
+    if (value == nil) {
+        return nil;
+    }
+    if (![value isKindOfClass:NSNumber.class] || !RKPixelFormatIsValid([value unsignedIntValue])) {
+        return @(RKPixelFormat_RGBA8888);
+    }
+    return value;
+}
+
+
+#pragma mark - Data Provider Callbacks
+
+// CoreGraphics calls this once the last image referencing the storage has been
+// destroyed. The storage was retained on behalf of the provider when it was created.
+static void RKPixelBufferReleaseProviderData(void *info, const void *data __unused, size_t size __unused)
+{
+    PixelStorageRelease(info);
+}
+
+// Called once the last owner of storage wrapping external pixels has released it.
+static void RKPixelBufferReleaseExternalOwner(void *context)
+{
+    CFRelease(context);
+}
+
+
+#pragma mark - Levels
+
+// The placement of a single level within the storage of a buffer.
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    size_t stride;
+    size_t offset;
+} RKPixelBufferLevel;
+
+
+@implementation RKPixelBuffer {
+@private
+    PixelStorage *_storage;
+    RKPixelBufferLevel _levels[RKPixelBufferMaxLevels];
+    CGImageRef _images[RKPixelBufferMaxLevels];
+}
+
+#pragma mark - Creation
+
++ (nullable instancetype)pixelBufferWithWidth:(uint32_t)width height:(uint32_t)height format:(RKPixelFormat)format
+{
+    return [[self alloc] initWithWidth:width height:height format:format colorTable:nil masked:NO mipmapped:NO];
+}
+
++ (nullable instancetype)pixelBufferWithWidth:(uint32_t)width height:(uint32_t)height format:(RKPixelFormat)format mipmapped:(BOOL)mipmapped
+{
+    return [[self alloc] initWithWidth:width height:height format:format colorTable:nil masked:NO mipmapped:mipmapped];
+}
+
++ (nullable instancetype)indexedPixelBufferWithWidth:(uint32_t)width height:(uint32_t)height colorTable:(RKColorTable *)colorTable masked:(BOOL)masked
+{
+    return [[self alloc] initWithWidth:width height:height format:RKPixelFormat_Indexed8 colorTable:colorTable masked:masked mipmapped:NO];
+}
+
+- (nullable instancetype)initWithWidth:(uint32_t)width height:(uint32_t)height format:(RKPixelFormat)format colorTable:(RKColorTable *)colorTable masked:(BOOL)masked mipmapped:(BOOL)mipmapped
+{
+    if (!RKPixelFormatIsValid(format)) {
+        return nil;
+    }
+    
+    if (self = [super init]) {
+        _width = width;
+        _height = height;
+        _format = format;
+        _colorTable = colorTable;
+        
+        size_t bytesPerPixel = RKPixelFormatBytesPerPixel(format);
+        
+        // Rows are padded out to 16 bytes so that every row starts on a vector boundary.
+        _stride = ((size_t)width * bytesPerPixel + 15) & ~(size_t)15;
+        
+        // The mask of an indexed buffer lives in the same storage, directly after the pixels.
+        _maskStride = masked ? (((size_t)width + 7) / 8 + 15) & ~(size_t)15 : 0;
+        
+        _levels[0] = (RKPixelBufferLevel){ width, height, _stride, 0 };
+        _levelCount = 1;
+        size_t length = (_stride + _maskStride) * height;
+        
+        // Each further level follows on from the one before it, and being a multiple of 16
+        // bytes long keeps every level vector aligned as well.
+        if (mipmapped && format != RKPixelFormat_Indexed8) {
+            while ((_levels[_levelCount - 1].width > 1 || _levels[_levelCount - 1].height > 1) && _levelCount < RKPixelBufferMaxLevels) {
+                RKPixelBufferLevel *previous = &_levels[_levelCount - 1];
+                RKPixelBufferLevel *level = &_levels[_levelCount++];
+                level->width = MAX(previous->width / 2, 1);
+                level->height = MAX(previous->height / 2, 1);
+                level->stride = ((size_t)level->width * bytesPerPixel + 15) & ~(size_t)15;
+                level->offset = length;
+                length += level->stride * level->height;
+            }
+        }
+        
+        _byteLength = length;
+        if ((_storage = PixelStorageCreate(MAX(length, 1))) == NULL) {
+            return nil;
+        }
+        
+        _maskBytes = masked ? _storage->bytes + (_stride * height) : NULL;
+    }
+    return self;
+}
+
+
+- (nullable instancetype)initWithBytes:(uint8_t *)bytes width:(uint32_t)width height:(uint32_t)height stride:(size_t)stride format:(RKPixelFormat)format owner:(id)owner
+{
+    if (format == RKPixelFormat_Indexed8 || !RKPixelFormatIsValid(format) || stride < (size_t)width * RKPixelFormatBytesPerPixel(format)) {
+        return nil;
+    }
+    
+    if (self = [super init]) {
+        _width = width;
+        _height = height;
+        _format = format;
+        _stride = stride;
+        _levels[0] = (RKPixelBufferLevel){ width, height, stride, 0 };
+        _levelCount = 1;
+        _byteLength = stride * height;
+        
+        void *context = (void *)CFBridgingRetain(owner);
+        if ((_storage = PixelStorageCreateWithBytes(bytes, stride * height, RKPixelBufferReleaseExternalOwner, context)) == NULL) {
+            CFRelease(context);
+            return nil;
+        }
+    }
+    return self;
+}
+
++ (nullable instancetype)pixelBufferWithBytes:(uint8_t *)bytes width:(uint32_t)width height:(uint32_t)height stride:(size_t)stride format:(RKPixelFormat)format owner:(id)owner
+{
+    return [[self alloc] initWithBytes:bytes width:width height:height stride:stride format:format owner:owner];
+}
+
+
+#pragma mark - Destruction
+
+- (void)dealloc
+{
+    for (uint32_t level = 0; level < _levelCount; ++level) {
+        CGImageRelease(_images[level]);
+    }
+    PixelStorageRelease(_storage);
+}
+
+
+#pragma mark - Accessors
+
+- (CGSize)size
+{
+    return CGSizeMake(_width, _height);
+}
+
+- (uint8_t *)bytes
+{
+    return _storage->bytes;
+}
+
+- (uint8_t *)rowAtIndex:(uint32_t)row
+{
+    NSAssert(row < _height, @"Attempted to access row %u of a %u row pixel buffer.", row, _height);
+    return _storage->bytes + (row * _stride);
+}
+
+- (uint8_t *)maskRowAtIndex:(uint32_t)row
+{
+    NSAssert(_maskBytes, @"Attempted to access the mask of an unmasked pixel buffer.");
+    NSAssert(row < _height, @"Attempted to access row %u of a %u row pixel buffer.", row, _height);
+    return _maskBytes + (row * _maskStride);
+}
+
+- (uint32_t)widthOfLevel:(uint32_t)level
+{
+    NSAssert(level < _levelCount, @"Attempted to access level %u of a %u level pixel buffer.", level, _levelCount);
+    return _levels[level].width;
+}
+
+- (uint32_t)heightOfLevel:(uint32_t)level
+{
+    NSAssert(level < _levelCount, @"Attempted to access level %u of a %u level pixel buffer.", level, _levelCount);
+    return _levels[level].height;
+}
+
+- (size_t)strideOfLevel:(uint32_t)level
+{
+    NSAssert(level < _levelCount, @"Attempted to access level %u of a %u level pixel buffer.", level, _levelCount);
+    return _levels[level].stride;
+}
+
+- (uint8_t *)bytesOfLevel:(uint32_t)level
+{
+    NSAssert(level < _levelCount, @"Attempted to access level %u of a %u level pixel buffer.", level, _levelCount);
+    return _storage->bytes + _levels[level].offset;
+}
+
+
+#pragma mark - Mipmaps
+
+- (void)generateMipmaps
+{
+    if (_levelCount < 2) {
+        return;
+    }
+    
+    const RKPixelConverter *converter = RKPixelConverterForFormat(_format);
+    for (uint32_t index = 1; index < _levelCount; ++index) {
+        const RKPixelBufferLevel *source = &_levels[index - 1];
+        const RKPixelBufferLevel *level = &_levels[index];
+        const uint8_t *sourceBytes = _storage->bytes + source->offset;
+        uint8_t *bytes = _storage->bytes + level->offset;
+        
+        for (uint32_t row = 0; row < level->height; ++row) {
+            // A source level that is only a single row tall is averaged with itself.
+            uint32_t top = MIN(row * 2, source->height - 1);
+            uint32_t bottom = MIN(top + 1, source->height - 1);
+            converter->reduce2x2(bytes + row * level->stride,
+                                 sourceBytes + top * source->stride,
+                                 sourceBytes + bottom * source->stride,
+                                 source->width,
+                                 level->width);
+        }
+    }
+}
+
+
+#pragma mark - Image Construction
+
+- (CGImageRef)imageValue
+{
+    return [self imageValueForLevel:0];
+}
+
+- (CGImageRef)imageValueForLevel:(uint32_t)level
+{
+    NSAssert(level < _levelCount, @"Attempted to access level %u of a %u level pixel buffer.", level, _levelCount);
+    @synchronized (self) {
+        if (!_images[level]) {
+            _images[level] = (_format == RKPixelFormat_Indexed8) ? [self constructIndexedCGImage]
+                                                                  : [self constructCGImageForLevel:&_levels[level]];
+        }
+        return _images[level];
+    }
+}
+
+- (CGImageRef)constructCGImageForLevel:(const RKPixelBufferLevel *)level
+{
+    if (level->width == 0 || level->height == 0) {
+        return NULL;
+    }
+    
+    PixelStorage *storage = NULL;
+    uint8_t *bytes = _storage->bytes + level->offset;
+    size_t stride = level->stride;
+    CGBitmapInfo bitmapInfo = (CGBitmapInfo)kCGImageAlphaPremultipliedLast;
+    
+    switch (_format) {
+        case RKPixelFormat_RGBA8888:
+            storage = PixelStorageRetain(_storage);
+            break;
+            
+        case RKPixelFormat_BGRA8888:
+            storage = PixelStorageRetain(_storage);
+            bitmapInfo = kCGBitmapByteOrder32Little | (CGBitmapInfo)kCGImageAlphaPremultipliedFirst;
+            break;
+            
+        case RKPixelFormat_RGB565:
+        case RKPixelFormat_RGBA5551: {
+            // Expand into a storage of our own, which the data provider will then own.
+            stride = ((size_t)level->width * 4 + 15) & ~(size_t)15;
+            if ((storage = PixelStorageCreate(stride * level->height)) == NULL) {
+                return NULL;
+            }
+            const RKPixelConverter *converter = RKPixelConverterForFormat(_format);
+            for (uint32_t row = 0; row < level->height; ++row) {
+                converter->expandToRGBA8888(storage->bytes + row * stride, bytes + row * level->stride, level->width);
+            }
+            bytes = storage->bytes;
+            break;
+        }
+            
+        case RKPixelFormat_Indexed8:
+            return NULL;
+    }
+    
+    // The data provider takes its own reference to the storage so that the image can
+    // outlive the receiver.
+    size_t length = stride * level->height;
+    CGDataProviderRef provider = CGDataProviderCreateWithData(storage, bytes, length, RKPixelBufferReleaseProviderData);
+    
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGImageRef image = CGImageCreate(level->width, level->height, 8, 32, stride, colorSpace, bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(provider);
+    return image;
+}
+
+- (CGImageRef)constructIndexedCGImage
+{
+    if (_width == 0 || _height == 0) {
+        return NULL;
+    }
+    
+    // The indices are drawn through an indexed color space, so the colors are looked up by
+    // CoreGraphics when the image is drawn rather than being expanded up front.
+    CGDataProviderRef provider = CGDataProviderCreateWithData(PixelStorageRetain(_storage), _storage->bytes, _stride * _height, RKPixelBufferReleaseProviderData);
+    CGImageRef image = CGImageCreate(_width, _height, 8, 8, _stride, _colorTable.colorSpace, (CGBitmapInfo)kCGImageAlphaNone, provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    
+    if (!_maskBytes || !image) {
+        return image;
+    }
+    
+    // CoreGraphics image masks block painting where a sample is 1, which is the inverse of
+    // the mask we store, so the mask is decoded inverted.
+    static const CGFloat decode[] = { 1, 0 };
+    CGDataProviderRef maskProvider = CGDataProviderCreateWithData(PixelStorageRetain(_storage), _maskBytes, _maskStride * _height, RKPixelBufferReleaseProviderData);
+    CGImageRef mask = CGImageMaskCreate(_width, _height, 1, 1, _maskStride, maskProvider, decode, false);
+    CGDataProviderRelease(maskProvider);
+    
+    CGImageRef maskedImage = CGImageCreateWithMask(image, mask);
+    CGImageRelease(mask);
+    CGImageRelease(image);
+    return maskedImage;
+}
+
+@end
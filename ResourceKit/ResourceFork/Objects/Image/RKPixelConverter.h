@@ -0,0 +1,71 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKPixelBuffer.h"
+
+/// A table of row conversion routines for a single pixel format. Each format has its own
+/// table, and every routine in it is generated from the format's pack/unpack functions at
+/// compile time. Decoders look up the table once per image and then convert whole runs of
+/// pixels, so there is no per-pixel switching on the output format.
+///
+/// All destinations are written in the layout of the table's format, and all 8-bit color
+/// output is premultiplied by alpha.
+typedef struct RKPixelConverter
+{
+    /// The format that the routines of the converter write.
+    RKPixelFormat format;
+    
+    /// The number of bytes a single pixel occupies in the format.
+    size_t bytesPerPixel;
+    
+    /// Store a single pixel with straight (non-premultiplied) alpha.
+    void (*storeRGBA)(uint8_t *dst, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+    
+    /// Convert a run of opaque, big endian XRGB 1555 pixels as found in PICT and RLË data.
+    void (*convertRGB555)(uint8_t *dst, const uint8_t *src, uint32_t count);
+    
+    /// Fill a run with opaque XRGB 1555 pixels, alternating between the two values given
+    /// starting with the first.
+    void (*fillRGB555)(uint8_t *dst, uint16_t first, uint16_t second, uint32_t count);
+    
+    /// Convert a run of planar 8-bit components with straight alpha. The alpha plane may
+    /// be NULL in which case the pixels are opaque.
+    void (*convertPlanar)(uint8_t *dst, const uint8_t *r, const uint8_t *g, const uint8_t *b, const uint8_t *a, uint32_t count);
+    
+    /// Convert a run of 8-bit indices using the specified RGBA 8888 color table entries.
+    void (*convertIndexed)(uint8_t *dst, const uint8_t *indices, const uint8_t *entries, uint32_t count);
+    
+    /// Expand a run of pixels in the format into premultiplied RGBA 8888.
+    void (*expandToRGBA8888)(uint8_t *dst, const uint8_t *src, uint32_t count);
+    
+    /// Box filter two rows of pixels down to a single row of half the width. The filter
+    /// operates on premultiplied values, so that transparent pixels do not bleed their
+    /// color into their neighbours. The last column is repeated when the source width is
+    /// odd, and both rows may be the same row.
+    void (*reduce2x2)(uint8_t *dst, const uint8_t *row0, const uint8_t *row1, uint32_t srcWidth, uint32_t dstWidth);
+} RKPixelConverter;
+
+/// Returns the conversion table for the specified pixel format. Indexed formats do not
+/// have a conversion table, and will return NULL.
+FOUNDATION_EXPORT const RKPixelConverter * _Nullable RKPixelConverterForFormat(RKPixelFormat format);
@@ -0,0 +1,270 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKPixelConverter.h"
+#import <simd/simd.h>
+
+#pragma mark - Component Helpers
+
+static inline uint8_t RKExpand5(uint16_t v)
+{
+    return (uint8_t)((v << 3) | (v >> 2));
+}
+
+static inline uint8_t RKPremultiply(uint8_t c, uint8_t a)
+{
+    return (uint8_t)((c * a + 127) / UINT8_MAX);
+}
+
+static inline uint8_t RKUnpremultiply(uint8_t c, uint8_t a)
+{
+    return (uint8_t)MIN((c * UINT8_MAX + a / 2) / a, UINT8_MAX);
+}
+
+
+#pragma mark - Format Definitions
+
+// Each format provides a pack function that takes premultiplied 8-bit components and
+// produces a single pixel, and an unpack function that reverses it. The 16-bit formats
+// are stored in host byte order.
+
+static inline void RKPack_RGBA8888(uint8_t *p, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    p[0] = r; p[1] = g; p[2] = b; p[3] = a;
+}
+
+static inline void RKUnpack_RGBA8888(const uint8_t *p, uint8_t *rgba)
+{
+    rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; rgba[3] = p[3];
+}
+
+static inline void RKPack_BGRA8888(uint8_t *p, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    p[0] = b; p[1] = g; p[2] = r; p[3] = a;
+}
+
+static inline void RKUnpack_BGRA8888(const uint8_t *p, uint8_t *rgba)
+{
+    rgba[0] = p[2]; rgba[1] = p[1]; rgba[2] = p[0]; rgba[3] = p[3];
+}
+
+static inline void RKPack_RGB565(uint8_t *p, uint8_t r, uint8_t g, uint8_t b, uint8_t a __unused)
+{
+    *(uint16_t *)p = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static inline void RKUnpack_RGB565(const uint8_t *p, uint8_t *rgba)
+{
+    uint16_t v = *(const uint16_t *)p;
+    uint8_t g = (v >> 5) & 0x3F;
+    rgba[0] = RKExpand5(v >> 11);
+    rgba[1] = (uint8_t)((g << 2) | (g >> 4));
+    rgba[2] = RKExpand5(v & 0x1F);
+    rgba[3] = UINT8_MAX;
+}
+
+static inline void RKPack_RGBA5551(uint8_t *p, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    // A single bit of alpha leaves nothing to premultiply with. A pixel with an alpha of
+    // 0x80 or more sets the bit and is stored fully covered, so its color is divided back
+    // out by alpha before it is truncated to 5 bits. Anything less is simply dropped.
+    if (a < 0x80) {
+        *(uint16_t *)p = 0;
+        return;
+    }
+    r = RKUnpremultiply(r, a);
+    g = RKUnpremultiply(g, a);
+    b = RKUnpremultiply(b, a);
+    *(uint16_t *)p = (uint16_t)(((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | 1);
+}
+
+static inline void RKUnpack_RGBA5551(const uint8_t *p, uint8_t *rgba)
+{
+    uint16_t v = *(const uint16_t *)p;
+    rgba[0] = RKExpand5(v >> 11);
+    rgba[1] = RKExpand5((v >> 6) & 0x1F);
+    rgba[2] = RKExpand5((v >> 1) & 0x1F);
+    rgba[3] = (v & 1) ? UINT8_MAX : 0;
+}
+
+
+#pragma mark - Reduction
+
+// Premultiplied 8-bit formats can be reduced without knowing which component is which,
+// as every component is simply averaged. Four source pixels (16 bytes) from each row are
+// summed as 16-bit lanes, and then adjacent pixels are paired up with a shuffle to give
+// two output pixels per iteration.
+static void RKReduce2x2_8888(uint8_t *dst, const uint8_t *row0, const uint8_t *row1, uint32_t srcWidth, uint32_t dstWidth)
+{
+    uint32_t x = 0;
+    
+    for (; x + 1 < dstWidth && (x * 2 + 3) < srcWidth; x += 2) {
+        simd_uchar16 a, b;
+        memcpy(&a, row0 + x * 8, sizeof(a));
+        memcpy(&b, row1 + x * 8, sizeof(b));
+        
+        simd_ushort16 sum = __builtin_convertvector(a, simd_ushort16) + __builtin_convertvector(b, simd_ushort16);
+        simd_ushort8 left = __builtin_shufflevector(sum, sum, 0, 1, 2, 3, 8, 9, 10, 11);
+        simd_ushort8 right = __builtin_shufflevector(sum, sum, 4, 5, 6, 7, 12, 13, 14, 15);
+        simd_uchar8 average = __builtin_convertvector((left + right + 2) >> 2, simd_uchar8);
+        
+        memcpy(dst + x * 4, &average, sizeof(average));
+    }
+    
+    // The remaining pixels, including a repeated last column when the width is odd.
+    for (; x < dstWidth; ++x) {
+        uint32_t x0 = MIN(x * 2, srcWidth - 1) * 4;
+        uint32_t x1 = MIN(x * 2 + 1, srcWidth - 1) * 4;
+        for (uint32_t c = 0; c < 4; ++c) {
+            dst[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+
+#pragma mark - Converter Generation
+
+// Instantiates the conversion loops for a format. The pack/unpack functions are inlined
+// into each loop, giving a dedicated loop per format rather than a branch per pixel.
+#define RK_DEFINE_PIXEL_CONVERTER(FMT, BPP, REDUCE)                                                 \
+static void RKStoreRGBA_##FMT(uint8_t *dst, uint8_t r, uint8_t g, uint8_t b, uint8_t a)             \
+{                                                                                                   \
+    if (a != UINT8_MAX) {                                                                           \
+        r = RKPremultiply(r, a);                                                                    \
+        g = RKPremultiply(g, a);                                                                    \
+        b = RKPremultiply(b, a);                                                                    \
+    }                                                                                               \
+    RKPack_##FMT(dst, r, g, b, a);                                                                  \
+}                                                                                                   \
+                                                                                                    \
+static void RKConvertRGB555_##FMT(uint8_t *dst, const uint8_t *src, uint32_t count)                 \
+{                                                                                                   \
+    for (uint32_t i = 0; i < count; ++i, src += 2, dst += BPP) {                                    \
+        uint16_t v = (uint16_t)((src[0] << 8) | src[1]);                                            \
+        RKPack_##FMT(dst, RKExpand5((v >> 10) & 0x1F), RKExpand5((v >> 5) & 0x1F),                  \
+                     RKExpand5(v & 0x1F), UINT8_MAX);                                               \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static void RKFillRGB555_##FMT(uint8_t *dst, uint16_t first, uint16_t second, uint32_t count)       \
+{                                                                                                   \
+    uint8_t a[BPP], b[BPP];                                                                         \
+    RKPack_##FMT(a, RKExpand5((first >> 10) & 0x1F), RKExpand5((first >> 5) & 0x1F),                \
+                 RKExpand5(first & 0x1F), UINT8_MAX);                                               \
+    RKPack_##FMT(b, RKExpand5((second >> 10) & 0x1F), RKExpand5((second >> 5) & 0x1F),              \
+                 RKExpand5(second & 0x1F), UINT8_MAX);                                              \
+    for (uint32_t i = 0; i < count; ++i, dst += BPP) {                                              \
+        memcpy(dst, (i & 1) ? b : a, BPP);                                                          \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static void RKConvertPlanar_##FMT(uint8_t *dst, const uint8_t *r, const uint8_t *g,                 \
+                                  const uint8_t *b, const uint8_t *a, uint32_t count)               \
+{                                                                                                   \
+    if (a == NULL) {                                                                                \
+        for (uint32_t i = 0; i < count; ++i, dst += BPP) {                                          \
+            RKPack_##FMT(dst, r[i], g[i], b[i], UINT8_MAX);                                         \
+        }                                                                                           \
+    }                                                                                               \
+    else {                                                                                          \
+        for (uint32_t i = 0; i < count; ++i, dst += BPP) {                                          \
+            RKPack_##FMT(dst, RKPremultiply(r[i], a[i]), RKPremultiply(g[i], a[i]),                 \
+                         RKPremultiply(b[i], a[i]), a[i]);                                          \
+        }                                                                                           \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static void RKConvertIndexed_##FMT(uint8_t *dst, const uint8_t *indices, const uint8_t *entries,    \
+                                   uint32_t count)                                                  \
+{                                                                                                   \
+    for (uint32_t i = 0; i < count; ++i, dst += BPP) {                                              \
+        const uint8_t *c = entries + indices[i] * 4;                                                \
+        RKPack_##FMT(dst, RKPremultiply(c[0], c[3]), RKPremultiply(c[1], c[3]),                     \
+                     RKPremultiply(c[2], c[3]), c[3]);                                              \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static void RKExpandToRGBA8888_##FMT(uint8_t *dst, const uint8_t *src, uint32_t count)              \
+{                                                                                                   \
+    for (uint32_t i = 0; i < count; ++i, src += BPP, dst += 4) {                                    \
+        RKUnpack_##FMT(src, dst);                                                                   \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+__unused static void RKReduce2x2Scalar_##FMT(uint8_t *dst, const uint8_t *row0,                     \
+                                             const uint8_t *row1, uint32_t srcWidth,                \
+                                             uint32_t dstWidth)                                     \
+{                                                                                                   \
+    for (uint32_t x = 0; x < dstWidth; ++x, dst += BPP) {                                           \
+        uint32_t x0 = MIN(x * 2, srcWidth - 1) * BPP;                                               \
+        uint32_t x1 = MIN(x * 2 + 1, srcWidth - 1) * BPP;                                           \
+        uint8_t p[4][4];                                                                            \
+        RKUnpack_##FMT(row0 + x0, p[0]);                                                            \
+        RKUnpack_##FMT(row0 + x1, p[1]);                                                            \
+        RKUnpack_##FMT(row1 + x0, p[2]);                                                            \
+        RKUnpack_##FMT(row1 + x1, p[3]);                                                            \
+        uint8_t c[4];                                                                               \
+        for (int i = 0; i < 4; ++i) {                                                               \
+            c[i] = (uint8_t)((p[0][i] + p[1][i] + p[2][i] + p[3][i] + 2) >> 2);                     \
+        }                                                                                           \
+        RKPack_##FMT(dst, c[0], c[1], c[2], c[3]);                                                  \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static const RKPixelConverter RKPixelConverter_##FMT = {                                            \
+    .format = RKPixelFormat_##FMT,                                                                  \
+    .bytesPerPixel = BPP,                                                                           \
+    .storeRGBA = RKStoreRGBA_##FMT,                                                                 \
+    .convertRGB555 = RKConvertRGB555_##FMT,                                                         \
+    .fillRGB555 = RKFillRGB555_##FMT,                                                               \
+    .convertPlanar = RKConvertPlanar_##FMT,                                                         \
+    .convertIndexed = RKConvertIndexed_##FMT,                                                       \
+    .expandToRGBA8888 = RKExpandToRGBA8888_##FMT,                                                   \
+    .reduce2x2 = REDUCE,                                                                            \
+};
+
+RK_DEFINE_PIXEL_CONVERTER(RGBA8888, 4, RKReduce2x2_8888)
+RK_DEFINE_PIXEL_CONVERTER(BGRA8888, 4, RKReduce2x2_8888)
+RK_DEFINE_PIXEL_CONVERTER(RGB565, 2, RKReduce2x2Scalar_RGB565)
+RK_DEFINE_PIXEL_CONVERTER(RGBA5551, 2, RKReduce2x2Scalar_RGBA5551)
+
+
+#pragma mark - Lookup
+
+const RKPixelConverter *RKPixelConverterForFormat(RKPixelFormat format)
+{
+    switch (format) {
+        case RKPixelFormat_RGBA8888:
+            return &RKPixelConverter_RGBA8888;
+        case RKPixelFormat_BGRA8888:
+            return &RKPixelConverter_BGRA8888;
+        case RKPixelFormat_RGB565:
+            return &RKPixelConverter_RGB565;
+        case RKPixelFormat_RGBA5551:
+            return &RKPixelConverter_RGBA5551;
+        case RKPixelFormat_Indexed8:
+            return NULL;
+    }
+    return NULL;
+}
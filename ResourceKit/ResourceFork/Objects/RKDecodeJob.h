@@ -0,0 +1,64 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "RKIncrementalDecoderProtocol.h"
+
+/// A decode job produces the object of a resource over a number of short steps, each
+/// limited to a time budget. This allows large resources to be streamed in from a game
+/// loop without blocking a frame, and without requiring a dedicated thread.
+///
+/// Jobs are not thread safe, and should only be stepped from one thread at a time.
+@interface RKDecodeJob : NSObject
+
+/// The current status of the job.
+@property (readonly) RKDecodeStatus status;
+
+/// The decoded object. This is only available once the job has completed.
+@property (nullable, readonly) id object;
+
+/// A block that is called once the job has finished, with the decoded object or nil if
+/// decoding failed.
+@property (nullable, copy) void (^completionHandler)(id _Nullable object);
+
+/// Create a job that steps the specified incremental decoder.
+- (nonnull instancetype)initWithDecoder:(nonnull id <RKIncrementalDecoderProtocol>)decoder;
+
+/// Create a job that produces its object in a single step using the block. This is used
+/// for resources that can not be decoded incrementally.
++ (nonnull instancetype)jobWithBlock:(nonnull id _Nullable (^)(void))block;
+
+/// Create a job that runs the job made by the block. The block is only called in the first
+/// step, so any work needed to set the job up, such as reading the data of the resource,
+/// is done by whoever steps it. The job fails if the block returns nil.
++ (nonnull instancetype)jobDeferringToJobBlock:(nonnull RKDecodeJob *_Nullable (^)(void))block;
+
+/// Decode for up to the specified number of nanoseconds. The budget may be overrun by
+/// the smallest unit of work the decoder performs, such as a single scanline.
+- (RKDecodeStatus)step:(uint64_t)budget;
+
+/// Decode all of the remaining work of the job.
+- (RKDecodeStatus)finish;
+
+@end
@@ -0,0 +1,170 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKDecodeJob.h"
+
+#pragma mark - Block Decoder
+
+@interface RKBlockDecoder : NSObject <RKIncrementalDecoderProtocol>
+@end
+
+@implementation RKBlockDecoder {
+@private
+    id (^_block)(void);
+    __strong id _decodedObject;
+}
+
+- (instancetype)initWithBlock:(id (^)(void))block
+{
+    if (self = [super init]) {
+        _block = [block copy];
+    }
+    return self;
+}
+
+- (RKDecodeStatus)decodeUntil:(uint64_t)deadline
+{
+    _decodedObject = _block();
+    _block = nil;
+    return _decodedObject ? RKDecodeStatus_Complete : RKDecodeStatus_Failed;
+}
+
+- (id)decodedObject
+{
+    return _decodedObject;
+}
+
+@end
+
+
+#pragma mark - Deferred Decoder
+
+@interface RKDecodeJob ()
+@property (nullable, copy) void (^resultHandler)(id _Nullable object);
+- (RKDecodeStatus)stepUntil:(uint64_t)deadline;
+@end
+
+// Steps the job made by a block, which is only called the first time the decoder is stepped.
+@interface RKDeferredDecoder : NSObject <RKIncrementalDecoderProtocol>
+@end
+
+@implementation RKDeferredDecoder {
+@private
+    RKDecodeJob *_Nullable (^_block)(void);
+    __strong RKDecodeJob *_job;
+}
+
+- (instancetype)initWithBlock:(RKDecodeJob *(^)(void))block
+{
+    if (self = [super init]) {
+        _block = [block copy];
+    }
+    return self;
+}
+
+- (RKDecodeStatus)decodeUntil:(uint64_t)deadline
+{
+    if (_block) {
+        _job = _block();
+        _block = nil;
+    }
+    return _job ? [_job stepUntil:deadline] : RKDecodeStatus_Failed;
+}
+
+- (id)decodedObject
+{
+    return _job.object;
+}
+
+@end
+
+
+#pragma mark - Decode Job
+
+@implementation RKDecodeJob {
+@private
+    __strong id <RKIncrementalDecoderProtocol> _decoder;
+}
+
+- (instancetype)initWithDecoder:(id<RKIncrementalDecoderProtocol>)decoder
+{
+    if (self = [super init]) {
+        _decoder = decoder;
+        _status = RKDecodeStatus_Incomplete;
+    }
+    return self;
+}
+
++ (instancetype)jobWithBlock:(id (^)(void))block
+{
+    return [[self alloc] initWithDecoder:[[RKBlockDecoder alloc] initWithBlock:block]];
+}
+
++ (instancetype)jobDeferringToJobBlock:(RKDecodeJob *(^)(void))block
+{
+    return [[self alloc] initWithDecoder:[[RKDeferredDecoder alloc] initWithBlock:block]];
+}
+
+
+#pragma mark - Stepping
+
+- (RKDecodeStatus)step:(uint64_t)budget
+{
+    uint64_t now = RKDecodeClock();
+    return [self stepUntil:(budget > UINT64_MAX - now) ? UINT64_MAX : now + budget];
+}
+
+- (RKDecodeStatus)finish
+{
+    return [self stepUntil:UINT64_MAX];
+}
+
+- (RKDecodeStatus)stepUntil:(uint64_t)deadline
+{
+    if (_status != RKDecodeStatus_Incomplete) {
+        return _status;
+    }
+    
+    _status = [_decoder decodeUntil:deadline];
+    if (_status == RKDecodeStatus_Incomplete) {
+        return _status;
+    }
+    
+    // The decoder is no longer needed once finished, and holds on to the source data and
+    // any scratch space it used.
+    _object = (_status == RKDecodeStatus_Complete) ? _decoder.decodedObject : nil;
+    _decoder = nil;
+    
+    if (self.resultHandler) {
+        self.resultHandler(_object);
+        self.resultHandler = nil;
+    }
+    if (self.completionHandler) {
+        self.completionHandler(_object);
+        self.completionHandler = nil;
+    }
+    return _status;
+}
+
+@end
@@ -0,0 +1,90 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/// The lanes of the decode scheduler. Requests in a higher lane are always started before
+/// any request in a lower one.
+typedef NS_ENUM(NSUInteger, RKDecodePriority)
+{
+    /// Speculative work, such as prefetching resources that may be needed soon.
+    RKDecodePriority_Prefetch,
+    RKDecodePriority_Normal,
+    /// Work that something on screen is waiting on.
+    RKDecodePriority_Visible,
+};
+
+typedef NS_ENUM(NSUInteger, RKDecodeRequestStatus)
+{
+    RKDecodeRequestStatus_Queued,
+    RKDecodeRequestStatus_Running,
+    RKDecodeRequestStatus_Finished,
+    RKDecodeRequestStatus_Cancelled,
+};
+
+/// A piece of work that has been handed to an RKDecodeScheduler. All methods are safe to
+/// call from any thread.
+@interface RKDecodeRequest : NSObject
+
+/// The lane of the request. Changing this whilst the request is still queued moves it to
+/// the back of the new lane. It has no effect once the request has started.
+@property RKDecodePriority priority;
+
+/// The current status of the request.
+@property (readonly) RKDecodeRequestStatus status;
+
+/// Prevent the request from running if it has not yet started. The completion handler of
+/// a cancelled request is never called. Requests that have already started run to
+/// completion.
+- (void)cancel;
+
+@end
+
+
+/// RKDecodeScheduler runs decode work on a pool of threads owned by ResourceKit, one per
+/// processor. Each worker has its own queue for each priority lane, and a worker that runs
+/// out of work steals from the others, always taking the highest priority work available
+/// anywhere in the pool first.
+///
+/// The workers of a scheduler live for the rest of the process, so the shared scheduler
+/// should normally be used.
+@interface RKDecodeScheduler : NSObject
+
+/// The scheduler used by the asynchronous object requests of RKResource and RKResourceFork.
++ (nonnull instancetype)sharedScheduler;
+
+/// Create a new scheduler with the specified number of workers.
+- (nonnull instancetype)initWithWorkerCount:(NSUInteger)workerCount;
+
+/// The number of threads that the scheduler runs work on.
+@property (readonly) NSUInteger workerCount;
+
+/// Queue the work in the specified lane. The completion handler is called with the result
+/// of the work on the specified queue, or directly on the worker if no queue is given.
+- (nonnull RKDecodeRequest *)scheduleWork:(nonnull id _Nullable (^)(void))work
+                                 priority:(RKDecodePriority)priority
+                                    queue:(nullable dispatch_queue_t)queue
+                               completion:(nullable void (^)(id _Nullable object))completion;
+
+@end
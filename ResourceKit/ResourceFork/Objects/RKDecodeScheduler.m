@@ -0,0 +1,280 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKDecodeScheduler.h"
+#import <os/lock.h>
+#import <stdatomic.h>
+
+static const NSUInteger RKDecodeLaneCount = RKDecodePriority_Visible + 1;
+
+@class RKDecodeWorker;
+
+#pragma mark - Requests
+
+@interface RKDecodeRequest () {
+@public
+    id (^_work)(void);
+    void (^_completion)(id);
+    dispatch_queue_t _queue;
+    RKDecodePriority _priority;
+    atomic_uint _status;
+    
+    // The worker whose queue the request was placed in. Its lock guards the priority.
+    __unsafe_unretained RKDecodeWorker *_worker;
+}
+@end
+
+
+#pragma mark - Workers
+
+@interface RKDecodeWorker : NSObject {
+@public
+    os_unfair_lock _lock;
+    NSMutableArray <RKDecodeRequest *> *_lanes[RKDecodeLaneCount];
+    NSUInteger _index;
+}
+@end
+
+@implementation RKDecodeWorker
+
+- (instancetype)initWithIndex:(NSUInteger)index
+{
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _index = index;
+        for (NSUInteger lane = 0; lane < RKDecodeLaneCount; ++lane) {
+            _lanes[lane] = [NSMutableArray new];
+        }
+    }
+    return self;
+}
+
+// Take the oldest request from the lane, so that the requests of a lane are served in
+// roughly the order they were made, whether by the owner or a thief.
+- (RKDecodeRequest *)popRequestFromLane:(NSUInteger)lane
+{
+    RKDecodeRequest *request = nil;
+    os_unfair_lock_lock(&_lock);
+    if (_lanes[lane].count) {
+        request = _lanes[lane].firstObject;
+        [_lanes[lane] removeObjectAtIndex:0];
+    }
+    os_unfair_lock_unlock(&_lock);
+    return request;
+}
+
+@end
+
+// The worker running on the current thread, if any. Work scheduled from inside other work
+// is queued with the worker that is running it.
+static __thread __unsafe_unretained RKDecodeWorker *RKDecodeCurrentWorker = nil;
+
+
+#pragma mark - Scheduler
+
+@implementation RKDecodeScheduler {
+@private
+    NSArray <RKDecodeWorker *> *_workers;
+    dispatch_semaphore_t _wake;
+    atomic_uint _nextWorker;
+}
+
++ (instancetype)sharedScheduler
+{
+    static RKDecodeScheduler *sharedScheduler = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedScheduler = [[self alloc] initWithWorkerCount:MAX(NSProcessInfo.processInfo.activeProcessorCount, 2)];
+    });
+    return sharedScheduler;
+}
+
+- (instancetype)init
+{
+    return [self initWithWorkerCount:MAX(NSProcessInfo.processInfo.activeProcessorCount, 2)];
+}
+
+- (instancetype)initWithWorkerCount:(NSUInteger)workerCount
+{
+    if (self = [super init]) {
+        _workerCount = MAX(workerCount, 1);
+        _wake = dispatch_semaphore_create(0);
+        
+        NSMutableArray <RKDecodeWorker *> *workers = [NSMutableArray arrayWithCapacity:_workerCount];
+        for (NSUInteger i = 0; i < _workerCount; ++i) {
+            [workers addObject:[[RKDecodeWorker alloc] initWithIndex:i]];
+        }
+        _workers = workers.copy;
+        
+        for (RKDecodeWorker *worker in _workers) {
+            NSThread *thread = [[NSThread alloc] initWithTarget:self selector:@selector(runWorker:) object:worker];
+            thread.name = [NSString stringWithFormat:@"ResourceKit.decode.%lu", (unsigned long)worker->_index];
+            thread.qualityOfService = NSQualityOfServiceUserInitiated;
+            [thread start];
+        }
+    }
+    return self;
+}
+
+
+#pragma mark - Scheduling
+
+- (RKDecodeRequest *)scheduleWork:(id (^)(void))work
+                         priority:(RKDecodePriority)priority
+                            queue:(dispatch_queue_t)queue
+                       completion:(void (^)(id))completion
+{
+    RKDecodeRequest *request = [RKDecodeRequest new];
+    request->_work = [work copy];
+    request->_completion = [completion copy];
+    request->_queue = queue;
+    request->_priority = MIN(priority, RKDecodePriority_Visible);
+    atomic_init(&request->_status, RKDecodeRequestStatus_Queued);
+    
+    RKDecodeWorker *worker = RKDecodeCurrentWorker;
+    if (![_workers containsObject:worker]) {
+        worker = _workers[atomic_fetch_add_explicit(&_nextWorker, 1, memory_order_relaxed) % _workerCount];
+    }
+    request->_worker = worker;
+    
+    os_unfair_lock_lock(&worker->_lock);
+    [worker->_lanes[request->_priority] addObject:request];
+    os_unfair_lock_unlock(&worker->_lock);
+    
+    dispatch_semaphore_signal(_wake);
+    return request;
+}
+
+// Find the highest priority request in the pool, looking first in the queue of the worker
+// and then stealing from the others. Cancelled requests are discarded along the way.
+- (RKDecodeRequest *)nextRequestForWorker:(RKDecodeWorker *)worker
+{
+    for (NSUInteger lane = RKDecodeLaneCount; lane-- > 0;) {
+        for (NSUInteger i = 0; i < _workerCount; ++i) {
+            RKDecodeWorker *victim = _workers[(worker->_index + i) % _workerCount];
+            
+            RKDecodeRequest *request = nil;
+            while ((request = [victim popRequestFromLane:lane])) {
+                unsigned int expected = RKDecodeRequestStatus_Queued;
+                if (atomic_compare_exchange_strong(&request->_status, &expected, RKDecodeRequestStatus_Running)) {
+                    return request;
+                }
+            }
+        }
+    }
+    return nil;
+}
+
+- (void)runWorker:(RKDecodeWorker *)worker
+{
+    RKDecodeCurrentWorker = worker;
+    
+    for (;;) {
+        @autoreleasepool {
+            RKDecodeRequest *request = [self nextRequestForWorker:worker];
+            if (!request) {
+                dispatch_semaphore_wait(_wake, DISPATCH_TIME_FOREVER);
+                continue;
+            }
+            
+            id object = request->_work();
+            void (^completion)(id) = request->_completion;
+            dispatch_queue_t queue = request->_queue;
+            
+            // Release anything captured by the request as soon as it is done with.
+            request->_work = nil;
+            request->_completion = nil;
+            request->_queue = nil;
+            atomic_store(&request->_status, RKDecodeRequestStatus_Finished);
+            
+            if (!completion) {
+                continue;
+            }
+            else if (queue) {
+                dispatch_async(queue, ^{
+                    completion(object);
+                });
+            }
+            else {
+                completion(object);
+            }
+        }
+    }
+}
+
+@end
+
+
+#pragma mark - Requests
+
+@implementation RKDecodeRequest
+
+- (RKDecodePriority)priority
+{
+    os_unfair_lock_lock(&_worker->_lock);
+    RKDecodePriority priority = _priority;
+    os_unfair_lock_unlock(&_worker->_lock);
+    return priority;
+}
+
+- (void)setPriority:(RKDecodePriority)priority
+{
+    priority = MIN(priority, RKDecodePriority_Visible);
+    
+    os_unfair_lock_lock(&_worker->_lock);
+    if (priority != _priority) {
+        NSUInteger index = [_worker->_lanes[_priority] indexOfObjectIdenticalTo:self];
+        if (index != NSNotFound) {
+            [_worker->_lanes[_priority] removeObjectAtIndex:index];
+            [_worker->_lanes[priority] addObject:self];
+        }
+        _priority = priority;
+    }
+    os_unfair_lock_unlock(&_worker->_lock);
+}
+
+- (RKDecodeRequestStatus)status
+{
+    return atomic_load(&_status);
+}
+
+- (void)cancel
+{
+    unsigned int expected = RKDecodeRequestStatus_Queued;
+    if (!atomic_compare_exchange_strong(&_status, &expected, RKDecodeRequestStatus_Cancelled)) {
+        return;
+    }
+    
+    // A worker may have already taken the request from its queue, in which case it will
+    // see that it has been cancelled and discard it.
+    os_unfair_lock_lock(&_worker->_lock);
+    [_worker->_lanes[_priority] removeObjectIdenticalTo:self];
+    os_unfair_lock_unlock(&_worker->_lock);
+    
+    _work = nil;
+    _completion = nil;
+    _queue = nil;
+}
+
+@end
@@ -0,0 +1,86 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/// The byte budget of the shared object cache, unless it is changed: 64MiB.
+FOUNDATION_EXPORT const size_t RKObjectCacheDefaultByteBudget;
+
+/// RKObjectCache holds on to the objects parsed from resources, up to a budget of bytes.
+/// Each object is stored with the number of bytes it is estimated to occupy, and once the
+/// total goes over the budget the objects that were least recently used are evicted until
+/// it is back within it.
+///
+/// Objects are keyed by an integer rather than by resource, so that the cache never keeps
+/// a resource alive. All methods are safe to call from any thread.
+@interface RKObjectCache : NSObject
+
+/// The cache that RKResource keeps its parsed objects in.
++ (nonnull instancetype)sharedCache;
+
+/// Create a new cache with the specified byte budget.
+- (nonnull instancetype)initWithByteBudget:(size_t)byteBudget;
+
+/// The number of bytes that the cached objects may occupy. Lowering the budget evicts
+/// objects immediately.
+@property (atomic) size_t byteBudget;
+
+/// The number of bytes that the cached objects occupy.
+@property (readonly) size_t currentBytes;
+
+/// The number of objects in the cache.
+@property (readonly) NSUInteger count;
+
+/// The number of lookups that found an object.
+@property (readonly) uint64_t hitCount;
+
+/// The number of lookups that did not find an object.
+@property (readonly) uint64_t missCount;
+
+/// The number of objects that have been removed to stay within the budget.
+@property (readonly) uint64_t evictionCount;
+
+/// Returns the object for the specified key, marking it as the most recently used, or nil
+/// if it is not in the cache.
+- (nullable id)objectForKey:(uint64_t)key;
+
+/// Returns the object for the specified key without marking it as used or counting the
+/// lookup as a hit or miss.
+- (nullable id)peekObjectForKey:(uint64_t)key;
+
+/// Add the object to the cache, replacing any object that already has the key. Objects
+/// that cost more than the entire budget are not cached at all.
+- (void)setObject:(nonnull id)object forKey:(uint64_t)key cost:(size_t)cost;
+
+/// Remove the object with the specified key from the cache. This is not counted as an
+/// eviction.
+- (void)removeObjectForKey:(uint64_t)key;
+
+/// Remove every object from the cache.
+- (void)removeAllObjects;
+
+/// Reset the hit, miss and eviction counts to zero.
+- (void)resetCounters;
+
+@end
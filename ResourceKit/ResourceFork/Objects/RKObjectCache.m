@@ -0,0 +1,302 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKObjectCache.h"
+#import <os/lock.h>
+
+const size_t RKObjectCacheDefaultByteBudget = 64 << 20;
+
+#pragma mark - Entries
+
+// Entries are kept in a list ordered from most to least recently used. The dictionary
+// owns the entries, so the links between them are unretained.
+@interface RKObjectCacheEntry : NSObject {
+@public
+    uint64_t _key;
+    size_t _cost;
+    __strong id _object;
+    __unsafe_unretained RKObjectCacheEntry *_previous;
+    __unsafe_unretained RKObjectCacheEntry *_next;
+}
+@end
+
+@implementation RKObjectCacheEntry
+@end
+
+
+@implementation RKObjectCache {
+@private
+    os_unfair_lock _lock;
+    NSMutableDictionary <NSNumber *, RKObjectCacheEntry *> *_entries;
+    __unsafe_unretained RKObjectCacheEntry *_head;
+    __unsafe_unretained RKObjectCacheEntry *_tail;
+    size_t _byteBudget;
+    size_t _currentBytes;
+    
+    // The counters are only touched with the lock held, and so are read under it too.
+    uint64_t _hitCount;
+    uint64_t _missCount;
+    uint64_t _evictionCount;
+}
+
+#pragma mark - Creation
+
++ (instancetype)sharedCache
+{
+    static RKObjectCache *sharedCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[RKObjectCache alloc] initWithByteBudget:RKObjectCacheDefaultByteBudget];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init
+{
+    return [self initWithByteBudget:RKObjectCacheDefaultByteBudget];
+}
+
+- (instancetype)initWithByteBudget:(size_t)byteBudget
+{
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _entries = [NSMutableDictionary new];
+        _byteBudget = byteBudget;
+    }
+    return self;
+}
+
+
+#pragma mark - Recency List
+
+- (void)unlinkEntry:(RKObjectCacheEntry *)entry
+{
+    if (entry->_previous) {
+        entry->_previous->_next = entry->_next;
+    }
+    else {
+        _head = entry->_next;
+    }
+    
+    if (entry->_next) {
+        entry->_next->_previous = entry->_previous;
+    }
+    else {
+        _tail = entry->_previous;
+    }
+    
+    entry->_previous = nil;
+    entry->_next = nil;
+}
+
+- (void)pushEntry:(RKObjectCacheEntry *)entry
+{
+    entry->_previous = nil;
+    entry->_next = _head;
+    if (_head) {
+        _head->_previous = entry;
+    }
+    _head = entry;
+    if (!_tail) {
+        _tail = entry;
+    }
+}
+
+// Removes the entry from the cache, returning its object so that the caller can release
+// it once the lock has been dropped. Objects may do a fair amount of work when they are
+// deallocated, which should not hold up other threads.
+- (id)removeEntry:(RKObjectCacheEntry *)entry
+{
+    id object = entry->_object;
+    [self unlinkEntry:entry];
+    _currentBytes -= entry->_cost;
+    [_entries removeObjectForKey:@(entry->_key)];
+    return object;
+}
+
+- (void)evictToBudgetInto:(NSMutableArray *)evicted
+{
+    while (_currentBytes > _byteBudget && _tail) {
+        [evicted addObject:[self removeEntry:_tail]];
+        _evictionCount++;
+    }
+}
+
+
+#pragma mark - Budget
+
+- (size_t)byteBudget
+{
+    os_unfair_lock_lock(&_lock);
+    size_t byteBudget = _byteBudget;
+    os_unfair_lock_unlock(&_lock);
+    return byteBudget;
+}
+
+- (void)setByteBudget:(size_t)byteBudget
+{
+    NSMutableArray *evicted = [NSMutableArray new];
+    
+    os_unfair_lock_lock(&_lock);
+    _byteBudget = byteBudget;
+    [self evictToBudgetInto:evicted];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (size_t)currentBytes
+{
+    os_unfair_lock_lock(&_lock);
+    size_t currentBytes = _currentBytes;
+    os_unfair_lock_unlock(&_lock);
+    return currentBytes;
+}
+
+- (NSUInteger)count
+{
+    os_unfair_lock_lock(&_lock);
+    NSUInteger count = _entries.count;
+    os_unfair_lock_unlock(&_lock);
+    return count;
+}
+
+
+#pragma mark - Counters
+
+- (uint64_t)hitCount
+{
+    os_unfair_lock_lock(&_lock);
+    uint64_t hitCount = _hitCount;
+    os_unfair_lock_unlock(&_lock);
+    return hitCount;
+}
+
+- (uint64_t)missCount
+{
+    os_unfair_lock_lock(&_lock);
+    uint64_t missCount = _missCount;
+    os_unfair_lock_unlock(&_lock);
+    return missCount;
+}
+
+- (uint64_t)evictionCount
+{
+    os_unfair_lock_lock(&_lock);
+    uint64_t evictionCount = _evictionCount;
+    os_unfair_lock_unlock(&_lock);
+    return evictionCount;
+}
+
+- (void)resetCounters
+{
+    os_unfair_lock_lock(&_lock);
+    _hitCount = 0;
+    _missCount = 0;
+    _evictionCount = 0;
+    os_unfair_lock_unlock(&_lock);
+}
+
+
+#pragma mark - Access
+
+- (id)objectForKey:(uint64_t)key
+{
+    os_unfair_lock_lock(&_lock);
+    RKObjectCacheEntry *entry = _entries[@(key)];
+    if (entry) {
+        [self unlinkEntry:entry];
+        [self pushEntry:entry];
+        _hitCount++;
+    }
+    else {
+        _missCount++;
+    }
+    id object = entry ? entry->_object : nil;
+    os_unfair_lock_unlock(&_lock);
+    return object;
+}
+
+- (id)peekObjectForKey:(uint64_t)key
+{
+    os_unfair_lock_lock(&_lock);
+    RKObjectCacheEntry *entry = _entries[@(key)];
+    id object = entry ? entry->_object : nil;
+    os_unfair_lock_unlock(&_lock);
+    return object;
+}
+
+- (void)setObject:(id)object forKey:(uint64_t)key cost:(size_t)cost
+{
+    NSMutableArray *evicted = [NSMutableArray new];
+    
+    os_unfair_lock_lock(&_lock);
+    RKObjectCacheEntry *existing = _entries[@(key)];
+    if (existing) {
+        [evicted addObject:[self removeEntry:existing]];
+    }
+    
+    if (cost <= _byteBudget) {
+        RKObjectCacheEntry *entry = [RKObjectCacheEntry new];
+        entry->_key = key;
+        entry->_cost = cost;
+        entry->_object = object;
+        _entries[@(key)] = entry;
+        [self pushEntry:entry];
+        _currentBytes += cost;
+        [self evictToBudgetInto:evicted];
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)removeObjectForKey:(uint64_t)key
+{
+    id object = nil;
+    
+    os_unfair_lock_lock(&_lock);
+    RKObjectCacheEntry *entry = _entries[@(key)];
+    if (entry) {
+        object = [self removeEntry:entry];
+    }
+    os_unfair_lock_unlock(&_lock);
+    
+    // The object is released here, outside of the lock.
+    object = nil;
+}
+
+- (void)removeAllObjects
+{
+    NSMutableDictionary *entries = nil;
+    
+    os_unfair_lock_lock(&_lock);
+    entries = _entries;
+    _entries = [NSMutableDictionary new];
+    _head = nil;
+    _tail = nil;
+    _currentBytes = 0;
+    os_unfair_lock_unlock(&_lock);
+    
+    // As are all of these.
+    entries = nil;
+}
+
+@end
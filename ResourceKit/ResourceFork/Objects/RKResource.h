@@ -24,6 +24,10 @@
 
 #import <Foundation/Foundation.h>
 #import "RKResourceFileProtocol.h"
+#import "RKDecodeScheduler.h"
+#import "ClassicMacTypes.h"
+
+@class RKDecodeJob;
 
 @interface RKResource : NSObject
 
@@ -39,14 +43,24 @@
 /// The type of the receiver
 @property (nonnull, readonly, copy) NSString *type;
 
+/// The type of the receiver packed into a four character code.
+@property (readonly) RKFourCC typeCode;
+
 /// The size of the data of the receiver
 @property (readonly) size_t size;
 
 /// The data of the reciever
 @property (nonnull, readonly) NSData *data;
 
+/// A 64-bit hash of the data of the receiver, computed the first time it is asked for.
+/// Resources with identical data have the same hash, wherever they come from.
+@property (readonly) uint64_t contentHash;
+
 /// The parsed object of the received. This will be the data of the
-/// receiver if no parser is available.
+/// receiver if no parser is available. The object is kept in the shared RKObjectCache,
+/// keyed by the type and content hash of the receiver, so every resource with the same
+/// type and data shares one object, and it is parsed again if it has since been evicted. This is safe to request from any
+/// thread; the object is only ever parsed once at a time, with other callers waiting for it.
 @property (nonnull, readonly) id object;
 
 
@@ -57,21 +71,59 @@
                                 size:(size_t)size
                                owner:(nullable id <RKResourceFileProtocol>)owner;
 
-/// Remove the currently cached object data.
+/// Parse the data of the receiver using the specified parser options. Unlike the object
+/// property the result of this is not cached.
+- (nullable id)objectWithOptions:(nullable NSDictionary <NSString *, id> *)options;
+
+/// Create a job that produces the object of the receiver incrementally, using the default
+/// parser options. The job looks for a cached object in its first step, which hashes the
+/// data of the receiver, and caches the object once it completes.
+- (nonnull RKDecodeJob *)decodeJob;
+
+/// Create a job that produces an object from the receiver incrementally, using the
+/// specified parser options. Resources whose parser is unable to decode incrementally are
+/// decoded in the first step of the job.
+- (nonnull RKDecodeJob *)decodeJobWithOptions:(nullable NSDictionary <NSString *, id> *)options;
+
+/// Produce the object of the receiver on the shared RKDecodeScheduler, in the specified
+/// lane. The completion handler is called on the specified queue, or on the worker if no
+/// queue is given, with the same object that the object property would return.
+- (nonnull RKDecodeRequest *)requestObjectWithPriority:(RKDecodePriority)priority
+                                                 queue:(nullable dispatch_queue_t)queue
+                                            completion:(nonnull void (^)(id _Nullable object))completion;
+
+/// Remove the object of the receiver from the object cache. As the object is shared with
+/// any other resource with the same type and data, they lose it too.
 - (void)flushCache;
 
+/// The key in the object cache of the object of any resource with the specified type and
+/// content hash.
++ (uint64_t)cacheKeyForTypeCode:(RKFourCC)type contentHash:(uint64_t)contentHash;
+
 @end
 
 
 @interface RKResource (RKResourceParsing)
 
-/// Search through the Objective-C runtime for all available parsers.
+/// Load the parsers registered with RK_REGISTER_PARSER. This happens automatically the
+/// first time a parser is looked up.
 + (void)loadParsers;
 
 /// Register a parser with the resource class so that appropriate parsers can be found.
+/// This replaces any parser already registered for the type.
 + (void)registerParser:(nonnull Class)cls forType:(nonnull NSString *)type;
 
-/// Request the parser for the specified resource type
+/// Request the parser for the specified resource type. This never takes a lock.
 + (nullable Class)parserForType:(nonnull NSString *)type;
 
+/// Request the parser for the specified four character type code. This never takes a lock.
++ (nullable Class)parserForTypeCode:(RKFourCC)code;
+
+/// The options that are passed to parsers when producing the object of a resource.
++ (nullable NSDictionary <NSString *, id> *)defaultParserOptions;
+
+/// Set the options that are passed to parsers when producing the object of a resource.
+/// This does not affect objects that have already been produced and cached.
++ (void)setDefaultParserOptions:(nullable NSDictionary <NSString *, id> *)options;
+
 @end
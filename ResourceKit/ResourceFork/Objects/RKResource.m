@@ -26,10 +26,61 @@
 #import <ResourceKit/ResourceKit.h>
 #import <objc/runtime.h>
 #import "RKResourceParserProtocol.h"
+#import "RKDecodeJob.h"
+#import "RKObjectCache.h"
+#import "RKFourCC.h"
+#import "ResourceIndex.h"
+#import "ContentHash.h"
+#import <os/lock.h>
+#import <stdatomic.h>
+#import <dlfcn.h>
+#import <mach-o/dyld.h>
+#import <mach-o/getsect.h>
+
+NSString * const RKResourceParserOptionPixelFormat = @"RKResourceParserOptionPixelFormat";
+NSString * const RKResourceParserOptionGenerateMipmaps = @"RKResourceParserOptionGenerateMipmaps";
+
+#pragma mark - Decodes
+
+// A decode of the object of a resource that is in progress. Anyone else asking for the
+// object while it is being decoded waits on the group for the result.
+@interface RKResourceDecode : NSObject {
+@public
+    dispatch_group_t _group;
+    __strong id _object;
+}
+@end
+
+@implementation RKResourceDecode
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _group = dispatch_group_create();
+        dispatch_group_enter(_group);
+    }
+    return self;
+}
+
+@end
+
+
+#pragma mark - Decode Jobs
+
+// The result handler of a decode job is called with the decoded object before its
+// completion handler. It is only used within ResourceKit, leaving the completion handler
+// free for the caller.
+@interface RKDecodeJob (RKResourceCaching)
+@property (nullable, copy) void (^resultHandler)(id _Nullable object);
+@end
+
 
 @implementation RKResource {
 @private
-    __strong id _object;
+    _Atomic(uint64_t) _contentHash;
+    atomic_bool _hasContentHash;
+    os_unfair_lock _decodeLock;
+    __strong RKResourceDecode *_decode;
 }
 
 - (nonnull instancetype)initWithType:(nonnull NSString *)type
@@ -38,42 +89,214 @@
                                 size:(size_t)size
                                owner:(nullable id <RKResourceFileProtocol>)owner
 {
-    [[self class] loadParsers];
     if (self = [super init]) {
         _type = type.copy;
+        _typeCode = RKFourCCFromString(type);
         _id = resourceId;
         _name = name.copy;
         _size = size;
         _owner = owner;
+        _decodeLock = OS_UNFAIR_LOCK_INIT;
     }
     return self;
 }
 
-
 #pragma mark - Computed Properties
 
 - (NSData *)data
 {
-    return [self.owner dataForResourceOfType:self.type id:self.id];
+    return [self dataFromOwner:self.owner];
+}
+
+- (NSData *)dataFromOwner:(id <RKResourceFileProtocol>)owner
+{
+    if ([owner respondsToSelector:@selector(dataForResourceOfTypeCode:id:)]) {
+        return [owner dataForResourceOfTypeCode:_typeCode id:_id];
+    }
+    return [owner dataForResourceOfType:_type id:_id];
+}
+
+- (uint64_t)contentHash
+{
+    return [self contentHashFromOwner:self.owner];
+}
+
+- (uint64_t)contentHashFromOwner:(id <RKResourceFileProtocol>)owner
+{
+    if (atomic_load_explicit(&_hasContentHash, memory_order_acquire)) {
+        return atomic_load_explicit(&_contentHash, memory_order_relaxed);
+    }
+    
+    // Racing callers compute the same hash, so whichever stores it last does no harm.
+    NSData *data = [self dataFromOwner:owner];
+    uint64_t hash = ContentHash(data.bytes, data.length, 0);
+    atomic_store_explicit(&_contentHash, hash, memory_order_relaxed);
+    atomic_store_explicit(&_hasContentHash, true, memory_order_release);
+    return hash;
+}
+
+// Objects are cached by content rather than by resource, so every resource with the same
+// data shares one object. The type is mixed in, as the same bytes parse differently as
+// different types.
+- (uint64_t)cacheKey
+{
+    return [self cacheKeyFromOwner:self.owner];
+}
+
+- (uint64_t)cacheKeyFromOwner:(id <RKResourceFileProtocol>)owner
+{
+    return [RKResource cacheKeyForTypeCode:_typeCode contentHash:[self contentHashFromOwner:owner]];
+}
+
++ (uint64_t)cacheKeyForTypeCode:(RKFourCC)type contentHash:(uint64_t)contentHash
+{
+    return contentHash ^ ((uint64_t)type * 0x9E3779B97F4A7C15ull);
 }
 
 - (id)object
 {
-    __weak __typeof(self) weakSelf = self;
-    return _object ?: (_object = ^id{
-        Class RKParser = [RKResource parserForType:weakSelf.type];
-        if (!RKParser) {
-            return weakSelf.data;
+    uint64_t cacheKey = self.cacheKey;
+    id object = [RKObjectCache.sharedCache objectForKey:cacheKey];
+    if (object) {
+        return object;
+    }
+    
+    // Only the first caller to miss decodes the object. Anyone else that misses whilst it
+    // is doing so waits for that decode instead of starting their own. The cache is checked
+    // again under the lock, as a decode may have finished since the first lookup.
+    os_unfair_lock_lock(&_decodeLock);
+    RKResourceDecode *decode = _decode;
+    BOOL waiting = (decode != nil);
+    if (!waiting && !(object = [RKObjectCache.sharedCache peekObjectForKey:cacheKey])) {
+        decode = _decode = [RKResourceDecode new];
+    }
+    os_unfair_lock_unlock(&_decodeLock);
+    
+    if (object) {
+        return object;
+    }
+    else if (waiting) {
+        dispatch_group_wait(decode->_group, DISPATCH_TIME_FOREVER);
+        return decode->_object;
+    }
+    
+    if ((object = [self objectWithOptions:RKResource.defaultParserOptions])) {
+        [self cacheObject:object];
+    }
+    
+    decode->_object = object;
+    os_unfair_lock_lock(&_decodeLock);
+    _decode = nil;
+    os_unfair_lock_unlock(&_decodeLock);
+    dispatch_group_leave(decode->_group);
+    
+    return object;
+}
+
+- (void)cacheObject:(id)object
+{
+    Class RKParser = [RKResource parserForTypeCode:_typeCode];
+    size_t cost = [RKParser respondsToSelector:@selector(costOfObject:)] ? [RKParser costOfObject:object] : self.size;
+    [RKObjectCache.sharedCache setObject:object forKey:self.cacheKey cost:cost];
+}
+
+- (id)objectWithOptions:(NSDictionary<NSString *, id> *)options
+{
+    return [self objectWithOptions:options owner:self.owner];
+}
+
+- (id)objectWithOptions:(NSDictionary<NSString *, id> *)options owner:(id <RKResourceFileProtocol>)owner
+{
+    // Files that hold pre-decoded objects can skip the parser entirely.
+    if ([owner respondsToSelector:@selector(objectForResourceOfType:id:options:)]) {
+        id object = [owner objectForResourceOfType:self.type id:self.id options:options];
+        if (object) {
+            return object;
         }
-        else {
-            return [RKParser parseData:weakSelf.data];
+    }
+    
+    Class RKParser = [RKResource parserForTypeCode:_typeCode];
+    if (!RKParser) {
+        return [self dataFromOwner:owner];
+    }
+    else if ([RKParser respondsToSelector:@selector(parseData:options:)]) {
+        return [RKParser parseData:[self dataFromOwner:owner] options:options];
+    }
+    else {
+        return [RKParser parseData:[self dataFromOwner:owner]];
+    }
+}
+
+- (RKDecodeJob *)decodeJob
+{
+    // Finding the object in the cache means hashing the data of the resource, so that is
+    // left to the first step of the job rather than done by the caller.
+    id <RKResourceFileProtocol> owner = self.owner;
+    __block BOOL cached = NO;
+    RKDecodeJob *job = [RKDecodeJob jobDeferringToJobBlock:^RKDecodeJob *{
+        id object = [RKObjectCache.sharedCache objectForKey:[self cacheKeyFromOwner:owner]];
+        if (object) {
+            cached = YES;
+            return [RKDecodeJob jobWithBlock:^id{
+                return object;
+            }];
         }
-    }());
+        return [self decodeJobWithOptions:RKResource.defaultParserOptions owner:owner];
+    }];
+    
+    // The completion handler of the job is left to the caller, so the object is cached
+    // through the result handler instead.
+    job.resultHandler = ^(id object) {
+        if (object && !cached) {
+            [self cacheObject:object];
+        }
+    };
+    return job;
+}
+
+- (RKDecodeJob *)decodeJobWithOptions:(NSDictionary<NSString *, id> *)options
+{
+    return [self decodeJobWithOptions:options owner:self.owner];
+}
+
+- (RKDecodeJob *)decodeJobWithOptions:(NSDictionary<NSString *, id> *)options owner:(id <RKResourceFileProtocol>)owner
+{
+    if ([owner respondsToSelector:@selector(objectForResourceOfType:id:options:)]) {
+        id object = [owner objectForResourceOfType:self.type id:self.id options:options];
+        if (object) {
+            return [RKDecodeJob jobWithBlock:^id{
+                return object;
+            }];
+        }
+    }
+    
+    Class RKParser = [RKResource parserForTypeCode:_typeCode];
+    if ([RKParser respondsToSelector:@selector(incrementalDecoderForData:options:)]) {
+        id <RKIncrementalDecoderProtocol> decoder = [RKParser incrementalDecoderForData:[self dataFromOwner:owner] options:options];
+        if (decoder) {
+            return [[RKDecodeJob alloc] initWithDecoder:decoder];
+        }
+    }
+    
+    // The job may not be stepped until after the resource fork has let go of the file, so
+    // it holds on to both the resource and its owner until it has run.
+    return [RKDecodeJob jobWithBlock:^id{
+        return [self objectWithOptions:options owner:owner];
+    }];
+}
+
+- (RKDecodeRequest *)requestObjectWithPriority:(RKDecodePriority)priority
+                                         queue:(dispatch_queue_t)queue
+                                    completion:(void (^)(id))completion
+{
+    return [RKDecodeScheduler.sharedScheduler scheduleWork:^id{
+        return self.object;
+    } priority:priority queue:queue completion:completion];
 }
 
 - (void)flushCache
 {
-    _object = nil;
+    [RKObjectCache.sharedCache removeObjectForKey:self.cacheKey];
 }
 
 
@@ -90,17 +313,142 @@
     if (subject == self) {
         return YES;
     }
-    else if (subject.id == self.id && [subject.type isEqual:self.type]) {
-        return YES;
+    else if (subject->_id != _id || subject->_typeCode != _typeCode) {
+        return NO;
     }
     
-    return NO;
+    // Every invalid type has the code 0, so those can only be told apart by their strings.
+    return _typeCode != 0 || [subject->_type isEqualToString:_type];
+}
+
+- (NSUInteger)hash
+{
+    NSUInteger typeHash = _typeCode ? _typeCode : _type.hash;
+    return (typeHash << 16) ^ (uint16_t)_id;
 }
 
 @end
 
 
-static const void * RKResourceParsersDictionaryKey = &RKResourceParsersDictionaryKey;
+static const void * RKResourceParserOptionsKey = &RKResourceParserOptionsKey;
+
+// The registry is an immutable table mapping type codes to parsers, which is replaced,
+// never modified, so that it can be read from any thread without a lock. It starts out
+// with the registrations emitted by RK_REGISTER_PARSER. Registering a parser at runtime
+// publishes a new copy of the table. Replaced copies are never released, as another
+// thread may still be reading one, but that only happens to the few parsers registered
+// by hand or by images loaded later.
+typedef struct {
+    ResourceIndex *index;
+    uint32_t count;
+    RKFourCC *types;
+    __unsafe_unretained Class *parsers;
+} RKParserTable;
+
+static _Atomic(RKParserTable *) RKResourceParserRegistry = NULL;
+static os_unfair_lock RKResourceParserRegistryLock = OS_UNFAIR_LOCK_INIT;
+
+// Build a table from the specified registrations. Later registrations of a type replace
+// earlier ones. Parsers are stored by position, with the index mapping each type code to
+// the position of its parser.
+static RKParserTable *RKParserTableCreate(const RKFourCC *types, __unsafe_unretained Class const *parsers, uint32_t count)
+{
+    RKParserTable *table = calloc(1, sizeof(*table));
+    table->index = ResourceIndexCreate(count);
+    table->types = calloc(MAX(count, 1), sizeof(*table->types));
+    table->parsers = (__unsafe_unretained Class *)calloc(MAX(count, 1), sizeof(*table->parsers));
+    
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t position = 0;
+        if (!ResourceIndexLookup(table->index, ResourceIndexKey(types[i], 0), &position)) {
+            position = table->count++;
+            ResourceIndexInsert(table->index, ResourceIndexKey(types[i], 0), position, NULL);
+        }
+        table->types[position] = types[i];
+        table->parsers[position] = parsers[i];
+    }
+    return table;
+}
+
+// Collect the registrations from the parser section of the image with the specified header.
+static void RKParserTableCollect(const struct mach_header *header, NSMutableData *types, NSMutableData *parsers)
+{
+    unsigned long size = 0;
+    const RKParserRegistration *registrations = (const RKParserRegistration *)getsectiondata((const struct mach_header_64 *)header, "__DATA", "__rk_parsers", &size);
+    
+    for (unsigned long i = 0; registrations && i < size / sizeof(*registrations); ++i) {
+        RKFourCC type = RKFourCCFromString(@(registrations[i].type));
+        Class parser = objc_getClass(registrations[i].className);
+        if (!type || !parser) {
+            NSLog(@"Ignoring invalid parser registration of %s for '%s'", registrations[i].className, registrations[i].type);
+            continue;
+        }
+        [types appendBytes:&type length:sizeof(type)];
+        [parsers appendBytes:&parser length:sizeof(parser)];
+    }
+}
+
+// Registrations are read from every image as it is loaded. Those found before the first
+// table is built are held here, by the rank of their image, so that the built in parsers
+// come first, then those of other images, and the main executable's last, letting an
+// application override anything it links. Guarded by the registry lock.
+typedef enum {
+    RKParserImageRank_ResourceKit,
+    RKParserImageRank_Other,
+    RKParserImageRank_Executable,
+    RKParserImageRankCount,
+} RKParserImageRank;
+
+static const struct mach_header *RKParserResourceKitImage = NULL;
+static const struct mach_header *RKParserExecutableImage = NULL;
+static NSMutableData *RKPendingParserTypes[RKParserImageRankCount];
+static NSMutableData *RKPendingParsers[RKParserImageRankCount];
+
+// Publish a new table made of the current one followed by the specified registrations,
+// which therefore replace any earlier registrations of the same types. The registry lock
+// must be held.
+static void RKParserTablePublishAppending(const RKFourCC *types, __unsafe_unretained Class const *parsers, uint32_t count)
+{
+    RKParserTable *current = atomic_load_explicit(&RKResourceParserRegistry, memory_order_acquire);
+    NSMutableData *allTypes = [NSMutableData dataWithBytes:current->types length:current->count * sizeof(RKFourCC)];
+    NSMutableData *allParsers = [NSMutableData dataWithBytes:current->parsers length:current->count * sizeof(Class)];
+    [allTypes appendBytes:types length:count * sizeof(RKFourCC)];
+    [allParsers appendBytes:parsers length:count * sizeof(Class)];
+    
+    RKParserTable *table = RKParserTableCreate(allTypes.bytes, (__unsafe_unretained Class const *)allParsers.bytes, current->count + count);
+    atomic_store_explicit(&RKResourceParserRegistry, table, memory_order_release);
+}
+
+// Called by dyld for every image that is already loaded when it is registered, and then
+// for every image loaded after that, such as a plug-in bundle.
+static void RKParserTableAddImage(const struct mach_header *header, intptr_t slide __unused)
+{
+    NSMutableData *types = [NSMutableData new];
+    NSMutableData *parsers = [NSMutableData new];
+    RKParserTableCollect(header, types, parsers);
+    if (types.length == 0) {
+        return;
+    }
+    
+    os_unfair_lock_lock(&RKResourceParserRegistryLock);
+    if (atomic_load_explicit(&RKResourceParserRegistry, memory_order_acquire)) {
+        RKParserTablePublishAppending(types.bytes, (__unsafe_unretained Class const *)parsers.bytes, (uint32_t)(types.length / sizeof(RKFourCC)));
+    }
+    else {
+        RKParserImageRank rank = (header == RKParserResourceKitImage) ? RKParserImageRank_ResourceKit
+                               : (header == RKParserExecutableImage) ? RKParserImageRank_Executable
+                               : RKParserImageRank_Other;
+        [RKPendingParserTypes[rank] appendData:types];
+        [RKPendingParsers[rank] appendData:parsers];
+    }
+    os_unfair_lock_unlock(&RKResourceParserRegistryLock);
+}
+
+static RKParserTable *RKResourceParsers(void)
+{
+    [RKResource loadParsers];
+    return atomic_load_explicit(&RKResourceParserRegistry, memory_order_acquire);
+}
 
 @implementation RKResource (RKResourceParsing)
 
@@ -108,36 +456,73 @@ static const void * RKResourceParsersDictionaryKey = &RKResourceParsersDictionar
 {
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        int classCount = 0;
-        classCount = objc_getClassList(NULL, classCount);
-        if (classCount) {
-            Class *classes = (__unsafe_unretained Class *)calloc(classCount, sizeof(*classes));
-            objc_getClassList(classes, classCount);
-
-            // Step through the classes and search for ones that conform to RKResourceParserProtocol
-            for (int i = 0; i < classCount; ++i) {
-                Method method = class_getClassMethod(classes[i], @selector(register));
-                if (method) {
-                    [classes[i] register];
-                }
-            }
-            
-            free(classes);
+        Dl_info info;
+        RKParserResourceKitImage = dladdr((const void *)&RKParserTableCollect, &info) ? info.dli_fbase : NULL;
+        RKParserExecutableImage = _dyld_get_image_header(0);
+        for (int rank = 0; rank < RKParserImageRankCount; ++rank) {
+            RKPendingParserTypes[rank] = [NSMutableData new];
+            RKPendingParsers[rank] = [NSMutableData new];
+        }
+        
+        // Registering the callback reports every image that is already loaded, which only
+        // collects their registrations, as there is no table yet. Images loaded from then on
+        // are added to the table once it has been published.
+        _dyld_register_func_for_add_image(RKParserTableAddImage);
+        
+        os_unfair_lock_lock(&RKResourceParserRegistryLock);
+        NSMutableData *types = [NSMutableData new];
+        NSMutableData *parsers = [NSMutableData new];
+        for (int rank = 0; rank < RKParserImageRankCount; ++rank) {
+            [types appendData:RKPendingParserTypes[rank]];
+            [parsers appendData:RKPendingParsers[rank]];
+            RKPendingParserTypes[rank] = nil;
+            RKPendingParsers[rank] = nil;
         }
+        RKParserTable *table = RKParserTableCreate(types.bytes, (__unsafe_unretained Class const *)parsers.bytes, (uint32_t)(types.length / sizeof(RKFourCC)));
+        atomic_store_explicit(&RKResourceParserRegistry, table, memory_order_release);
+        os_unfair_lock_unlock(&RKResourceParserRegistryLock);
     });
 }
 
 + (void)registerParser:(Class)cls forType:(NSString *)type
 {
-    NSMutableDictionary <NSString *, Class> *parsers = objc_getAssociatedObject(self, RKResourceParsersDictionaryKey) ?: [NSMutableDictionary new];
-    [parsers setObject:cls forKey:type];
-    objc_setAssociatedObject(self, RKResourceParsersDictionaryKey, parsers, OBJC_ASSOCIATION_RETAIN);
+    RKFourCC code = RKFourCCFromString(type);
+    if (!code) {
+        NSLog(@"Unable to register parser %@ for invalid type '%@'", cls, type);
+        return;
+    }
+    
+    // The table is loaded before taking the lock, as loading it takes the lock itself.
+    [self loadParsers];
+    os_unfair_lock_lock(&RKResourceParserRegistryLock);
+    __unsafe_unretained Class parser = cls;
+    RKParserTablePublishAppending(&code, &parser, 1);
+    os_unfair_lock_unlock(&RKResourceParserRegistryLock);
 }
 
 + (nullable Class)parserForType:(nonnull NSString *)type
 {
-    NSDictionary <NSString *, Class> *parsers = objc_getAssociatedObject(self, RKResourceParsersDictionaryKey) ?: [NSMutableDictionary new];
-    return parsers[type];
+    return [self parserForTypeCode:RKFourCCFromString(type)];
+}
+
++ (nullable Class)parserForTypeCode:(RKFourCC)code
+{
+    RKParserTable *table = RKResourceParsers();
+    uint32_t position = 0;
+    if (!code || !ResourceIndexLookup(table->index, ResourceIndexKey(code, 0), &position)) {
+        return Nil;
+    }
+    return table->parsers[position];
+}
+
++ (nullable NSDictionary<NSString *, id> *)defaultParserOptions
+{
+    return objc_getAssociatedObject(self, RKResourceParserOptionsKey);
+}
+
++ (void)setDefaultParserOptions:(nullable NSDictionary<NSString *, id> *)options
+{
+    objc_setAssociatedObject(self, RKResourceParserOptionsKey, options, OBJC_ASSOCIATION_COPY);
 }
 
 @end
@@ -0,0 +1,70 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "ClassicMacTypes.h"
+
+/// A resource identified by its packed type code and id.
+typedef struct RKResourceKey {
+    RKFourCC type;
+    int16_t id;
+} RKResourceKey;
+
+/// A change set describes how the resources of a resource fork changed when one of its
+/// files was reloaded. It is described in terms of the fork rather than the file: a
+/// resource the file added but a later file shadows is not included, and a resource the
+/// file removed that an earlier file also provides is included as changed rather than
+/// removed. RKResourceDiff produces change sets too, comparing two versions of a file or
+/// two forks.
+///
+/// Each list holds RKResourceKey values packed into a single block of data, sorted by
+/// type code and then by id.
+@interface RKResourceChangeSet : NSObject
+
+/// The path of the file that was reloaded or compared, or nil if two forks were compared.
+@property (nullable, readonly, copy) NSString *filePath;
+
+/// The resources the fork has now that it did not have before the file was reloaded.
+@property (nonnull, readonly) NSData *addedResources;
+
+/// The resources the fork no longer has.
+@property (nonnull, readonly) NSData *removedResources;
+
+/// The resources the fork still has, but whose name, size or data is now different.
+@property (nonnull, readonly) NSData *changedResources;
+
+/// The distinct types of every resource in the change set, sorted.
+@property (nonnull, readonly) NSArray <NSString *> *affectedTypes;
+
+/// Whether the reload left every resource of the fork as it was.
+@property (readonly, getter=isEmpty) BOOL empty;
+
+/// Instantiates a change set with the specified lists of packed RKResourceKey values,
+/// which must already be sorted.
+- (nonnull instancetype)initWithFilePath:(nullable NSString *)filePath
+                          addedResources:(nonnull NSData *)addedResources
+                        removedResources:(nonnull NSData *)removedResources
+                        changedResources:(nonnull NSData *)changedResources;
+
+@end
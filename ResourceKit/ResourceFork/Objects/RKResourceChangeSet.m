@@ -0,0 +1,66 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKResourceChangeSet.h"
+#import "RKFourCC.h"
+
+@implementation RKResourceChangeSet
+
+- (nonnull instancetype)initWithFilePath:(nullable NSString *)filePath
+                          addedResources:(nonnull NSData *)addedResources
+                        removedResources:(nonnull NSData *)removedResources
+                        changedResources:(nonnull NSData *)changedResources
+{
+    if (self = [super init]) {
+        _filePath = filePath.copy;
+        _addedResources = addedResources.copy;
+        _removedResources = removedResources.copy;
+        _changedResources = changedResources.copy;
+        
+        NSMutableSet <NSNumber *> *codes = [NSMutableSet new];
+        for (NSData *list in @[_addedResources, _removedResources, _changedResources]) {
+            const RKResourceKey *key = list.bytes;
+            for (NSUInteger i = 0; i < list.length / sizeof(*key); ++i) {
+                [codes addObject:@(key[i].type)];
+            }
+        }
+        
+        NSMutableArray <NSString *> *types = [NSMutableArray arrayWithCapacity:codes.count];
+        for (NSNumber *code in codes) {
+            [types addObject:NSStringFromFourCC(code.unsignedIntValue)];
+        }
+        _affectedTypes = [types sortedArrayUsingSelector:@selector(compare:)];
+    }
+    return self;
+}
+
+
+#pragma mark - Calculated Properties
+
+- (BOOL)isEmpty
+{
+    return _addedResources.length == 0 && _removedResources.length == 0 && _changedResources.length == 0;
+}
+
+@end
@@ -0,0 +1,48 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "RKResourceFileProtocol.h"
+#import "RKResourceChangeSet.h"
+
+@class RKResourceFork;
+
+/// RKResourceDiff compares two versions of a resource file, or two resource forks, by the
+/// type, id, size and content hash of each resource. Nothing is parsed or copied: resources
+/// whose sizes differ are modified without looking any further, resources read from the
+/// same bytes of the same file are unchanged, and only the remaining candidates have their
+/// data hashed, straight from the mapping of their file.
+@interface RKResourceDiff : NSObject
+
+/// Returns the resources that were added to, removed from or modified in the new file
+/// relative to the old one. The change set has the path of the new file.
++ (nonnull RKResourceChangeSet *)changesFromResourceFile:(nonnull id <RKResourceFileProtocol>)oldFile
+                                          toResourceFile:(nonnull id <RKResourceFileProtocol>)newFile;
+
+/// Returns the resources that differ between the merged contents of two resource forks,
+/// as they stand when this is called. The change set has no file path.
++ (nonnull RKResourceChangeSet *)changesFromResourceFork:(nonnull RKResourceFork *)oldFork
+                                          toResourceFork:(nonnull RKResourceFork *)newFork;
+
+@end
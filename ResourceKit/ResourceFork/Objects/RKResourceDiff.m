@@ -0,0 +1,184 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKResourceDiff.h"
+#import "RKResourceFork.h"
+#import "RKFourCC.h"
+#import "ContentHash.h"
+
+// A resource of one side of a diff, as much as is needed to compare it.
+typedef struct {
+    int16_t id;
+    uint32_t size;
+    RKBytesView data;
+} RKResourceDiffItem;
+
+// One side of a diff: its types, the items of each type sorted by id, and a way to read
+// the data of a resource that could not be viewed in place.
+@interface RKResourceDiffSide : NSObject
+@property (nonatomic, copy) NSArray <NSString *> *types;
+@property (nonatomic, copy) NSData *(^itemsOfType)(RKFourCC type);
+@property (nonatomic, copy) NSData *(^dataOfResource)(RKFourCC type, int16_t resourceId);
+@end
+
+@implementation RKResourceDiffSide
+@end
+
+
+@implementation RKResourceDiff
+
+#pragma mark - Sides
+
++ (RKResourceDiffSide *)sideWithResourceFile:(id <RKResourceFileProtocol>)file
+{
+    RKResourceDiffSide *side = [RKResourceDiffSide new];
+    side.types = file.allTypes;
+    side.itemsOfType = ^NSData *(RKFourCC type) {
+        NSData *entries = [file resourceEntriesOfTypeCode:type];
+        const RKResourceEntry *entry = entries.bytes;
+        NSUInteger count = entries.length / sizeof(*entry);
+        
+        NSMutableData *items = [NSMutableData dataWithLength:count * sizeof(RKResourceDiffItem)];
+        RKResourceDiffItem *item = items.mutableBytes;
+        for (NSUInteger i = 0; i < count; ++i) {
+            item[i] = (RKResourceDiffItem){ entry[i].id, entry[i].size, [file dataViewOfResourceEntry:entry[i]] };
+        }
+        return items;
+    };
+    side.dataOfResource = ^NSData *(RKFourCC type, int16_t resourceId) {
+        if ([file respondsToSelector:@selector(dataForResourceOfTypeCode:id:)]) {
+            return [file dataForResourceOfTypeCode:type id:resourceId];
+        }
+        return [file dataForResourceOfType:NSStringFromFourCC(type) id:resourceId];
+    };
+    return side;
+}
+
++ (RKResourceDiffSide *)sideWithResourceFork:(RKResourceFork *)fork
+{
+    RKResourceDiffSide *side = [RKResourceDiffSide new];
+    side.types = fork.allTypes;
+    side.itemsOfType = ^NSData *(RKFourCC type) {
+        NSMutableData *items = [NSMutableData dataWithCapacity:[fork handlesOfTypeCode:type].length / sizeof(RKResourceHandle) * sizeof(RKResourceDiffItem)];
+        [fork enumerateResourcesOfTypeCode:type idRange:RKResourceIdRangeAll usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+            RKResourceDiffItem item = { info->id, info->size, info->data };
+            [items appendBytes:&item length:sizeof(item)];
+        }];
+        return items;
+    };
+    side.dataOfResource = ^NSData *(RKFourCC type, int16_t resourceId) {
+        return [fork dataForResourceOfTypeCode:type id:resourceId];
+    };
+    return side;
+}
+
+
+#pragma mark - Comparison
+
++ (nonnull RKResourceChangeSet *)changesFromResourceFile:(nonnull id <RKResourceFileProtocol>)oldFile
+                                          toResourceFile:(nonnull id <RKResourceFileProtocol>)newFile
+{
+    return [self changesFromSide:[self sideWithResourceFile:oldFile] toSide:[self sideWithResourceFile:newFile] filePath:newFile.filePath];
+}
+
++ (nonnull RKResourceChangeSet *)changesFromResourceFork:(nonnull RKResourceFork *)oldFork
+                                          toResourceFork:(nonnull RKResourceFork *)newFork
+{
+    return [self changesFromSide:[self sideWithResourceFork:oldFork] toSide:[self sideWithResourceFork:newFork] filePath:nil];
+}
+
+static uint64_t RKResourceDiffHash(RKResourceDiffSide *side, RKFourCC type, const RKResourceDiffItem *item)
+{
+    if (!item->data.bytes && item->size > 0) {
+        NSData *data = side.dataOfResource(type, item->id);
+        return ContentHash(data.bytes, data.length, 0);
+    }
+    return ContentHash(item->data.bytes, item->data.length, 0);
+}
+
++ (RKResourceChangeSet *)changesFromSide:(RKResourceDiffSide *)oldSide
+                                  toSide:(RKResourceDiffSide *)newSide
+                                filePath:(NSString *)filePath
+{
+    NSMutableSet <NSNumber *> *codes = [NSMutableSet new];
+    for (NSString *type in [oldSide.types arrayByAddingObjectsFromArray:newSide.types]) {
+        RKFourCC code = RKFourCCFromString(type);
+        if (code) {
+            [codes addObject:@(code)];
+        }
+    }
+    
+    NSMutableData *added = [NSMutableData data];
+    NSMutableData *removed = [NSMutableData data];
+    NSMutableData *modified = [NSMutableData data];
+    NSArray <NSNumber *> *sortedCodes = [codes.allObjects sortedArrayUsingSelector:@selector(compare:)];
+    for (NSNumber *code in sortedCodes) {
+        @autoreleasepool {
+            RKFourCC type = code.unsignedIntValue;
+            NSData *oldItems = oldSide.itemsOfType(type);
+            NSData *newItems = newSide.itemsOfType(type);
+            const RKResourceDiffItem *before = oldItems.bytes;
+            const RKResourceDiffItem *after = newItems.bytes;
+            NSUInteger beforeCount = oldItems.length / sizeof(*before);
+            NSUInteger afterCount = newItems.length / sizeof(*after);
+            
+            // Both sides are sorted by id, so they are walked together.
+            NSUInteger i = 0;
+            NSUInteger j = 0;
+            while (i < beforeCount || j < afterCount) {
+                BOOL inBefore = i < beforeCount && (j >= afterCount || before[i].id <= after[j].id);
+                BOOL inAfter = j < afterCount && (i >= beforeCount || after[j].id <= before[i].id);
+                RKResourceKey key = { type, inAfter ? after[j].id : before[i].id };
+                
+                if (!inBefore) {
+                    [added appendBytes:&key length:sizeof(key)];
+                }
+                else if (!inAfter) {
+                    [removed appendBytes:&key length:sizeof(key)];
+                }
+                else if (before[i].size != after[j].size) {
+                    [modified appendBytes:&key length:sizeof(key)];
+                }
+                else if (before[i].data.bytes && before[i].data.bytes == after[j].data.bytes) {
+                    // The same bytes of the same mapping, such as a file both forks share.
+                }
+                else if (RKResourceDiffHash(oldSide, type, &before[i]) != RKResourceDiffHash(newSide, type, &after[j])) {
+                    [modified appendBytes:&key length:sizeof(key)];
+                }
+                
+                i += inBefore;
+                j += inAfter;
+            }
+        }
+    }
+    
+    // The types were visited in order of their codes, and the ids of each in order, so the
+    // lists are already sorted.
+    return [[RKResourceChangeSet alloc] initWithFilePath:filePath
+                                          addedResources:added
+                                        removedResources:removed
+                                        changedResources:modified];
+}
+
+@end
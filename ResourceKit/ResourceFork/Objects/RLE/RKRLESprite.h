@@ -23,6 +23,9 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "RKPixelBuffer.h"
+
+@class RKColorTable;
 
 @interface RKRLESprite : NSObject
 
@@ -30,15 +33,58 @@
 @property (atomic, assign, readonly) uint32_t transparentColor;
 @property (atomic, assign, readonly) CGImageRef imageValue;
 
+/// The decoded pixels of the sprite. The image value of the sprite wraps this buffer.
+@property (nonnull, atomic, strong, readonly) RKPixelBuffer *pixelBuffer;
+
 - (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor;
+- (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor pixelFormat:(RKPixelFormat)format;
+
+/// Create a sprite whose 8-bit pixels are looked up in the specified color table. If the
+/// format is RKPixelFormat_Indexed8 the pixels are stored as indices and the transparent
+/// color is ignored. Indexed sprites only accept 8-bit pixels. A format that is not valid
+/// is stored as RKPixelFormat_RGBA8888.
+- (instancetype)initWithSize:(CGSize)size
+            transparentColor:(uint32_t)transparentColor
+                 pixelFormat:(RKPixelFormat)format
+                  colorTable:(nonnull RKColorTable *)colorTable;
+
+/// Create a sprite as above, optionally with room for a mip chain in its pixel buffer.
+/// Indexed sprites are never mipmapped. Call -generateMipmaps once the sprite has been
+/// written to fill in the chain.
+- (instancetype)initWithSize:(CGSize)size
+            transparentColor:(uint32_t)transparentColor
+                 pixelFormat:(RKPixelFormat)format
+                  colorTable:(nonnull RKColorTable *)colorTable
+                   mipmapped:(BOOL)mipmapped;
 
+/// Create a sprite around a pixel buffer that has already been decoded, such as one
+/// served from a baked archive. The sprite takes its size from the buffer, and its
+/// transparent color is zero.
+- (instancetype)initWithPixelBuffer:(nonnull RKPixelBuffer *)pixelBuffer;
+
+/// Fill in the mip chain of the sprite from the pixels that have been written to it.
+- (void)generateMipmaps;
+
+/// Write pixels into the sprite. Offsets are specified in pixels from the top left
+/// corner of the sprite.
 - (void)writePixelDataDepth8:(uint8_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset;
 - (void)writePixelDataDepth16:(uint16_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset;
 - (void)writePixelRunDepth8:(uint8_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset;
 - (void)writePixelRunDepth16Variant1:(uint32_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset;
 - (void)writePixelRunDepth16Variant2:(uint32_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset;
 
-- (void)render;
+/// Write a run of opaque 8-bit pixels into the sprite.
+- (void)writePixelsDepth8:(nonnull const uint8_t *)pixels count:(uint32_t)count atOffset:(uint32_t)offset;
+
+/// Write a run of opaque pixels into the sprite, cycling through the 4 bytes of the
+/// specified value from the most significant byte.
+- (void)writePixelRunDepth8:(uint32_t)pixel count:(uint32_t)count atOffset:(uint32_t)offset;
+
+/// Write a run of opaque, big endian 16-bit pixels into the sprite.
+- (void)writePixelsDepth16:(nonnull const uint8_t *)pixels count:(uint32_t)count atOffset:(uint32_t)offset;
 
+/// Write a run of opaque pixels into the sprite, alternating between the high and low
+/// 16-bit words of the specified value.
+- (void)writePixelRunDepth16:(uint32_t)pixel count:(uint32_t)count atOffset:(uint32_t)offset;
 
 @end
@@ -23,77 +23,161 @@
 //
 
 #import "RKRLESprite.h"
+#import "RKPixelBuffer.h"
+#import "RKPixelConverter.h"
+#import "RKColorTable.h"
 
-@interface RKRLESprite ()
-@property (nonatomic, assign) uint8_t *data;
-@property (nonatomic, assign) uint8_t *mask;
-@property (nonatomic, assign) uint8_t *rgbRaw;
-@end
+@implementation RKRLESprite {
+@private
+    __strong RKColorTable *_colorTable;
+    const RKPixelConverter *_converter;
+    uint8_t *_pixels;
+    uint32_t _width;
+    uint32_t _pixelCount;
+    size_t _stride;
+}
 
+- (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor
+{
+    return [self initWithSize:size transparentColor:transparentColor pixelFormat:RKPixelFormat_RGBA8888];
+}
 
-@implementation RKRLESprite
+- (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor pixelFormat:(RKPixelFormat)format
+{
+    return [self initWithSize:size transparentColor:transparentColor pixelFormat:format colorTable:RKColorTable.standardColorTable];
+}
 
-- (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor
+- (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor pixelFormat:(RKPixelFormat)format colorTable:(RKColorTable *)colorTable
+{
+    return [self initWithSize:size transparentColor:transparentColor pixelFormat:format colorTable:colorTable mipmapped:NO];
+}
+
+- (instancetype)initWithSize:(CGSize)size transparentColor:(uint32_t)transparentColor pixelFormat:(RKPixelFormat)format colorTable:(RKColorTable *)colorTable mipmapped:(BOOL)mipmapped
 {
     if (self = [super init]) {
         self->_size = size;
         self->_transparentColor = transparentColor;
+        _colorTable = colorTable;
         
-        [self prepare];
+        [self prepareWithFormat:format mipmapped:mipmapped];
     }
     return self;
 }
 
-- (void)dealloc
+- (instancetype)initWithPixelBuffer:(RKPixelBuffer *)pixelBuffer
 {
-    free(self.data);
-    free(self.mask);
-    free(self.rgbRaw);
-    CGImageRelease(self->_imageValue);
+    if (self = [super init]) {
+        self->_size = pixelBuffer.size;
+        self->_pixelBuffer = pixelBuffer;
+        _colorTable = pixelBuffer.colorTable ?: RKColorTable.standardColorTable;
+        _converter = (pixelBuffer.format == RKPixelFormat_Indexed8) ? NULL : RKPixelConverterForFormat(pixelBuffer.format);
+        _pixels = pixelBuffer.bytes;
+        _width = pixelBuffer.width;
+        _pixelCount = _width * pixelBuffer.height;
+        _stride = pixelBuffer.stride;
+    }
+    return self;
 }
 
 #pragma mark - Setup
 
-- (void)prepare
+- (void)prepareWithFormat:(RKPixelFormat)format mipmapped:(BOOL)mipmapped
 {
-    size_t size = self.size.width * self.size.height * 3;
+    if (!RKPixelFormatIsValid(format)) {
+        format = RKPixelFormat_RGBA8888;
+    }
     
-    self.data = malloc(size);
-    self.mask = malloc(size);
+    if (format == RKPixelFormat_Indexed8) {
+        // Indexed sprites start out fully masked, and have no converter.
+        self->_pixelBuffer = [RKPixelBuffer indexedPixelBufferWithWidth:self.size.width
+                                                                 height:self.size.height
+                                                             colorTable:_colorTable
+                                                                 masked:YES];
+        _converter = NULL;
+    }
+    else {
+        self->_pixelBuffer = [RKPixelBuffer pixelBufferWithWidth:self.size.width
+                                                          height:self.size.height
+                                                          format:format
+                                                       mipmapped:mipmapped];
+        _converter = RKPixelConverterForFormat(format);
+    }
     
-    for (NSUInteger i = 0; i < (size / 3); ++i) {
-        self.data[3 * i] = self.transparentColor & 0xff;
-        self.data[3 * i + 1] = (self.transparentColor >> 8) & 0xff;
-        self.data[3 * i + 2] = (self.transparentColor >> 16) & 0xff;
-        
-        self.mask[3 * i] = 0x00;
-        self.mask[3 * i + 1] = 0x00;
-        self.mask[3 * i + 2] = 0x00;
+    _pixels = self.pixelBuffer.bytes;
+    _width = self.pixelBuffer.width;
+    _pixelCount = _width * self.pixelBuffer.height;
+    _stride = self.pixelBuffer.stride;
+    
+    // Pixel buffers start out zeroed, which is already fully transparent. Only fill the
+    // sprite if a different transparent color has been requested. The color is AARRGGBB.
+    if (self.transparentColor != 0 && _converter) {
+        for (uint32_t i = 0; i < _pixelCount; ++i) {
+            [self storeRed:(self.transparentColor >> 16) & 0xff
+                     green:(self.transparentColor >> 8) & 0xff
+                      blue:self.transparentColor & 0xff
+                      mask:(self.transparentColor >> 24) & 0xff
+                  atOffset:i];
+        }
     }
 }
 
+- (void)generateMipmaps
+{
+    [self.pixelBuffer generateMipmaps];
+}
+
 #pragma mark - Construction
 
+// Translate the offset from a linear pixel index to a location inside the (possibly
+// padded) rows of the pixel buffer.
+static inline uint8_t *RKRLESpritePixelAtOffset(uint8_t *pixels, uint32_t offset, uint32_t width, size_t stride, size_t bytesPerPixel)
+{
+    return pixels + (offset / width) * stride + (offset % width) * bytesPerPixel;
+}
+
+// Mark a run of pixels within a single row of a mask as opaque or transparent.
+static inline void RKRLESpriteSetMask(uint8_t *mask, uint32_t x, uint32_t count, BOOL opaque)
+{
+    for (uint32_t i = x; i < x + count; ++i) {
+        uint8_t bit = 0x80 >> (i & 7);
+        mask[i >> 3] = opaque ? (mask[i >> 3] | bit) : (mask[i >> 3] & ~bit);
+    }
+}
+
+- (void)storeRed:(uint8_t)r green:(uint8_t)g blue:(uint8_t)b mask:(uint8_t)mask atOffset:(uint32_t)offset
+{
+    if (offset >= _pixelCount || !_converter) {
+        return;
+    }
+    _converter->storeRGBA(RKRLESpritePixelAtOffset(_pixels, offset, _width, _stride, _converter->bytesPerPixel), r, g, b, mask);
+}
+
 - (void)writePixelDataDepth8:(uint8_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset
 {
-    self.data[offset] = pixel;
-    self.data[offset + 1] = pixel;
-    self.data[offset + 2] = pixel;
-    
-    self.mask[offset] = mask;
-    self.mask[offset + 1] = mask;
-    self.mask[offset + 2] = mask;
+    if (offset >= _pixelCount) {
+        return;
+    }
+    else if (!_converter) {
+        // Indexed sprites can only represent pixels that are either opaque or not.
+        _pixels[(offset / _width) * _stride + (offset % _width)] = pixel;
+        RKRLESpriteSetMask(self.pixelBuffer.maskBytes + (offset / _width) * self.pixelBuffer.maskStride, offset % _width, 1, mask >= 0x80);
+    }
+    else {
+        const uint8_t *color = _colorTable.entries + pixel * 4;
+        [self storeRed:color[0] green:color[1] blue:color[2] mask:mask atOffset:offset];
+    }
 }
 
 - (void)writePixelDataDepth16:(uint16_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset
 {
-    self.data[offset] = (pixel & 0x001F) << 3;
-    self.data[offset + 1] = (pixel & 0x03E0) >> 2;
-    self.data[offset + 2] = (pixel & 0x7C00) >> 7;
-    
-    self.mask[offset] = mask;
-    self.mask[offset + 1] = mask;
-    self.mask[offset + 2] = mask;
+    uint8_t r = (pixel >> 10) & 0x1F;
+    uint8_t g = (pixel >> 5) & 0x1F;
+    uint8_t b = pixel & 0x1F;
+    [self storeRed:(r << 3) | (r >> 2)
+             green:(g << 3) | (g >> 2)
+              blue:(b << 3) | (b >> 2)
+              mask:mask
+          atOffset:offset];
 }
 
 - (void)writePixelRunDepth8:(uint8_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset
@@ -103,60 +187,101 @@
 
 - (void)writePixelRunDepth16Variant1:(uint32_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset
 {
-    self.data[offset] = (pixel & 0x001F0000) << 13;
-    self.data[offset + 1] = (pixel & 0x03E00000) >> 18;
-    self.data[offset + 2] = (pixel & 0x7C000000) >> 23;
-    
-    self.mask[offset] = mask;
-    self.mask[offset + 1] = mask;
-    self.mask[offset + 2] = mask;
+    [self writePixelDataDepth16:(pixel >> 16) & 0xFFFF withMask:mask atOffset:offset];
 }
 
 - (void)writePixelRunDepth16Variant2:(uint32_t)pixel withMask:(uint8_t)mask atOffset:(uint32_t)offset
 {
-    self.data[offset] = (pixel & 0x0000001F) << 3;
-    self.data[offset + 1] = (pixel & 0x000003E0) >> 2;
-    self.data[offset + 2] = (pixel & 0x00007C00) >> 7;
-    
-    self.mask[offset] = mask;
-    self.mask[offset + 1] = mask;
-    self.mask[offset + 2] = mask;
+    [self writePixelDataDepth16:pixel & 0xFFFF withMask:mask atOffset:offset];
 }
 
+- (void)writePixelsDepth8:(const uint8_t *)pixels count:(uint32_t)count atOffset:(uint32_t)offset
+{
+    count = MIN(count, offset < _pixelCount ? _pixelCount - offset : 0);
+    while (count > 0) {
+        uint32_t x = offset % _width;
+        uint32_t y = offset / _width;
+        uint32_t n = MIN(count, _width - x);
+        
+        if (!_converter) {
+            memcpy(_pixels + y * _stride + x, pixels, n);
+            RKRLESpriteSetMask(self.pixelBuffer.maskBytes + y * self.pixelBuffer.maskStride, x, n, YES);
+        }
+        else {
+            _converter->convertIndexed(_pixels + y * _stride + x * _converter->bytesPerPixel, pixels, _colorTable.entries, n);
+        }
+        
+        pixels += n;
+        offset += n;
+        count -= n;
+    }
+}
 
-#pragma mark - Image Construction
+- (void)writePixelRunDepth8:(uint32_t)pixel count:(uint32_t)count atOffset:(uint32_t)offset
+{
+    // Expand the repeating pattern a chunk at a time and write it as ordinary pixel data.
+    // The chunk is a multiple of 4 pixels so the pattern carries on between chunks.
+    uint8_t pattern[64];
+    while (count > 0) {
+        uint32_t n = MIN(count, (uint32_t)sizeof(pattern));
+        for (uint32_t i = 0; i < n; ++i) {
+            pattern[i] = (pixel >> (24 - 8 * (i & 3))) & 0xFF;
+        }
+        [self writePixelsDepth8:pattern count:n atOffset:offset];
+        offset += n;
+        count -= n;
+    }
+}
 
-- (void)render
+- (void)writePixelsDepth16:(const uint8_t *)pixels count:(uint32_t)count atOffset:(uint32_t)offset
 {
-    free(self.rgbRaw);
-    
-    size_t size = self.size.width * self.size.height * 4;
-    size_t dataSize = self.size.width * self.size.height * 3;
-    self.rgbRaw = malloc(size);
-    
-    for (NSUInteger i = 0, j = 0; i < dataSize; i+=3, j+=4) {
-        self.rgbRaw[j+0] = self.data[i+2];
-        self.rgbRaw[j+1] = self.data[i+1];
-        self.rgbRaw[j+2] = self.data[i+0];
-        self.rgbRaw[j+3] = (self.mask[i+0] + self.mask[i+1] + self.mask[i+2]) / 3;
+    if (!_converter) {
+        return;
     }
     
-    [self constructCGImageWithRGBData:self.rgbRaw];
+    // Runs are expected to stay within a single row, but are split at row boundaries
+    // just in case, as the rows of the pixel buffer are not contiguous.
+    count = MIN(count, offset < _pixelCount ? _pixelCount - offset : 0);
+    while (count > 0) {
+        uint32_t n = MIN(count, _width - (offset % _width));
+        _converter->convertRGB555(RKRLESpritePixelAtOffset(_pixels, offset, _width, _stride, _converter->bytesPerPixel), pixels, n);
+        pixels += n * sizeof(uint16_t);
+        offset += n;
+        count -= n;
+    }
 }
 
-- (void)constructCGImageWithRGBData:(uint8_t *)rgb
+- (void)writePixelRunDepth16:(uint32_t)pixel count:(uint32_t)count atOffset:(uint32_t)offset
 {
-    const size_t componentsPerPixel = 4;
-    const size_t bitsPerComponent = 8;
-    const size_t bytesPerRow = ((bitsPerComponent * self.size.width) / 8) * componentsPerPixel;
-    
-    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-    CGContextRef ctx = CGBitmapContextCreate(rgb, self.size.width, self.size.height, bitsPerComponent, bytesPerRow, colorSpace, (CGBitmapInfo)kCGImageAlphaPremultipliedLast);
+    if (!_converter) {
+        return;
+    }
     
-    self->_imageValue = CGBitmapContextCreateImage(ctx);
+    uint16_t first = (pixel >> 16) & 0xFFFF;
+    uint16_t second = pixel & 0xFFFF;
     
-    CGColorSpaceRelease(colorSpace);
-    CGContextRelease(ctx);
+    count = MIN(count, offset < _pixelCount ? _pixelCount - offset : 0);
+    while (count > 0) {
+        uint32_t n = MIN(count, _width - (offset % _width));
+        _converter->fillRGB555(RKRLESpritePixelAtOffset(_pixels, offset, _width, _stride, _converter->bytesPerPixel), first, second, n);
+        
+        // Keep the alternation going if the run was split on an odd pixel.
+        if (n & 1) {
+            uint16_t t = first;
+            first = second;
+            second = t;
+        }
+        offset += n;
+        count -= n;
+    }
+}
+
+
+#pragma mark - Image Construction
+
+- (CGImageRef)imageValue
+{
+    return self.pixelBuffer.imageValue;
 }
 
 @end
@@ -30,12 +30,7 @@
 
 #pragma mark - Auto-Loading
 
-+ (void)register
-{
-    // Register the parser in the resource class. This will allow the resource
-    // to lookup an appropriate parser when required.
-    [RKResource registerParser:self forType:@"bööm"];
-}
+RK_REGISTER_PARSER(RKNovaBoomResourceParser, "bööm");
 
 
 #pragma mark - Data Reading
@@ -25,14 +25,13 @@
 #import "RKNovaResourceTypeParser.h"
 #import "RKResource.h"
 #import "NSData+Parsing.h"
+#import <objc/runtime.h>
 
 @implementation RKNovaResourceTypeParser {
 @private
     __strong NSData * _data;
 }
 
-+ (void)register {}
-
 #pragma mark - Top Level
 
 + (id)parseData:(NSData *)data
@@ -41,6 +40,12 @@
     return parser ? parser.object : nil;
 }
 
++ (size_t)costOfObject:(id)object
+{
+    // Nova objects are a handful of scalar fields.
+    return class_getInstanceSize([object class]);
+}
+
 
 #pragma mark - Internal Instantiation
 
@@ -30,12 +30,7 @@
 
 #pragma mark - Auto-Loading
 
-+ (void)register
-{
-    // Register the parser in the resource class. This will allow the resource
-    // to lookup an appropriate parser when required.
-    [RKResource registerParser:self forType:@"spïn"];
-}
+RK_REGISTER_PARSER(RKNovaSpinResourceParser, "spïn");
 
 
 #pragma mark - Data Reading
@@ -26,6 +26,10 @@
 #import "RKResource.h"
 #import "NSData+Parsing.h"
 #import "RKPackBitsDecoder.h"
+#import "RKPixelBuffer.h"
+#import "RKPixelConverter.h"
+#import "RKColorTable.h"
+#import "PixelStorage.h"
 #import <Cocoa/Cocoa.h>
 
 #pragma mark - Support
@@ -34,6 +38,8 @@ typedef NS_ENUM(uint16_t, RKPictureOpcode)
 {
     RKPictureOpcode_nop = 0x0000,
     RKPictureOpcode_clipRegion = 0x0001,
+    RKPictureOpcode_bitsRect = 0x0090,
+    RKPictureOpcode_packBitsRect = 0x0098,
     RKPictureOpcode_directBitsRect = 0x009A,
     RKPictureOpcode_eof = 0x00FF,
     RKPictureOpcode_defHilite = 0x001E,
@@ -79,48 +85,160 @@ typedef struct {
 
 
 
+/// The state of a bitmap opcode that is part way through being decoded.
+typedef struct {
+    BOOL active;
+    BOOL direct;
+    BOOL packed;
+    BOOL indexed;
+    RKPictPixMap px;
+    RKPictRect sourceRect;
+    uint32_t width;
+    uint32_t height;
+    uint32_t scanline;
+    uint32_t packedRowBytes;
+    uint32_t valueSize;
+    size_t rawLength;
+} RKPictBitmapState;
+
+
+@interface RKPictureResourceParser () <RKIncrementalDecoderProtocol>
+@end
+
 @implementation RKPictureResourceParser {
 @private
     __strong NSImage *_currentImage;
+    __strong RKPixelBuffer *_currentPixels;
     __strong NSData * _data;
     RKMacRect _frame;
     RKPictRect _regionRect;
     double _xRatio;
     double _yRatio;
+    __strong NSNumber *_requestedPixelFormat;
+    BOOL _mipmapped;
+    
+    // Decoding state, which is kept between steps.
+    RKDecodeStatus _status;
+    BOOL _headerParsed;
+    RKPictBitmapState _bitmap;
+    __strong RKPixelBuffer *_pixels;
+    __strong RKColorTable *_colorTable;
+    const RKPixelConverter *_converter;
+    PixelStorage *_scratch;
 }
 
 #pragma mark - Auto-Loading
 
-+ (void)register
-{
-    // Register the parser in the resource class. This will allow the resource
-    // to lookup an appropriate parser when required.
-    [RKResource registerParser:self forType:@"PICT"];
-}
+RK_REGISTER_PARSER(RKPictureResourceParser, "PICT");
 
 
 #pragma mark - Top Level
 
 + (id)parseData:(NSData *)data
 {
-    RKPictureResourceParser *parser = [[self alloc] initWithData:data];
-    return parser ? parser->_currentImage : nil;
+    return [self parseData:data options:nil];
+}
+
++ (id)parseData:(NSData *)data options:(NSDictionary<NSString *, id> *)options
+{
+    RKPictureResourceParser *parser = [self incrementalDecoderForData:data options:options];
+    return ([parser decodeUntil:UINT64_MAX] == RKDecodeStatus_Complete) ? parser.decodedObject : nil;
+}
+
++ (id<RKIncrementalDecoderProtocol>)incrementalDecoderForData:(NSData *)data options:(NSDictionary<NSString *, id> *)options
+{
+    return [[self alloc] initWithData:data
+                          pixelFormat:options[RKResourceParserOptionPixelFormat]
+                            mipmapped:[options[RKResourceParserOptionGenerateMipmaps] boolValue]];
+}
+
++ (size_t)costOfObject:(id)object
+{
+    // Any further representations are the smaller levels of a mip chain, which together
+    // come to no more than a third of the first.
+    NSImage *image = object;
+    CGImageRef cgImage = [image CGImageForProposedRect:NULL context:nil hints:nil];
+    size_t cost = cgImage ? CGImageGetBytesPerRow(cgImage) * CGImageGetHeight(cgImage) : 0;
+    return (image.representations.count > 1) ? cost + cost / 3 : cost;
 }
 
 
 #pragma mark - Internal Instantiation
 
-- (instancetype)initWithData:(NSData *)data
+- (instancetype)initWithData:(NSData *)data pixelFormat:(NSNumber *)format mipmapped:(BOOL)mipmapped
 {
     if (self = [super init]) {
         _data = data.copy;
-        if (![self parse]) {
-            return nil;
-        }
+        _requestedPixelFormat = RKPixelFormatFromParserOption(format);
+        _mipmapped = mipmapped;
+        _status = RKDecodeStatus_Incomplete;
     }
     return self;
 }
 
+- (void)dealloc
+{
+    PixelStorageRelease(_scratch);
+}
+
+
+#pragma mark - Incremental Decoding
+
+- (RKDecodeStatus)decodeUntil:(uint64_t)deadline
+{
+    if (_status != RKDecodeStatus_Incomplete) {
+        return _status;
+    }
+    
+    if (!_headerParsed) {
+        if (![self parseHeader]) {
+            return (_status = RKDecodeStatus_Failed);
+        }
+        _headerParsed = YES;
+    }
+    
+    // We're now at a point of parsing out the main picture body. PICT does this in a
+    // slightly strange way. It uses "opcodes" and a series of instructions on how to
+    // produce the picture. There are a lot of these in the PICT specification, and
+    // from what I have been able to determine the vast majority are unused by EV Nova.
+    BOOL progressed = NO;
+    RKPictureOpcode op;
+    
+    for (;;) {
+        // Bitmaps are by far the most expensive part of a picture, so they are decoded a
+        // scanline at a time with the deadline checked between each one.
+        while (_bitmap.active) {
+            if (progressed && RKDecodeClock() >= deadline) {
+                return RKDecodeStatus_Incomplete;
+            }
+            if (![self decodeScanline]) {
+                return (_status = RKDecodeStatus_Failed);
+            }
+            progressed = YES;
+        }
+        
+        if (_data.position >= _data.length || (op = self.readOpcode) == RKPictureOpcode_eof) {
+            break;
+        }
+        
+        if (![self parseOpcode:op]) {
+            return (_status = RKDecodeStatus_Failed);
+        }
+    }
+    
+    return (_status = RKDecodeStatus_Complete);
+}
+
+- (id)decodedObject
+{
+    return _currentImage;
+}
+
+- (NSArray<RKPixelBuffer *> *)decodedPixelBuffers
+{
+    return (_status == RKDecodeStatus_Complete && _currentPixels) ? @[ _currentPixels ] : nil;
+}
+
 
 #pragma mark - Data Reading
 
@@ -130,7 +248,7 @@ typedef struct {
     return _data.readWord;
 }
 
-- (BOOL)parse
+- (BOOL)parseHeader
 {
     // PICT was a format back in the classic era and was designed under a big endian
     // system and architecture. Therefore all the data in the format is stored as such.
@@ -194,41 +312,38 @@ typedef struct {
     
     // The final 4 bytes of the header also appear to be unused.
     _data.position += 4;
-    
-    // We're now at a point of parsing out the main picture body. PICT does this in a
-    // slightly strange way. It uses "opcodes" and a series of instructions on how to
-    // produce the picture. There are a lot of these in the PICT specification, and
-    // from what I have been able to determine the vast majority are unused by EV Nova.
-    RKPictureOpcode op;
-    
-    while (_data.position < _data.length && (op = self.readOpcode) != RKPictureOpcode_eof) {
-        switch (op) {
-            case RKPictureOpcode_clipRegion:
-                [self readRegionWithRect:&_regionRect];
-                break;
-                
-            case RKPictureOpcode_directBitsRect:
-                [self parseDirectBitsRect];
-                break;
-                
-            case RKPictureOpcode_longComment:
-                [self parseLongComment];
-                break;
-                
-            case RKPictureOpcode_nop:
-            case RKPictureOpcode_extHeader:
-            case RKPictureOpcode_defHilite:
-                break;
-                
-            default:
-                NSLog(@"Encountered an unhandled opcode: %04x", op);
-                return NO;
-        }
-    }
-    
     return YES;
 }
 
+- (BOOL)parseOpcode:(RKPictureOpcode)op
+{
+    switch (op) {
+        case RKPictureOpcode_clipRegion:
+            [self readRegionWithRect:&_regionRect];
+            return YES;
+            
+        case RKPictureOpcode_directBitsRect:
+            return [self beginDirectBitsRect];
+            
+        case RKPictureOpcode_bitsRect:
+        case RKPictureOpcode_packBitsRect:
+            return [self beginIndexedBitsRectPacked:(op == RKPictureOpcode_packBitsRect)];
+            
+        case RKPictureOpcode_longComment:
+            [self parseLongComment];
+            return YES;
+            
+        case RKPictureOpcode_nop:
+        case RKPictureOpcode_extHeader:
+        case RKPictureOpcode_defHilite:
+            return YES;
+            
+        default:
+            NSLog(@"Encountered an unhandled opcode: %04x", op);
+            return NO;
+    }
+}
+
 
 #pragma mark - Helpers
 
@@ -247,14 +362,8 @@ typedef struct {
     _data.position += (sizeof(uint16_t) * 2 * points);
 }
 
-- (RKPictPixMap *)parsePixMap
+- (void)parsePixMapFields:(RKPictPixMap *)px
 {
-    RKPictPixMap *px = calloc(1, sizeof(*px));
-    px->baseAddress = _data.readDWord;
-    
-    uint16_t rowBytesRaw = _data.readWord;
-    px->rowBytes = rowBytesRaw & 0x7FFF;
-    
     px->bounds = RKPictRectFromMacRect(_data.readMacRect);
     
     px->pmVersion = _data.readWord;
@@ -272,13 +381,51 @@ typedef struct {
     px->planeBytes = _data.readDWord;
     px->pmTable = _data.readDWord;
     px->pmReserved = _data.readDWord;
-    return px;
 }
 
-- (void)parseDirectBitsRect
+- (RKColorTable *)readColorTable
 {
-    RKPictPixMap *px = self.parsePixMap;
-    RKPictRect sourceRect = RKPictRectFromMacRect(_data.readMacRect);
+    _data.position += 4; // Seed
+    uint16_t flags = _data.readWord;
+    uint32_t count = (uint32_t)_data.readWord + 1;
+    
+    // Each entry specifies the index it belongs to, unless the table is a device table in
+    // which case the entries are simply in order. Components are 16-bit, and only the high
+    // byte is of interest.
+    uint8_t entries[RKColorTableCapacity * 4] = { 0 };
+    uint32_t highest = 0;
+    
+    for (uint32_t i = 0; i < count; ++i) {
+        uint16_t value = _data.readWord;
+        uint8_t r = _data.readWord >> 8;
+        uint8_t g = _data.readWord >> 8;
+        uint8_t b = _data.readWord >> 8;
+        
+        uint32_t index = (flags & 0x8000) ? i : value;
+        if (index < RKColorTableCapacity) {
+            entries[index * 4 + 0] = r;
+            entries[index * 4 + 1] = g;
+            entries[index * 4 + 2] = b;
+            entries[index * 4 + 3] = UINT8_MAX;
+            highest = MAX(highest, index + 1);
+        }
+    }
+    
+    return [RKColorTable colorTableWithEntries:entries count:highest];
+}
+
+
+#pragma mark - Bitmaps
+
+- (BOOL)beginDirectBitsRect
+{
+    memset(&_bitmap, 0, sizeof(_bitmap));
+    RKPictPixMap *px = &_bitmap.px;
+    px->baseAddress = _data.readDWord;
+    px->rowBytes = _data.readWord & 0x7FFF;
+    [self parsePixMapFields:px];
+    
+    _bitmap.sourceRect = RKPictRectFromMacRect(_data.readMacRect);
     RKPictRect destinationRect = RKPictRectFromMacRect(_data.readMacRect);
     
     // The next 2 bytes represent the "mode" for the direct bits packing. However
@@ -289,117 +436,223 @@ typedef struct {
     // type 3 and 4.
     if (!(px->packType == 3 || px->packType == 4)) {
         NSLog(@"Unsupported pack type: %d", px->packType);
-        abort();
+        return NO;
     }
     
-    uint8_t *raw = NULL;
-    uint16_t *pxShortArray = NULL;
-    uint32_t *pxArray = NULL;
+    // Direct pictures have no color table, so can not be stored indexed.
+    RKPixelFormat format = _requestedPixelFormat.unsignedIntValue;
+    if (format == RKPixelFormat_Indexed8) {
+        format = RKPixelFormat_RGBA8888;
+    }
     
-    if (px->packType == 3) {
-        raw = calloc(px->rowBytes, sizeof(*raw));
-        pxShortArray = calloc(sourceRect.height * (px->rowBytes + 1) / 2, sizeof(*pxShortArray));
+    // The decoded pixels are written straight into the destination pixel buffer, one
+    // scanline at a time. The only other memory required is a single scanline of
+    // scratch space to unpack into, which is borrowed from the pixel storage pool.
+    _pixels = [RKPixelBuffer pixelBufferWithWidth:destinationRect.width
+                                           height:destinationRect.height
+                                           format:format
+                                        mipmapped:_mipmapped];
+    _converter = RKPixelConverterForFormat(format);
+    
+    // Narrow pictures don't use the pack bits compression. Not certain what the deciding factor
+    // for such a thing is, but low numbers of rowBytes seem to be the cause. Setting this to the
+    // highest value found that doesn't have compression.
+    _bitmap.direct = YES;
+    _bitmap.packed = YES;
+    _bitmap.packedRowBytes = 5;
+    _bitmap.valueSize = (px->packType == 3) ? sizeof(uint16_t) : 1;
+    _bitmap.rawLength = (px->packType == 3) ? px->rowBytes : MAX(px->rowBytes, px->cmpCount * px->bounds.width);
+    _bitmap.width = MIN(_bitmap.sourceRect.width, destinationRect.width);
+    _bitmap.height = MIN(_bitmap.sourceRect.height, destinationRect.height);
+    
+    return [self beginBitmapWithScratchLength:_bitmap.rawLength];
+}
+
+- (BOOL)beginIndexedBitsRectPacked:(BOOL)packed
+{
+    memset(&_bitmap, 0, sizeof(_bitmap));
+    RKPictPixMap *px = &_bitmap.px;
+    
+    // Indexed pictures store their pixmap without a base address. Only pixmaps are
+    // supported, which are identified by the top bit of the row bytes being set. The older
+    // 1-bit bitmaps are not used by EV Nova.
+    uint16_t rowBytesRaw = _data.readWord;
+    if (!(rowBytesRaw & 0x8000)) {
+        NSLog(@"Unsupported bitmap in picture resource. Aborting parse.");
+        return NO;
     }
-    else if (px->packType == 4) {
-        raw = calloc(px->cmpCount * px->rowBytes / 4, sizeof(*raw));
-        pxArray = calloc(sourceRect.height * (px->rowBytes + 3) / 4, sizeof(*pxArray));
+    
+    px->rowBytes = rowBytesRaw & 0x7FFF;
+    [self parsePixMapFields:px];
+    
+    if (px->pixelSize == 0 || px->pixelSize > 8 || (8 % px->pixelSize) != 0) {
+        NSLog(@"Unsupported pixel size in picture resource: %d", px->pixelSize);
+        return NO;
     }
     
+    _colorTable = self.readColorTable;
+    _bitmap.sourceRect = RKPictRectFromMacRect(_data.readMacRect);
+    RKPictRect destinationRect = RKPictRectFromMacRect(_data.readMacRect);
+    _data.position += 2; // Mode
+    
+    // Indexed pictures are kept indexed unless a direct format has been explicitly requested.
+    _bitmap.indexed = (!_requestedPixelFormat || _requestedPixelFormat.unsignedIntValue == RKPixelFormat_Indexed8);
+    if (_bitmap.indexed) {
+        _pixels = [RKPixelBuffer indexedPixelBufferWithWidth:destinationRect.width
+                                                      height:destinationRect.height
+                                                  colorTable:_colorTable
+                                                      masked:NO];
+        _converter = NULL;
+    }
+    else {
+        _pixels = [RKPixelBuffer pixelBufferWithWidth:destinationRect.width
+                                               height:destinationRect.height
+                                               format:_requestedPixelFormat.unsignedIntValue
+                                            mipmapped:_mipmapped];
+        _converter = RKPixelConverterForFormat(_pixels.format);
+    }
     
-    uint32_t pxBufOffset = 0;
-    uint16_t packedBytesCount = 0;
+    // Rows of fewer than 8 bytes are never packed. Pixel sizes below 8 bits are widened
+    // to one index per byte after the raw scanline in the scratch space.
+    _bitmap.packed = packed;
+    _bitmap.packedRowBytes = 8;
+    _bitmap.valueSize = 1;
+    _bitmap.rawLength = MAX(px->rowBytes, 1);
+    _bitmap.width = MIN(_bitmap.sourceRect.width, destinationRect.width);
+    _bitmap.height = MIN(_bitmap.sourceRect.height, destinationRect.height);
     
-    for (uint32_t scanline = 0; scanline < sourceRect.height; ++scanline) {
-        
-        // Narrow pictures don't use the pack bits compression. Not certain what the deciding factor
-        // for such a thing is, but low numbers of rowBytes seem to be the cause. Setting this to the
-        // highest value found that doesn't have compression.
-        if (px->rowBytes <= 4) { // No PackBits Compression
-            [[_data readDataOfLength:px->rowBytes] getBytes:raw length:sourceRect.width * 2];
+    return [self beginBitmapWithScratchLength:_bitmap.rawLength + _bitmap.width];
+}
+
+- (BOOL)beginBitmapWithScratchLength:(size_t)length
+{
+    if (!_pixels) {
+        NSLog(@"Invalid bitmap bounds in picture resource. Aborting parse.");
+        return NO;
+    }
+    
+    PixelStorageRelease(_scratch);
+    if ((_scratch = PixelStorageCreate(length)) == NULL) {
+        NSLog(@"Unable to allocate scanline space for picture resource. Aborting parse.");
+        return NO;
+    }
+    _bitmap.active = YES;
+    
+    if (_bitmap.sourceRect.height <= 0) {
+        [self finishBitmap];
+    }
+    return YES;
+}
+
+- (BOOL)decodeScanline
+{
+    RKPictPixMap *px = &_bitmap.px;
+    const uint8_t *bytes = _data.bytes;
+    uint8_t *raw = _scratch->bytes;
+    
+    if (!_bitmap.packed || px->rowBytes < _bitmap.packedRowBytes) {
+        // No PackBits Compression
+        if (_data.position + px->rowBytes > _data.length) {
+            NSLog(@"Early end of bitmap data in picture resource. Aborting parse.");
+            return NO;
         }
-        else { // Pack Bits Compression
-            packedBytesCount = px->rowBytes > 250 ? _data.readWord : _data.readByte;
-            
-            // Read a single scanline from the data. This will need to be decoded.
-            NSData *encodedScanline = [_data readDataOfLength:packedBytesCount];
-            if (px->packType == 3) {
-                NSData *decodedScanline = [RKPackBitsDecoder decodeData:encodedScanline withValueSize:sizeof(uint16_t)];
-                [decodedScanline getBytes:raw length:sourceRect.width * 2];
-            }
-            else {
-                NSData *decodedScanline = [RKPackBitsDecoder decodeData:encodedScanline withValueSize:1];
-                [decodedScanline getBytes:raw length:sourceRect.width * 2];
-            }
+        memcpy(raw, bytes + _data.position, MIN(px->rowBytes, _bitmap.rawLength));
+        _data.position += px->rowBytes;
+    }
+    else {
+        // Pack Bits Compression
+        uint16_t packedBytesCount = px->rowBytes > 250 ? _data.readWord : _data.readByte;
+        if (_data.position + packedBytesCount > _data.length) {
+            NSLog(@"Early end of bitmap data in picture resource. Aborting parse.");
+            return NO;
         }
         
-        if (px->packType == 3) {
-            // Store the decoded pixel data.
-            for (uint32_t i = 0; i < sourceRect.width; ++i) {
-                pxShortArray[pxBufOffset + i] = (uint16_t)(((0xFF & raw[2*i]) << 8) | (0xFF & raw[2*i+1]));
-            }
+        // Decode a single scanline from the data straight into the scratch space.
+        RKPackBitsDecode(bytes + _data.position, packedBytesCount, raw, _bitmap.rawLength, _bitmap.valueSize);
+        _data.position += packedBytesCount;
+    }
+    
+    if (_bitmap.scanline < _bitmap.height) {
+        uint8_t *out = [_pixels rowAtIndex:_bitmap.scanline];
+        if (_bitmap.direct) {
+            [self convertDirectScanline:raw into:out];
         }
         else {
-            if (px->cmpCount == 3) {
-                // RGB Data
-                for (int32_t i = 0; i < sourceRect.width; ++i) {
-                    pxArray[pxBufOffset + i] = 0xFF000000
-                    | (raw[i] & 0xFF) << 16
-                    | (raw[px->bounds.width + i] & 0xFF) << 8
-                    | (raw[2 * px->bounds.width + i] & 0xFF);
-                }
-            }
-            else {
-                // ARGB Data
-                for (int32_t i = 0; i < sourceRect.width; ++i) {
-                    pxArray[pxBufOffset + i] =
-                    (raw[i] & 0xFF) << 24
-                    | (raw[px->bounds.width + i] & 0xFF) << 16
-                    | (raw[2 * px->bounds.width + i] & 0xFF) << 8
-                    | (raw[3 * px->bounds.width + i] & 0xFF);
-                }
-            }
+            [self convertIndexedScanline:raw into:out];
         }
-        
-        
-        pxBufOffset += sourceRect.width;
     }
     
-    // Finally we need to unpack all of the pixel data. This is due to the pixels being
-    // stored in an RGB 555 format. CoreGraphics does not expose a way of cleanly/publically
-    // parsing this type of encoding so we need to convert it to a more modern
-    // representation, such as RGBA 8888
-    uint32_t sourceLength = destinationRect.width * destinationRect.height;
-    uint32_t rgbCount = sourceLength * 4;
-    uint8_t *rgbRaw = calloc(rgbCount, sizeof(*rgbRaw));
+    if (++_bitmap.scanline >= (uint32_t)_bitmap.sourceRect.height) {
+        [self finishBitmap];
+    }
+    return YES;
+}
+
+- (void)convertDirectScanline:(const uint8_t *)raw into:(uint8_t *)out
+{
+    // Finally we need to unpack all of the pixel data. Pack type 3 stores pixels in an
+    // RGB 555 format, and pack type 4 stores separate planes for each component.
+    // CoreGraphics does not expose a way of cleanly/publically parsing these encodings
+    // so we convert them into the requested pixel format.
+    RKPictPixMap *px = &_bitmap.px;
+    uint32_t plane = px->bounds.width;
     
     if (px->packType == 3) {
-        for (uint32_t p = 0, i = 0; i < sourceLength; ++i) {
-            rgbRaw[p++] = ((pxShortArray[i] & 0x7c00) >> 10) << 3;
-            rgbRaw[p++] = ((pxShortArray[i] & 0x03e0) >> 5) << 3;
-            rgbRaw[p++] = ((pxShortArray[i] & 0x001f) << 3);
-            rgbRaw[p++] = UINT8_MAX;
-        }
+        _converter->convertRGB555(out, raw, _bitmap.width);
+    }
+    else if (px->cmpCount == 3) {
+        // RGB Data
+        _converter->convertPlanar(out, raw, raw + plane, raw + 2 * plane, NULL, _bitmap.width);
     }
     else {
-        for (uint32_t p = 0, i = 0; i < sourceLength; ++i) {
-            rgbRaw[p++] = (pxArray[i] & 0xFF0000) >> 16;
-            rgbRaw[p++] = (pxArray[i] & 0xFF00) >> 8;
-            rgbRaw[p++] = (pxArray[i] & 0xFF);
-            rgbRaw[p++] = (pxArray[i] & 0xFF000000) >> 24;
+        // ARGB Data
+        _converter->convertPlanar(out, raw + plane, raw + 2 * plane, raw + 3 * plane, raw, _bitmap.width);
+    }
+}
+
+- (void)convertIndexedScanline:(const uint8_t *)raw into:(uint8_t *)out
+{
+    RKPictPixMap *px = &_bitmap.px;
+    const uint8_t *row = raw;
+    
+    if (px->pixelSize < 8) {
+        uint8_t *indices = _scratch->bytes + _bitmap.rawLength;
+        uint32_t perByte = 8 / px->pixelSize;
+        uint8_t valueMask = (1 << px->pixelSize) - 1;
+        for (uint32_t i = 0; i < _bitmap.width && i / perByte < _bitmap.rawLength; ++i) {
+            uint32_t shift = 8 - px->pixelSize * (1 + i % perByte);
+            indices[i] = (raw[i / perByte] >> shift) & valueMask;
         }
+        row = indices;
     }
     
+    if (_bitmap.indexed) {
+        memcpy(out, row, _bitmap.width);
+    }
+    else {
+        _converter->convertIndexed(out, row, _colorTable.entries, _bitmap.width);
+    }
+}
+
+- (void)finishBitmap
+{
+    [_pixels generateMipmaps];
+    _currentImage = [[NSImage alloc] initWithCGImage:_pixels.imageValue size:_pixels.size];
+    
+    // Each smaller level is added as a further representation of the same size, which
+    // lets AppKit pick the closest level when the picture is drawn scaled down.
+    for (uint32_t level = 1; level < _pixels.levelCount; ++level) {
+        NSBitmapImageRep *rep = [[NSBitmapImageRep alloc] initWithCGImage:[_pixels imageValueForLevel:level]];
+        rep.size = _pixels.size;
+        [_currentImage addRepresentation:rep];
+    }
     
-    CGImageRef image = [self cgImageWithRGBData:rgbRaw frame:destinationRect];
-    _currentImage = [[NSImage alloc] initWithCGImage:image size:CGSizeMake(destinationRect.width, destinationRect.height)];
-    
-    // Clean up memory
-    CGImageRelease(image);
-    free(pxArray);
-    free(pxShortArray);
-    free(rgbRaw);
-    free(raw);
-    free(px);
+    // Clean up memory. The finished buffer is kept, as its storage is shared with the image.
+    PixelStorageRelease(_scratch);
+    _scratch = NULL;
+    _currentPixels = _pixels;
+    _pixels = nil;
+    _bitmap.active = NO;
 }
 
 
@@ -411,23 +664,4 @@ typedef struct {
     _data.position += length;
 }
 
-
-#pragma mark - Image Construction
-
-- (CGImageRef)cgImageWithRGBData:(uint8_t *)rgb frame:(RKPictRect)frame
-{
-    const size_t componentsPerPixel = 4;
-    const size_t bitsPerComponent = 8;
-    const size_t bytesPerRow = ((bitsPerComponent * frame.width) / 8) * componentsPerPixel;
-    
-    CGColorSpaceRef colorSpace = colorSpace = CGColorSpaceCreateDeviceRGB();
-    CGContextRef ctx = CGBitmapContextCreate(rgb, frame.width, frame.height, bitsPerComponent, bytesPerRow, colorSpace, (CGBitmapInfo)kCGImageAlphaPremultipliedLast);
-    
-    CGImageRef image = CGBitmapContextCreateImage(ctx);
-    CGContextRelease(ctx);
-    CGColorSpaceRelease(colorSpace);
-    return image;
-}
-
-
 @end
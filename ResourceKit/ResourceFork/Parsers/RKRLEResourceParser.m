@@ -26,6 +26,8 @@
 #import "RKRLESprite.h"
 #import "RKRLEObject.h"
 #import "RKResource.h"
+#import "RKColorTable.h"
+#import "RKPixelBuffer.h"
 #import "NSData+Parsing.h"
 
 
@@ -39,71 +41,135 @@ typedef NS_ENUM(NSUInteger, RLEOpCode)
 };
 
 
+@interface RKRLEResourceParser () <RKIncrementalDecoderProtocol>
+@end
+
 @implementation RKRLEResourceParser {
 @private
     __strong NSMutableArray <RKRLESprite *> *_sprites;
     __strong NSData * _data;
+    __strong RKRLEObject *_decodedObject;
     
     CGSize _size;
     uint16_t _bytesPerPixel;
     uint16_t _numberOfFrames;
-    uint32_t _bytesPerRow;
+    uint32_t _pixelsPerRow;
+    __strong NSNumber *_requestedPixelFormat;
+    RKPixelFormat _pixelFormat;
+    BOOL _mipmapped;
+    
+    // Decoding state, which is kept between steps.
+    RKDecodeStatus _status;
+    BOOL _preambleParsed;
+    uint32_t _rowStart;
+    int32_t _currentLine;
+    int32_t _currentOffset;
+    int32_t _currentFrame;
+    int32_t _count;
 }
 
 #pragma mark - Auto-Loading
 
-+ (void)register
-{
-    // Register the parser in the resource class. This will allow the resource
-    // to lookup an appropriate parser when required.
-    [RKResource registerParser:self forType:@"RLËD"];
-    [RKResource registerParser:self forType:@"rlëD"];
-}
+RK_REGISTER_PARSER(RKRLEResourceParser, "RLËD");
+RK_REGISTER_PARSER(RKRLEResourceParser, "rlëD");
+RK_REGISTER_PARSER(RKRLEResourceParser, "RLË8");
+RK_REGISTER_PARSER(RKRLEResourceParser, "rlë8");
 
 
 #pragma mark - Top Level
 
 + (id)parseData:(NSData *)data
 {
-    RKRLEResourceParser *parser = [[self alloc] initWithData:data];
-    return parser ? [RKRLEObject.alloc initWithSprites:parser->_sprites ofSize:parser->_size] : nil;
+    return [self parseData:data options:nil];
+}
+
++ (id)parseData:(NSData *)data options:(NSDictionary<NSString *, id> *)options
+{
+    RKRLEResourceParser *parser = [self incrementalDecoderForData:data options:options];
+    return ([parser decodeUntil:UINT64_MAX] == RKDecodeStatus_Complete) ? parser.decodedObject : nil;
+}
+
++ (id<RKIncrementalDecoderProtocol>)incrementalDecoderForData:(NSData *)data options:(NSDictionary<NSString *, id> *)options
+{
+    return [[self alloc] initWithData:data
+                          pixelFormat:options[RKResourceParserOptionPixelFormat]
+                            mipmapped:[options[RKResourceParserOptionGenerateMipmaps] boolValue]];
+}
+
++ (size_t)costOfObject:(id)object
+{
+    size_t cost = 0;
+    for (RKRLESprite *sprite in [(RKRLEObject *)object sprites]) {
+        cost += sprite.pixelBuffer.byteLength;
+    }
+    return cost;
 }
 
 
 #pragma mark - Internal Instantiation
 
-- (instancetype)initWithData:(NSData *)data
+- (instancetype)initWithData:(NSData *)data pixelFormat:(NSNumber *)format mipmapped:(BOOL)mipmapped
 {
     if (self = [super init]) {
         _data = data.copy;
+        _requestedPixelFormat = RKPixelFormatFromParserOption(format);
+        _mipmapped = mipmapped;
         _sprites = NSMutableArray.new;
-        if (![self parse]) {
-            return nil;
-        }
+        _status = RKDecodeStatus_Incomplete;
+        _currentLine = -1;
     }
     return self;
 }
 
 
-#pragma mark - Data Reading
+#pragma mark - Incremental Decoding
 
-- (BOOL)parse
+- (RKDecodeStatus)decodeUntil:(uint64_t)deadline
 {
-    if (![self parsePreamble]) {
-        NSLog(@"Failed to parse the preamble for the RLËD. Aborting");
-        return NO;
+    if (_status != RKDecodeStatus_Incomplete) {
+        return _status;
     }
     
-    [self prepareBlankSprites];
+    if (!_preambleParsed) {
+        if (![self parsePreamble]) {
+            NSLog(@"Failed to parse the preamble for the RLËD. Aborting");
+            return (_status = RKDecodeStatus_Failed);
+        }
+        [self prepareBlankSprites];
+        _preambleParsed = YES;
+    }
     
-    if (![self parseSpriteFrames]) {
+    _status = [self parseSpriteFramesUntil:deadline];
+    if (_status == RKDecodeStatus_Failed) {
         NSLog(@"Failed to parse the sprite frame for the RLËD. Aborting");
-        return NO;
     }
-    
-    return YES;
+    else if (_status == RKDecodeStatus_Complete) {
+        if (_mipmapped) {
+            [_sprites makeObjectsPerformSelector:@selector(generateMipmaps)];
+        }
+        _decodedObject = [RKRLEObject.alloc initWithSprites:_sprites ofSize:_size];
+    }
+    return _status;
+}
+
+- (id)decodedObject
+{
+    return _decodedObject;
+}
+
+- (NSArray<RKPixelBuffer *> *)decodedPixelBuffers
+{
+    return [_decodedObject.sprites valueForKey:@"pixelBuffer"];
+}
+
+- (RKPixelFormat)defaultPixelFormat
+{
+    return (_bytesPerPixel == 8) ? RKPixelFormat_Indexed8 : RKPixelFormat_RGBA8888;
 }
 
+
+#pragma mark - Data Reading
+
 - (BOOL)parsePreamble
 {
     // The first part of the RLË resource is the preamble or header. This begins
@@ -122,13 +188,24 @@ typedef NS_ENUM(NSUInteger, RLEOpCode)
     // And again there seems to be another run of 6 unused bytes.
     _data.position += 6;
     
-    // We're going to assume a colour depth of 16. Anything else will trigger an error.
-    if (_bytesPerPixel != 16) {
+    // Sprites are either 16-bit direct colour, or 8-bit indices into the standard colour
+    // table. Anything else will trigger an error.
+    if (_bytesPerPixel != 16 && _bytesPerPixel != 8) {
         NSLog(@"Invalid colour depth in RLËD resource.");
         return NO;
     }
     
-    _bytesPerRow = _size.width * 3;
+    // 8-bit sprites are kept indexed unless a direct format has been explicitly requested.
+    // 16-bit sprites have no colour table, so can not be stored indexed.
+    _pixelFormat = _requestedPixelFormat.unsignedIntValue;
+    if (_bytesPerPixel == 8 && !_requestedPixelFormat) {
+        _pixelFormat = RKPixelFormat_Indexed8;
+    }
+    else if (_bytesPerPixel == 16 && _pixelFormat == RKPixelFormat_Indexed8) {
+        _pixelFormat = RKPixelFormat_RGBA8888;
+    }
+    
+    _pixelsPerRow = _size.width;
     
     return YES;
 }
@@ -137,71 +214,90 @@ typedef NS_ENUM(NSUInteger, RLEOpCode)
 {
     uint32_t transparentColor = 0x00000000; // AARRGGBB
     for (NSUInteger i = 0; i < _numberOfFrames; ++i) {
-        [_sprites addObject:[RKRLESprite.alloc initWithSize:_size transparentColor:transparentColor]];
+        [_sprites addObject:[RKRLESprite.alloc initWithSize:_size
+                                                    transparentColor:transparentColor
+                                                         pixelFormat:_pixelFormat
+                                                          colorTable:RKColorTable.standardColorTable
+                                                           mipmapped:_mipmapped]];
     }
 }
 
-- (BOOL)parseSpriteFrames
+- (RKDecodeStatus)parseSpriteFramesUntil:(uint64_t)deadline
 {
     NSUInteger position = 0;
-    uint32_t rowStart = 0;
-    int32_t currentLine = -1;
-    int32_t currentOffset = 0;
     int8_t opcode = 0;
-    int32_t count = 0;
-    uint16_t pixel = 0;
-    int32_t currentFrame = 0;
     uint32_t pixelRun = 0;
+    uint32_t opcodesDecoded = 0;
     
-    RKRLESprite *sprite = _sprites.firstObject;
+    // All of the state of the parse lives in instance variables, so that it is able to
+    // stop after any opcode and resume from the same point in a later step.
+    RKRLESprite *sprite = (_currentFrame < _sprites.count) ? _sprites[_currentFrame] : nil;
     
     // Loop forever! The RLËD resource will contain an opcode that tells us where the end of the
     // resource is located.
     for (;;) {
+        // Reading the clock is not free, so only check the deadline every few opcodes.
+        if ((++opcodesDecoded & 0x3F) == 0 && RKDecodeClock() >= deadline) {
+            return RKDecodeStatus_Incomplete;
+        }
+        
         if ((position = _data.position) >= _data.length) {
             NSLog(@"Early End-of-Resource encountered in RLËD");
-            return NO;
+            return RKDecodeStatus_Failed;
         }
         
-        if ((rowStart != 0) && ((position - rowStart) & 0x03)) {
-            position += 4 - ((position - rowStart) & 0x03);
-            _data.position += 4 - (count & 0x03);
+        if ((_rowStart != 0) && ((position - _rowStart) & 0x03)) {
+            position += 4 - ((position - _rowStart) & 0x03);
+            _data.position += 4 - (_count & 0x03);
         }
         
-        count = _data.readDWord;
-        opcode = (count & 0xFF000000) >> 24;
-        count &= 0x00FFFFFF;
+        _count = _data.readDWord;
+        opcode = (_count & 0xFF000000) >> 24;
+        _count &= 0x00FFFFFF;
+        int32_t count = _count;
         
         switch (opcode) {
             case RLEOpCode_EndOfFrame: {
-                if (currentLine != _size.height - 1) {
+                if (_currentLine != _size.height - 1) {
                     NSLog(@"Incorrect number of scanlines in RLËD resource.");
-                    return NO;
+                    return RKDecodeStatus_Failed;
                 }
-                [sprite render];
-                if (++currentFrame >= _numberOfFrames) {
+                if (++_currentFrame >= _numberOfFrames) {
                     // Finished parsing everything successfully.
-                    return YES;
+                    return RKDecodeStatus_Complete;
                 }
-                sprite = _sprites[currentFrame];
-                currentLine = -1;
+                sprite = _sprites[_currentFrame];
+                _currentLine = -1;
                 break;
             }
             
             case RLEOpCode_LineStart: {
-                ++currentLine;
-                currentOffset = currentLine * _bytesPerRow;
-                rowStart = (uint32_t)_data.position;
+                ++_currentLine;
+                _currentOffset = _currentLine * _pixelsPerRow;
+                _rowStart = (uint32_t)_data.position;
                 break;
             }
                 
             case RLEOpCode_PixelData: {
-                for (uint32_t i = 0; i < count; i+=2) {
-                    pixel = _data.readWord;
-                    [sprite writePixelDataDepth16:pixel withMask:0xFF atOffset:currentOffset];
-                    currentOffset += 3;
+                // Pixel data is a run of pixels, which is converted as a whole directly
+                // from the resource data.
+                uint32_t pixelSize = _bytesPerPixel >> 3;
+                uint32_t pixelCount = (count + pixelSize - 1) / pixelSize;
+                if (_data.position + pixelCount * pixelSize > _data.length) {
+                    NSLog(@"Early End-of-Resource encountered in RLËD");
+                    return RKDecodeStatus_Failed;
                 }
                 
+                const uint8_t *pixels = (const uint8_t *)_data.bytes + _data.position;
+                if (pixelSize == 1) {
+                    [sprite writePixelsDepth8:pixels count:pixelCount atOffset:_currentOffset];
+                }
+                else {
+                    [sprite writePixelsDepth16:pixels count:pixelCount atOffset:_currentOffset];
+                }
+                _data.position += pixelCount * pixelSize;
+                _currentOffset += pixelCount;
+                
                 if (count & 0x03) {
                     _data.position += 4 - (count & 0x03);
                 }
@@ -209,33 +305,35 @@ typedef NS_ENUM(NSUInteger, RLEOpCode)
             }
                 
             case RLEOpCode_TransparentRun: {
-                currentOffset += (count >> ((_bytesPerPixel >> 3) - 1)) * 3;
+                _currentOffset += (count >> ((_bytesPerPixel >> 3) - 1));
                 break;
             }
                 
             case RLEOpCode_PixelRun: {
+                // The run value holds either two 16-bit or four 8-bit pixels, which repeat
+                // for the length of the run.
                 pixelRun = _data.readDWord;
-                for (uint32_t i = 0; i < count; i+=4) {
-                    [sprite writePixelRunDepth16Variant1:pixel withMask:0xFF atOffset:currentOffset];
-                    currentOffset += 3;
-                    
-                    if (i + 2 < count) {
-                        [sprite writePixelRunDepth16Variant2:pixel withMask:0xFF atOffset:currentOffset];
-                        currentOffset += 3;
-                    }
+                if (_bytesPerPixel == 8) {
+                    [sprite writePixelRunDepth8:pixelRun count:count atOffset:_currentOffset];
+                    _currentOffset += count;
+                }
+                else {
+                    uint32_t pixelCount = (count + 1) >> 1;
+                    [sprite writePixelRunDepth16:pixelRun count:pixelCount atOffset:_currentOffset];
+                    _currentOffset += pixelCount;
                 }
                 break;
             }
                 
             default: {
                 NSLog(@"Invalid opcode encountered in RLËD resource.");
-                return NO;
+                return RKDecodeStatus_Failed;
             }
         }
     }
     
     // Unreachable...
-    return NO;
+    return RKDecodeStatus_Failed;
 }
 
 @end
@@ -34,12 +34,7 @@
 
 #pragma mark - Auto-Loading
 
-+ (void)register
-{
-    // Register the parser in the resource class. This will allow the resource
-    // to lookup an appropriate parser when required.
-    [RKResource registerParser:self forType:@"STR#"];
-}
+RK_REGISTER_PARSER(RKStringListResourceParser, "STR#");
 
 
 #pragma mark - Top Level
@@ -50,6 +45,15 @@
     return parser ? parser->_strings : nil;
 }
 
++ (size_t)costOfObject:(id)object
+{
+    size_t cost = 0;
+    for (NSString *string in (NSArray <NSString *> *)object) {
+        cost += sizeof(void *) + string.length * sizeof(unichar);
+    }
+    return cost;
+}
+
 
 #pragma mark - Internal Instantiation
 
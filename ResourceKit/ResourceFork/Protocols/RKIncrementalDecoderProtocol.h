@@ -0,0 +1,66 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <time.h>
+#import "RKPixelBuffer.h"
+
+typedef NS_ENUM(NSUInteger, RKDecodeStatus)
+{
+    RKDecodeStatus_Incomplete,
+    RKDecodeStatus_Complete,
+    RKDecodeStatus_Failed,
+};
+
+/// Returns the current time in nanoseconds on the clock that decode deadlines are
+/// measured against.
+static inline uint64_t RKDecodeClock(void)
+{
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+/// An incremental decoder holds all of the state of a partially decoded resource, so
+/// that decoding can be spread across many short steps.
+@protocol RKIncrementalDecoderProtocol <NSObject>
+
+/// Continue decoding until either the resource has been fully decoded, or the deadline
+/// (as measured by RKDecodeClock) has passed. Some progress must be made by every call,
+/// even if the deadline has already passed.
+- (RKDecodeStatus)decodeUntil:(uint64_t)deadline;
+
+/// The decoded object. This is only available once decoding has completed.
+@property (nullable, readonly) id decodedObject;
+
+@optional
+
+/// The pixel buffers that the decoded object was built from, in order. Image decoders
+/// provide these so that their output can be baked into an archive. This is only
+/// available once decoding has completed.
+@property (nullable, readonly) NSArray <RKPixelBuffer *> *decodedPixelBuffers;
+
+/// The pixel format the decoder produces when no format is requested, which may depend on
+/// the resource being decoded. This is only available once decoding has completed.
+@property (readonly) RKPixelFormat defaultPixelFormat;
+
+@end
@@ -23,9 +23,63 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "ClassicMacTypes.h"
 
 @class RKResource;
 
+/// A breakdown of the memory held by the resource map of a resource file, as reported by
+/// -resourceMapUsage.
+typedef struct RKResourceMapUsage {
+    /// The number of resources in the file.
+    NSUInteger resourceCount;
+    
+    /// The number of distinct resource names in the file.
+    NSUInteger nameCount;
+    
+    /// The bytes held by the resource records and the pool of names they refer to.
+    NSUInteger bytes;
+    
+    /// The bytes the same records would need if each carried its name in a fixed 256 byte
+    /// field, as they did before names were pooled.
+    NSUInteger inlineNameBytes;
+    
+    /// The number of names that have been made into strings so far.
+    NSUInteger internedStringCount;
+} RKResourceMapUsage;
+
+/// A compact description of a single resource in a resource file, used to list resources
+/// without creating an RKResource for each of them.
+typedef struct RKResourceEntry {
+    /// The id of the resource.
+    int16_t id;
+    
+    /// The size of the data of the resource.
+    uint32_t size;
+    
+    /// A value that the file which produced the entry uses to find the rest of the
+    /// resource, such as its name. It has no meaning to anything else.
+    uint32_t reference;
+    
+    /// The offset of the data of the resource within the file that produced the entry.
+    uint32_t dataOffset;
+} RKResourceEntry;
+
+/// Orders two resource entries by id, for sorting and searching the entries of a type
+/// with qsort and bsearch.
+static inline int RKResourceEntryCompareIds(const void *_Nonnull lhs, const void *_Nonnull rhs)
+{
+    int16_t lhsId = ((const RKResourceEntry *)lhs)->id;
+    int16_t rhsId = ((const RKResourceEntry *)rhs)->id;
+    return (lhsId > rhsId) - (lhsId < rhsId);
+}
+
+/// A view of bytes owned by something else, such as the mapping of a resource file. The
+/// bytes are not copied and are not terminated.
+typedef struct RKBytesView {
+    const void *_Nullable bytes;
+    NSUInteger length;
+} RKBytesView;
+
 /// The RKResourceFileProtocol is a protocol that can represent any type of resource
 /// file. A resource file is one denoted as having a representation of a ResourceFork
 /// flattened into the DataFork.
@@ -57,4 +111,49 @@
 /// Returns the data for the resource with the specified type and id.
 - (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id;
 
+/// Returns an RKResourceEntry for each of the resources of the specified type, sorted by
+/// id and packed into a single block of data. No resource objects are created.
+- (nonnull NSData *)resourceEntriesOfTypeCode:(RKFourCC)type;
+
+/// Returns the name of the resource described by an entry that the receiver produced.
+- (nonnull NSString *)nameOfResourceEntry:(RKResourceEntry)entry;
+
+/// Returns the resource described by an entry of the specified type that the receiver
+/// produced. The resource is created the first time it is asked for, and the same
+/// instance is returned for it from then on, including by -resourcesOfType:.
+- (nonnull RKResource *)resourceForEntry:(RKResourceEntry)entry typeCode:(RKFourCC)type;
+
+/// Returns a view of the MacRoman bytes of the name of the resource described by an entry
+/// that the receiver produced. The bytes remain valid for as long as the receiver does.
+- (RKBytesView)nameViewOfResourceEntry:(RKResourceEntry)entry;
+
+/// Returns a view of the data of the resource described by an entry that the receiver
+/// produced, read straight from a mapping of the file. The bytes remain valid for as long
+/// as the receiver does, and the view is empty if the data could not be mapped or the file
+/// has since been truncated to before its end.
+- (RKBytesView)dataViewOfResourceEntry:(RKResourceEntry)entry;
+
+@optional
+
+/// Returns the data for the resource with the specified packed type code and id. Resources
+/// ask their file for data this way when it is available, so that the type is never
+/// converted to a string and back.
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
+/// Returns an object for the resource with the specified type and id that the file
+/// already holds in decoded form, such as an image in a baked archive, or nil if the
+/// resource has to be parsed. The object must be the same as the parser would produce
+/// with the specified options.
+- (nullable id)objectForResourceOfType:(nonnull NSString *)type
+                                    id:(int16_t)id
+                               options:(nullable NSDictionary <NSString *, id> *)options;
+
+/// Returns the resource with the specified packed type code and id if the receiver has
+/// already created it, or nil if it has not, without creating one.
+- (nullable RKResource *)existingResourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
+/// Returns the memory held by the parsed resource map of the file. Files that are read
+/// from an index cache or archive map their resource map instead, and report nothing.
+- (RKResourceMapUsage)resourceMapUsage;
+
 @end
@@ -23,15 +23,61 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "RKIncrementalDecoderProtocol.h"
 
-@protocol RKResourceParserProtocol <NSObject>
+/// The RKPixelFormat (as an NSNumber) that image parsers should decode into. Parsers
+/// default to RKPixelFormat_RGBA8888 when it is not specified.
+FOUNDATION_EXPORT NSString * _Nonnull const RKResourceParserOptionPixelFormat;
+
+/// Whether image parsers should build a mip chain for each image they decode (as an
+/// NSNumber holding a BOOL). Images decoded into indexed buffers are not mipmapped.
+/// Defaults to NO.
+FOUNDATION_EXPORT NSString * _Nonnull const RKResourceParserOptionGenerateMipmaps;
+
+/// An entry in the parser registration table. These are emitted by RK_REGISTER_PARSER
+/// and should not need to be created directly.
+typedef struct {
+    /// The resource type, as a UTF-8 string.
+    const char * _Nonnull type;
+    /// The name of the class of the parser.
+    const char * _Nonnull className;
+} RKParserRegistration;
+
+#define RK_PARSER_REGISTRATION_NAME_(line) RKParserRegistration_##line
+#define RK_PARSER_REGISTRATION_NAME(line) RK_PARSER_REGISTRATION_NAME_(line)
+
+/// Register the parser class for the specified resource type at link time. The
+/// registration is placed in a section of the binary that ResourceKit reads from every
+/// loaded image when the first parser is looked up, and from every image loaded after
+/// that, so no classes need to be searched or messaged at runtime. The main executable
+/// overrides the parsers of the images loaded with it, which override those built in to
+/// ResourceKit, and an image loaded later, such as a plug-in, overrides all of them.
+#define RK_REGISTER_PARSER(cls, typeString) \
+    __attribute__((used, section("__DATA,__rk_parsers"))) \
+    static const RKParserRegistration RK_PARSER_REGISTRATION_NAME(__LINE__) = { typeString, #cls }
 
-/// Instructs the parser to register itself with the resource reader.
-+ (void)register;
+@protocol RKResourceParserProtocol <NSObject>
 
 /// Take a data object and parse its contents in order to produce an output
 /// object. A nil result will be returned if the parser is unable to correctly
 /// operate on the data.
 + (nullable id)parseData:(nonnull NSData *)data;
 
+@optional
+
+/// Parse the data in the same manner as parseData:, but using the specified options to
+/// control how the output object is produced. Parsers that have no options to honour
+/// do not need to implement this.
++ (nullable id)parseData:(nonnull NSData *)data options:(nullable NSDictionary <NSString *, id> *)options;
+
+/// Create a decoder that parses the data a piece at a time, producing the same object
+/// as parseData:options:. Parsers that are unable to do this do not need to implement it.
++ (nullable id <RKIncrementalDecoderProtocol>)incrementalDecoderForData:(nonnull NSData *)data
+                                                                options:(nullable NSDictionary <NSString *, id> *)options;
+
+/// Returns an estimate of the number of bytes occupied by an object that the parser
+/// produced. This is what the object is charged against the budget of the object cache.
+/// Objects from parsers that do not implement this are charged the size of their data.
++ (size_t)costOfObject:(nonnull id)object;
+
 @end
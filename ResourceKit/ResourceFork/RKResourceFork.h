@@ -24,7 +24,86 @@
 
 #import <Foundation/Foundation.h>
 #import "RKResourceFileProtocol.h"
+#import "RKDecodeScheduler.h"
+#import "RKResourceChangeSet.h"
 
+/// The totals of decoding every resource of a type.
+typedef struct {
+    /// The number of resources that were decoded.
+    NSUInteger count;
+    /// The number of resources that did not produce an object.
+    NSUInteger failures;
+    /// The combined size of the data of the resources.
+    uint64_t bytes;
+    /// The combined time, in nanoseconds, spent decoding each of the resources.
+    uint64_t decodeTime;
+    /// The time, in nanoseconds, from the start of the first decode to the end of the last.
+    uint64_t elapsedTime;
+} RKBulkDecodeSummary;
+
+/// The totals of the resources of a type whose data is identical to that of another
+/// resource of the same type, as reported by -duplicationSummaryOfTypeCode:.
+typedef struct {
+    /// The number of resources of the type.
+    NSUInteger count;
+    /// The number of distinct payloads among them.
+    NSUInteger uniqueCount;
+    /// The combined size of the data of the resources.
+    uint64_t bytes;
+    /// The combined size of the data of each resource that is a copy of another. Resources
+    /// with the same type and data share one decoded object, so this is the data that no
+    /// longer has to be parsed or cached.
+    uint64_t duplicateBytes;
+} RKDuplicationSummary;
+
+/// A compact reference to a resource of a resource fork. A handle is a position in the
+/// merged index of the fork, so resources can be listed and inspected through handles
+/// without an RKResource being created for each one. Handles remain valid for as long as
+/// the fork does, unless a reloaded file leaves the fork without the resource at all. When
+/// a later file shadows a resource, its handle refers to the replacement.
+typedef uint32_t RKResourceHandle;
+
+/// The handle returned for a resource that does not exist.
+static const RKResourceHandle RKResourceHandleNotFound = UINT32_MAX;
+
+/// A description of a single resource passed to the block of
+/// -enumerateResourcesOfTypeCode:idRange:usingBlock:. The name and data are views into
+/// the file the resource comes from, and remain valid for as long as the fork does.
+typedef struct RKResourceInfo {
+    RKResourceHandle handle;
+    int16_t id;
+    uint32_t size;
+    RKBytesView name;
+    RKBytesView data;
+} RKResourceInfo;
+
+/// An inclusive range of resource ids.
+typedef struct RKResourceIdRange {
+    int16_t first;
+    int16_t last;
+} RKResourceIdRange;
+
+static inline RKResourceIdRange RKResourceIdRangeMake(int16_t first, int16_t last)
+{
+    return (RKResourceIdRange){ first, last };
+}
+
+/// The range that includes every resource id.
+static const RKResourceIdRange RKResourceIdRangeAll = { INT16_MIN, INT16_MAX };
+
+/// Posted when a file of a resource fork has been reloaded and the resources of the fork
+/// changed as a result. The object is the fork, and the user info holds the
+/// RKResourceChangeSet under RKResourceForkChangeSetKey. It is posted on the thread that
+/// reloaded the file.
+FOUNDATION_EXPORT NSNotificationName const _Nonnull RKResourceForkDidReloadResourceFileNotification;
+
+/// The key of the change set in the user info of RKResourceForkDidReloadResourceFileNotification.
+FOUNDATION_EXPORT NSString *const _Nonnull RKResourceForkChangeSetKey;
+
+/// A resource fork merges the resources of any number of resource files. Its state is
+/// published as immutable snapshots: adding files builds a new snapshot and swaps it in,
+/// so lookups never wait for files to be merged, even while files are being added on
+/// another thread. Each lookup sees the files that had been added when it started.
 @interface RKResourceFork : NSObject
 
 /// Returns a resource fork instance that is shared across all resource files in
@@ -37,9 +116,53 @@
 
 
 /// Load the file at the specified path as a resource file and add it to the receiver.
-/// This will return the resource file for reference.
+/// This will return the resource file for reference. The resources of the file are
+/// merged into the receiver as it is added, replacing any resources with the same type
+/// and id from files added before it.
 - (nullable id <RKResourceFileProtocol>)addResourceFileAtPath:(nonnull NSString *)filePath;
 
+/// Load each of the files at the specified paths and add them to the receiver. The maps
+/// of the files are parsed concurrently, one worker per processor, but the files are
+/// merged in the order given so later paths override earlier ones, just as if each had
+/// been added in turn. Returns the files that were successfully loaded, in order.
+- (nonnull NSArray <id<RKResourceFileProtocol>> *)addResourceFilesAtPaths:(nonnull NSArray <NSString *> *)filePaths;
+
+/// Load and add the files at the specified paths as above, parsing no more than the
+/// specified number of files at once.
+- (nonnull NSArray <id<RKResourceFileProtocol>> *)addResourceFilesAtPaths:(nonnull NSArray <NSString *> *)filePaths
+                                                       maximumConcurrency:(NSUInteger)maximumConcurrency;
+
+
+/// Parse the file at the specified path again and update the receiver with the changes,
+/// without touching anything the file does not provide. Resources keep their handles, and
+/// those that did not change keep their decoded objects. The file keeps its place in the
+/// order of files, or the last place if it was added more than once. Returns the changes
+/// the receiver now sees, which are also posted with
+/// RKResourceForkDidReloadResourceFileNotification if there are any, or nil if the file
+/// was never added or can no longer be loaded, in which case the receiver is unchanged.
+- (nullable RKResourceChangeSet *)reloadResourceFileAtPath:(nonnull NSString *)filePath;
+
+/// Start reloading each file of the receiver, including those added later, whenever it
+/// changes on disk. Files are watched by the kernel where possible, and polled otherwise.
+- (void)startWatchingResourceFiles;
+
+/// Start reloading files as above, polling every file if specified, which is needed for
+/// volumes that do not deliver file system events.
+- (void)startWatchingResourceFilesUsingPolling:(BOOL)usesPolling;
+
+/// Stop reloading files when they change.
+- (void)stopWatchingResourceFiles;
+
+/// Whether the receiver is reloading its files when they change.
+@property (readonly, getter=isWatchingResourceFiles) BOOL watchingResourceFiles;
+
+
+/// Returns every file added to the receiver that has a resource with the specified packed
+/// type code and id, in the order they were added, so the last is the one whose resource
+/// the receiver provides. Each file keeps a small filter of the resources it has, so most
+/// files are ruled out without their resource maps being read.
+- (nonnull NSArray <id<RKResourceFileProtocol>> *)resourceFilesContainingResourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
 
 /// Get an array of all available types through the ResourceFork. This is a distinct union
 /// of all the types from all the resource files added to the receiver.
@@ -52,7 +175,88 @@
 /// Returns an array of all the resources of the specified type.
 - (nonnull NSArray <RKResource *> *)resourcesOfType:(nonnull NSString *)type;
 
+/// Returns the resource with the specified type and id, from whichever file added it
+/// last.
+- (nullable RKResource *)resourceOfType:(nonnull NSString *)type id:(int16_t)id;
+
 /// Returns the data for the resource with the specified type and id.
 - (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id;
 
+/// Returns an array of all the resources of the specified packed type code. The string
+/// based methods above convert the type and then call through to these.
+- (nonnull NSArray <RKResource *> *)resourcesOfTypeCode:(RKFourCC)type;
+
+/// Returns the resource with the specified packed type code and id, from whichever file
+/// added it last.
+- (nullable RKResource *)resourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
+/// Returns the data for the resource with the specified packed type code and id.
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
+/// Returns the handle of every resource of the specified packed type code, sorted by id,
+/// packed into a single block of data.
+- (nonnull NSData *)handlesOfTypeCode:(RKFourCC)type;
+
+/// Returns the handle of the resource with the specified packed type code and id, or
+/// RKResourceHandleNotFound if there is no such resource.
+- (RKResourceHandle)handleOfResourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
+/// Returns the packed type code of the resource with the specified handle.
+- (RKFourCC)typeCodeOfResource:(RKResourceHandle)handle;
+
+/// Returns the id of the resource with the specified handle.
+- (int16_t)idOfResource:(RKResourceHandle)handle;
+
+/// Returns the size of the data of the resource with the specified handle.
+- (uint32_t)sizeOfResource:(RKResourceHandle)handle;
+
+/// Returns the name of the resource with the specified handle.
+- (nullable NSString *)nameOfResource:(RKResourceHandle)handle;
+
+/// Returns the data of the resource with the specified handle.
+- (nullable NSData *)dataOfResource:(RKResourceHandle)handle;
+
+/// Returns a 64-bit hash of the data of the resource with the specified handle, read
+/// straight from its file. This is the same as the content hash of its RKResource.
+- (uint64_t)contentHashOfResource:(RKResourceHandle)handle;
+
+/// Returns the resource with the specified handle. The resource is created by its file the
+/// first time it is asked for, and is the same instance the other methods return.
+- (nullable RKResource *)resourceForHandle:(RKResourceHandle)handle;
+
+/// Call the block for each resource of the specified packed type code with an id in the
+/// specified range, in order of id. Nothing is allocated for each resource: the name and
+/// data are read straight from the files, so a full pass over a type allocates nothing
+/// once its handles have been listed. Set stop to YES to end the enumeration early.
+- (void)enumerateResourcesOfTypeCode:(RKFourCC)type
+                             idRange:(RKResourceIdRange)range
+                          usingBlock:(nonnull void (^)(const RKResourceInfo *_Nonnull info, BOOL *_Nonnull stop))block;
+
+/// Hash the data of every resource of the specified packed type code and total up how
+/// many of them are copies of another. Nothing is allocated for each resource.
+- (RKDuplicationSummary)duplicationSummaryOfTypeCode:(RKFourCC)type;
+
+/// Decode the object of every resource of the specified type, one worker per processor.
+/// Objects are produced exactly as the object property of RKResource does, so this also
+/// warms the object cache. The handler is called as each resource finishes, from the
+/// worker that decoded it, with the object (nil if the parser failed) and the time taken
+/// in nanoseconds. Handlers are called concurrently and in no particular order.
+- (RKBulkDecodeSummary)decodeResourcesOfType:(nonnull NSString *)type
+                                     handler:(nullable void (^)(RKResource *_Nonnull resource, id _Nullable object, uint64_t duration))handler;
+
+/// Decode every resource of the specified type as above, decoding no more than the
+/// specified number of resources at once.
+- (RKBulkDecodeSummary)decodeResourcesOfType:(nonnull NSString *)type
+                          maximumConcurrency:(NSUInteger)maximumConcurrency
+                                     handler:(nullable void (^)(RKResource *_Nonnull resource, id _Nullable object, uint64_t duration))handler;
+
+/// Produce the object of the resource with the specified type and id on the shared
+/// RKDecodeScheduler, as RKResource does. Returns nil, without calling the completion
+/// handler, if there is no such resource.
+- (nullable RKDecodeRequest *)requestObjectForResourceOfType:(nonnull NSString *)type
+                                                          id:(int16_t)id
+                                                    priority:(RKDecodePriority)priority
+                                                       queue:(nullable dispatch_queue_t)queue
+                                                  completion:(nonnull void (^)(id _Nullable object))completion;
+
 @end
@@ -25,14 +25,690 @@
 #import "RKResourceFork.h"
 #import "RKRezResourceFile.h"
 #import "RKNdatResourceFile.h"
+#import "RKArchiveResourceFile.h"
 #import "RKResource.h"
+#import "RKObjectCache.h"
+#import "RKFourCC.h"
+#import "RKIncrementalDecoderProtocol.h"
+#import "RKFileWatcher.h"
+#import "ResourceIndex.h"
+#import "ResourceFilter.h"
+#import "ContentHash.h"
+#import <stdatomic.h>
+#import <os/lock.h>
+#import <sys/stat.h>
+
+// The merged record of a single resource. The handle of a resource is the position of its
+// slot, and the slot refers back to the file that the resource currently comes from.
+typedef struct {
+    RKFourCC type;
+    uint32_t file;
+    RKResourceEntry entry;
+} RKResourceForkSlot;
+
+// The file of a slot whose resource was removed when its file was reloaded. The handle of
+// the slot is never reused.
+static const uint32_t RKResourceForkSlotRemoved = UINT32_MAX;
+
+NSNotificationName const RKResourceForkDidReloadResourceFileNotification = @"RKResourceForkDidReloadResourceFileNotification";
+NSString *const RKResourceForkChangeSetKey = @"RKResourceForkChangeSetKey";
+
+// Sorts a run of handles by the id of the resource each refers to. The index guarantees
+// each id appears once per type, so a plain sort is enough.
+static void RKSortHandles(NSMutableData *run, const RKResourceForkSlot *slots)
+{
+    qsort_b(run.mutableBytes, run.length / sizeof(RKResourceHandle), sizeof(RKResourceHandle), ^int(const void *lhs, const void *rhs) {
+        int16_t lhsId = slots[*(const RKResourceHandle *)lhs].entry.id;
+        int16_t rhsId = slots[*(const RKResourceHandle *)rhs].entry.id;
+        return (lhsId > rhsId) - (lhsId < rhsId);
+    });
+}
+
+// The position of a merge in one of its runs.
+typedef struct {
+    const RKResourceHandle *next;
+    const RKResourceHandle *end;
+} RKHandleRunCursor;
+
+static inline int16_t RKHandleRunCursorId(const RKHandleRunCursor *cursor, const RKResourceForkSlot *slots)
+{
+    return slots[*cursor->next].entry.id;
+}
+
+// Restores the heap order of the cursors below the specified position.
+static void RKSiftDownHandleRunCursor(RKHandleRunCursor *heap, size_t count, size_t i, const RKResourceForkSlot *slots)
+{
+    while (true) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < count && RKHandleRunCursorId(&heap[left], slots) < RKHandleRunCursorId(&heap[smallest], slots)) {
+            smallest = left;
+        }
+        if (right < count && RKHandleRunCursorId(&heap[right], slots) < RKHandleRunCursorId(&heap[smallest], slots)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        
+        RKHandleRunCursor cursor = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = cursor;
+        i = smallest;
+    }
+}
+
+// Merges runs of handles, each sorted by id, into a single sorted list with a heap of
+// the runs, in O(n log k) for n handles across k runs. Each id appears in only one run,
+// as a file only adds a handle for an id that no earlier file had, so the merge never has
+// to choose between runs.
+static NSData *RKMergeHandleRuns(NSArray <NSData *> *runs, const RKResourceForkSlot *slots)
+{
+    if (runs.count <= 1) {
+        return runs.firstObject.copy ?: [NSData data];
+    }
+    
+    NSUInteger total = 0;
+    for (NSData *run in runs) {
+        total += run.length;
+    }
+    NSMutableData *merged = [NSMutableData dataWithLength:total];
+    RKResourceHandle *output = merged.mutableBytes;
+    
+    RKHandleRunCursor *heap = calloc(runs.count, sizeof(*heap));
+    if (!heap) {
+        return [NSData data];
+    }
+    
+    size_t count = 0;
+    for (NSData *run in runs) {
+        const RKResourceHandle *handles = run.bytes;
+        heap[count++] = (RKHandleRunCursor){ handles, handles + run.length / sizeof(*handles) };
+    }
+    for (size_t i = count / 2; i-- > 0;) {
+        RKSiftDownHandleRunCursor(heap, count, i, slots);
+    }
+    
+    while (count > 0) {
+        *output++ = *heap[0].next++;
+        if (heap[0].next == heap[0].end) {
+            heap[0] = heap[--count];
+        }
+        RKSiftDownHandleRunCursor(heap, count, 0, slots);
+    }
+    
+    free(heap);
+    return merged.copy;
+}
+
+static int RKResourceKeyCompare(const void *lhs, const void *rhs)
+{
+    const RKResourceKey *lhsKey = lhs;
+    const RKResourceKey *rhsKey = rhs;
+    if (lhsKey->type != rhsKey->type) {
+        return (lhsKey->type > rhsKey->type) - (lhsKey->type < rhsKey->type);
+    }
+    return (lhsKey->id > rhsKey->id) - (lhsKey->id < rhsKey->id);
+}
+
+static NSData *RKSortResourceKeys(NSMutableData *keys)
+{
+    qsort(keys.mutableBytes, keys.length / sizeof(RKResourceKey), sizeof(RKResourceKey), RKResourceKeyCompare);
+    return keys.copy;
+}
+
+static NSData *RKResourceFileData(id <RKResourceFileProtocol> file, RKFourCC type, int16_t resourceId)
+{
+    if ([file respondsToSelector:@selector(dataForResourceOfTypeCode:id:)]) {
+        return [file dataForResourceOfTypeCode:type id:resourceId];
+    }
+    return [file dataForResourceOfType:NSStringFromFourCC(type) id:resourceId];
+}
+
+// A resource that a reload changed or removed, whose object may be left in the cache.
+typedef struct {
+    RKFourCC type;
+    uint32_t size;
+    uint64_t contentHash;
+} RKStaleResource;
+
+static void RKAppendStaleResource(NSMutableData *stale, id <RKResourceFileProtocol> file, RKFourCC type, RKResourceEntry entry)
+{
+    NSData *data = RKResourceFileData(file, type, entry.id);
+    if (data) {
+        RKStaleResource resource = { type, (uint32_t)data.length, ContentHash(data.bytes, data.length, 0) };
+        [stale appendBytes:&resource length:sizeof(resource)];
+    }
+}
+
+// Whether two entries, from the old and new versions of a file, describe the same resource.
+// The data is only compared when everything else matches. The old data is read through the
+// old file, so this can only be trusted while that still reads the old version, which is
+// not the case once the file has been rewritten in place.
+static BOOL RKResourceEntriesMatch(id <RKResourceFileProtocol> oldFile, RKResourceEntry oldEntry,
+                                   id <RKResourceFileProtocol> newFile, RKResourceEntry newEntry, RKFourCC type)
+{
+    if (oldEntry.size != newEntry.size) {
+        return NO;
+    }
+    
+    RKBytesView oldName = [oldFile nameViewOfResourceEntry:oldEntry];
+    RKBytesView newName = [newFile nameViewOfResourceEntry:newEntry];
+    if (oldName.length != newName.length || (oldName.length > 0 && memcmp(oldName.bytes, newName.bytes, oldName.length) != 0)) {
+        return NO;
+    }
+    
+    NSData *oldData = RKResourceFileData(oldFile, type, oldEntry.id);
+    NSData *newData = RKResourceFileData(newFile, type, newEntry.id);
+    return oldData && newData && [oldData isEqualToData:newData];
+}
+
+// Identifies the version of a file on disk that a resource file was opened from.
+typedef struct {
+    BOOL valid;
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec modified;
+} RKResourceFileIdentity;
+
+static RKResourceFileIdentity RKResourceFileIdentityOfPath(NSString *filePath)
+{
+    struct stat info;
+    if (stat(filePath.fileSystemRepresentation, &info) != 0) {
+        return (RKResourceFileIdentity){ .valid = NO };
+    }
+    return (RKResourceFileIdentity){ YES, info.st_dev, info.st_ino, info.st_size, info.st_mtimespec };
+}
+
+// Whether the old version of a file can still be read through the resource file opened
+// from it. Files are mostly saved by replacing them, which leaves the old inode readable
+// through the open file, but a file rewritten in place keeps its inode and loses its old
+// contents, which shows as a different size or modification date.
+static BOOL RKResourceFileIdentityStillReadable(RKResourceFileIdentity old, RKResourceFileIdentity current)
+{
+    if (!old.valid || !current.valid) {
+        return NO;
+    }
+    if (old.device != current.device || old.inode != current.inode) {
+        return YES;
+    }
+    return old.size == current.size && old.modified.tv_sec == current.modified.tv_sec && old.modified.tv_nsec == current.modified.tv_nsec;
+}
+
+// What a fork keeps about each of its files besides the file itself: its presence filter,
+// or NULL if that could not be built, and the identity of the file it was opened from.
+// Snapshots share records, so a filter is destroyed along with the last snapshot that
+// refers to it.
+@interface RKResourceForkFileRecord : NSObject {
+@public
+    ResourceFilter *_Nullable _filter;
+    RKResourceFileIdentity _identity;
+}
+@end
+
+@implementation RKResourceForkFileRecord
+
+- (void)dealloc
+{
+    ResourceFilterDestroy(_filter);
+}
+
+@end
+
+
+// The resource objects of one type in a snapshot, which are created the first time they
+// are asked for. Racing callers may each create them, and the first to publish theirs wins.
+@interface RKResourceForkListing : NSObject {
+@public
+    _Atomic(void *) _resources;
+}
+@end
+
+@implementation RKResourceForkListing
+
+- (void)dealloc
+{
+    void *resources = atomic_load_explicit(&_resources, memory_order_acquire);
+    if (resources) {
+        CFRelease(resources);
+    }
+}
+
+@end
+
+
+// The state of a fork at one point in time. A snapshot is never changed once it has been
+// published: adding files builds a new snapshot from the current one and publishes that
+// in its place, so readers can use whichever snapshot they loaded without a lock, for as
+// long as they hold on to it.
+@interface RKResourceForkSnapshot : NSObject {
+@public
+    NSArray <id<RKResourceFileProtocol>> *_files;
+    NSArray <NSString *> *_types;
+    NSArray <NSString *> *_filePaths;
+    
+    // The merged index maps each type and id to the handle of the winning resource. Slots
+    // are kept in the order they were first seen, and a later file shadowing a resource
+    // replaces its slot in the next snapshot, so a handle means the same resource in every
+    // snapshot. Types are keyed by their packed code, which is a tagged NSNumber and so
+    // never allocates or compares strings.
+    ResourceIndex *_index;
+    RKResourceForkSlot *_slots;
+    uint32_t _slotCount;
+    
+    // The handles of each type, sorted by id. Types that a new file does not touch share
+    // their handles with the snapshot before.
+    NSDictionary <NSNumber *, NSData *> *_sortedHandles;
+    
+    // The record of each file, in the same order as the files, which keeps its filter. The
+    // filters are also kept in an array of their own, as lookups go through every one of
+    // them. A file whose filter could not be built has NULL, and is always assumed to
+    // possibly have a resource.
+    NSArray <RKResourceForkFileRecord *> *_records;
+    ResourceFilter *_Nullable *_filters;
+    
+    // Every type has a listing from the moment the snapshot is built, so the dictionary is
+    // never changed once published and the objects in a listing can be made on demand. Types
+    // that a new file does not touch share their listing with the snapshot before.
+    NSMutableDictionary <NSNumber *, RKResourceForkListing *> *_listings;
+}
+@end
+
+@implementation RKResourceForkSnapshot
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _files = @[];
+        _types = @[];
+        _filePaths = @[];
+        _records = @[];
+        _sortedHandles = @{};
+        _listings = [NSMutableDictionary new];
+        if ((_index = ResourceIndexCreate(0)) == NULL) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    ResourceIndexDestroy(_index);
+    free(_slots);
+    free(_filters);
+}
+
+
+#pragma mark - Building Snapshots
+
+// Starts a snapshot from a copy of the previous one, with room for the specified number of
+// files and resources to be merged into it.
+- (nullable instancetype)initWithSnapshot:(RKResourceForkSnapshot *)previous
+                                fileCount:(NSUInteger)fileCount
+                            resourceCount:(NSUInteger)resourceCount
+{
+    if (self = [super init]) {
+        uint64_t slotCount = (uint64_t)previous->_slotCount + resourceCount;
+        if (slotCount >= RKResourceHandleNotFound) {
+            return nil;
+        }
+        
+        _index = ResourceIndexCopy(previous->_index, (uint32_t)resourceCount);
+        _slots = malloc((size_t)MAX(slotCount, 1) * sizeof(*_slots));
+        _filters = malloc((previous->_files.count + fileCount) * sizeof(*_filters));
+        if (!_index || !_slots || !_filters) {
+            return nil;
+        }
+        
+        if (previous->_slotCount > 0) {
+            memcpy(_slots, previous->_slots, previous->_slotCount * sizeof(*_slots));
+        }
+        if (previous->_files.count > 0) {
+            memcpy(_filters, previous->_filters, previous->_files.count * sizeof(*_filters));
+        }
+        _slotCount = previous->_slotCount;
+        _files = previous->_files;
+        _types = previous->_types;
+        _filePaths = previous->_filePaths;
+        _records = previous->_records;
+        _sortedHandles = previous->_sortedHandles;
+        _listings = [previous->_listings mutableCopy];
+    }
+    return self;
+}
+
+// Merges the resources of a file into the receiver, which must not have been published
+// yet. Resources the file shadows keep their handle, and the handles the file introduces
+// to each type are added to the runs of that type, as a single run sorted by id.
+- (void)mergeResourceFile:(id <RKResourceFileProtocol>)file
+                  atIndex:(uint32_t)fileIndex
+                  entries:(NSArray <NSData *> *)typeEntries
+                     runs:(NSMutableDictionary <NSNumber *, NSMutableArray <NSData *> *> *)runs
+{
+    NSArray <NSString *> *types = file.allTypes;
+    for (NSUInteger i = 0; i < types.count && i < typeEntries.count; ++i) {
+        NSString *type = types[i];
+        RKFourCC code = RKFourCCFromString(type);
+        const RKResourceEntry *entries = typeEntries[i].bytes;
+        NSUInteger count = typeEntries[i].length / sizeof(*entries);
+        if (!code) {
+            NSLog(@"Ignoring resources of invalid type '%@' in %@", type, file.filePath);
+            continue;
+        }
+        
+        NSMutableArray <NSData *> *typeRuns = runs[@(code)];
+        if (!typeRuns) {
+            typeRuns = runs[@(code)] = [NSMutableArray new];
+            if (_sortedHandles[@(code)]) {
+                [typeRuns addObject:_sortedHandles[@(code)]];
+            }
+        }
+        
+        // Entries arrive sorted by id, so the handles this file adds are already in order.
+        NSMutableData *run = [NSMutableData dataWithCapacity:count * sizeof(RKResourceHandle)];
+        BOOL sorted = YES;
+        for (NSUInteger j = 0; j < count; ++j) {
+            uint64_t key = ResourceIndexKey(code, entries[j].id);
+            RKResourceHandle handle = 0;
+            
+            if (!ResourceIndexLookup(_index, key, &handle)) {
+                handle = _slotCount++;
+                ResourceIndexInsert(_index, key, handle, NULL);
+                [run appendBytes:&handle length:sizeof(handle)];
+            }
+            _slots[handle] = (RKResourceForkSlot){ .type = code, .file = fileIndex, .entry = entries[j] };
+            sorted = sorted && (j == 0 || entries[j - 1].id < entries[j].id);
+        }
+        
+        if (run.length > 0) {
+            if (!sorted) {
+                RKSortHandles(run, _slots);
+            }
+            [typeRuns addObject:run];
+        }
+        _listings[@(code)] = [RKResourceForkListing new];
+    }
+}
+
++ (nullable instancetype)snapshotByAddingFiles:(NSArray <id<RKResourceFileProtocol>> *)files
+                                       entries:(NSArray <NSArray <NSData *> *> *)fileEntries
+                                       records:(NSArray <RKResourceForkFileRecord *> *)records
+                                    toSnapshot:(RKResourceForkSnapshot *)previous
+{
+    NSUInteger resourceCount = 0;
+    for (NSArray <NSData *> *typeEntries in fileEntries) {
+        for (NSData *entries in typeEntries) {
+            resourceCount += entries.length / sizeof(RKResourceEntry);
+        }
+    }
+    
+    RKResourceForkSnapshot *snapshot = [[self alloc] initWithSnapshot:previous fileCount:files.count resourceCount:resourceCount];
+    if (!snapshot) {
+        NSLog(@"Failed to grow the resource index for %lu resource files", (unsigned long)files.count);
+        return nil;
+    }
+    
+    NSMutableDictionary <NSNumber *, NSMutableArray <NSData *> *> *runs = [NSMutableDictionary new];
+    NSMutableArray <NSString *> *filePaths = [previous->_filePaths mutableCopy];
+    for (NSUInteger i = 0; i < files.count; ++i) {
+        uint32_t fileIndex = (uint32_t)(previous->_files.count + i);
+        [snapshot mergeResourceFile:files[i] atIndex:fileIndex entries:fileEntries[i] runs:runs];
+        snapshot->_filters[fileIndex] = records[i]->_filter;
+        [filePaths addObject:files[i].filePath];
+    }
+    snapshot->_files = [previous->_files arrayByAddingObjectsFromArray:files];
+    snapshot->_filePaths = filePaths.copy;
+    snapshot->_records = [previous->_records arrayByAddingObjectsFromArray:records];
+    
+    // Only the types the files touched are merged again, the rest keep their handles.
+    NSMutableDictionary <NSNumber *, NSData *> *sortedHandles = [previous->_sortedHandles mutableCopy];
+    for (NSNumber *code in runs) {
+        sortedHandles[code] = RKMergeHandleRuns(runs[code], snapshot->_slots);
+    }
+    snapshot->_sortedHandles = sortedHandles.copy;
+    
+    if (sortedHandles.count != previous->_sortedHandles.count) {
+        [snapshot updateTypes];
+    }
+    return snapshot;
+}
+
+// Lists the types again from the sorted handles, which have an entry for each type.
+- (void)updateTypes
+{
+    NSMutableArray <NSString *> *types = [NSMutableArray arrayWithCapacity:_sortedHandles.count];
+    for (NSNumber *code in _sortedHandles) {
+        [types addObject:NSStringFromFourCC(code.unsignedIntValue)];
+    }
+    _types = [types sortedArrayUsingSelector:@selector(compare:)];
+}
+
+
+#pragma mark - Replacing Files
+
+// Finds the resource with the specified type and id in the last file before the specified
+// index that has it, using the filters to rule out most files without reading their maps.
+- (BOOL)getEntry:(RKResourceEntry *)entry
+            file:(uint32_t *)fileIndex
+ ofResourceOfTypeCode:(RKFourCC)type
+              id:(int16_t)resourceId
+     beforeIndex:(uint32_t)limit
+{
+    uint64_t key = ResourceIndexKey(type, resourceId);
+    for (uint32_t i = limit; i-- > 0;) {
+        if (_filters[i] && !ResourceFilterMayContainResource(_filters[i], key)) {
+            continue;
+        }
+        
+        NSData *entries = [_files[i] resourceEntriesOfTypeCode:type];
+        RKResourceEntry target = { .id = resourceId };
+        const RKResourceEntry *found = bsearch(&target, entries.bytes, entries.length / sizeof(target), sizeof(target), RKResourceEntryCompareIds);
+        if (found) {
+            *entry = *found;
+            *fileIndex = i;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+// Builds a snapshot in which the file at the specified index is replaced by a new version
+// of it, touching only the resources the two versions of the file provide. Every handle
+// keeps referring to the same type and id, and the handles of resources that are gone
+// entirely are retired. The changes the fork sees are returned through changes.
+//
+// Decoded objects are cached by content, so resources that did not change keep theirs.
+// The resources of the old version of the file that changed or went away are returned
+// through stale, so that their objects can be evicted. When the old data can no longer be
+// read their content is unknown, and their objects are left for the cache to evict.
++ (nullable instancetype)snapshotByReplacingFileAtIndex:(uint32_t)fileIndex
+                                               withFile:(id <RKResourceFileProtocol>)file
+                                                entries:(NSArray <NSData *> *)typeEntries
+                                                 record:(RKResourceForkFileRecord *)record
+                                             inSnapshot:(RKResourceForkSnapshot *)previous
+                                                changes:(RKResourceChangeSet *_Nullable *_Nonnull)changes
+                                                  stale:(NSData *_Nullable *_Nonnull)stale
+{
+    id <RKResourceFileProtocol> oldFile = previous->_files[fileIndex];
+    NSArray <NSString *> *types = file.allTypes;
+    
+    // When the old data can no longer be read, every resource the file still has is
+    // treated as changed.
+    BOOL comparesData = RKResourceFileIdentityStillReadable(previous->_records[fileIndex]->_identity, record->_identity);
+    
+    // The entries of both versions of the file, by type.
+    NSMutableDictionary <NSNumber *, NSData *> *oldEntries = [NSMutableDictionary new];
+    for (NSString *type in oldFile.allTypes) {
+        RKFourCC code = RKFourCCFromString(type);
+        if (code) {
+            oldEntries[@(code)] = [oldFile resourceEntriesOfTypeCode:code];
+        }
+    }
+    NSMutableDictionary <NSNumber *, NSData *> *newEntries = [NSMutableDictionary new];
+    NSUInteger resourceCount = 0;
+    for (NSUInteger i = 0; i < types.count && i < typeEntries.count; ++i) {
+        RKFourCC code = RKFourCCFromString(types[i]);
+        if (code) {
+            newEntries[@(code)] = typeEntries[i];
+            resourceCount += typeEntries[i].length / sizeof(RKResourceEntry);
+        }
+    }
+    
+    RKResourceForkSnapshot *snapshot = [[self alloc] initWithSnapshot:previous fileCount:0 resourceCount:resourceCount];
+    if (!snapshot) {
+        NSLog(@"Failed to grow the resource index to reload %@", file.filePath);
+        return nil;
+    }
+    
+    NSMutableArray <id<RKResourceFileProtocol>> *files = [previous->_files mutableCopy];
+    files[fileIndex] = file;
+    snapshot->_files = files.copy;
+    NSMutableArray <RKResourceForkFileRecord *> *records = [previous->_records mutableCopy];
+    records[fileIndex] = record;
+    snapshot->_records = records.copy;
+    snapshot->_filters[fileIndex] = record->_filter;
+    
+    NSMutableData *added = [NSMutableData data];
+    NSMutableData *removed = [NSMutableData data];
+    NSMutableData *changed = [NSMutableData data];
+    NSMutableData *dropped = [NSMutableData data];
+    NSMutableDictionary <NSNumber *, NSData *> *sortedHandles = [previous->_sortedHandles mutableCopy];
+    BOOL typesChanged = NO;
+    
+    NSMutableSet <NSNumber *> *codes = [NSMutableSet setWithArray:oldEntries.allKeys];
+    [codes addObjectsFromArray:newEntries.allKeys];
+    for (NSNumber *code in codes) {
+        RKFourCC type = code.unsignedIntValue;
+        const RKResourceEntry *before = oldEntries[code].bytes;
+        NSUInteger beforeCount = oldEntries[code].length / sizeof(*before);
+        const RKResourceEntry *after = newEntries[code].bytes;
+        NSUInteger afterCount = newEntries[code].length / sizeof(*after);
+        NSMutableData *run = [NSMutableData data];
+        BOOL retired = NO;
+        
+        // Both lists of entries are sorted by id, so they are walked together.
+        NSUInteger i = 0;
+        NSUInteger j = 0;
+        while (i < beforeCount || j < afterCount) {
+            BOOL inBefore = i < beforeCount && (j >= afterCount || before[i].id <= after[j].id);
+            BOOL inAfter = j < afterCount && (i >= beforeCount || after[j].id <= before[i].id);
+            RKResourceKey key = { type, inAfter ? after[j].id : before[i].id };
+            uint64_t indexKey = ResourceIndexKey(type, key.id);
+            RKResourceHandle handle = RKResourceHandleNotFound;
+            RKResourceForkSlot *slot = ResourceIndexLookup(snapshot->_index, indexKey, &handle) ? &snapshot->_slots[handle] : NULL;
+            BOOL dropsOld = comparesData && inBefore && slot && slot->file == fileIndex;
+            
+            if (slot && slot->file > fileIndex) {
+                // A later file shadows the resource, so the fork does not see the change.
+            }
+            else if (inAfter && !slot) {
+                handle = snapshot->_slotCount++;
+                ResourceIndexInsert(snapshot->_index, indexKey, handle, NULL);
+                snapshot->_slots[handle] = (RKResourceForkSlot){ .type = type, .file = fileIndex, .entry = after[j] };
+                [run appendBytes:&handle length:sizeof(handle)];
+                [added appendBytes:&key length:sizeof(key)];
+            }
+            else if (inAfter) {
+                // The entry is always replaced, as the resource may have moved in the file.
+                BOOL same = comparesData && inBefore && slot->file == fileIndex && RKResourceEntriesMatch(oldFile, before[i], file, after[j], type);
+                *slot = (RKResourceForkSlot){ .type = type, .file = fileIndex, .entry = after[j] };
+                if (!same) {
+                    [changed appendBytes:&key length:sizeof(key)];
+                    if (dropsOld) {
+                        RKAppendStaleResource(dropped, oldFile, type, before[i]);
+                    }
+                }
+            }
+            else if (slot && slot->file == fileIndex) {
+                if (dropsOld) {
+                    RKAppendStaleResource(dropped, oldFile, type, before[i]);
+                }
+                
+                // The resource falls back to the last earlier file that has it, if any.
+                RKResourceEntry entry;
+                uint32_t provider;
+                if ([snapshot getEntry:&entry file:&provider ofResourceOfTypeCode:type id:key.id beforeIndex:fileIndex]) {
+                    *slot = (RKResourceForkSlot){ .type = type, .file = provider, .entry = entry };
+                    [changed appendBytes:&key length:sizeof(key)];
+                }
+                else {
+                    ResourceIndexRemove(snapshot->_index, indexKey, NULL);
+                    slot->file = RKResourceForkSlotRemoved;
+                    retired = YES;
+                    [removed appendBytes:&key length:sizeof(key)];
+                }
+            }
+            
+            i += inBefore;
+            j += inAfter;
+        }
+        
+        // Retired handles are dropped from the sorted handles of the type, and the handles
+        // the file introduced are merged in as a single run, as when adding a file.
+        if (run.length > 0 || retired) {
+            NSData *handles = sortedHandles[code] ?: [NSData data];
+            if (retired) {
+                const RKResourceHandle *handle = handles.bytes;
+                NSMutableData *kept = [NSMutableData dataWithCapacity:handles.length];
+                for (NSUInteger k = 0; k < handles.length / sizeof(*handle); ++k) {
+                    if (snapshot->_slots[handle[k]].file != RKResourceForkSlotRemoved) {
+                        [kept appendBytes:&handle[k] length:sizeof(*handle)];
+                    }
+                }
+                handles = kept;
+            }
+            
+            NSMutableArray <NSData *> *runs = [NSMutableArray arrayWithCapacity:2];
+            for (NSData *candidate in @[handles, run]) {
+                if (candidate.length > 0) {
+                    [runs addObject:candidate];
+                }
+            }
+            NSData *merged = RKMergeHandleRuns(runs, snapshot->_slots);
+            typesChanged = typesChanged || (sortedHandles[code] == nil) != (merged.length == 0);
+            sortedHandles[code] = merged.length > 0 ? merged : nil;
+        }
+        
+        // Listings of the type hold resources of the old version of the file.
+        snapshot->_listings[code] = sortedHandles[code] ? [RKResourceForkListing new] : nil;
+    }
+    
+    snapshot->_sortedHandles = sortedHandles.copy;
+    if (typesChanged) {
+        [snapshot updateTypes];
+    }
+    
+    *changes = [[RKResourceChangeSet alloc] initWithFilePath:file.filePath
+                                              addedResources:RKSortResourceKeys(added)
+                                            removedResources:RKSortResourceKeys(removed)
+                                            changedResources:RKSortResourceKeys(changed)];
+    *stale = dropped.copy;
+    return snapshot;
+}
+
+@end
+
 
 @implementation RKResourceFork {
 @private
-    __strong NSArray <id<RKResourceFileProtocol>> *_files;
-    __strong NSArray <NSString *> *_types;
-    __strong NSArray <NSString *> *_filePaths;
-    __strong NSMutableDictionary <NSString *, NSArray <RKResource *> *> *_resources;
+    // The current snapshot, which the fork holds a reference to. Readers load it and take
+    // their own reference without a lock. Snapshots it replaces are retired rather than
+    // released, and are only released once no reader is between loading the pointer and
+    // taking its reference, which is what the count of loading readers tracks.
+    _Atomic(void *) _snapshot;
+    _Atomic(uint32_t) _loadingReaders;
+    
+    // Serialises building new snapshots. Readers never take it.
+    os_unfair_lock _writeLock;
+    
+    // Snapshots that have been replaced but may not yet be released, guarded by the write lock.
+    NSMutableArray <RKResourceForkSnapshot *> *_retiredSnapshots;
+    
+    // Watches the files of the fork while it is watching, guarded by the write lock.
+    RKFileWatcher *_watcher;
 }
 
 
@@ -57,123 +733,714 @@
 - (instancetype)init
 {
     if (self = [super init]) {
-        _resources = [NSMutableDictionary new];
+        RKResourceForkSnapshot *snapshot = [RKResourceForkSnapshot new];
+        if (!snapshot) {
+            return nil;
+        }
+        atomic_init(&_snapshot, (void *)CFBridgingRetain(snapshot));
+        atomic_init(&_loadingReaders, 0);
+        _writeLock = OS_UNFAIR_LOCK_INIT;
+        _retiredSnapshots = [NSMutableArray new];
     }
     return self;
 }
 
+- (void)dealloc
+{
+    CFRelease(atomic_load_explicit(&_snapshot, memory_order_acquire));
+}
+
+
+#pragma mark - Snapshots
+
+- (RKResourceForkSnapshot *)snapshot
+{
+    // The count is raised before the pointer is loaded and only lowered once the reader
+    // holds a reference, so a writer that sees no loading readers after publishing knows
+    // that nobody can still be about to retain a snapshot it has replaced.
+    atomic_fetch_add_explicit(&_loadingReaders, 1, memory_order_seq_cst);
+    void *snapshot = atomic_load_explicit(&_snapshot, memory_order_seq_cst);
+    CFRetain(snapshot);
+    atomic_fetch_sub_explicit(&_loadingReaders, 1, memory_order_seq_cst);
+    return (__bridge_transfer RKResourceForkSnapshot *)snapshot;
+}
+
+// Publishes a new snapshot in place of the current one, which must be done with the write
+// lock held. Retired snapshots are released by whichever publish first sees that no reader
+// is loading, and readers that already hold one keep it for as long as they need it.
+- (void)publishSnapshot:(RKResourceForkSnapshot *)snapshot
+{
+    void *previous = atomic_exchange_explicit(&_snapshot, (void *)CFBridgingRetain(snapshot), memory_order_seq_cst);
+    [_retiredSnapshots addObject:(__bridge_transfer RKResourceForkSnapshot *)previous];
+    if (atomic_load_explicit(&_loadingReaders, memory_order_seq_cst) == 0) {
+        [_retiredSnapshots removeAllObjects];
+    }
+}
+
 
 #pragma mark - Loading Resource Files
 
-- (nullable id <RKResourceFileProtocol>)addResourceFileAtPath:(nonnull NSString *)filePath
++ (nullable id <RKResourceFileProtocol>)resourceFileAtPath:(nonnull NSString *)filePath
 {
-    [self invalidateCalculatedProperties];
-    
-    id <RKResourceFileProtocol> file = nil;
-    
     if ([filePath.pathExtension isEqualToString:RKRezResourceFile.extension]) {
-        file = [RKRezResourceFile resourceFileWithPath:filePath];
+        return [RKRezResourceFile resourceFileWithPath:filePath];
     }
     else if ([filePath.pathExtension isEqualToString:RKNdatResourceFile.extension]) {
-        file = [RKNdatResourceFile resourceFileWithPath:filePath];
+        return [RKNdatResourceFile resourceFileWithPath:filePath];
     }
-    
+    else if ([filePath.pathExtension isEqualToString:RKArchiveResourceFile.extension]) {
+        return [RKArchiveResourceFile resourceFileWithPath:filePath];
+    }
+    return nil;
+}
+
+- (nullable id <RKResourceFileProtocol>)addResourceFileAtPath:(nonnull NSString *)filePath
+{
+    // The identity is taken before the file is opened, so that a change in between is seen
+    // as a change when the file is reloaded.
+    RKResourceFileIdentity identity = RKResourceFileIdentityOfPath(filePath);
+    id <RKResourceFileProtocol> file = [RKResourceFork resourceFileAtPath:filePath];
     if (file) {
-        _files = _files ? [_files arrayByAddingObject:file] : @[file];
+        [self addResourceFile:file identity:identity];
     }
-        
     return file;
 }
 
+- (nonnull NSArray <id<RKResourceFileProtocol>> *)addResourceFilesAtPaths:(nonnull NSArray <NSString *> *)filePaths
+{
+    return [self addResourceFilesAtPaths:filePaths maximumConcurrency:NSProcessInfo.processInfo.activeProcessorCount];
+}
 
-#pragma mark - Calculated Properties
+- (nonnull NSArray <id<RKResourceFileProtocol>> *)addResourceFilesAtPaths:(nonnull NSArray <NSString *> *)filePaths
+                                                       maximumConcurrency:(NSUInteger)maximumConcurrency
+{
+    NSUInteger count = filePaths.count;
+    if (count == 0) {
+        return @[];
+    }
+    
+    // Each worker claims the next unopened path until none remain. Files are parsed into
+    // their own slot, so the order they finish in has no bearing on the result.
+    __strong id <RKResourceFileProtocol> *files = (__strong id <RKResourceFileProtocol> *)calloc(count, sizeof(*files));
+    __strong NSArray <NSData *> **entries = (__strong NSArray <NSData *> **)calloc(count, sizeof(*entries));
+    __strong RKResourceForkFileRecord **records = (__strong RKResourceForkFileRecord **)calloc(count, sizeof(*records));
+    __block _Atomic(NSUInteger) nextPath = 0;
+    size_t workerCount = MAX(MIN(maximumConcurrency, count), 1);
+    
+    dispatch_apply(workerCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t worker __unused) {
+        NSUInteger i;
+        while ((i = atomic_fetch_add_explicit(&nextPath, 1, memory_order_relaxed)) < count) {
+            @autoreleasepool {
+                RKResourceFileIdentity identity = RKResourceFileIdentityOfPath(filePaths[i]);
+                id <RKResourceFileProtocol> file = [RKResourceFork resourceFileAtPath:filePaths[i]];
+                if (!file) {
+                    continue;
+                }
+                
+                // Reading the resource entries here does the bulk of the map parsing on the
+                // worker, leaving the merge with little more than index updates.
+                entries[i] = [RKResourceFork resourceEntriesOfResourceFile:file types:file.allTypes];
+                records[i] = RKCreateFileRecord(file.allTypes, entries[i], identity);
+                files[i] = file;
+            }
+        }
+    });
+    
+    // The files are merged in input order, so later paths still override earlier ones
+    // exactly as if they had been added one at a time, but into a single new snapshot.
+    NSMutableArray <id<RKResourceFileProtocol>> *addedFiles = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray <NSArray <NSData *> *> *addedEntries = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray <RKResourceForkFileRecord *> *addedRecords = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; ++i) {
+        if (files[i]) {
+            [addedFiles addObject:files[i]];
+            [addedEntries addObject:entries[i]];
+            [addedRecords addObject:records[i]];
+        }
+        files[i] = nil;
+        entries[i] = nil;
+        records[i] = nil;
+    }
+    [self addResourceFiles:addedFiles entries:addedEntries records:addedRecords];
+    
+    free(files);
+    free(entries);
+    free(records);
+    return addedFiles.copy;
+}
 
-- (void)invalidateCalculatedProperties
++ (NSArray <NSData *> *)resourceEntriesOfResourceFile:(id <RKResourceFileProtocol>)file types:(NSArray <NSString *> *)types
 {
-    _types = nil;
-    _filePaths = nil;
-    _resources = [NSMutableDictionary new];
+    NSMutableArray <NSData *> *entries = [NSMutableArray arrayWithCapacity:types.count];
+    for (NSString *type in types) {
+        [entries addObject:[file resourceEntriesOfTypeCode:RKFourCCFromString(type)]];
+    }
+    return entries;
 }
 
-- (NSArray<NSString *> *)allTypes
+// Builds the presence filter of a file from its entries, or returns NULL if it can not.
+static ResourceFilter *RKCreateResourceFilter(NSArray <NSString *> *types, NSArray <NSData *> *typeEntries)
 {
-    __weak __typeof(self) weakSelf = self;
-    return _types ?: (_types = ^NSArray <NSString *> * {
-        __strong __typeof(self) self = weakSelf;
-        NSMutableArray <NSString *> *types = [NSMutableArray new];
+    NSUInteger resourceCount = 0;
+    for (NSData *entries in typeEntries) {
+        resourceCount += entries.length / sizeof(RKResourceEntry);
+    }
+    
+    ResourceFilter *filter = ResourceFilterCreate((uint32_t)types.count, (uint32_t)MIN(resourceCount, UINT32_MAX));
+    for (NSUInteger i = 0; filter && i < types.count; ++i) {
+        RKFourCC code = RKFourCCFromString(types[i]);
+        const RKResourceEntry *entry = typeEntries[i].bytes;
+        NSUInteger count = typeEntries[i].length / sizeof(*entry);
         
-        // Do a distinct merge of all the arrays
-        for (id <RKResourceFileProtocol> file in self->_files) {
-            for (NSString *type in file.allTypes) {
-                if (![types containsObject:type]) {
-                    [types addObject:type];
-                }
+        bool added = ResourceFilterAddType(filter, code);
+        for (NSUInteger j = 0; added && j < count; ++j) {
+            added = ResourceFilterAddResource(filter, ResourceIndexKey(code, entry[j].id));
+        }
+        if (!added) {
+            ResourceFilterDestroy(filter);
+            filter = NULL;
+        }
+    }
+    return filter;
+}
+
+static RKResourceForkFileRecord *RKCreateFileRecord(NSArray <NSString *> *types, NSArray <NSData *> *typeEntries, RKResourceFileIdentity identity)
+{
+    RKResourceForkFileRecord *record = [RKResourceForkFileRecord new];
+    record->_filter = RKCreateResourceFilter(types, typeEntries);
+    record->_identity = identity;
+    return record;
+}
+
+- (void)addResourceFile:(nonnull id <RKResourceFileProtocol>)file identity:(RKResourceFileIdentity)identity
+{
+    // The entries of the file are read before building the snapshot, as this may mean parsing.
+    NSArray <NSString *> *types = file.allTypes;
+    NSArray <NSData *> *entries = [RKResourceFork resourceEntriesOfResourceFile:file types:types];
+    [self addResourceFiles:@[file] entries:@[entries] records:@[RKCreateFileRecord(types, entries, identity)]];
+}
+
+// Builds a snapshot with the files merged into the current one, in order, and publishes it.
+- (void)addResourceFiles:(NSArray <id<RKResourceFileProtocol>> *)files
+                 entries:(NSArray <NSArray <NSData *> *> *)fileEntries
+                 records:(NSArray <RKResourceForkFileRecord *> *)records
+{
+    if (files.count == 0) {
+        return;
+    }
+    
+    os_unfair_lock_lock(&_writeLock);
+    RKResourceForkSnapshot *snapshot = [RKResourceForkSnapshot snapshotByAddingFiles:files
+                                                                              entries:fileEntries
+                                                                              records:records
+                                                                           toSnapshot:self.snapshot];
+    if (snapshot) {
+        [self publishSnapshot:snapshot];
+    }
+    for (id <RKResourceFileProtocol> file in files) {
+        [_watcher watchFileAtPath:file.filePath];
+    }
+    os_unfair_lock_unlock(&_writeLock);
+}
+
+#pragma mark - Reloading Resource Files
+
+- (nullable RKResourceChangeSet *)reloadResourceFileAtPath:(nonnull NSString *)filePath
+{
+    // The new version of the file is parsed before anything is locked, as when it was added.
+    RKResourceFileIdentity identity = RKResourceFileIdentityOfPath(filePath);
+    id <RKResourceFileProtocol> file = [RKResourceFork resourceFileAtPath:filePath];
+    if (!file) {
+        NSLog(@"Failed to reload resource file %@", filePath);
+        return nil;
+    }
+    NSArray <NSString *> *types = file.allTypes;
+    NSArray <NSData *> *entries = [RKResourceFork resourceEntriesOfResourceFile:file types:types];
+    RKResourceForkFileRecord *record = RKCreateFileRecord(types, entries, identity);
+    
+    os_unfair_lock_lock(&_writeLock);
+    RKResourceForkSnapshot *previous = self.snapshot;
+    
+    // If the same path was added more than once, the last one is the one that matters.
+    NSUInteger fileIndex = NSNotFound;
+    for (NSUInteger i = previous->_filePaths.count; i-- > 0;) {
+        if ([previous->_filePaths[i] isEqualToString:filePath]) {
+            fileIndex = i;
+            break;
+        }
+    }
+    if (fileIndex == NSNotFound) {
+        os_unfair_lock_unlock(&_writeLock);
+        return nil;
+    }
+    
+    RKResourceChangeSet *changes = nil;
+    NSData *stale = nil;
+    RKResourceForkSnapshot *snapshot = [RKResourceForkSnapshot snapshotByReplacingFileAtIndex:(uint32_t)fileIndex
+                                                                                     withFile:file
+                                                                                      entries:entries
+                                                                                       record:record
+                                                                                   inSnapshot:previous
+                                                                                      changes:&changes
+                                                                                        stale:&stale];
+    if (snapshot) {
+        [self publishSnapshot:snapshot];
+    }
+    os_unfair_lock_unlock(&_writeLock);
+    
+    if (stale.length > 0) {
+        [self evictObjectsOfStaleResources:stale];
+    }
+    
+    if (changes && !changes.empty) {
+        [NSNotificationCenter.defaultCenter postNotificationName:RKResourceForkDidReloadResourceFileNotification
+                                                          object:self
+                                                        userInfo:@{ RKResourceForkChangeSetKey: changes }];
+    }
+    return changes;
+}
+
+// The object of a stale resource may still be shared by a resource that survived, as
+// objects are cached by type and content. Only a resource of the same type and size can
+// have the same content, so only those are hashed to find the keys nothing maps to anymore.
+- (void)evictObjectsOfStaleResources:(NSData *)stale
+{
+    const RKStaleResource *resource = stale.bytes;
+    NSUInteger count = stale.length / sizeof(*resource);
+    NSMutableDictionary <NSNumber *, NSMutableSet <NSNumber *> *> *hashesBySize = [NSMutableDictionary new];
+    NSMutableSet <NSNumber *> *types = [NSMutableSet new];
+    for (NSUInteger i = 0; i < count; ++i) {
+        [types addObject:@(resource[i].type)];
+    }
+    
+    for (NSNumber *code in types) {
+        RKFourCC type = code.unsignedIntValue;
+        [hashesBySize removeAllObjects];
+        for (NSUInteger i = 0; i < count; ++i) {
+            if (resource[i].type == type) {
+                NSMutableSet <NSNumber *> *hashes = hashesBySize[@(resource[i].size)] ?: (hashesBySize[@(resource[i].size)] = [NSMutableSet new]);
+                [hashes addObject:@(resource[i].contentHash)];
             }
         }
         
-        // Ensure they are alphabetical
-        [types sortUsingComparator:^NSComparisonResult(NSString *obj1, NSString *obj2) {
-            return [obj1 compare:obj2];
+        [self enumerateResourcesOfTypeCode:type idRange:RKResourceIdRangeAll usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+            NSMutableSet <NSNumber *> *hashes = hashesBySize[@(info->size)];
+            if (hashes) {
+                uint64_t hash = (info->data.bytes || info->size == 0) ? ContentHash(info->data.bytes, info->data.length, 0) : [self contentHashOfResource:info->handle];
+                [hashes removeObject:@(hash)];
+            }
         }];
         
-        // Ensure its a none mutable array we finally use.
-        return types.copy;
-    }());
+        for (NSMutableSet <NSNumber *> *hashes in hashesBySize.allValues) {
+            for (NSNumber *hash in hashes) {
+                [RKObjectCache.sharedCache removeObjectForKey:[RKResource cacheKeyForTypeCode:type contentHash:hash.unsignedLongLongValue]];
+            }
+        }
+    }
 }
 
-- (NSArray<NSString *> *)allFilePaths
+- (void)startWatchingResourceFiles
 {
-    __weak __typeof(self) weakSelf = self;
-    return _filePaths ?: (_filePaths = ^NSArray <NSString *> * {
-        __strong __typeof(self) self = weakSelf;
-        NSMutableArray <NSString *> *filePaths = [NSMutableArray new];
-        
-        for (id <RKResourceFileProtocol> file in self->_files) {
-            [filePaths addObject:file.filePath];
+    [self startWatchingResourceFilesUsingPolling:NO];
+}
+
+- (void)startWatchingResourceFilesUsingPolling:(BOOL)usesPolling
+{
+    os_unfair_lock_lock(&_writeLock);
+    if (!_watcher) {
+        // Reloads happen one at a time, so two versions of a file can never race to be
+        // published out of order.
+        __weak RKResourceFork *weakSelf = self;
+        dispatch_queue_t queue = dispatch_queue_create("com.resourcekit.resource-fork.reload", DISPATCH_QUEUE_SERIAL);
+        _watcher = [[RKFileWatcher alloc] initWithQueue:queue handler:^(NSString *filePath) {
+            [weakSelf reloadResourceFileAtPath:filePath];
+        }];
+        _watcher.usesPolling = usesPolling;
+        for (NSString *filePath in self.snapshot->_filePaths) {
+            [_watcher watchFileAtPath:filePath];
         }
-        
-        // Ensure its a none mutable array we finally use.
-        return filePaths.copy;
-    }());
+    }
+    os_unfair_lock_unlock(&_writeLock);
+}
+
+- (void)stopWatchingResourceFiles
+{
+    os_unfair_lock_lock(&_writeLock);
+    RKFileWatcher *watcher = _watcher;
+    _watcher = nil;
+    os_unfair_lock_unlock(&_writeLock);
+    
+    [watcher stopWatchingAllFiles];
+}
+
+- (BOOL)isWatchingResourceFiles
+{
+    os_unfair_lock_lock(&_writeLock);
+    BOOL watching = (_watcher != nil);
+    os_unfair_lock_unlock(&_writeLock);
+    return watching;
+}
+
+
+#pragma mark - Calculated Properties
+
+- (NSArray<NSString *> *)allTypes
+{
+    return self.snapshot->_types;
+}
+
+- (NSArray<NSString *> *)allFilePaths
+{
+    return self.snapshot->_filePaths;
 }
 
 - (nonnull NSArray <RKResource *> *)resourcesOfType:(nonnull NSString *)type
 {
-    __weak __typeof(self) weakSelf = self;
-    return _resources[type] ?: (_resources[type] = ^NSArray <RKResource *> * {
-        __strong __typeof(self) self = weakSelf;
-        NSMutableArray <RKResource *> *resources = [NSMutableArray new];
-        
-        for (id <RKResourceFileProtocol> file in self->_files) {
-            if (![file.allTypes containsObject:type]) {
-                continue;
-            }
-            
-            NSArray <RKResource *> *fileResources = [file resourcesOfType:type];
-            for (RKResource *resource in fileResources) {
-                if (![resources containsObject:resource]) {
-                    [resources addObject:resource];
-                }
-            }
+    return [self resourcesOfTypeCode:RKFourCCFromString(type)];
+}
+
+- (nonnull NSArray <RKResource *> *)resourcesOfTypeCode:(RKFourCC)type
+{
+    RKResourceForkSnapshot *snapshot = self.snapshot;
+    RKResourceForkListing *listing = snapshot->_listings[@(type)];
+    if (!listing) {
+        return @[];
+    }
+    
+    void *resources = atomic_load_explicit(&listing->_resources, memory_order_acquire);
+    if (resources) {
+        return (__bridge NSArray <RKResource *> *)resources;
+    }
+    
+    // The resources are created by their files the first time the type is asked for.
+    NSData *handles = snapshot->_sortedHandles[@(type)];
+    const RKResourceHandle *handle = handles.bytes;
+    NSUInteger count = handles.length / sizeof(*handle);
+    NSMutableArray <RKResource *> *created = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; ++i) {
+        const RKResourceForkSlot *slot = &snapshot->_slots[handle[i]];
+        [created addObject:[snapshot->_files[slot->file] resourceForEntry:slot->entry typeCode:slot->type]];
+    }
+    
+    // Whoever loses the race to publish their listing drops it and returns the winner's.
+    void *expected = NULL;
+    resources = (void *)CFBridgingRetain(created.copy);
+    if (!atomic_compare_exchange_strong_explicit(&listing->_resources, &expected, resources, memory_order_acq_rel, memory_order_acquire)) {
+        CFRelease(resources);
+        resources = expected;
+    }
+    return (__bridge NSArray <RKResource *> *)resources;
+}
+
+- (nullable RKResource *)resourceOfType:(nonnull NSString *)type id:(int16_t)id
+{
+    return [self resourceOfTypeCode:RKFourCCFromString(type) id:id];
+}
+
+- (nullable RKResource *)resourceOfTypeCode:(RKFourCC)type id:(int16_t)id
+{
+    return [self resourceForHandle:[self handleOfResourceOfTypeCode:type id:id]];
+}
+
+- (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id
+{
+    return [self dataForResourceOfTypeCode:RKFourCCFromString(type) id:id];
+}
+
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id
+{
+    return [self dataOfResource:[self handleOfResourceOfTypeCode:type id:id]];
+}
+
+
+#pragma mark - Resource Handles
+
+- (nonnull NSData *)handlesOfTypeCode:(RKFourCC)type
+{
+    return self.snapshot->_sortedHandles[@(type)] ?: [NSData data];
+}
+
+- (RKResourceHandle)handleOfResourceOfTypeCode:(RKFourCC)type id:(int16_t)id
+{
+    RKResourceForkSnapshot *snapshot = self.snapshot;
+    RKResourceHandle handle = RKResourceHandleNotFound;
+    if (!ResourceIndexLookup(snapshot->_index, ResourceIndexKey(type, id), &handle)) {
+        return RKResourceHandleNotFound;
+    }
+    return handle;
+}
+
+// Copies the slot of the specified handle, and the file it refers to, out of the current
+// snapshot. Handles mean the same resource in every snapshot, so it does not matter which
+// snapshot the handle came from, but a handle retired since then has no slot.
+- (BOOL)getSlot:(RKResourceForkSlot *)slot file:(id <RKResourceFileProtocol> *)file forHandle:(RKResourceHandle)handle
+{
+    RKResourceForkSnapshot *snapshot = self.snapshot;
+    if (handle >= snapshot->_slotCount || snapshot->_slots[handle].file == RKResourceForkSlotRemoved) {
+        return NO;
+    }
+    
+    *slot = snapshot->_slots[handle];
+    if (file) {
+        *file = snapshot->_files[slot->file];
+    }
+    return YES;
+}
+
+- (RKFourCC)typeCodeOfResource:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    return [self getSlot:&slot file:NULL forHandle:handle] ? slot.type : 0;
+}
+
+- (int16_t)idOfResource:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    return [self getSlot:&slot file:NULL forHandle:handle] ? slot.entry.id : 0;
+}
+
+- (uint32_t)sizeOfResource:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    return [self getSlot:&slot file:NULL forHandle:handle] ? slot.entry.size : 0;
+}
+
+- (nullable NSString *)nameOfResource:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    id <RKResourceFileProtocol> file = nil;
+    return [self getSlot:&slot file:&file forHandle:handle] ? [file nameOfResourceEntry:slot.entry] : nil;
+}
+
+- (nullable NSData *)dataOfResource:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    id <RKResourceFileProtocol> file = nil;
+    if (![self getSlot:&slot file:&file forHandle:handle]) {
+        return nil;
+    }
+    else if ([file respondsToSelector:@selector(dataForResourceOfTypeCode:id:)]) {
+        return [file dataForResourceOfTypeCode:slot.type id:slot.entry.id];
+    }
+    return [file dataForResourceOfType:NSStringFromFourCC(slot.type) id:slot.entry.id];
+}
+
+- (uint64_t)contentHashOfResource:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    id <RKResourceFileProtocol> file = nil;
+    if (![self getSlot:&slot file:&file forHandle:handle]) {
+        return 0;
+    }
+    
+    RKBytesView data = [file dataViewOfResourceEntry:slot.entry];
+    if (!data.bytes && slot.entry.size > 0) {
+        NSData *copy = RKResourceFileData(file, slot.type, slot.entry.id);
+        return ContentHash(copy.bytes, copy.length, 0);
+    }
+    return ContentHash(data.bytes, data.length, 0);
+}
+
+- (nullable RKResource *)resourceForHandle:(RKResourceHandle)handle
+{
+    RKResourceForkSlot slot;
+    id <RKResourceFileProtocol> file = nil;
+    return [self getSlot:&slot file:&file forHandle:handle] ? [file resourceForEntry:slot.entry typeCode:slot.type] : nil;
+}
+
+
+#pragma mark - Resource Files
+
+- (nonnull NSArray <id<RKResourceFileProtocol>> *)resourceFilesContainingResourceOfTypeCode:(RKFourCC)type id:(int16_t)resourceId
+{
+    uint64_t key = ResourceIndexKey(type, resourceId);
+    
+    // The filters rule out almost every file that does not have the resource without
+    // touching its resource map, leaving only the candidates to be checked properly.
+    RKResourceForkSnapshot *snapshot = self.snapshot;
+    NSMutableArray <id<RKResourceFileProtocol>> *containing = [NSMutableArray new];
+    for (NSUInteger i = 0; i < snapshot->_files.count; ++i) {
+        if (snapshot->_filters[i] && !ResourceFilterMayContainResource(snapshot->_filters[i], key)) {
+            continue;
         }
         
-        [resources sortUsingComparator:^NSComparisonResult(RKResource *obj1, RKResource *obj2) {
-            return obj1.id < obj2.id ? NSOrderedAscending : NSOrderedDescending;
-        }];
+        id <RKResourceFileProtocol> file = snapshot->_files[i];
+        NSData *entries = [file resourceEntriesOfTypeCode:type];
+        RKResourceEntry target = { .id = resourceId };
+        if (bsearch(&target, entries.bytes, entries.length / sizeof(target), sizeof(target), RKResourceEntryCompareIds)) {
+            [containing addObject:file];
+        }
+    }
+    return containing.copy;
+}
+
+
+#pragma mark - Enumeration
+
+- (void)enumerateResourcesOfTypeCode:(RKFourCC)type
+                             idRange:(RKResourceIdRange)range
+                          usingBlock:(nonnull void (^)(const RKResourceInfo *info, BOOL *stop))block
+{
+    // The whole enumeration works from one snapshot, so files added meanwhile are not seen.
+    RKResourceForkSnapshot *snapshot = self.snapshot;
+    NSData *handles = snapshot->_sortedHandles[@(type)];
+    const RKResourceHandle *handle = handles.bytes;
+    const RKResourceForkSlot *slots = snapshot->_slots;
+    NSUInteger count = handles.length / sizeof(*handle);
+    
+    // The handles are sorted by id, so the start of the range can be found by bisection.
+    NSUInteger lower = 0;
+    NSUInteger upper = count;
+    while (lower < upper) {
+        NSUInteger middle = lower + (upper - lower) / 2;
+        if (slots[handle[middle]].entry.id < range.first) {
+            lower = middle + 1;
+        }
+        else {
+            upper = middle;
+        }
+    }
+    
+    BOOL stop = NO;
+    for (NSUInteger i = lower; i < count && !stop; ++i) {
+        const RKResourceForkSlot *slot = &slots[handle[i]];
+        if (slot->entry.id > range.last) {
+            break;
+        }
         
-        return resources.copy;
-    }());
+        id <RKResourceFileProtocol> file = snapshot->_files[slot->file];
+        RKResourceInfo info = {
+            .handle = handle[i],
+            .id = slot->entry.id,
+            .size = slot->entry.size,
+            .name = [file nameViewOfResourceEntry:slot->entry],
+            .data = [file dataViewOfResourceEntry:slot->entry],
+        };
+        block(&info, &stop);
+    }
 }
 
-- (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id
+
+#pragma mark - Duplication
+
+typedef struct {
+    uint64_t hash;
+    uint32_t size;
+} RKPayloadRecord;
+
+static int RKPayloadRecordCompare(const void *lhs, const void *rhs)
+{
+    uint64_t lhsHash = ((const RKPayloadRecord *)lhs)->hash;
+    uint64_t rhsHash = ((const RKPayloadRecord *)rhs)->hash;
+    return (lhsHash > rhsHash) - (lhsHash < rhsHash);
+}
+
+- (RKDuplicationSummary)duplicationSummaryOfTypeCode:(RKFourCC)type
 {
-    NSArray <RKResource *> *resources = [self resourcesOfType:type];
-    for (RKResource *resource in resources) {
-        if (resource.id == id) {
-            return resource.data;
+    RKDuplicationSummary summary = { 0 };
+    NSUInteger capacity = [self handlesOfTypeCode:type].length / sizeof(RKResourceHandle);
+    RKPayloadRecord *records = malloc(MAX(capacity, 1) * sizeof(*records));
+    if (!records) {
+        return summary;
+    }
+    
+    // Every payload is hashed straight from its file, and sorting the hashes brings the
+    // copies of each payload together.
+    __block NSUInteger count = 0;
+    [self enumerateResourcesOfTypeCode:type idRange:RKResourceIdRangeAll usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+        if (count == capacity) {
+            *stop = YES;
+            return;
+        }
+        uint64_t hash = (info->data.bytes || info->size == 0) ? ContentHash(info->data.bytes, info->data.length, 0) : [self contentHashOfResource:info->handle];
+        records[count++] = (RKPayloadRecord){ hash, info->size };
+    }];
+    qsort(records, count, sizeof(*records), RKPayloadRecordCompare);
+    
+    for (NSUInteger i = 0; i < count; ++i) {
+        summary.bytes += records[i].size;
+        if (i > 0 && records[i].hash == records[i - 1].hash) {
+            summary.duplicateBytes += records[i].size;
+        }
+        else {
+            summary.uniqueCount++;
         }
     }
-    return nil;
+    summary.count = count;
+    
+    free(records);
+    return summary;
+}
+
+
+#pragma mark - Decoding
+
+- (RKBulkDecodeSummary)decodeResourcesOfType:(nonnull NSString *)type
+                                     handler:(nullable void (^)(RKResource *_Nonnull resource, id _Nullable object, uint64_t duration))handler
+{
+    return [self decodeResourcesOfType:type maximumConcurrency:NSProcessInfo.processInfo.activeProcessorCount handler:handler];
+}
+
+- (RKBulkDecodeSummary)decodeResourcesOfType:(nonnull NSString *)type
+                          maximumConcurrency:(NSUInteger)maximumConcurrency
+                                     handler:(nullable void (^)(RKResource *_Nonnull resource, id _Nullable object, uint64_t duration))handler
+{
+    RKBulkDecodeSummary summary = { 0 };
+    RKFourCC code = RKFourCCFromString(type);
+    
+    NSData *handles = [self handlesOfTypeCode:code];
+    const RKResourceHandle *handle = handles.bytes;
+    NSUInteger count = handles.length / sizeof(*handle);
+    if (count == 0) {
+        return summary;
+    }
+    
+    // Workers claim resources by position in the merged handles.
+    __block _Atomic(NSUInteger) nextResource = 0;
+    __block _Atomic(NSUInteger) failures = 0;
+    __block _Atomic(uint64_t) bytes = 0;
+    __block _Atomic(uint64_t) decodeTime = 0;
+    size_t workerCount = MAX(MIN(maximumConcurrency, count), 1);
+    uint64_t start = RKDecodeClock();
+    
+    dispatch_apply(workerCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t worker __unused) {
+        NSUInteger i;
+        while ((i = atomic_fetch_add_explicit(&nextResource, 1, memory_order_relaxed)) < count) {
+            @autoreleasepool {
+                RKResource *resource = [self resourceForHandle:handle[i]];
+                
+                uint64_t decodeStart = RKDecodeClock();
+                id object = resource.object;
+                uint64_t duration = RKDecodeClock() - decodeStart;
+                
+                atomic_fetch_add_explicit(&bytes, resource.size, memory_order_relaxed);
+                atomic_fetch_add_explicit(&decodeTime, duration, memory_order_relaxed);
+                if (!object) {
+                    atomic_fetch_add_explicit(&failures, 1, memory_order_relaxed);
+                }
+                
+                if (handler) {
+                    handler(resource, object, duration);
+                }
+            }
+        }
+    });
+    
+    summary.count = count;
+    summary.failures = atomic_load(&failures);
+    summary.bytes = atomic_load(&bytes);
+    summary.decodeTime = atomic_load(&decodeTime);
+    summary.elapsedTime = RKDecodeClock() - start;
+    return summary;
+}
+
+- (nullable RKDecodeRequest *)requestObjectForResourceOfType:(nonnull NSString *)type
+                                                          id:(int16_t)id
+                                                    priority:(RKDecodePriority)priority
+                                                       queue:(nullable dispatch_queue_t)queue
+                                                  completion:(nonnull void (^)(id _Nullable object))completion
+{
+    return [[self resourceOfType:type id:id] requestObjectWithPriority:priority queue:queue completion:completion];
 }
 
 @end
@@ -0,0 +1,70 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "RKResourceFileProtocol.h"
+#import "RKPixelBuffer.h"
+
+@class RKResourceFork;
+
+/// The domain of the errors produced when baking an archive.
+FOUNDATION_EXPORT NSErrorDomain const _Nonnull RKArchiveErrorDomain;
+
+/// The reasons that an archive could not be baked.
+typedef NS_ENUM(NSInteger, RKArchiveError)
+{
+    /// The pixel format is indexed or not valid. Only direct formats can be baked.
+    RKArchiveError_UnsupportedPixelFormat = 1,
+    
+    /// The archive could not be created or written. The underlying POSIX error, if there
+    /// is one, is under NSUnderlyingErrorKey.
+    RKArchiveError_WriteFailed,
+};
+
+/// RKArchiveResourceFile serves resources from a baked archive. An archive holds the raw
+/// data of every resource from the resource files it was baked from, along with the
+/// decoded pixels of every image in a single pixel format. The archive is mapped rather
+/// than read, so the data of a resource and the images built from it refer directly to
+/// the pages of the archive, which are shared between every process that loads it.
+///
+/// Baked images are served in place of parsing whenever the requested pixel format is
+/// the one the archive was baked in and no mipmaps are requested. Pictures are also
+/// served when no pixel format is requested and the archive is RKPixelFormat_RGBA8888,
+/// as that is the format they are parsed into by default. Everything else, including the
+/// Nova type records, is parsed from the raw data as usual.
+@interface RKArchiveResourceFile : NSObject <RKResourceFileProtocol>
+
+/// The pixel format that the images in the archive were decoded into.
+@property (readonly) RKPixelFormat pixelFormat;
+
+/// Bake every resource in the resource fork into an archive at the specified path, with
+/// images decoded into the specified pixel format. Indexed images are only meaningful
+/// alongside their color tables, and so can not be baked. Returns NO and sets the error
+/// if the archive could not be written.
++ (BOOL)bakeResourceFork:(nonnull RKResourceFork *)resourceFork
+                  toPath:(nonnull NSString *)path
+             pixelFormat:(RKPixelFormat)pixelFormat
+                   error:(NSError * _Nullable * _Nullable)error;
+
+@end
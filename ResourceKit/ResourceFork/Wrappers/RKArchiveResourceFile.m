@@ -0,0 +1,379 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Cocoa/Cocoa.h>
+#import "RKArchiveResourceFile.h"
+#import "Archive.h"
+#import "RKResource.h"
+#import "RKFourCC.h"
+#import "ResourceIndex.h"
+#import "RKResourceFork.h"
+#import "RKResourceParserProtocol.h"
+#import "RKIncrementalDecoderProtocol.h"
+#import "RKRLEObject.h"
+#import "RKRLESprite.h"
+
+NSErrorDomain const RKArchiveErrorDomain = @"RKArchiveErrorDomain";
+
+static NSError *RKArchiveBakeError(RKArchiveError code, NSString *path, NSString *description, int posixError)
+{
+    NSMutableDictionary <NSString *, id> *userInfo = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                                      description, NSLocalizedDescriptionKey,
+                                                      path, NSFilePathErrorKey, nil];
+    if (posixError) {
+        userInfo[NSUnderlyingErrorKey] = [NSError errorWithDomain:NSPOSIXErrorDomain code:posixError userInfo:nil];
+    }
+    return [NSError errorWithDomain:RKArchiveErrorDomain code:code userInfo:userInfo];
+}
+
+@implementation RKArchiveResourceFile {
+@private
+    __strong NSArray <NSString *> *_Nullable _types;
+    __strong NSMutableDictionary <NSString *, NSArray <RKResource *> *> *_resources;
+    __strong NSMutableDictionary <NSNumber *, RKResource *> *_resourceObjects;
+    Archive *_archive;
+}
+
+@synthesize filePath = _filePath;
+
+#pragma mark - Resource File Information
+
++ (NSString *)extension
+{
+    return @"rka";
+}
+
+
+#pragma mark - Creation
+
++ (instancetype)resourceFileWithPath:(NSString *)filePath
+{
+    return [[self alloc] initWithFilePath:filePath];
+}
+
+- (instancetype)initWithFilePath:(NSString *)filePath
+{
+    if (!filePath) {
+        return nil;
+    }
+    
+    if (self = [super init]) {
+        if ((_archive = ArchiveOpen(filePath.fileSystemRepresentation)) == NULL) {
+            return nil;
+        }
+        
+        _pixelFormat = _archive->header->pixelFormat;
+        _resources = NSMutableDictionary.new;
+        _resourceObjects = NSMutableDictionary.new;
+        _filePath = filePath.copy;
+    }
+    
+    return self;
+}
+
+
+#pragma mark - Destruction
+
+- (void)dealloc
+{
+    // Anything still using the pages of the archive holds a reference to the receiver, so
+    // by now nothing is.
+    ArchiveClose(_archive);
+}
+
+
+#pragma mark - Baking
+
++ (BOOL)bakeResourceFork:(RKResourceFork *)resourceFork toPath:(NSString *)path pixelFormat:(RKPixelFormat)pixelFormat error:(NSError **)error
+{
+    if (pixelFormat == RKPixelFormat_Indexed8 || !RKPixelFormatIsValid(pixelFormat)) {
+        if (error) {
+            *error = RKArchiveBakeError(RKArchiveError_UnsupportedPixelFormat, path, @"Images can only be baked into an archive in a direct pixel format.", 0);
+        }
+        return NO;
+    }
+    
+    ArchiveWriter *writer = ArchiveWriterCreate(path.fileSystemRepresentation, pixelFormat);
+    if (!writer) {
+        if (error) {
+            *error = RKArchiveBakeError(RKArchiveError_WriteFailed, path, [NSString stringWithFormat:@"Unable to create the archive at %@.", path], errno);
+        }
+        return NO;
+    }
+    
+    NSDictionary <NSString *, id> *options = @{ RKResourceParserOptionPixelFormat: @(pixelFormat) };
+    for (NSString *typeString in resourceFork.allTypes) {
+        // The resource fork never lists a type that it could not convert.
+        RKFourCC code = RKFourCCFromString(typeString);
+        if (code == 0) {
+            continue;
+        }
+        
+        uint32_t type = ArchiveWriterAddType(writer, code);
+        Class parser = [RKResource parserForTypeCode:code];
+        
+        for (RKResource *resource in [resourceFork resourcesOfType:typeString]) {
+            @autoreleasepool {
+                NSData *data = resource.data ?: [NSData data];
+                const char *name = [resource.name cStringUsingEncoding:NSMacOSRomanStringEncoding] ?: resource.name.UTF8String;
+                ArchiveWriterAddResource(writer, type, resource.id, name, data.bytes, (uint32_t)data.length);
+                [self bakeImageOfData:data parser:parser options:options writer:writer];
+            }
+        }
+    }
+    
+    BOOL finished = ArchiveWriterFinish(writer);
+    int writeError = finished ? 0 : errno;
+    ArchiveWriterDestroy(writer);
+    if (!finished && error) {
+        *error = RKArchiveBakeError(RKArchiveError_WriteFailed, path, [NSString stringWithFormat:@"Failed to write the archive at %@.", path], writeError);
+    }
+    return finished;
+}
+
++ (void)bakeImageOfData:(NSData *)data parser:(Class)parser options:(NSDictionary <NSString *, id> *)options writer:(ArchiveWriter *)writer
+{
+    // Only decoders that can hand back their pixel buffers have anything worth baking.
+    if (![parser respondsToSelector:@selector(incrementalDecoderForData:options:)]) {
+        return;
+    }
+    
+    id <RKIncrementalDecoderProtocol> decoder = [parser incrementalDecoderForData:data options:options];
+    if (![decoder respondsToSelector:@selector(decodedPixelBuffers)] || [decoder decodeUntil:UINT64_MAX] != RKDecodeStatus_Complete) {
+        return;
+    }
+    
+    // Pictures are handed back as an NSImage whatever format their pixels were decoded in,
+    // so they can always stand in for one decoded in the default format.
+    ArchiveImageKind kind = ArchiveImageKind_None;
+    RKPixelFormat defaultPixelFormat = RKPixelFormat_RGBA8888;
+    if ([decoder.decodedObject isKindOfClass:RKRLEObject.class]) {
+        kind = ArchiveImageKind_Sprites;
+        if ([decoder respondsToSelector:@selector(defaultPixelFormat)]) {
+            defaultPixelFormat = decoder.defaultPixelFormat;
+        }
+    }
+    else if ([decoder.decodedObject isKindOfClass:NSImage.class]) {
+        kind = ArchiveImageKind_Picture;
+    }
+    
+    // A decoder may still fall back to a format of its own choosing, in which case the
+    // image is left to be parsed when it is loaded.
+    NSArray <RKPixelBuffer *> *buffers = decoder.decodedPixelBuffers;
+    RKPixelFormat pixelFormat = [options[RKResourceParserOptionPixelFormat] unsignedIntValue];
+    if (kind == ArchiveImageKind_None || buffers.count == 0) {
+        return;
+    }
+    for (RKPixelBuffer *buffer in buffers) {
+        if (buffer.format != pixelFormat) {
+            return;
+        }
+    }
+    
+    for (RKPixelBuffer *buffer in buffers) {
+        ArchiveWriterAddFrame(writer, kind, defaultPixelFormat, buffer.width, buffer.height, RKPixelFormatBytesPerPixel(buffer.format), buffer.bytes, buffer.stride);
+    }
+}
+
+
+#pragma mark - Accessors
+
+- (const ArchiveResource *)resourceOfTypeCode:(RKFourCC)code id:(int16_t)id
+{
+    const ArchiveType *type = code ? ArchiveGetTypeForCode(_archive, code) : NULL;
+    return type ? ArchiveGetResourceOfTypeWithId(_archive, type, id) : NULL;
+}
+
+- (NSArray<NSString *> *)allTypes
+{
+    @synchronized (self) {
+        return _types ?: (_types = ^ NSArray <NSString *> * {
+            NSMutableArray <NSString *> *types = [NSMutableArray arrayWithCapacity:_archive->header->typeCount];
+            for (uint32_t i = 0; i < _archive->header->typeCount; ++i) {
+                [types addObject:[[NSString alloc] initWithBytes:_archive->types[i].code length:4 encoding:NSMacOSRomanStringEncoding]];
+            }
+            return types.copy;
+        }());
+    }
+}
+
+- (nonnull NSArray <RKResource *> *)resourcesOfType:(nonnull NSString *)typeString
+{
+    @synchronized (self) {
+        return _resources[typeString] ?: (_resources[typeString] = ^ NSArray <RKResource *> * {
+            RKFourCC code = RKFourCCFromString(typeString);
+            NSData *entries = [self resourceEntriesOfTypeCode:code];
+            const RKResourceEntry *entry = entries.bytes;
+            
+            NSUInteger count = entries.length / sizeof(*entry);
+            NSMutableArray <RKResource *> *resources = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger i = 0; i < count; ++i) {
+                [resources addObject:[self resourceForEntry:entry[i] typeCode:code]];
+            }
+            return resources.copy;
+        }());
+    }
+}
+
+- (nonnull NSData *)resourceEntriesOfTypeCode:(RKFourCC)code
+{
+    // The archive is immutable and mapped, so it can be read without taking a lock.
+    const ArchiveType *type = code ? ArchiveGetTypeForCode(_archive, code) : NULL;
+    if (!type) {
+        return [NSData data];
+    }
+    
+    NSMutableData *entries = [NSMutableData dataWithLength:type->resourceCount * sizeof(RKResourceEntry)];
+    RKResourceEntry *entry = entries.mutableBytes;
+    for (uint32_t i = 0; i < type->resourceCount; ++i) {
+        const ArchiveResource *resource = &_archive->resources[type->firstResource + i];
+        entry[i] = (RKResourceEntry){ .id = resource->id, .size = resource->size, .reference = type->firstResource + i, .dataOffset = (uint32_t)resource->dataOffset };
+    }
+    return entries;
+}
+
+- (nonnull NSString *)nameOfResourceEntry:(RKResourceEntry)entry
+{
+    if (entry.reference >= _archive->header->resourceCount) {
+        return @"";
+    }
+    
+    const ArchiveResource *resource = &_archive->resources[entry.reference];
+    return [[NSString alloc] initWithBytes:_archive->names + resource->nameOffset
+                                    length:resource->nameLength
+                                  encoding:NSMacOSRomanStringEncoding] ?: @"";
+}
+
+- (nonnull RKResource *)resourceForEntry:(RKResourceEntry)entry typeCode:(RKFourCC)code
+{
+    @synchronized (self) {
+        NSNumber *key = @(ResourceIndexKey(code, entry.id));
+        return _resourceObjects[key] ?: (_resourceObjects[key] = [[RKResource alloc] initWithType:NSStringFromFourCC(code)
+                                                                                                id:entry.id
+                                                                                              name:[self nameOfResourceEntry:entry]
+                                                                                              size:entry.size
+                                                                                             owner:self]);
+    }
+}
+
+- (nullable RKResource *)existingResourceOfTypeCode:(RKFourCC)code id:(int16_t)resourceId
+{
+    @synchronized (self) {
+        return _resourceObjects[@(ResourceIndexKey(code, resourceId))];
+    }
+}
+
+- (RKBytesView)nameViewOfResourceEntry:(RKResourceEntry)entry
+{
+    if (entry.reference >= _archive->header->resourceCount) {
+        return (RKBytesView){ NULL, 0 };
+    }
+    
+    const ArchiveResource *resource = &_archive->resources[entry.reference];
+    return (RKBytesView){ _archive->names + resource->nameOffset, resource->nameLength };
+}
+
+- (RKBytesView)dataViewOfResourceEntry:(RKResourceEntry)entry
+{
+    if (entry.reference >= _archive->header->resourceCount) {
+        return (RKBytesView){ NULL, 0 };
+    }
+    
+    // Archives may be larger than the offset in an entry can hold, so the offset is taken
+    // from the resource itself.
+    const ArchiveResource *resource = &_archive->resources[entry.reference];
+    return (RKBytesView){ _archive->mapping + resource->dataOffset, resource->size };
+}
+
+- (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id
+{
+    return [self dataForResourceOfTypeCode:RKFourCCFromString(type) id:id];
+}
+
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id
+{
+    const ArchiveResource *resource = [self resourceOfTypeCode:type id:id];
+    if (!resource) {
+        return nil;
+    }
+    
+    // The data refers straight to the archive, which it keeps mapped for as long as it
+    // is alive.
+    return [[NSData alloc] initWithBytesNoCopy:_archive->mapping + resource->dataOffset
+                                        length:resource->size
+                                   deallocator:^(void *bytes __unused, NSUInteger length __unused) {
+                                       (void)self;
+                                   }];
+}
+
+- (nullable id)objectForResourceOfType:(nonnull NSString *)type id:(int16_t)id options:(nullable NSDictionary<NSString *, id> *)options
+{
+    const ArchiveResource *resource = [self resourceOfTypeCode:RKFourCCFromString(type) id:id];
+    if (!resource || resource->frameCount == 0 || [options[RKResourceParserOptionGenerateMipmaps] boolValue]) {
+        return nil;
+    }
+    
+    // Without a requested format the frames are only used if they are in the format the
+    // parser would have chosen, which rules out 8-bit sprites as those are kept indexed.
+    NSNumber *requestedFormat = options[RKResourceParserOptionPixelFormat];
+    RKPixelFormat format = requestedFormat ? requestedFormat.unsignedIntValue : resource->defaultPixelFormat;
+    if (format != _pixelFormat) {
+        return nil;
+    }
+    
+    NSMutableArray <RKPixelBuffer *> *buffers = [NSMutableArray arrayWithCapacity:resource->frameCount];
+    for (uint32_t i = 0; i < resource->frameCount; ++i) {
+        const ArchiveFrame *frame = &_archive->frames[resource->firstFrame + i];
+        RKPixelBuffer *buffer = [RKPixelBuffer pixelBufferWithBytes:_archive->mapping + frame->offset
+                                                              width:frame->width
+                                                             height:frame->height
+                                                             stride:frame->stride
+                                                             format:_pixelFormat
+                                                              owner:self];
+        if (!buffer) {
+            return nil;
+        }
+        [buffers addObject:buffer];
+    }
+    
+    switch (resource->kind) {
+        case ArchiveImageKind_Picture: {
+            RKPixelBuffer *buffer = buffers.lastObject;
+            return [[NSImage alloc] initWithCGImage:buffer.imageValue size:buffer.size];
+        }
+            
+        case ArchiveImageKind_Sprites: {
+            NSMutableArray <RKRLESprite *> *sprites = [NSMutableArray arrayWithCapacity:buffers.count];
+            for (RKPixelBuffer *buffer in buffers) {
+                [sprites addObject:[[RKRLESprite alloc] initWithPixelBuffer:buffer]];
+            }
+            return [[RKRLEObject alloc] initWithSprites:sprites ofSize:buffers.firstObject.size];
+        }
+            
+        default:
+            return nil;
+    }
+}
+
+@end
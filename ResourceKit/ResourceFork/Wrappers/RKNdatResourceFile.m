@@ -26,12 +26,21 @@
 #import "Ndat.h"
 #import "Allocations.h"
 #import "RKResource.h"
+#import "RKFourCC.h"
+#import "RKResourceIndexCache.h"
+#import "IndexCache.h"
+#import "ResourceIndex.h"
+#import "DataFile.h"
 
 @implementation RKNdatResourceFile {
 @private
     __strong NSArray <NSString *> *_Nullable _types;
     __strong NSMutableDictionary <NSString *, NSArray <RKResource *> *> *_resources;
+    __strong NSMutableDictionary <NSNumber *, RKResource *> *_resourceObjects;
+    __strong NSMutableDictionary <NSNumber *, NSString *> *_names;
     NdatResourceFile *_Nullable _file;
+    __strong RKResourceIndexCache *_Nullable _indexCache;
+    FileMapping _mapping;
 }
 
 @synthesize filePath = _filePath;
@@ -58,12 +67,24 @@
     }
     
     if (self = [super init]) {
-        _file = NdatOpenFile(filePath.UTF8String);
-        if (!_file) {
-            return nil;
+        // An up to date index cache saves parsing the resource map at all. The key is taken
+        // before the file is parsed, so a cache written from the parse can never claim to
+        // describe a version of the file that changed in the meantime.
+        IndexCacheKey key;
+        BOOL hasKey = [RKResourceIndexCache getKey:&key forResourceFileAtPath:filePath];
+        _indexCache = hasKey ? [RKResourceIndexCache indexCacheForResourceFileAtPath:filePath key:&key] : nil;
+        if (!_indexCache) {
+            if ((_file = NdatOpenFile(filePath.UTF8String)) == NULL) {
+                return nil;
+            }
+            if (hasKey) {
+                [self writeIndexCacheForFilePath:filePath key:&key];
+            }
         }
         
         _resources = NSMutableDictionary.new;
+        _resourceObjects = NSMutableDictionary.new;
+        _names = NSMutableDictionary.new;
         _filePath = filePath.copy;
     }
     
@@ -76,6 +97,26 @@
 - (void)dealloc
 {
     NdatCloseFile(_file);
+    FileUnmap(&_mapping);
+}
+
+
+#pragma mark - Index Cache
+
+- (void)writeIndexCacheForFilePath:(NSString *)filePath key:(const IndexCacheKey *)key
+{
+    NdatResourceFile *file = _file;
+    [RKResourceIndexCache writeIndexCacheForResourceFileAtPath:filePath key:key usingBlock:^(IndexCacheWriter *writer) {
+        for (NdatType *type = file->types; type; type = type->next) {
+            uint32_t typeIndex = IndexCacheWriterAddType(writer, type->fourCC);
+            for (NdatResource *resource = type->resources; resource; resource = resource->next) {
+                // Ndat data offsets are relative to the data section, and skip the length
+                // that precedes the data of each resource.
+                uint64_t offset = (uint64_t)file->header->resourceDataOffset + resource->dataOffset + sizeof(int32_t);
+                IndexCacheWriterAddResource(writer, typeIndex, resource->id, NdatGetResourceName(file, resource), offset, resource->size);
+            }
+        }
+    }];
 }
 
 
@@ -83,59 +124,191 @@
 
 - (NSArray<NSString *> *)allTypes
 {
-    return _types ?: (_types = ^ NSArray <NSString *> * {
-        NSMutableArray *types = [NSMutableArray new];
-        
-        for (uint32_t i = 0; i < _file->typeCount; ++i) {
-            NdatType *type = NdatGetResourceTypeAtIndex(_file, i);
-            char *typeCode = New(5);
-            strncpy(typeCode, type->code, 4);
-            [types addObject:[NSString stringWithFormat:@"%s", typeCode]];
-            free(typeCode);
+    @synchronized (self) {
+        if (_indexCache) {
+            return _types ?: (_types = _indexCache.allTypes);
         }
         
-        return types;
-    }());
+        return _types ?: (_types = ^ NSArray <NSString *> * {
+            NSMutableArray *types = [NSMutableArray new];
+            
+            for (uint32_t i = 0; i < _file->typeCount; ++i) {
+                NdatType *type = NdatGetResourceTypeAtIndex(_file, i);
+                char *typeCode = New(5);
+                strncpy(typeCode, type->code, 4);
+                [types addObject:[NSString stringWithFormat:@"%s", typeCode]];
+                free(typeCode);
+            }
+            
+            return types;
+        }());
+    }
 }
 
 - (nonnull NSArray <RKResource *> *)resourcesOfType:(nonnull NSString *)typeCode
 {
-    // TODO: This needs to be made more efficient and cleaner.
-    return _resources[typeCode] ?: (_resources[typeCode] = ^NSArray <RKResource *> *{
-        NSMutableArray <RKResource *> *resources = [NSMutableArray new];
+    @synchronized (self) {
+        return _resources[typeCode] ?: (_resources[typeCode] = ^NSArray <RKResource *> *{
+            RKFourCC code = RKFourCCFromString(typeCode);
+            NSData *entries = [self resourceEntriesOfTypeCode:code];
+            const RKResourceEntry *entry = entries.bytes;
+            
+            NSUInteger count = entries.length / sizeof(*entry);
+            NSMutableArray <RKResource *> *resources = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger i = 0; i < count; ++i) {
+                [resources addObject:[self resourceForEntry:entry[i] typeCode:code]];
+            }
+            return resources.copy;
+        }());
+    }
+}
+
+- (nonnull NSData *)resourceEntriesOfTypeCode:(RKFourCC)code
+{
+    if (code == 0) {
+        return [NSData data];
+    }
+    
+    @synchronized (self) {
+        if (_indexCache) {
+            return [_indexCache resourceEntriesOfTypeCode:code];
+        }
         
-        const char *typeCodeMacOS = [typeCode cStringUsingEncoding:NSMacOSRomanStringEncoding];
-        NdatType *type = NdatGetResourceTypeForCode(_file, typeCodeMacOS);
+        NdatType *type = NdatGetResourceTypeForCode(_file, code);
+        if (!type || type->resourceCount == 0) {
+            return [NSData data];
+        }
         
-        if (!type) {
-            return @[];
+        NSMutableData *entries = [NSMutableData dataWithLength:type->resourceCount * sizeof(RKResourceEntry)];
+        RKResourceEntry *entry = entries.mutableBytes;
+        size_t count = 0;
+        for (NdatResource *resource = type->resources; resource && count < type->resourceCount; resource = resource->next) {
+            entry[count++] = (RKResourceEntry){ .id = resource->id, .size = resource->size, .reference = resource->nameOffset, .dataOffset = (uint32_t)(_file->header->resourceDataOffset + resource->dataOffset + sizeof(int32_t)) };
         }
+        entries.length = count * sizeof(*entry);
         
-        for (uint32_t i = 0; i < type->resourceCount; ++i) {
-            NdatResource *resource = NdatGetResourceHeaderOfTypeAtIndex(_file, typeCodeMacOS, i);
-            
-            NSString *name = [NSString stringWithFormat:@"%s", resource->name];
-            
-            RKResource *resourceObject = [[RKResource alloc] initWithType:typeCode
-                                                                       id:resource->id
-                                                                     name:name
-                                                                     size:resource->size
-                                                                    owner:self];
-            [resources addObject:resourceObject];
+        // Resource maps are not necessarily in id order, but the fork expects entries to be.
+        qsort(entry, count, sizeof(*entry), RKResourceEntryCompareIds);
+        return entries;
+    }
+}
+
+- (nonnull NSString *)nameOfResourceEntry:(RKResourceEntry)entry
+{
+    @synchronized (self) {
+        if (_indexCache) {
+            return [_indexCache nameOfResourceAtIndex:entry.reference];
+        }
+        
+        // Identical names share an offset in the names pool, so each distinct name is only
+        // made into a string once, and only when a resource with that name is first asked for.
+        if (entry.reference == 0) {
+            return @"";
+        }
+        
+        NSString *name = _names[@(entry.reference)];
+        if (!name) {
+            name = [[NSString alloc] initWithCString:StringPoolGetString(&_file->names, entry.reference)
+                                            encoding:NSMacOSRomanStringEncoding] ?: @"";
+            _names[@(entry.reference)] = name;
+        }
+        return name;
+    }
+}
+
+- (nonnull RKResource *)resourceForEntry:(RKResourceEntry)entry typeCode:(RKFourCC)code
+{
+    @synchronized (self) {
+        NSNumber *key = @(ResourceIndexKey(code, entry.id));
+        return _resourceObjects[key] ?: (_resourceObjects[key] = [[RKResource alloc] initWithType:NSStringFromFourCC(code)
+                                                                                                id:entry.id
+                                                                                              name:[self nameOfResourceEntry:entry]
+                                                                                              size:entry.size
+                                                                                             owner:self]);
+    }
+}
+
+- (nullable RKResource *)existingResourceOfTypeCode:(RKFourCC)code id:(int16_t)resourceId
+{
+    @synchronized (self) {
+        return _resourceObjects[@(ResourceIndexKey(code, resourceId))];
+    }
+}
+
+- (RKBytesView)nameViewOfResourceEntry:(RKResourceEntry)entry
+{
+    if (_indexCache) {
+        return [_indexCache nameViewOfResourceAtIndex:entry.reference];
+    }
+    
+    // The names pool is complete once the file has been opened, so it can be read without
+    // taking a lock.
+    const char *name = StringPoolGetString(&_file->names, entry.reference);
+    return (RKBytesView){ name, strlen(name) };
+}
+
+- (RKBytesView)dataViewOfResourceEntry:(RKResourceEntry)entry
+{
+    // The file is only mapped the first time the data of a resource is viewed, as most
+    // files are only ever read through -dataForResourceOfType:id:.
+    @synchronized (self) {
+        if (!_mapping.bytes && !FileMap(_filePath.fileSystemRepresentation, &_mapping)) {
+            return (RKBytesView){ NULL, 0 };
+        }
+    }
+    
+    // The file may have been truncated in place since it was mapped, so the data is only
+    // handed out while the file still holds it.
+    if (!FileMappingCanReadData(&_mapping, entry.dataOffset, entry.size)) {
+        return (RKBytesView){ NULL, 0 };
+    }
+    return (RKBytesView){ _mapping.bytes + entry.dataOffset, entry.size };
+}
+
+- (RKResourceMapUsage)resourceMapUsage
+{
+    RKResourceMapUsage usage = { 0 };
+    @synchronized (self) {
+        if (!_file) {
+            return usage;
         }
         
-        return resources.copy;
-    }());
+        for (NdatType *type = _file->types; type; type = type->next) {
+            for (NdatResource *resource = type->resources; resource; resource = resource->next) {
+                usage.resourceCount++;
+            }
+        }
+        usage.nameCount = _file->names.stringCount;
+        usage.bytes = usage.resourceCount * sizeof(NdatResource) + _file->names.capacity;
+        usage.inlineNameBytes = usage.resourceCount * (sizeof(NdatResource) - sizeof(uint32_t) - sizeof(uint8_t) + UINT8_MAX + 1);
+        usage.internedStringCount = _names.count;
+    }
+    return usage;
 }
 
 - (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id
 {
+    return [self dataForResourceOfTypeCode:RKFourCCFromString(type) id:id];
+}
+
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id
+{
+    if (type == 0) {
+        return nil;
+    }
+    if (_indexCache) {
+        return [_indexCache dataForResourceOfTypeCode:type id:id];
+    }
+    
     uint8_t *raw = NULL;
     size_t size = 0;
     
-    NdatGetResourceDataOfTypeAndId(_file, [type cStringUsingEncoding:NSMacOSRomanStringEncoding], id, &raw, &size);
+    // The file handle is shared, so seeking and reading it must not interleave between threads.
+    @synchronized (self) {
+        NdatGetResourceDataOfTypeAndId(_file, type, id, &raw, &size);
+    }
     
-    return [NSData dataWithBytes:raw length:size];
+    return raw ? [NSData dataWithBytesNoCopy:raw length:size freeWhenDone:YES] : nil;
 }
 
 @end
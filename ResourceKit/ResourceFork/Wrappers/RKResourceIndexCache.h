@@ -0,0 +1,94 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "RKResourceFileProtocol.h"
+
+struct _IndexCacheKey;
+struct _IndexCacheWriter;
+
+/// RKResourceIndexCache provides resource files with a persistent copy of their resource
+/// map. When caching is enabled a resource file that has to parse its resource map writes
+/// the result out as an index cache, and the next time the same unchanged file is opened
+/// the cache is mapped and used in place of parsing the map again.
+///
+/// A cache is tied to the size, modification time and a hash of the header of the file
+/// it describes, and is ignored as soon as any of these change.
+@interface RKResourceIndexCache : NSObject
+
+/// Whether resource files should read and write index caches. Defaults to NO.
+@property (class) BOOL enabled;
+
+/// The directory that index caches are kept in. When this is nil (the default) each
+/// cache is written alongside its resource file, with ".rkindex" appended to its name.
+@property (class, nullable, copy) NSString *cacheDirectory;
+
+/// Returns the path of the index cache for the resource file at the specified path.
++ (nonnull NSString *)cachePathForResourceFileAtPath:(nonnull NSString *)filePath;
+
+/// Take the key that identifies the resource file at the specified path as it is now.
+/// Returns NO if caching is disabled or the file could not be read. A resource file takes
+/// the key before parsing its resource map, and writes its cache with that same key, so
+/// a file that changes in between is never cached under the key of its new version.
++ (BOOL)getKey:(nonnull struct _IndexCacheKey *)key forResourceFileAtPath:(nonnull NSString *)filePath;
+
+/// Open the index cache for the resource file at the specified path. Returns nil if
+/// caching is disabled, or if there is no cache that matches the file as it is now.
++ (nullable instancetype)indexCacheForResourceFileAtPath:(nonnull NSString *)filePath;
+
+/// Open the index cache for the resource file at the specified path, if it matches the
+/// specified key. Returns nil if caching is disabled or there is no matching cache.
++ (nullable instancetype)indexCacheForResourceFileAtPath:(nonnull NSString *)filePath key:(nonnull const struct _IndexCacheKey *)key;
+
+/// Write an index cache for the resource file at the specified path under the specified
+/// key, if caching is enabled. The block is expected to add every type and resource of the
+/// file to the writer. Failure to write a cache is not an error, the file will simply be
+/// parsed again next time.
++ (void)writeIndexCacheForResourceFileAtPath:(nonnull NSString *)filePath
+                                         key:(nonnull const struct _IndexCacheKey *)key
+                                  usingBlock:(nonnull void (^)(struct _IndexCacheWriter *_Nonnull writer))block;
+
+/// All of the resource type codes in the cache.
+@property (nonnull, readonly) NSArray <NSString *> *allTypes;
+
+/// Returns an RKResourceEntry for each of the resources of the specified type in the
+/// cache, sorted by id. The reference of each entry is the index of the resource in the
+/// cache, which can be used to look up its name.
+- (nonnull NSData *)resourceEntriesOfTypeCode:(RKFourCC)type;
+
+/// Returns the name of the resource at the specified index of the cache.
+- (nonnull NSString *)nameOfResourceAtIndex:(uint32_t)index;
+
+/// Returns a view of the bytes of the name of the resource at the specified index of the
+/// cache. The bytes remain valid for as long as the receiver does.
+- (RKBytesView)nameViewOfResourceAtIndex:(uint32_t)index;
+
+/// Read the data of the specified resource directly from the resource file.
+- (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id;
+
+/// Read the data of the resource with the specified packed type code and id directly
+/// from the resource file.
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id;
+
+@end
@@ -0,0 +1,224 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKResourceIndexCache.h"
+#import "RKFourCC.h"
+#import "IndexCache.h"
+#import "ContentHash.h"
+#import <fcntl.h>
+#import <unistd.h>
+
+static BOOL RKResourceIndexCacheEnabled = NO;
+static NSString *RKResourceIndexCacheDirectory = nil;
+
+@implementation RKResourceIndexCache {
+@private
+    IndexCache *_cache;
+    int _fd;
+}
+
+#pragma mark - Configuration
+
++ (BOOL)enabled
+{
+    return RKResourceIndexCacheEnabled;
+}
+
++ (void)setEnabled:(BOOL)enabled
+{
+    RKResourceIndexCacheEnabled = enabled;
+}
+
++ (NSString *)cacheDirectory
+{
+    return RKResourceIndexCacheDirectory;
+}
+
++ (void)setCacheDirectory:(NSString *)cacheDirectory
+{
+    RKResourceIndexCacheDirectory = cacheDirectory.copy;
+}
+
++ (NSString *)cachePathForResourceFileAtPath:(NSString *)filePath
+{
+    NSString *directory = RKResourceIndexCacheDirectory;
+    if (!directory) {
+        return [filePath stringByAppendingPathExtension:@"rkindex"];
+    }
+    
+    // Files from different directories may well share a name, so the name of a cache in a
+    // shared directory also includes a hash of the full path. NSString's hash only looks
+    // at part of a long string, so the bytes of the whole path are hashed instead.
+    NSString *standardPath = filePath.stringByStandardizingPath;
+    const char *bytes = standardPath.fileSystemRepresentation;
+    NSString *name = [NSString stringWithFormat:@"%@-%016llx.rkindex", standardPath.lastPathComponent, (unsigned long long)ContentHash(bytes, strlen(bytes), 0)];
+    return [directory stringByAppendingPathComponent:name];
+}
+
+
+#pragma mark - Creation
+
++ (BOOL)getKey:(IndexCacheKey *)key forResourceFileAtPath:(NSString *)filePath
+{
+    return RKResourceIndexCacheEnabled && IndexCacheKeyForFile(filePath.fileSystemRepresentation, key);
+}
+
++ (instancetype)indexCacheForResourceFileAtPath:(NSString *)filePath
+{
+    IndexCacheKey key;
+    return [self getKey:&key forResourceFileAtPath:filePath] ? [self indexCacheForResourceFileAtPath:filePath key:&key] : nil;
+}
+
++ (instancetype)indexCacheForResourceFileAtPath:(NSString *)filePath key:(const IndexCacheKey *)key
+{
+    if (!RKResourceIndexCacheEnabled) {
+        return nil;
+    }
+    
+    IndexCache *cache = IndexCacheOpen([self cachePathForResourceFileAtPath:filePath].fileSystemRepresentation, key);
+    if (!cache) {
+        return nil;
+    }
+    
+    RKResourceIndexCache *indexCache = [[self alloc] initWithCache:cache filePath:filePath];
+    if (!indexCache) {
+        IndexCacheClose(cache);
+    }
+    return indexCache;
+}
+
+- (instancetype)initWithCache:(IndexCache *)cache filePath:(NSString *)filePath
+{
+    if (self = [super init]) {
+        if ((_fd = open(filePath.fileSystemRepresentation, O_RDONLY)) < 0) {
+            return nil;
+        }
+        _cache = cache;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    IndexCacheClose(_cache);
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+
+#pragma mark - Writing
+
++ (void)writeIndexCacheForResourceFileAtPath:(NSString *)filePath key:(const IndexCacheKey *)key usingBlock:(void (^)(struct _IndexCacheWriter *))block
+{
+    if (!RKResourceIndexCacheEnabled) {
+        return;
+    }
+    
+    IndexCacheWriter *writer = IndexCacheWriterCreate();
+    if (!writer) {
+        return;
+    }
+    
+    block(writer);
+    IndexCacheWriterWrite(writer, [self cachePathForResourceFileAtPath:filePath].fileSystemRepresentation, key);
+    IndexCacheWriterDestroy(writer);
+}
+
+
+#pragma mark - Accessors
+
+static NSString *RKResourceIndexCacheTypeString(const IndexCacheType *type)
+{
+    return [[NSString alloc] initWithBytes:type->code length:4 encoding:NSMacOSRomanStringEncoding];
+}
+
+- (NSArray<NSString *> *)allTypes
+{
+    NSMutableArray <NSString *> *types = [NSMutableArray arrayWithCapacity:_cache->header->typeCount];
+    for (uint32_t i = 0; i < _cache->header->typeCount; ++i) {
+        [types addObject:RKResourceIndexCacheTypeString(&_cache->types[i])];
+    }
+    return types.copy;
+}
+
+- (NSData *)resourceEntriesOfTypeCode:(RKFourCC)code
+{
+    const IndexCacheType *type = code ? IndexCacheGetTypeForCode(_cache, code) : NULL;
+    if (!type) {
+        return [NSData data];
+    }
+    
+    NSMutableData *entries = [NSMutableData dataWithLength:type->resourceCount * sizeof(RKResourceEntry)];
+    RKResourceEntry *entry = entries.mutableBytes;
+    for (uint32_t i = 0; i < type->resourceCount; ++i) {
+        const IndexCacheResource *resource = &_cache->resources[type->firstResource + i];
+        entry[i] = (RKResourceEntry){ .id = resource->id, .size = resource->size, .reference = type->firstResource + i, .dataOffset = (uint32_t)resource->dataOffset };
+    }
+    return entries;
+}
+
+- (NSString *)nameOfResourceAtIndex:(uint32_t)index
+{
+    if (index >= _cache->header->resourceCount) {
+        return @"";
+    }
+    
+    const IndexCacheResource *resource = &_cache->resources[index];
+    return [[NSString alloc] initWithBytes:_cache->names + resource->nameOffset
+                                    length:resource->nameLength
+                                  encoding:NSMacOSRomanStringEncoding] ?: @"";
+}
+
+- (RKBytesView)nameViewOfResourceAtIndex:(uint32_t)index
+{
+    if (index >= _cache->header->resourceCount) {
+        return (RKBytesView){ NULL, 0 };
+    }
+    
+    const IndexCacheResource *resource = &_cache->resources[index];
+    return (RKBytesView){ _cache->names + resource->nameOffset, resource->nameLength };
+}
+
+- (NSData *)dataForResourceOfType:(NSString *)typeString id:(int16_t)id
+{
+    return [self dataForResourceOfTypeCode:RKFourCCFromString(typeString) id:id];
+}
+
+- (NSData *)dataForResourceOfTypeCode:(RKFourCC)code id:(int16_t)id
+{
+    const IndexCacheType *type = code ? IndexCacheGetTypeForCode(_cache, code) : NULL;
+    const IndexCacheResource *resource = type ? IndexCacheGetResourceOfTypeWithId(_cache, type, id) : NULL;
+    if (!resource) {
+        return nil;
+    }
+    
+    NSMutableData *data = [NSMutableData dataWithLength:resource->size];
+    if (pread(_fd, data.mutableBytes, resource->size, (off_t)resource->dataOffset) != (ssize_t)resource->size) {
+        return nil;
+    }
+    return data;
+}
+
+@end
@@ -26,12 +26,21 @@
 #import "Rez.h"
 #import "Allocations.h"
 #import "RKResource.h"
+#import "RKFourCC.h"
+#import "RKResourceIndexCache.h"
+#import "IndexCache.h"
+#import "ResourceIndex.h"
+#import "DataFile.h"
 
 @implementation RKRezResourceFile {
 @private
     __strong NSArray <NSString *> *_Nullable _types;
     __strong NSMutableDictionary <NSString *, NSArray <RKResource *> *> *_resources;
+    __strong NSMutableDictionary <NSNumber *, RKResource *> *_resourceObjects;
+    __strong NSMutableDictionary <NSNumber *, NSString *> *_names;
     RezResourceFile *_Nullable _file;
+    __strong RKResourceIndexCache *_Nullable _indexCache;
+    FileMapping _mapping;
 }
 
 @synthesize filePath = _filePath;
@@ -58,12 +67,24 @@
     }
 
     if (self = [super init]) {
-        _file = RezOpenFile(filePath.UTF8String);
-        if (!_file) {
-            return nil;
+        // An up to date index cache saves parsing the resource map at all. The key is taken
+        // before the file is parsed, so a cache written from the parse can never claim to
+        // describe a version of the file that changed in the meantime.
+        IndexCacheKey key;
+        BOOL hasKey = [RKResourceIndexCache getKey:&key forResourceFileAtPath:filePath];
+        _indexCache = hasKey ? [RKResourceIndexCache indexCacheForResourceFileAtPath:filePath key:&key] : nil;
+        if (!_indexCache) {
+            if ((_file = RezOpenFile(filePath.UTF8String)) == NULL) {
+                return nil;
+            }
+            if (hasKey) {
+                [self writeIndexCacheForFilePath:filePath key:&key];
+            }
         }
         
         _resources = NSMutableDictionary.new;
+        _resourceObjects = NSMutableDictionary.new;
+        _names = NSMutableDictionary.new;
         _filePath = filePath.copy;
     }
 
@@ -76,6 +97,32 @@
 - (void)dealloc
 {
     RezClosefile(_file);
+    FileUnmap(&_mapping);
+}
+
+
+#pragma mark - Index Cache
+
+- (void)writeIndexCacheForFilePath:(NSString *)filePath key:(const IndexCacheKey *)key
+{
+    RezResourceFile *file = _file;
+    [RKResourceIndexCache writeIndexCacheForResourceFileAtPath:filePath key:key usingBlock:^(IndexCacheWriter *writer) {
+        // Types are only ever a handful, so resources find their type by a linear search.
+        uint32_t typeCount = 0;
+        RKFourCC codes[file->header->typeCount ?: 1];
+        for (RezResourceType *type = file->type; type; type = type->next) {
+            IndexCacheWriterAddType(writer, type->fourCC);
+            codes[typeCount++] = type->fourCC;
+        }
+        
+        for (RezResourceHeader *resource = file->resource; resource; resource = resource->next) {
+            uint32_t type = 0;
+            while (type < typeCount && codes[type] != resource->typeFourCC) {
+                ++type;
+            }
+            IndexCacheWriterAddResource(writer, type, resource->id, RezGetResourceName(file, resource), (uint64_t)resource->offset, (uint32_t)resource->size);
+        }
+    }];
 }
 
 
@@ -83,59 +130,193 @@
 
 - (NSArray<NSString *> *)allTypes
 {
-    return _types ?: (_types = ^ NSArray <NSString *> * {
-        NSMutableArray *types = [NSMutableArray new];
-        
-        for (uint32_t i = 0; i < _file->header->typeCount; ++i) {
-            RezResourceType *type = RezGetResourceTypeAtIndex(_file, i);
-            char *typeCode = New(5);
-            strncpy(typeCode, type->code, 4);
-            [types addObject:[NSString stringWithFormat:@"%s", typeCode]];
-            free(typeCode);
+    @synchronized (self) {
+        if (_indexCache) {
+            return _types ?: (_types = _indexCache.allTypes);
         }
         
-        return types;
-    }());
+        return _types ?: (_types = ^ NSArray <NSString *> * {
+            NSMutableArray *types = [NSMutableArray new];
+            
+            for (uint32_t i = 0; i < _file->header->typeCount; ++i) {
+                RezResourceType *type = RezGetResourceTypeAtIndex(_file, i);
+                char *typeCode = New(5);
+                strncpy(typeCode, type->code, 4);
+                [types addObject:[NSString stringWithFormat:@"%s", typeCode]];
+                free(typeCode);
+            }
+            
+            return types;
+        }());
+    }
 }
 
 - (nonnull NSArray <RKResource *> *)resourcesOfType:(nonnull NSString *)typeCode
 {
-    // TODO: This needs to be made more efficient and cleaner.
-    return _resources[typeCode] ?: (_resources[typeCode] = ^NSArray <RKResource *> *{
-        NSMutableArray <RKResource *> *resources = [NSMutableArray new];
+    @synchronized (self) {
+        return _resources[typeCode] ?: (_resources[typeCode] = ^NSArray <RKResource *> *{
+            RKFourCC code = RKFourCCFromString(typeCode);
+            NSData *entries = [self resourceEntriesOfTypeCode:code];
+            const RKResourceEntry *entry = entries.bytes;
+            
+            NSUInteger count = entries.length / sizeof(*entry);
+            NSMutableArray <RKResource *> *resources = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger i = 0; i < count; ++i) {
+                [resources addObject:[self resourceForEntry:entry[i] typeCode:code]];
+            }
+            return resources.copy;
+        }());
+    }
+}
+
+- (nonnull NSData *)resourceEntriesOfTypeCode:(RKFourCC)code
+{
+    if (code == 0) {
+        return [NSData data];
+    }
+    
+    @synchronized (self) {
+        if (_indexCache) {
+            return [_indexCache resourceEntriesOfTypeCode:code];
+        }
         
-        const char *typeCodeMacOS = [typeCode cStringUsingEncoding:NSMacOSRomanStringEncoding];
-        RezResourceType *type = RezGetResourceTypeForCode(_file, typeCodeMacOS);
+        RezResourceType *type = RezGetResourceTypeForCode(_file, code);
+        if (!type || type->resourceCount == 0) {
+            return [NSData data];
+        }
         
-        if (!type) {
-            return @[];
+        // A single walk of the resource list picks out every resource of the type, rather
+        // than walking it again for each one.
+        NSMutableData *entries = [NSMutableData dataWithLength:type->resourceCount * sizeof(RKResourceEntry)];
+        RKResourceEntry *entry = entries.mutableBytes;
+        size_t count = 0;
+        for (RezResourceHeader *resource = _file->resource; resource && count < type->resourceCount; resource = resource->next) {
+            if (resource->typeFourCC == code) {
+                entry[count++] = (RKResourceEntry){ .id = resource->id, .size = (uint32_t)resource->size, .reference = resource->nameOffset, .dataOffset = (uint32_t)resource->offset };
+            }
         }
+        entries.length = count * sizeof(*entry);
         
-        for (uint32_t i = 0; i < type->resourceCount; ++i) {
-            RezResourceHeader *resourceHeader = RezGetResourceHeaderOfTypeAtIndex(_file, typeCodeMacOS, i);
-            
-            NSString *name = [NSString stringWithFormat:@"%s", resourceHeader->name];
-            
-            RKResource *resource = [[RKResource alloc] initWithType:typeCode
-                                                                 id:resourceHeader->id
-                                                               name:name
-                                                               size:resourceHeader->size
-                                                              owner:self];
-            [resources addObject:resource];
+        // Resource maps are not necessarily in id order, but the fork expects entries to be.
+        qsort(entry, count, sizeof(*entry), RKResourceEntryCompareIds);
+        return entries;
+    }
+}
+
+- (nonnull NSString *)nameOfResourceEntry:(RKResourceEntry)entry
+{
+    @synchronized (self) {
+        if (_indexCache) {
+            return [_indexCache nameOfResourceAtIndex:entry.reference];
+        }
+        
+        // Identical names share an offset in the names pool, so each distinct name is only
+        // made into a string once, and only when a resource with that name is first asked for.
+        if (entry.reference == 0) {
+            return @"";
+        }
+        
+        NSString *name = _names[@(entry.reference)];
+        if (!name) {
+            name = [[NSString alloc] initWithCString:StringPoolGetString(&_file->names, entry.reference)
+                                            encoding:NSMacOSRomanStringEncoding] ?: @"";
+            _names[@(entry.reference)] = name;
+        }
+        return name;
+    }
+}
+
+- (nonnull RKResource *)resourceForEntry:(RKResourceEntry)entry typeCode:(RKFourCC)code
+{
+    @synchronized (self) {
+        NSNumber *key = @(ResourceIndexKey(code, entry.id));
+        return _resourceObjects[key] ?: (_resourceObjects[key] = [[RKResource alloc] initWithType:NSStringFromFourCC(code)
+                                                                                                id:entry.id
+                                                                                              name:[self nameOfResourceEntry:entry]
+                                                                                              size:entry.size
+                                                                                             owner:self]);
+    }
+}
+
+- (nullable RKResource *)existingResourceOfTypeCode:(RKFourCC)code id:(int16_t)resourceId
+{
+    @synchronized (self) {
+        return _resourceObjects[@(ResourceIndexKey(code, resourceId))];
+    }
+}
+
+- (RKBytesView)nameViewOfResourceEntry:(RKResourceEntry)entry
+{
+    if (_indexCache) {
+        return [_indexCache nameViewOfResourceAtIndex:entry.reference];
+    }
+    
+    // The names pool is complete once the file has been opened, so it can be read without
+    // taking a lock.
+    const char *name = StringPoolGetString(&_file->names, entry.reference);
+    return (RKBytesView){ name, strlen(name) };
+}
+
+- (RKBytesView)dataViewOfResourceEntry:(RKResourceEntry)entry
+{
+    // The file is only mapped the first time the data of a resource is viewed, as most
+    // files are only ever read through -dataForResourceOfType:id:.
+    @synchronized (self) {
+        if (!_mapping.bytes && !FileMap(_filePath.fileSystemRepresentation, &_mapping)) {
+            return (RKBytesView){ NULL, 0 };
+        }
+    }
+    
+    // The file may have been truncated in place since it was mapped, so the data is only
+    // handed out while the file still holds it.
+    if (!FileMappingCanReadData(&_mapping, entry.dataOffset, entry.size)) {
+        return (RKBytesView){ NULL, 0 };
+    }
+    return (RKBytesView){ _mapping.bytes + entry.dataOffset, entry.size };
+}
+
+- (RKResourceMapUsage)resourceMapUsage
+{
+    RKResourceMapUsage usage = { 0 };
+    @synchronized (self) {
+        if (!_file) {
+            return usage;
         }
         
-        return resources.copy;
-    }());
+        for (RezResourceHeader *resource = _file->resource; resource; resource = resource->next) {
+            usage.resourceCount++;
+        }
+        usage.nameCount = _file->names.stringCount;
+        usage.bytes = usage.resourceCount * sizeof(RezResourceHeader) + _file->names.capacity;
+        usage.inlineNameBytes = usage.resourceCount * (sizeof(RezResourceHeader) - sizeof(uint32_t) - sizeof(uint16_t) + UINT8_MAX + 1);
+        usage.internedStringCount = _names.count;
+    }
+    return usage;
 }
 
 - (nullable NSData *)dataForResourceOfType:(nonnull NSString *)type id:(int16_t)id
 {
+    return [self dataForResourceOfTypeCode:RKFourCCFromString(type) id:id];
+}
+
+- (nullable NSData *)dataForResourceOfTypeCode:(RKFourCC)type id:(int16_t)id
+{
+    if (type == 0) {
+        return nil;
+    }
+    if (_indexCache) {
+        return [_indexCache dataForResourceOfTypeCode:type id:id];
+    }
+    
     uint8_t *raw = NULL;
     size_t size = 0;
     
-    RezGetResourceDataOfTypeAndId(_file, type.UTF8String, id, &raw, &size);
+    // The file handle is shared, so seeking and reading it must not interleave between threads.
+    @synchronized (self) {
+        RezGetResourceDataOfTypeAndId(_file, type, id, &raw, &size);
+    }
     
-    return [NSData dataWithBytes:raw length:size];
+    return raw ? [NSData dataWithBytesNoCopy:raw length:size freeWhenDone:YES] : nil;
 }
 
 @end
@@ -0,0 +1,77 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "RKResourceFileProtocol.h"
+
+/// The order in which an RKRezWriter lays out the data of its resources.
+typedef NS_ENUM(NSInteger, RKRezLayout) {
+    /// Resource data is written in the order the resources were added.
+    RKRezLayoutAsAdded,
+    
+    /// Resource data is grouped by type and sorted by id, so that loading every resource
+    /// of a type reads one contiguous run of the file.
+    RKRezLayoutByTypeAndId,
+};
+
+/// RKRezWriter builds a Rez file from resources held in memory, such as when repackaging
+/// a plug-in. The resources are copied as they are added, and the file is laid out when
+/// it is written.
+@interface RKRezWriter : NSObject
+
+/// The order of the resource data in the file. Defaults to RKRezLayoutAsAdded.
+@property RKRezLayout layout;
+
+/// The boundary that the data of each resource starts on, which must be a power of two.
+/// Defaults to 1, which packs the data without any padding.
+@property uint32_t alignment;
+
+/// The number of resources added so far.
+@property (readonly) NSUInteger resourceCount;
+
+/// Add a resource. Names are written in MacRoman and truncated to 255 bytes.
+- (void)addResourceOfType:(nonnull NSString *)type
+                       id:(int16_t)resourceId
+                     name:(nullable NSString *)name
+                     data:(nonnull NSData *)data;
+
+/// Add a resource with the specified packed type code. Resources of an invalid type, with
+/// the code 0, are skipped.
+- (void)addResourceOfTypeCode:(RKFourCC)type
+                           id:(int16_t)resourceId
+                         name:(nullable NSString *)name
+                         data:(nonnull NSData *)data;
+
+/// Add every resource of a resource file, in the order that their data appears in the
+/// file, so that writing them with RKRezLayoutAsAdded keeps the layout of the file.
+- (void)addResourcesFromResourceFile:(nonnull id <RKResourceFileProtocol>)resourceFile;
+
+/// Returns the contents of the Rez file, or nil if a resource was added twice or the
+/// resources do not fit in a Rez file.
+- (nullable NSData *)rezData;
+
+/// Write the Rez file to the specified path, returning NO if it could not be written.
+- (BOOL)writeToFile:(nonnull NSString *)path;
+
+@end
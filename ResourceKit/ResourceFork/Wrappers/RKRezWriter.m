@@ -0,0 +1,159 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKRezWriter.h"
+#import "RKFourCC.h"
+#import "RezWriter.h"
+
+// A resource of a file being added to the writer, with the type it was listed under.
+typedef struct RKRezWriterFileResource {
+    RKFourCC type;
+    RKResourceEntry entry;
+} RKRezWriterFileResource;
+
+@implementation RKRezWriter {
+@private
+    RezWriter *_writer;
+}
+
+#pragma mark - Creation
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        if ((_writer = RezWriterCreate()) == NULL) {
+            return nil;
+        }
+        _layout = RKRezLayoutAsAdded;
+        _alignment = 1;
+    }
+    return self;
+}
+
+
+#pragma mark - Destruction
+
+- (void)dealloc
+{
+    RezWriterDestroy(_writer);
+}
+
+
+#pragma mark - Resources
+
+- (NSUInteger)resourceCount
+{
+    @synchronized (self) {
+        return RezWriterGetResourceCount(_writer);
+    }
+}
+
+- (void)addResourceOfType:(NSString *)type id:(int16_t)resourceId name:(NSString *)name data:(NSData *)data
+{
+    [self addResourceOfTypeCode:RKFourCCFromString(type) id:resourceId name:name data:data];
+}
+
+- (void)addResourceOfTypeCode:(RKFourCC)type id:(int16_t)resourceId name:(NSString *)name data:(NSData *)data
+{
+    if (type == 0) {
+        NSLog(@"Unable to add resource %d of an invalid type. Skipping", resourceId);
+        return;
+    }
+    
+    NSData *nameBytes = [name dataUsingEncoding:NSMacOSRomanStringEncoding allowLossyConversion:YES];
+    @synchronized (self) {
+        RezWriterAddResource(_writer, type, resourceId, nameBytes.bytes, nameBytes.length, data.bytes, data.length);
+    }
+}
+
+static int RKRezWriterCompareDataOffsets(const void *lhs, const void *rhs)
+{
+    const RKRezWriterFileResource *a = lhs;
+    const RKRezWriterFileResource *b = rhs;
+    if (a->entry.dataOffset != b->entry.dataOffset) {
+        return a->entry.dataOffset < b->entry.dataOffset ? -1 : 1;
+    }
+    if (a->type != b->type) {
+        return a->type < b->type ? -1 : 1;
+    }
+    return (a->entry.id > b->entry.id) - (a->entry.id < b->entry.id);
+}
+
+- (void)addResourcesFromResourceFile:(id <RKResourceFileProtocol>)resourceFile
+{
+    NSMutableData *resources = [NSMutableData new];
+    for (NSString *type in resourceFile.allTypes) {
+        RKFourCC code = RKFourCCFromString(type);
+        if (code == 0) {
+            NSLog(@"Ignoring resources of invalid type '%@' in %@", type, resourceFile.filePath);
+            continue;
+        }
+        NSData *entries = [resourceFile resourceEntriesOfTypeCode:code];
+        const RKResourceEntry *entry = entries.bytes;
+        for (NSUInteger i = 0; i < entries.length / sizeof(*entry); ++i) {
+            RKRezWriterFileResource resource = { .type = code, .entry = entry[i] };
+            [resources appendBytes:&resource length:sizeof(resource)];
+        }
+    }
+    
+    RKRezWriterFileResource *resource = resources.mutableBytes;
+    NSUInteger count = resources.length / sizeof(*resource);
+    qsort(resource, count, sizeof(*resource), RKRezWriterCompareDataOffsets);
+    
+    @synchronized (self) {
+        for (NSUInteger i = 0; i < count; ++i) {
+            // Data is copied straight out of the mapping of the file where it can be, and
+            // only read into a buffer of its own when the file could not be mapped.
+            RKBytesView name = [resourceFile nameViewOfResourceEntry:resource[i].entry];
+            RKBytesView data = [resourceFile dataViewOfResourceEntry:resource[i].entry];
+            NSData *copy = nil;
+            if (!data.bytes && resource[i].entry.size) {
+                copy = [resourceFile dataForResourceOfType:NSStringFromFourCC(resource[i].type) id:resource[i].entry.id];
+                data = (RKBytesView){ copy.bytes, copy.length };
+            }
+            RezWriterAddResource(_writer, resource[i].type, resource[i].entry.id, name.bytes, name.length, data.bytes, data.length);
+        }
+    }
+}
+
+
+#pragma mark - Writing
+
+- (NSData *)rezData
+{
+    @synchronized (self) {
+        size_t length = 0;
+        uint8_t *bytes = RezWriterCopyData(_writer, (RezWriterLayout)_layout, _alignment, &length);
+        return bytes ? [NSData dataWithBytesNoCopy:bytes length:length freeWhenDone:YES] : nil;
+    }
+}
+
+- (BOOL)writeToFile:(NSString *)path
+{
+    @synchronized (self) {
+        return RezWriterWrite(_writer, path.fileSystemRepresentation, (RezWriterLayout)_layout, _alignment);
+    }
+}
+
+@end
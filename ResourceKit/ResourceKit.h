@@ -33,13 +33,26 @@ FOUNDATION_EXPORT const unsigned char ResourceKitVersionString[];
 // In this header, you should import all the public headers of your framework using statements like #import <ResourceKit/PublicHeader.h>
 #import <ResourceKit/RKResourceFileProtocol.h>
 #import <ResourceKit/RKRezResourceFile.h>
+#import <ResourceKit/RKArchiveResourceFile.h>
+#import <ResourceKit/RKResourceIndexCache.h>
+#import <ResourceKit/RKRezWriter.h>
 #import <ResourceKit/RKResourceFork.h>
 #import <ResourceKit/RKResource.h>
+#import <ResourceKit/RKFourCC.h>
+#import <ResourceKit/RKDecodeJob.h>
+#import <ResourceKit/RKDecodeScheduler.h>
+#import <ResourceKit/RKObjectCache.h>
+#import <ResourceKit/RKResourceChangeSet.h>
+#import <ResourceKit/RKResourceDiff.h>
+#import <ResourceKit/RKFileWatcher.h>
 
 #import <ResourceKit/RKRLESprite.h>
 #import <ResourceKit/RKRLEObject.h>
+#import <ResourceKit/RKPixelBuffer.h>
+#import <ResourceKit/RKColorTable.h>
 #import <ResourceKit/EVObject.h>
 #import <ResourceKit/NSData+Parsing.h>
 #import <ResourceKit/RKNovaResourceTypeParser.h>
 #import <ResourceKit/RKResourceParserProtocol.h>
+#import <ResourceKit/RKIncrementalDecoderProtocol.h>
 #import <ResourceKit/ClassicMacTypes.h>
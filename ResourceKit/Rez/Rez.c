@@ -53,6 +53,11 @@ RezResourceFile *RezOpenFile(const char *restrict path)
     file->path = NewString(path);
     file->currentEndian = DataLittleEndian;
 
+    if ( !StringPoolInit(&file->names) ) {
+        fprintf(stderr, "*** Failed to allocate the names of the rez file: %s\n", file->path);
+        goto REZ_OPEN_FILE_ERROR;
+    }
+
     errno = 0;
     if ( (file->handle = fopen(file->path, "r")) == NULL ) {
         fprintf(stderr, "*** Failed to open rez file (code: %d): %s\n", errno, file->path);
@@ -91,6 +96,7 @@ void RezClosefile(RezResourceFile *file)
         RezResourceTypeListFree(file->type);
         RezDataRangeListFree(file->dataRange);
         RezHeaderFree(file->header);
+        StringPoolFree(&file->names);
         fclose(file->handle);
         free((void *)file->path);
         free(file);
@@ -174,6 +180,7 @@ RezResourceFile *RezParseResourceMap(RezResourceFile *file)
     file->header->typeCount = FileReadLong(file->handle, file->currentEndian);
     file->type = RezParseResourceTypes(file);
     file->resource = RezParseResourceHeaders(file);
+    StringPoolFinish(&file->names);
 
     return file;
 }
@@ -189,6 +196,7 @@ RezResourceType *RezParseResourceTypes(RezResourceFile *file)
         RezResourceType *type = New(sizeof(*type));
 
         FileGetBytes(file->handle, 4, type->code);
+        type->fourCC = RKFourCCMake(type->code);
         type->firstResourceOffset = FileReadLong(file->handle, file->currentEndian);
         type->resourceCount = FileReadLong(file->handle, file->currentEndian);
 
@@ -213,8 +221,12 @@ RezResourceHeader *RezParseResourceHeaders(RezResourceFile *file)
         RezDataRange *range = RezGetDataRangeAtIndex(file, dataRangeIndex - 1);
 
         FileGetBytes(file->handle, 4, resource->typeCode);
+        resource->typeFourCC = RKFourCCMake(resource->typeCode);
         resource->id = FileReadWord(file->handle, file->currentEndian);
-        FileGetBytes(file->handle, 256, resource->name);
+        char name[256];
+        FileGetBytes(file->handle, sizeof(name), name);
+        resource->nameOffset = StringPoolAdd(&file->names, name, sizeof(name));
+        resource->nameLength = (uint16_t)strnlen(name, sizeof(name));
 
         resource->owner = file;
         resource->offset = range->offset;
@@ -295,13 +307,12 @@ RezResourceType *RezGetResourceTypeAtIndex(RezResourceFile *file, int32_t index)
     return type;
 }
 
-RezResourceType *RezGetResourceTypeForCode(RezResourceFile *file, const char *code)
+RezResourceType *RezGetResourceTypeForCode(RezResourceFile *file, RKFourCC code)
 {
     assert(file);
-    assert(code);
 
     RezResourceType *type = file->type;
-    while (type && strncmp(type->code, code, 4) != 0) {
+    while (type && type->fourCC != code) {
         type = type->next;
     }
     return type;
@@ -322,18 +333,18 @@ RezResourceHeader *RezGetResourceHeaderAtIndex(RezResourceFile *file, int32_t in
     return resource;
 }
 
-RezResourceHeader *RezGetResourceHeaderOfTypeAtIndex(RezResourceFile *file, const char *typeCode, int32_t index)
+RezResourceHeader *RezGetResourceHeaderOfTypeAtIndex(RezResourceFile *file, RKFourCC typeCode, int32_t index)
 {
     assert(file);
 
     RezResourceType *type = RezGetResourceTypeForCode(file, typeCode);
-    if (index >= type->resourceCount || index < 0) {
+    if (!type || index >= type->resourceCount || index < 0) {
         return NULL;
     }
 
     RezResourceHeader *resource = file->resource;
     while (resource) {
-        if ( strncmp(resource->typeCode, typeCode, 4) == 0 ) {
+        if (resource->typeFourCC == typeCode) {
             if (index == 0) {
                 break;
             }
@@ -344,14 +355,21 @@ RezResourceHeader *RezGetResourceHeaderOfTypeAtIndex(RezResourceFile *file, cons
     return resource;
 }
 
-RezResourceHeader *RezGetResourceHeaderOfTypeAtId(RezResourceFile *file, const char *typeCode, int16_t id)
+const char *RezGetResourceName(RezResourceFile *file, RezResourceHeader *resource)
+{
+    assert(file);
+    assert(resource);
+
+    return StringPoolGetString(&file->names, resource->nameOffset);
+}
+
+RezResourceHeader *RezGetResourceHeaderOfTypeAtId(RezResourceFile *file, RKFourCC typeCode, int16_t id)
 {
     assert(file);
-    assert(typeCode);
 
     RezResourceHeader *resource = file->resource;
     while (resource) {
-        if ( strncmp(resource->typeCode, typeCode, 4) == 0 && resource->id == id ) {
+        if (resource->typeFourCC == typeCode && resource->id == id) {
             break;
         }
         resource = resource->next;
@@ -359,13 +377,18 @@ RezResourceHeader *RezGetResourceHeaderOfTypeAtId(RezResourceFile *file, const c
     return resource;
 }
 
-void RezGetResourceDataOfTypeAndId(RezResourceFile *file, const char *type, int16_t id, uint8_t **dst, size_t *size)
+void RezGetResourceDataOfTypeAndId(RezResourceFile *file, RKFourCC type, int16_t id, uint8_t **dst, size_t *size)
 {
     assert(dst);
     assert(file);
     assert(size);
 
     RezResourceHeader *resource = RezGetResourceHeaderOfTypeAtId(file, type, id);
+    if (!resource) {
+        *dst = NULL;
+        *size = 0;
+        return;
+    }
     *dst = calloc(resource->size, sizeof(**dst));
     *size = resource->size;
 
@@ -26,6 +26,8 @@
 #define ResourceKit_Rez_h
 
 #include "DataFile.h"
+#include "ClassicMacTypes.h"
+#include "StringPool.h"
 
 // We have a bunch of forward declarations to make in order to be able to construct
 // the structures required by the Rez format.
@@ -67,6 +69,9 @@ typedef struct _RezResourceFile {
     /// is a pointer to the first.
     struct _RezResourceHeader *resource;
 
+    /// The names of all of the resources in the Rez file. Resources refer to their names by offset.
+    StringPool names;
+
 } RezResourceFile;
 
 /// The RezDataRange structure is a linked list node the contains information about the offset and
@@ -117,6 +122,9 @@ typedef struct _RezResourceType {
     /// The type code of the resource. This code a FCC (four-char-code) and will always be 4 bytes long.
     char code[4];
 
+    /// The type code packed into a single value, which is what lookups compare against.
+    RKFourCC fourCC;
+
     /// The offset of the first resource in the Rez file. This is an offset to the header data of the first
     /// resource. Not the data of the first resource.
     fpos_t firstResourceOffset;
@@ -140,9 +148,15 @@ typedef struct _RezResourceHeader {
     /// The type code of the resource. This code a FCC (four-char-code) and will always be 4 bytes long.
     char typeCode[4];
 
-    /// The name of the resource can be a maximum of 256 bytes due to it being a Pascal String. The field
-    /// is 257 bytes long to ensure there is always a 0 byte as a terminator.
-    char name[UINT8_MAX + 1];
+    /// The type code packed into a single value, which is what lookups compare against.
+    RKFourCC typeFourCC;
+
+    /// The offset of the name of the resource in the names pool of the owning Rez file. Resources without a
+    /// name, which is most of them, all share the empty string at offset 0.
+    uint32_t nameOffset;
+
+    /// The length of the name of the resource. Names are stored in a 256 byte field in the Rez file.
+    uint16_t nameLength;
 
     /// The id of the resource. The id range of resources is 32,767 to -32,767. Convention generally states that
     /// negative ids state the resource is "owned" by another resource. Typically resources start numbering at
@@ -179,7 +193,7 @@ RezResourceType *RezGetResourceTypeAtIndex(RezResourceFile *file, int32_t index)
 
 /// Get the RezResourceType instance from the specified rez file for the specified type code. NULL will be
 /// returned if the type code is not present.
-RezResourceType *RezGetResourceTypeForCode(RezResourceFile *file, const char *code);
+RezResourceType *RezGetResourceTypeForCode(RezResourceFile *file, RKFourCC code);
 
 /// Get the RezResourceHeader instance from the specified rez file for the specified index. NULL will be
 /// returned if the index is out of bounds.
@@ -187,15 +201,18 @@ RezResourceHeader *RezGetResourceHeaderAtIndex(RezResourceFile *file, int32_t in
 
 /// Get the RezResourceHeader instance from the specified rez file for the specified index and type.
 /// NULL will returned if the index is out of bounds.
-RezResourceHeader *RezGetResourceHeaderOfTypeAtIndex(RezResourceFile *file, const char *type, int32_t index);
+RezResourceHeader *RezGetResourceHeaderOfTypeAtIndex(RezResourceFile *file, RKFourCC type, int32_t index);
+
+/// Get the name of the specified resource as a zero terminated string. The string is owned by the rez file.
+const char *RezGetResourceName(RezResourceFile *file, RezResourceHeader *resource);
 
 /// Get the RezResourceHeader instance from the specified rez file for the specified id and type.
 /// NULL will returned if the id does not exist.
-RezResourceHeader *RezGetResourceHeaderOfTypeAtId(RezResourceFile *file, const char *type, int16_t id);
+RezResourceHeader *RezGetResourceHeaderOfTypeAtId(RezResourceFile *file, RKFourCC type, int16_t id);
 
 /// Get the block of data from the specified rez file for the specified id and type.
 /// NULL will be returned if the id does not exist. The caller is expected to provide a location for
 /// the memory to read into.
-void RezGetResourceDataOfTypeAndId(RezResourceFile *file, const char *type, int16_t id, uint8_t **dst, size_t *size);
+void RezGetResourceDataOfTypeAndId(RezResourceFile *file, RKFourCC type, int16_t id, uint8_t **dst, size_t *size);
 
 #endif
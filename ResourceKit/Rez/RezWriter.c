@@ -0,0 +1,409 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "RezWriter.h"
+
+#pragma mark - Format Constants
+
+// The header is five little endian longs after the magic, and each data range is three.
+#define REZ_HEADER_LENGTH               24
+#define REZ_DATA_RANGE_LENGTH           12
+#define REZ_MAP_TAG                     "resource.map"
+#define REZ_MAP_TAG_LENGTH              12
+
+// The resource map starts with two longs, followed by the type list and the headers.
+#define REZ_MAP_HEADER_LENGTH           8
+#define REZ_TYPE_LENGTH                 12
+#define REZ_RESOURCE_NAME_LENGTH        256
+#define REZ_RESOURCE_HEADER_LENGTH      (4 + 4 + 2 + REZ_RESOURCE_NAME_LENGTH)
+
+
+#pragma mark - Writer
+
+typedef struct _RezWriterResource {
+    RKFourCC type;
+    int16_t id;
+    uint8_t nameLength;
+    uint32_t nameOffset;
+    size_t dataOffset;
+    uint32_t size;
+
+    // Assigned while laying out the file.
+    uint32_t typeRank;
+    uint32_t entry;
+    uint32_t fileOffset;
+} RezWriterResource;
+
+struct _RezWriter {
+    RezWriterResource *resources;
+    size_t resourceCount;
+    size_t resourceCapacity;
+
+    uint8_t *data;
+    size_t dataLength;
+    size_t dataCapacity;
+
+    char *names;
+    size_t namesLength;
+    size_t namesCapacity;
+
+    bool failed;
+};
+
+static bool RezWriterGrow(void **array, size_t *capacity, size_t required, size_t elementSize)
+{
+    if (required <= *capacity) {
+        return true;
+    }
+
+    size_t newCapacity = *capacity ?: 16;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+
+    void *newArray = realloc(*array, newCapacity * elementSize);
+    if (!newArray) {
+        return false;
+    }
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+RezWriter *RezWriterCreate(void)
+{
+    return calloc(1, sizeof(RezWriter));
+}
+
+void RezWriterDestroy(RezWriter *writer)
+{
+    if (writer) {
+        free(writer->resources);
+        free(writer->data);
+        free(writer->names);
+        free(writer);
+    }
+}
+
+void RezWriterAddResource(RezWriter *writer, RKFourCC type, int16_t id, const char *name, size_t nameLength, const void *data, size_t size)
+{
+    if (writer->failed) {
+        return;
+    }
+
+    nameLength = name ? (nameLength < REZ_RESOURCE_NAME_LENGTH ? nameLength : REZ_RESOURCE_NAME_LENGTH - 1) : 0;
+    if (size > UINT32_MAX
+        || !RezWriterGrow((void **)&writer->resources, &writer->resourceCapacity, writer->resourceCount + 1, sizeof(*writer->resources))
+        || !RezWriterGrow((void **)&writer->data, &writer->dataCapacity, writer->dataLength + size, 1)
+        || !RezWriterGrow((void **)&writer->names, &writer->namesCapacity, writer->namesLength + nameLength, 1)) {
+        writer->failed = true;
+        return;
+    }
+
+    RezWriterResource *resource = &writer->resources[writer->resourceCount++];
+    memset(resource, 0, sizeof(*resource));
+    resource->type = type;
+    resource->id = id;
+    resource->nameLength = (uint8_t)nameLength;
+    resource->nameOffset = (uint32_t)writer->namesLength;
+    resource->dataOffset = writer->dataLength;
+    resource->size = (uint32_t)size;
+
+    if (nameLength) {
+        memcpy(writer->names + writer->namesLength, name, nameLength);
+        writer->namesLength += nameLength;
+    }
+    if (size) {
+        memcpy(writer->data + writer->dataLength, data, size);
+        writer->dataLength += size;
+    }
+}
+
+size_t RezWriterGetResourceCount(const RezWriter *writer)
+{
+    return writer->resourceCount;
+}
+
+
+#pragma mark - Layout
+
+// Resources are laid out through an array of these, so that sorting moves only a few
+// bytes per resource.
+typedef struct _RezWriterSlot {
+    uint32_t typeRank;
+    int16_t id;
+    uint32_t index;
+} RezWriterSlot;
+
+static int RezWriterCompareTypeCodes(const void *lhs, const void *rhs)
+{
+    RKFourCC a = *(const RKFourCC *)lhs;
+    RKFourCC b = *(const RKFourCC *)rhs;
+    return (a > b) - (a < b);
+}
+
+static int RezWriterCompareSlotsById(const void *lhs, const void *rhs)
+{
+    const RezWriterSlot *a = lhs;
+    const RezWriterSlot *b = rhs;
+    if (a->typeRank != b->typeRank) {
+        return a->typeRank < b->typeRank ? -1 : 1;
+    }
+    if (a->id != b->id) {
+        return a->id < b->id ? -1 : 1;
+    }
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+static int RezWriterCompareSlotsByIndex(const void *lhs, const void *rhs)
+{
+    const RezWriterSlot *a = lhs;
+    const RezWriterSlot *b = rhs;
+    if (a->typeRank != b->typeRank) {
+        return a->typeRank < b->typeRank ? -1 : 1;
+    }
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+static inline uint64_t RezWriterAlign(uint64_t offset, uint32_t alignment)
+{
+    return alignment > 1 ? (offset + alignment - 1) & ~(uint64_t)(alignment - 1) : offset;
+}
+
+static inline void RezWriterPutLittleLong(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static inline void RezWriterPutBigLong(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+static inline void RezWriterPutBigWord(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)(value >> 8);
+    bytes[1] = (uint8_t)value;
+}
+
+uint8_t *RezWriterCopyData(RezWriter *writer, RezWriterLayout layout, uint32_t alignment, size_t *length)
+{
+    if (writer->failed) {
+        fprintf(stderr, "*** Failed to collect the resources of the rez file.\n");
+        return NULL;
+    }
+    if (alignment & (alignment - 1)) {
+        fprintf(stderr, "*** The alignment of rez file data must be a power of two: %u\n", alignment);
+        return NULL;
+    }
+
+    size_t count = writer->resourceCount;
+    RKFourCC *types = calloc(count ?: 1, sizeof(*types));
+    uint32_t *typeCounts = calloc(count ?: 1, sizeof(*typeCounts));
+    RezWriterSlot *slots = calloc(count ?: 1, sizeof(*slots));
+    uint8_t *bytes = NULL;
+    uint32_t typeCount = 0;
+
+    if (!types || !typeCounts || !slots) {
+        goto REZ_WRITER_COPY_ERROR;
+    }
+
+    // Types are only ever a handful, so each resource finds its type by a linear search.
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t type = 0;
+        while (type < typeCount && types[type] != writer->resources[i].type) {
+            ++type;
+        }
+        if (type == typeCount) {
+            types[typeCount++] = writer->resources[i].type;
+        }
+    }
+    if (layout == RezWriterLayoutByTypeAndId) {
+        qsort(types, typeCount, sizeof(*types), RezWriterCompareTypeCodes);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        RezWriterResource *resource = &writer->resources[i];
+        resource->typeRank = 0;
+        while (types[resource->typeRank] != resource->type) {
+            resource->typeRank++;
+        }
+        typeCounts[resource->typeRank]++;
+        slots[i] = (RezWriterSlot){ .typeRank = resource->typeRank, .id = resource->id, .index = (uint32_t)i };
+    }
+
+    // Sorting by id finds any resource that was added twice, and is the order of the
+    // resource map when the data is to be sorted too.
+    qsort(slots, count, sizeof(*slots), RezWriterCompareSlotsById);
+    for (size_t i = 1; i < count; ++i) {
+        if (slots[i].typeRank == slots[i - 1].typeRank && slots[i].id == slots[i - 1].id) {
+            fprintf(stderr, "*** More than one resource was added with the id %d.\n", slots[i].id);
+            goto REZ_WRITER_COPY_ERROR;
+        }
+    }
+    if (layout == RezWriterLayoutAsAdded) {
+        qsort(slots, count, sizeof(*slots), RezWriterCompareSlotsByIndex);
+    }
+
+    // Place the data. The data ranges of the file are in the order of the data, and the
+    // resource map refers to them by their index, counting from one.
+    uint64_t offset = RezWriterAlign(REZ_HEADER_LENGTH + (count + 1) * REZ_DATA_RANGE_LENGTH + REZ_MAP_TAG_LENGTH, alignment);
+    for (size_t i = 0; i < count; ++i) {
+        RezWriterResource *resource = &writer->resources[layout == RezWriterLayoutAsAdded ? i : slots[i].index];
+        resource->entry = (uint32_t)i + 1;
+        resource->fileOffset = (uint32_t)offset;
+        offset = RezWriterAlign(offset + resource->size, alignment);
+        if (offset > UINT32_MAX) {
+            fprintf(stderr, "*** The resources are too large for a rez file.\n");
+            goto REZ_WRITER_COPY_ERROR;
+        }
+    }
+
+    uint64_t mapOffset = offset;
+    uint64_t mapLength = REZ_MAP_HEADER_LENGTH + (uint64_t)typeCount * REZ_TYPE_LENGTH + (uint64_t)count * REZ_RESOURCE_HEADER_LENGTH;
+    if (mapOffset + mapLength > UINT32_MAX || count + 1 > UINT32_MAX) {
+        fprintf(stderr, "*** The resources are too large for a rez file.\n");
+        goto REZ_WRITER_COPY_ERROR;
+    }
+
+    // Padding between the runs of data is left as zeros.
+    if ( (bytes = calloc((size_t)(mapOffset + mapLength), 1)) == NULL ) {
+        goto REZ_WRITER_COPY_ERROR;
+    }
+
+    // The header and data ranges are little endian.
+    uint8_t *cursor = bytes;
+    RezWriterPutLittleLong(cursor, 'RGRB');
+    RezWriterPutLittleLong(cursor + 4, 1);
+    RezWriterPutLittleLong(cursor + 8, REZ_DATA_RANGE_LENGTH);
+    RezWriterPutLittleLong(cursor + 20, (uint32_t)count + 1);
+    cursor += REZ_HEADER_LENGTH;
+
+    for (size_t i = 0; i < count; ++i) {
+        const RezWriterResource *resource = &writer->resources[layout == RezWriterLayoutAsAdded ? i : slots[i].index];
+        RezWriterPutLittleLong(cursor, resource->fileOffset);
+        RezWriterPutLittleLong(cursor + 4, resource->size);
+        cursor += REZ_DATA_RANGE_LENGTH;
+        if (resource->size) {
+            memcpy(bytes + resource->fileOffset, writer->data + resource->dataOffset, resource->size);
+        }
+    }
+    RezWriterPutLittleLong(cursor, (uint32_t)mapOffset);
+    RezWriterPutLittleLong(cursor + 4, (uint32_t)mapLength);
+    cursor += REZ_DATA_RANGE_LENGTH;
+    memcpy(cursor, REZ_MAP_TAG, REZ_MAP_TAG_LENGTH);
+
+    // The resource map is big endian. The headers of each type are contiguous, and each
+    // type records the offset of its first header from the start of the map.
+    cursor = bytes + mapOffset;
+    RezWriterPutBigLong(cursor, REZ_MAP_HEADER_LENGTH);
+    RezWriterPutBigLong(cursor + 4, typeCount);
+    cursor += REZ_MAP_HEADER_LENGTH;
+
+    uint32_t headerOffset = REZ_MAP_HEADER_LENGTH + typeCount * REZ_TYPE_LENGTH;
+    for (uint32_t i = 0; i < typeCount; ++i) {
+        RezWriterPutBigLong(cursor, types[i]);
+        RezWriterPutBigLong(cursor + 4, headerOffset);
+        RezWriterPutBigLong(cursor + 8, typeCounts[i]);
+        cursor += REZ_TYPE_LENGTH;
+        headerOffset += typeCounts[i] * REZ_RESOURCE_HEADER_LENGTH;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const RezWriterResource *resource = &writer->resources[slots[i].index];
+        RezWriterPutBigLong(cursor, resource->entry);
+        RezWriterPutBigLong(cursor + 4, resource->type);
+        RezWriterPutBigWord(cursor + 8, (uint16_t)resource->id);
+        if (resource->nameLength) {
+            memcpy(cursor + 10, writer->names + resource->nameOffset, resource->nameLength);
+        }
+        cursor += REZ_RESOURCE_HEADER_LENGTH;
+    }
+
+    *length = (size_t)(mapOffset + mapLength);
+    goto REZ_WRITER_COPY_DONE;
+
+REZ_WRITER_COPY_ERROR:
+    free(bytes);
+    bytes = NULL;
+
+REZ_WRITER_COPY_DONE:
+    free(types);
+    free(typeCounts);
+    free(slots);
+    return bytes;
+}
+
+
+#pragma mark - Writing
+
+bool RezWriterWrite(RezWriter *writer, const char *path, RezWriterLayout layout, uint32_t alignment)
+{
+    size_t length = 0;
+    uint8_t *bytes = RezWriterCopyData(writer, layout, alignment, &length);
+    if (!bytes) {
+        return false;
+    }
+
+    // The temporary file is given a unique name by mkstemp, which only lets its owner read
+    // it, so it is opened up to the permissions a new file would usually have.
+    char temporaryPath[1024];
+    FILE *handle = NULL;
+    int fd = -1;
+    if (snprintf(temporaryPath, sizeof(temporaryPath), "%s.XXXXXX", path) >= (int)sizeof(temporaryPath)
+        || (fd = mkstemp(temporaryPath)) < 0
+        || fchmod(fd, 0644) != 0
+        || (handle = fdopen(fd, "wb")) == NULL) {
+        fprintf(stderr, "*** Failed to create the rez file: %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+            unlink(temporaryPath);
+        }
+        free(bytes);
+        return false;
+    }
+
+    bool written = fwrite(bytes, 1, length, handle) == length;
+    written = (fclose(handle) == 0) && written;
+    free(bytes);
+
+    if (!written || rename(temporaryPath, path) != 0) {
+        fprintf(stderr, "*** Failed to write the rez file: %s\n", path);
+        unlink(temporaryPath);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef ResourceKit_RezWriter_h
+#define ResourceKit_RezWriter_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ClassicMacTypes.h"
+
+/// The order in which a RezWriter lays out the data of its resources.
+typedef enum _RezWriterLayout {
+
+    /// Resource data is written in the order the resources were added, and types appear in
+    /// the resource map in the order they were first added. Repackaging a file this way
+    /// keeps its layout as it was.
+    RezWriterLayoutAsAdded,
+
+    /// Resource data is grouped by type and sorted by id within each type, with types in
+    /// order of their codes, so that loading every resource of a type reads one contiguous
+    /// run of the file. The resource map is written in the same order.
+    RezWriterLayoutByTypeAndId,
+
+} RezWriterLayout;
+
+/// A RezWriter collects resources in memory and writes them out as a Rez file: the RGRB
+/// header, a data range for each resource followed by one for the resource map, the
+/// resource data, and finally the resource map with its type list and resource headers.
+///
+/// Resource data and names are copied when they are added, so nothing that was passed to
+/// the writer needs to outlive the call that passed it.
+typedef struct _RezWriter RezWriter;
+
+RezWriter *RezWriterCreate(void);
+void RezWriterDestroy(RezWriter *writer);
+
+/// Add a resource. Names are MacRoman bytes, and are truncated to 255 bytes to fit the
+/// field that holds them. A resource with the same type and id as one that was already
+/// added makes the file fail to write.
+void RezWriterAddResource(RezWriter *writer, RKFourCC type, int16_t id, const char *name, size_t nameLength, const void *data, size_t size);
+
+/// Returns the number of resources added so far.
+size_t RezWriterGetResourceCount(const RezWriter *writer);
+
+/// Lay out the resources and return the contents of the Rez file, which the caller must
+/// free. Each resource's data starts at a multiple of the alignment, which must be a power
+/// of two; an alignment of 0 or 1 packs the data without any padding. Returns NULL if a
+/// resource was added twice, an allocation failed, or the file would not fit the 32-bit
+/// offsets of the format. Any errors will be printed to stderr.
+uint8_t *RezWriterCopyData(RezWriter *writer, RezWriterLayout layout, uint32_t alignment, size_t *length);
+
+/// Lay out the resources and write them to the specified path. The file is written to a
+/// temporary file first and then moved into place, so that a reader will never open a
+/// partially written file.
+bool RezWriterWrite(RezWriter *writer, const char *path, RezWriterLayout layout, uint32_t alignment);
+
+#endif
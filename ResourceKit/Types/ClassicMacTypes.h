@@ -22,6 +22,8 @@
 // SOFTWARE.
 //
 
+#ifndef ResourceKit_ClassicMacTypes_h
+#define ResourceKit_ClassicMacTypes_h
 
 #pragma mark - Macintosh Rectangle / Geometry
 
@@ -56,3 +58,18 @@ static inline int16_t RKMacRectGetHeight(RKMacRect r)
 {
     return r.y2 - r.y1;
 }
+
+
+#pragma mark - Four Character Codes
+
+/// A classic Mac OS four character code, such as a resource type, packed into a single
+/// big endian value so that it can be compared and hashed as an integer.
+typedef uint32_t RKFourCC;
+
+static inline RKFourCC RKFourCCMake(const char *code)
+{
+    return ((RKFourCC)(uint8_t)code[0] << 24) | ((RKFourCC)(uint8_t)code[1] << 16)
+         | ((RKFourCC)(uint8_t)code[2] << 8) | (RKFourCC)(uint8_t)code[3];
+}
+
+#endif
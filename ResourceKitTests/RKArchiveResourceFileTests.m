@@ -0,0 +1,237 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import <Cocoa/Cocoa.h>
+#import "RKArchiveResourceFile.h"
+#import "RKResourceFork.h"
+#import "RKResource.h"
+#import "RKRLEResourceParser.h"
+#import "RKRLEObject.h"
+#import "RKRLESprite.h"
+#import "RKResourceParserProtocol.h"
+#import "RKRezFixture.h"
+
+@interface RKArchiveResourceFileTests : XCTestCase
+@end
+
+/// An RLË parser which counts how many times it is asked to decode.
+@interface RKCountingRLEResourceParser : RKRLEResourceParser
+@property (class, nonatomic) NSUInteger decodeCount;
+@end
+
+@implementation RKCountingRLEResourceParser
+
+static NSUInteger RKCountingRLEDecodeCount = 0;
+
++ (NSUInteger)decodeCount
+{
+    return RKCountingRLEDecodeCount;
+}
+
++ (void)setDecodeCount:(NSUInteger)decodeCount
+{
+    RKCountingRLEDecodeCount = decodeCount;
+}
+
++ (id)parseData:(NSData *)data options:(NSDictionary<NSString *, id> *)options
+{
+    RKCountingRLEDecodeCount++;
+    return [super parseData:data options:options];
+}
+
++ (id<RKIncrementalDecoderProtocol>)incrementalDecoderForData:(NSData *)data options:(NSDictionary<NSString *, id> *)options
+{
+    RKCountingRLEDecodeCount++;
+    return [super incrementalDecoderForData:data options:options];
+}
+
+@end
+
+@implementation RKArchiveResourceFileTests
+
+#pragma mark - Sample Data
+
+static void RKAppendDWord(NSMutableData *data, uint32_t value)
+{
+    uint32_t be = OSSwapHostToBigInt32(value);
+    [data appendBytes:&be length:sizeof(be)];
+}
+
+/// A 4x2 single frame 8-bit sprite, with a transparent pixel and a pixel run.
+- (NSData *)rle8Sample
+{
+    NSMutableData *data = [NSMutableData new];
+    RKAppendDWord(data, 0x00040002);                // Width, Height
+    RKAppendDWord(data, 0x00080000);                // Depth
+    RKAppendDWord(data, 0x00010000);                // Frames
+    [data increaseLengthBy:4];
+    
+    RKAppendDWord(data, 0x01000000);                // Line Start
+    RKAppendDWord(data, 0x02000002);                // Pixel Data (2 bytes)
+    [data appendBytes:(uint8_t[]){ 0x05, 0x23, 0x00, 0x00 } length:4];
+    RKAppendDWord(data, 0x03000001);                // Transparent Run (1 pixel)
+    RKAppendDWord(data, 0x04000001);                // Pixel Run (1 pixel)
+    RKAppendDWord(data, 0xFF000000);
+    
+    RKAppendDWord(data, 0x01000000);                // Line Start
+    RKAppendDWord(data, 0x04000004);                // Pixel Run (4 pixels)
+    RKAppendDWord(data, 0x01020304);
+    
+    RKAppendDWord(data, 0x00000000);                // End of Frame
+    return data;
+}
+
+/// A 2x1 single frame 16-bit sprite, with a red and a green pixel.
+- (NSData *)rle16Sample
+{
+    NSMutableData *data = [NSMutableData new];
+    RKAppendDWord(data, 0x00020001);                // Width, Height
+    RKAppendDWord(data, 0x00100000);                // Depth
+    RKAppendDWord(data, 0x00010000);                // Frames
+    [data increaseLengthBy:4];
+    
+    RKAppendDWord(data, 0x01000000);                // Line Start
+    RKAppendDWord(data, 0x02000004);                // Pixel Data (4 bytes)
+    [data appendBytes:(uint8_t[]){ 0x7C, 0x00, 0x03, 0xE0 } length:4];
+    
+    RKAppendDWord(data, 0x00000000);                // End of Frame
+    return data;
+}
+
+- (RKResourceFork *)sampleResourceFork
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Greeting" data:[@"hello" dataUsingEncoding:NSUTF8StringEncoding]];
+    [fixture addResourceOfType:@"rlë8" id:200 name:@"Sprite" data:self.rle8Sample];
+    [fixture addResourceOfType:@"rlëD" id:201 name:@"Direct Sprite" data:self.rle16Sample];
+    [fixture addResourceOfType:@"STR " id:-5 name:nil data:[NSData data]];
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKArchiveResourceFileTests"]];
+    return resourceFork;
+}
+
+- (RKArchiveResourceFile *)bakeResourceFork:(RKResourceFork *)resourceFork pixelFormat:(RKPixelFormat)format
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RKArchiveResourceFileTests.rka"];
+    NSError *error = nil;
+    XCTAssertTrue([RKArchiveResourceFile bakeResourceFork:resourceFork toPath:path pixelFormat:format error:&error]);
+    XCTAssertNil(error);
+    return [RKArchiveResourceFile resourceFileWithPath:path];
+}
+
+
+#pragma mark - Tests
+
+- (void)test_bakedArchive_rawDataIsBitExact
+{
+    RKResourceFork *resourceFork = self.sampleResourceFork;
+    RKArchiveResourceFile *archive = [self bakeResourceFork:resourceFork pixelFormat:RKPixelFormat_RGBA8888];
+    XCTAssertNotNil(archive);
+    
+    XCTAssertEqualObjects([NSSet setWithArray:archive.allTypes], [NSSet setWithArray:resourceFork.allTypes]);
+    for (NSString *type in resourceFork.allTypes) {
+        NSArray <RKResource *> *expected = [resourceFork resourcesOfType:type];
+        NSArray <RKResource *> *baked = [archive resourcesOfType:type];
+        XCTAssertEqual(baked.count, expected.count);
+        for (RKResource *resource in expected) {
+            XCTAssertEqualObjects([archive dataForResourceOfType:type id:resource.id], resource.data);
+        }
+    }
+    XCTAssertEqualObjects([archive resourcesOfType:@"rlë8"].firstObject.name, @"Sprite");
+}
+
+- (void)test_bakedArchive_spritesMatchDecodedPixels
+{
+    RKArchiveResourceFile *archive = [self bakeResourceFork:self.sampleResourceFork pixelFormat:RKPixelFormat_BGRA8888];
+    NSDictionary *options = @{ RKResourceParserOptionPixelFormat: @(RKPixelFormat_BGRA8888) };
+    
+    RKRLEObject *decoded = [RKRLEResourceParser parseData:self.rle8Sample options:options];
+    RKRLEObject *baked = [archive objectForResourceOfType:@"rlë8" id:200 options:options];
+    XCTAssertTrue([baked isKindOfClass:RKRLEObject.class]);
+    XCTAssertEqual(baked.sprites.count, decoded.sprites.count);
+    XCTAssertTrue(CGSizeEqualToSize(baked.size, decoded.size));
+    
+    RKPixelBuffer *a = decoded.sprites.firstObject.pixelBuffer;
+    RKPixelBuffer *b = baked.sprites.firstObject.pixelBuffer;
+    XCTAssertEqual(b.format, RKPixelFormat_BGRA8888);
+    for (uint32_t row = 0; row < a.height; ++row) {
+        XCTAssertEqual(memcmp([a rowAtIndex:row], [b rowAtIndex:row], a.width * 4), 0);
+    }
+    XCTAssertTrue(baked.sprites.firstObject.imageValue != NULL);
+}
+
+- (void)test_bakedArchive_otherPixelFormats_areParsed
+{
+    RKArchiveResourceFile *archive = [self bakeResourceFork:self.sampleResourceFork pixelFormat:RKPixelFormat_RGBA8888];
+    
+    // Unbaked formats, mipmaps and resources without images are left to the parser.
+    XCTAssertNil([archive objectForResourceOfType:@"rlë8" id:200 options:@{ RKResourceParserOptionPixelFormat: @(RKPixelFormat_RGB565) }]);
+    NSDictionary *mipmapped = @{ RKResourceParserOptionPixelFormat: @(RKPixelFormat_RGBA8888), RKResourceParserOptionGenerateMipmaps: @YES };
+    XCTAssertNil([archive objectForResourceOfType:@"rlë8" id:200 options:mipmapped]);
+    XCTAssertNil([archive objectForResourceOfType:@"STR " id:128 options:nil]);
+    
+    RKResource *resource = [archive resourcesOfType:@"rlë8"].firstObject;
+    RKRLEObject *object = [resource objectWithOptions:@{ RKResourceParserOptionPixelFormat: @(RKPixelFormat_RGB565) }];
+    XCTAssertEqual(object.sprites.firstObject.pixelBuffer.format, RKPixelFormat_RGB565);
+}
+
+- (void)test_bakedArchive_defaultPixelFormat_isNotDecoded
+{
+    RKArchiveResourceFile *archive = [self bakeResourceFork:self.sampleResourceFork pixelFormat:RKPixelFormat_RGBA8888];
+    RKResource *resource = [archive resourcesOfType:@"rlëD"].firstObject;
+    
+    // 16-bit sprites default to the baked format, so are served without invoking the parser.
+    [RKResource registerParser:RKCountingRLEResourceParser.class forType:@"rlëD"];
+    RKCountingRLEResourceParser.decodeCount = 0;
+    RKRLEObject *object = [resource objectWithOptions:nil];
+    [RKResource registerParser:RKRLEResourceParser.class forType:@"rlëD"];
+    
+    XCTAssertTrue([object isKindOfClass:RKRLEObject.class]);
+    XCTAssertEqual(object.sprites.firstObject.pixelBuffer.format, RKPixelFormat_RGBA8888);
+    XCTAssertEqual(RKCountingRLEResourceParser.decodeCount, 0);
+    
+    // 8-bit sprites default to indexed pixels, which are never baked.
+    XCTAssertNil([archive objectForResourceOfType:@"rlë8" id:200 options:nil]);
+}
+
+- (void)test_bake_failures_returnErrors
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RKArchiveResourceFileTests-Failure.rka"];
+    NSError *error = nil;
+    XCTAssertFalse([RKArchiveResourceFile bakeResourceFork:self.sampleResourceFork toPath:path pixelFormat:RKPixelFormat_Indexed8 error:&error]);
+    XCTAssertEqualObjects(error.domain, RKArchiveErrorDomain);
+    XCTAssertEqual(error.code, RKArchiveError_UnsupportedPixelFormat);
+    
+    error = nil;
+    NSString *unwritable = @"/nonexistent-directory/RKArchiveResourceFileTests.rka";
+    XCTAssertFalse([RKArchiveResourceFile bakeResourceFork:self.sampleResourceFork toPath:unwritable pixelFormat:RKPixelFormat_RGBA8888 error:&error]);
+    XCTAssertEqualObjects(error.domain, RKArchiveErrorDomain);
+    XCTAssertEqual(error.code, RKArchiveError_WriteFailed);
+    XCTAssertEqualObjects(error.userInfo[NSFilePathErrorKey], unwritable);
+    XCTAssertEqual([error.userInfo[NSUnderlyingErrorKey] code], ENOENT);
+}
+
+@end
@@ -0,0 +1,293 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKDecodeScheduler.h"
+#import "RKIncrementalDecoderProtocol.h"
+#import "RKResourceFork.h"
+#import "RKResource.h"
+#import "RKDecodeJob.h"
+#import "RKRezFixture.h"
+
+/// The number of speculative requests used to flood the scheduler, the number of visible
+/// requests made once it is flooded, and how long each request keeps a worker busy.
+static const NSUInteger RKDecodeSchedulerFloodCount = 10000;
+static const NSUInteger RKDecodeSchedulerVisibleCount = 100;
+static const uint64_t RKDecodeSchedulerWorkDuration = 100 * NSEC_PER_USEC;
+
+static id RKDecodeSchedulerBusyWork(void)
+{
+    uint64_t deadline = RKDecodeClock() + RKDecodeSchedulerWorkDuration;
+    while (RKDecodeClock() < deadline) {
+    }
+    return @YES;
+}
+
+static uint64_t RKDecodeSchedulerPercentile(uint64_t *values, NSUInteger count, double percentile)
+{
+    qsort_b(values, count, sizeof(*values), ^int(const void *lhs, const void *rhs) {
+        uint64_t a = *(const uint64_t *)lhs, b = *(const uint64_t *)rhs;
+        return (a > b) - (a < b);
+    });
+    return values[MIN((NSUInteger)(percentile * count), count - 1)];
+}
+
+@interface RKDecodeSchedulerTests : XCTestCase
+@end
+
+@implementation RKDecodeSchedulerTests
+
+#pragma mark - Helpers
+
+// Keep every worker of the scheduler busy until the returned semaphore is signalled once
+// for each of them. The group is left as each worker is released.
+- (dispatch_semaphore_t)occupyWorkersOfScheduler:(RKDecodeScheduler *)scheduler group:(dispatch_group_t)group
+{
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    dispatch_semaphore_t released = dispatch_semaphore_create(0);
+    
+    for (NSUInteger i = 0; i < scheduler.workerCount; ++i) {
+        dispatch_group_enter(group);
+        [scheduler scheduleWork:^id{
+            dispatch_semaphore_signal(started);
+            dispatch_semaphore_wait(released, DISPATCH_TIME_FOREVER);
+            return nil;
+        } priority:RKDecodePriority_Visible queue:nil completion:^(id object) {
+            dispatch_group_leave(group);
+        }];
+    }
+    
+    for (NSUInteger i = 0; i < scheduler.workerCount; ++i) {
+        dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+    }
+    return released;
+}
+
+
+#pragma mark - Tests
+
+- (void)test_scheduler_cancelledRequest_neverCompletes
+{
+    RKDecodeScheduler *scheduler = [[RKDecodeScheduler alloc] initWithWorkerCount:2];
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_semaphore_t released = [self occupyWorkersOfScheduler:scheduler group:group];
+    
+    __block BOOL cancelledDidComplete = NO;
+    RKDecodeRequest *cancelled = [scheduler scheduleWork:^id{
+        return @YES;
+    } priority:RKDecodePriority_Normal queue:nil completion:^(id object) {
+        cancelledDidComplete = YES;
+    }];
+    
+    dispatch_group_enter(group);
+    RKDecodeRequest *other = [scheduler scheduleWork:^id{
+        return @YES;
+    } priority:RKDecodePriority_Normal queue:nil completion:^(id object) {
+        dispatch_group_leave(group);
+    }];
+    
+    [cancelled cancel];
+    XCTAssertEqual(cancelled.status, RKDecodeRequestStatus_Cancelled);
+    
+    for (NSUInteger i = 0; i < scheduler.workerCount; ++i) {
+        dispatch_semaphore_signal(released);
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    XCTAssertFalse(cancelledDidComplete);
+    XCTAssertEqual(other.status, RKDecodeRequestStatus_Finished);
+}
+
+- (void)test_scheduler_reprioritisedRequest_jumpsQueue
+{
+    RKDecodeScheduler *scheduler = [[RKDecodeScheduler alloc] initWithWorkerCount:2];
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_semaphore_t released = [self occupyWorkersOfScheduler:scheduler group:group];
+    
+    NSMutableArray <NSNumber *> *startOrder = [NSMutableArray new];
+    NSMutableArray <RKDecodeRequest *> *requests = [NSMutableArray new];
+    for (NSUInteger i = 0; i < 20; ++i) {
+        dispatch_group_enter(group);
+        [requests addObject:[scheduler scheduleWork:^id{
+            @synchronized (startOrder) {
+                [startOrder addObject:@(i)];
+            }
+            return @YES;
+        } priority:RKDecodePriority_Prefetch queue:nil completion:^(id object) {
+            dispatch_group_leave(group);
+        }]];
+    }
+    
+    requests.lastObject.priority = RKDecodePriority_Visible;
+    XCTAssertEqual(requests.lastObject.priority, RKDecodePriority_Visible);
+    
+    for (NSUInteger i = 0; i < scheduler.workerCount; ++i) {
+        dispatch_semaphore_signal(released);
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    // Workers race to record their start, so the request need only be among the first
+    // started by each worker.
+    XCTAssertEqual(startOrder.count, requests.count);
+    XCTAssertLessThan([startOrder indexOfObject:@(requests.count - 1)], scheduler.workerCount);
+}
+
+- (void)test_scheduler_flood_visibleLaneLatency
+{
+    RKDecodeScheduler *scheduler = RKDecodeScheduler.sharedScheduler;
+    dispatch_group_t group = dispatch_group_create();
+    
+    uint64_t *floodLatencies = calloc(RKDecodeSchedulerFloodCount, sizeof(uint64_t));
+    uint64_t *visibleLatencies = calloc(RKDecodeSchedulerVisibleCount, sizeof(uint64_t));
+    
+    for (NSUInteger i = 0; i < RKDecodeSchedulerFloodCount; ++i) {
+        uint64_t submitted = RKDecodeClock();
+        dispatch_group_enter(group);
+        [scheduler scheduleWork:^id{
+            return RKDecodeSchedulerBusyWork();
+        } priority:RKDecodePriority_Prefetch queue:nil completion:^(id object) {
+            floodLatencies[i] = RKDecodeClock() - submitted;
+            dispatch_group_leave(group);
+        }];
+    }
+    
+    for (NSUInteger i = 0; i < RKDecodeSchedulerVisibleCount; ++i) {
+        uint64_t submitted = RKDecodeClock();
+        dispatch_group_enter(group);
+        [scheduler scheduleWork:^id{
+            return RKDecodeSchedulerBusyWork();
+        } priority:RKDecodePriority_Visible queue:nil completion:^(id object) {
+            visibleLatencies[i] = RKDecodeClock() - submitted;
+            dispatch_group_leave(group);
+        }];
+    }
+    
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    uint64_t visibleP50 = RKDecodeSchedulerPercentile(visibleLatencies, RKDecodeSchedulerVisibleCount, 0.50);
+    uint64_t visibleP95 = RKDecodeSchedulerPercentile(visibleLatencies, RKDecodeSchedulerVisibleCount, 0.95);
+    uint64_t visibleP99 = RKDecodeSchedulerPercentile(visibleLatencies, RKDecodeSchedulerVisibleCount, 0.99);
+    uint64_t floodP50 = RKDecodeSchedulerPercentile(floodLatencies, RKDecodeSchedulerFloodCount, 0.50);
+    uint64_t floodP99 = RKDecodeSchedulerPercentile(floodLatencies, RKDecodeSchedulerFloodCount, 0.99);
+    NSLog(@"%lu workers. Visible latency p50 %.2fms, p95 %.2fms, p99 %.2fms. Prefetch latency p50 %.2fms, p99 %.2fms.",
+          (unsigned long)scheduler.workerCount,
+          visibleP50 / 1e6, visibleP95 / 1e6, visibleP99 / 1e6, floodP50 / 1e6, floodP99 / 1e6);
+    
+    // Visible requests were made after the entire flood, so they only finish ahead of most
+    // of it if they jumped the queue.
+    XCTAssertLessThan(visibleP99, floodP50);
+    
+    free(floodLatencies);
+    free(visibleLatencies);
+}
+
+- (void)test_resource_requestObject_matchesObject
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"TEXT" id:128 name:@"Text" data:[@"text" dataUsingEncoding:NSUTF8StringEncoding]];
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKDecodeSchedulerTests"]];
+    
+    XCTAssertNil([resourceFork requestObjectForResourceOfType:@"TEXT" id:129 priority:RKDecodePriority_Visible queue:nil completion:^(id object) {
+        XCTFail(@"Completion called for a missing resource");
+    }]);
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Object decoded"];
+    __block id asyncObject = nil;
+    [resourceFork requestObjectForResourceOfType:@"TEXT" id:128 priority:RKDecodePriority_Visible queue:dispatch_get_main_queue() completion:^(id object) {
+        XCTAssertTrue(NSThread.isMainThread);
+        asyncObject = object;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    
+    XCTAssertNotNil(asyncObject);
+    XCTAssertEqual(asyncObject, [resourceFork resourceOfType:@"TEXT" id:128].object);
+}
+
+- (void)test_resource_decodeJob_leavesCompletionHandlerToCaller
+{
+    NSData *data = [NSUUID.UUID.UUIDString dataUsingEncoding:NSUTF8StringEncoding];
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"TEXT" id:128 name:nil data:data];
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKDecodeSchedulerTests-CompletionHandler"]];
+    RKResource *resource = [resourceFork resourceOfType:@"TEXT" id:128];
+    
+    RKDecodeJob *job = resource.decodeJob;
+    XCTAssertNil(job.completionHandler);
+    
+    __block id completedObject = nil;
+    job.completionHandler = ^(id object) {
+        completedObject = object;
+    };
+    while ([job step:1] == RKDecodeStatus_Incomplete) {
+        continue;
+    }
+    XCTAssertEqualObjects(completedObject, data);
+    
+    // The object is still cached for the resource, despite the handler being replaced.
+    XCTAssertEqual(resource.object, completedObject);
+}
+
+- (void)test_resource_decodeJob_outlivesResourceFork
+{
+    NSData *data = [NSUUID.UUID.UUIDString dataUsingEncoding:NSUTF8StringEncoding];
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"TEXT" id:128 name:nil data:data];
+    NSString *path = [fixture writeToTemporaryFileNamed:@"RKDecodeSchedulerTests-Outlives"];
+    
+    RKDecodeJob *job = nil;
+    RKDecodeJob *cachingJob = nil;
+    @autoreleasepool {
+        RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+        [resourceFork addResourceFileAtPath:path];
+        job = [[resourceFork resourceOfType:@"TEXT" id:128] decodeJobWithOptions:nil];
+        cachingJob = [resourceFork resourceOfType:@"TEXT" id:128].decodeJob;
+    }
+    
+    XCTAssertEqual([job finish], RKDecodeStatus_Complete);
+    XCTAssertEqualObjects(job.object, data);
+    
+    // The caching job only reads the data to look for the object when it is stepped.
+    XCTAssertEqual([cachingJob finish], RKDecodeStatus_Complete);
+    XCTAssertEqualObjects(cachingJob.object, data);
+}
+
+- (void)test_resource_decodeJob_findsCachedObjectWhenStepped
+{
+    NSData *data = [NSUUID.UUID.UUIDString dataUsingEncoding:NSUTF8StringEncoding];
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"TEXT" id:128 name:nil data:data];
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKDecodeSchedulerTests-Cached"]];
+    RKResource *resource = [resourceFork resourceOfType:@"TEXT" id:128];
+    
+    RKDecodeJob *job = resource.decodeJob;
+    id object = resource.object;
+    XCTAssertEqual([job finish], RKDecodeStatus_Complete);
+    XCTAssertEqual(job.object, object);
+}
+
+@end
@@ -0,0 +1,383 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import <Cocoa/Cocoa.h>
+#import "RKRLEResourceParser.h"
+#import "RKPictureResourceParser.h"
+#import "RKRLEObject.h"
+#import "RKRLESprite.h"
+#import "RKPixelBuffer.h"
+#import "RKColorTable.h"
+#import "RKResourceParserProtocol.h"
+#import "RKDecodeJob.h"
+
+@interface RKIndexedImageTests : XCTestCase
+@end
+
+@implementation RKIndexedImageTests
+
+#pragma mark - Sample Data
+
+static void RKAppendWord(NSMutableData *data, uint16_t value)
+{
+    uint16_t be = OSSwapHostToBigInt16(value);
+    [data appendBytes:&be length:sizeof(be)];
+}
+
+static void RKAppendDWord(NSMutableData *data, uint32_t value)
+{
+    uint32_t be = OSSwapHostToBigInt32(value);
+    [data appendBytes:&be length:sizeof(be)];
+}
+
+static void RKAppendRect(NSMutableData *data, int16_t top, int16_t left, int16_t bottom, int16_t right)
+{
+    RKAppendWord(data, top);
+    RKAppendWord(data, left);
+    RKAppendWord(data, bottom);
+    RKAppendWord(data, right);
+}
+
+/// A 4x2 single frame 8-bit sprite.
+///   Row 0: index 5, index 0x23, transparent, index 0xFF
+///   Row 1: a pixel run of indices 1, 2, 3, 4
+- (NSData *)rle8Sample
+{
+    NSMutableData *data = [NSMutableData new];
+    RKAppendWord(data, 4);      // Width
+    RKAppendWord(data, 2);      // Height
+    RKAppendWord(data, 8);      // Depth
+    RKAppendWord(data, 0);
+    RKAppendWord(data, 1);      // Frames
+    [data increaseLengthBy:6];
+    
+    RKAppendDWord(data, 0x01000000);                // Line Start
+    RKAppendDWord(data, 0x02000002);                // Pixel Data (2 bytes)
+    [data appendBytes:(uint8_t[]){ 0x05, 0x23, 0x00, 0x00 } length:4];
+    RKAppendDWord(data, 0x03000001);                // Transparent Run (1 pixel)
+    RKAppendDWord(data, 0x04000001);                // Pixel Run (1 pixel)
+    RKAppendDWord(data, 0xFF000000);
+    
+    RKAppendDWord(data, 0x01000000);                // Line Start
+    RKAppendDWord(data, 0x04000004);                // Pixel Run (4 pixels)
+    RKAppendDWord(data, 0x01020304);
+    
+    RKAppendDWord(data, 0x00000000);                // End of Frame
+    return data;
+}
+
+/// A 32x32 8-bit sprite of 16 frames, with every row written as a run of pixel data. This
+/// is large enough that it can not be decoded in a single short step.
+- (NSData *)largeRLE8Sample
+{
+    NSMutableData *data = [NSMutableData new];
+    RKAppendWord(data, 32);     // Width
+    RKAppendWord(data, 32);     // Height
+    RKAppendWord(data, 8);      // Depth
+    RKAppendWord(data, 0);
+    RKAppendWord(data, 16);     // Frames
+    [data increaseLengthBy:6];
+    
+    for (uint8_t frame = 0; frame < 16; ++frame) {
+        for (uint8_t y = 0; y < 32; ++y) {
+            RKAppendDWord(data, 0x01000000);        // Line Start
+            RKAppendDWord(data, 0x02000020);        // Pixel Data (32 bytes)
+            for (uint8_t x = 0; x < 32; ++x) {
+                uint8_t index = (uint8_t)(x * 7 + y * 3 + frame);
+                [data appendBytes:&index length:1];
+            }
+        }
+        RKAppendDWord(data, 0x00000000);            // End of Frame
+    }
+    return data;
+}
+
+/// An 8x2 PackBitsRect picture using a two color table of red (0) and blue (1).
+///   Row 0: packed as a repeat of 8 red pixels
+///   Row 1: packed as a literal run alternating red and blue
+- (NSData *)packBitsPictSample
+{
+    NSMutableData *data = [NSMutableData new];
+    RKAppendWord(data, 0);
+    RKAppendRect(data, 0, 0, 2, 8);                 // Frame
+    RKAppendDWord(data, 0x001102ff);                // Version 2
+    RKAppendWord(data, 0x0C00);                     // Extended Header
+    RKAppendDWord(data, 0xfffe0000);
+    RKAppendDWord(data, 0x00480000);
+    RKAppendDWord(data, 0x00480000);
+    RKAppendRect(data, 0, 0, 2, 8);
+    RKAppendDWord(data, 0);
+    
+    RKAppendWord(data, 0x0098);                     // PackBitsRect
+    RKAppendWord(data, 0x8000 | 8);                 // Row Bytes
+    RKAppendRect(data, 0, 0, 2, 8);                 // Bounds
+    RKAppendWord(data, 0);                          // Version
+    RKAppendWord(data, 0);                          // Pack Type
+    RKAppendDWord(data, 0);                         // Pack Size
+    RKAppendDWord(data, 0x00480000);                // Resolution
+    RKAppendDWord(data, 0x00480000);
+    RKAppendWord(data, 0);                          // Pixel Type
+    RKAppendWord(data, 8);                          // Pixel Size
+    RKAppendWord(data, 1);                          // Component Count
+    RKAppendWord(data, 8);                          // Component Size
+    RKAppendDWord(data, 0);
+    RKAppendDWord(data, 0);
+    RKAppendDWord(data, 0);
+    
+    RKAppendDWord(data, 0);                         // Color Table Seed
+    RKAppendWord(data, 0);                          // Flags
+    RKAppendWord(data, 1);                          // Size - 1
+    RKAppendWord(data, 0); RKAppendWord(data, 0xFFFF); RKAppendWord(data, 0); RKAppendWord(data, 0);
+    RKAppendWord(data, 1); RKAppendWord(data, 0); RKAppendWord(data, 0); RKAppendWord(data, 0xFFFF);
+    
+    RKAppendRect(data, 0, 0, 2, 8);                 // Source
+    RKAppendRect(data, 0, 0, 2, 8);                 // Destination
+    RKAppendWord(data, 0);                          // Mode
+    
+    [data appendBytes:(uint8_t[]){ 2, 0xF9, 0x00 } length:3];
+    [data appendBytes:(uint8_t[]){ 9, 0x07, 0, 1, 0, 1, 0, 1, 0, 1 } length:10];
+    
+    if (data.length & 1) {
+        [data increaseLengthBy:1];
+    }
+    RKAppendWord(data, 0x00FF);                     // End of Picture
+    return data;
+}
+
+
+#pragma mark - Helpers
+
+/// Step a decoder to completion using the smallest possible budget, returning the decoded
+/// object and the number of steps that it took.
+- (id)stepDecoderToCompletion:(id<RKIncrementalDecoderProtocol>)decoder steps:(NSUInteger *)steps
+{
+    RKDecodeJob *job = [[RKDecodeJob alloc] initWithDecoder:decoder];
+    *steps = 1;
+    while ([job step:1] == RKDecodeStatus_Incomplete) {
+        ++*steps;
+    }
+    XCTAssertEqual(job.status, RKDecodeStatus_Complete);
+    return job.object;
+}
+
+- (BOOL)pixelBuffer:(RKPixelBuffer *)a matchesPixelBuffer:(RKPixelBuffer *)b
+{
+    if (a.format != b.format || a.width != b.width || a.height != b.height || a.levelCount != b.levelCount) {
+        return NO;
+    }
+    for (uint32_t level = 0; level < a.levelCount; ++level) {
+        size_t rowLength = [a widthOfLevel:level] * RKPixelFormatBytesPerPixel(a.format);
+        for (uint32_t row = 0; row < [a heightOfLevel:level]; ++row) {
+            if (memcmp([a bytesOfLevel:level] + row * [a strideOfLevel:level],
+                       [b bytesOfLevel:level] + row * [b strideOfLevel:level], rowLength) != 0) {
+                return NO;
+            }
+        }
+    }
+    if ((a.maskBytes == NULL) != (b.maskBytes == NULL)) {
+        return NO;
+    }
+    for (uint32_t row = 0; a.maskBytes && row < a.height; ++row) {
+        if (memcmp([a maskRowAtIndex:row], [b maskRowAtIndex:row], (a.width + 7) / 8) != 0) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/// Draw the image into an RGBA 8888 bitmap and return the pixels, top row first.
+- (NSData *)renderImage:(CGImageRef)image
+{
+    size_t width = CGImageGetWidth(image);
+    size_t height = CGImageGetHeight(image);
+    NSMutableData *pixels = [NSMutableData dataWithLength:width * height * 4];
+    
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef ctx = CGBitmapContextCreate(pixels.mutableBytes, width, height, 8, width * 4, colorSpace, kCGImageAlphaPremultipliedLast);
+    CGContextDrawImage(ctx, CGRectMake(0, 0, width, height), image);
+    CGContextRelease(ctx);
+    CGColorSpaceRelease(colorSpace);
+    return pixels;
+}
+
+- (uint32_t)pixelAtX:(size_t)x y:(size_t)y ofRender:(NSData *)render width:(size_t)width
+{
+    const uint8_t *p = (const uint8_t *)render.bytes + (y * width + x) * 4;
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+#pragma mark - RLË Tests
+
+- (void)test_rle8_decodesAsIndexedPixels
+{
+    RKRLEObject *rle = [RKRLEResourceParser parseData:self.rle8Sample];
+    XCTAssertEqual(rle.sprites.count, 1);
+    
+    RKPixelBuffer *buffer = rle.sprites.firstObject.pixelBuffer;
+    XCTAssertEqual(buffer.format, RKPixelFormat_Indexed8);
+    XCTAssertEqual(buffer.colorTable, RKColorTable.standardColorTable);
+    
+    const uint8_t *row0 = [buffer rowAtIndex:0];
+    const uint8_t *row1 = [buffer rowAtIndex:1];
+    XCTAssertEqual(row0[0], 0x05);
+    XCTAssertEqual(row0[1], 0x23);
+    XCTAssertEqual(row0[3], 0xFF);
+    XCTAssertEqual(row1[0], 1);
+    XCTAssertEqual(row1[1], 2);
+    XCTAssertEqual(row1[2], 3);
+    XCTAssertEqual(row1[3], 4);
+    
+    XCTAssertEqual([buffer maskRowAtIndex:0][0], 0xD0);
+    XCTAssertEqual([buffer maskRowAtIndex:1][0], 0xF0);
+}
+
+- (void)test_rle8_sharesStandardColorTableBetweenSprites
+{
+    RKRLEObject *a = [RKRLEResourceParser parseData:self.rle8Sample];
+    RKRLEObject *b = [RKRLEResourceParser parseData:self.rle8Sample];
+    XCTAssertEqual(a.sprites.firstObject.pixelBuffer.colorTable, b.sprites.firstObject.pixelBuffer.colorTable);
+}
+
+- (void)test_rle8_expandsThroughColorTableWhenDrawn
+{
+    RKRLEObject *rle = [RKRLEResourceParser parseData:self.rle8Sample];
+    NSData *render = [self renderImage:rle.sprites.firstObject.imageValue];
+    
+    XCTAssertEqual([self pixelAtX:0 y:0 ofRender:render width:4], 0xFFFF00FF);
+    XCTAssertEqual([self pixelAtX:2 y:0 ofRender:render width:4], 0x00000000);
+    XCTAssertEqual([self pixelAtX:3 y:0 ofRender:render width:4], 0x000000FF);
+}
+
+- (void)test_rle8_requestedDirectFormat_expandsAtDecode
+{
+    RKRLEObject *rle = [RKRLEResourceParser parseData:self.rle8Sample
+                                              options:@{ RKResourceParserOptionPixelFormat : @(RKPixelFormat_RGBA8888) }];
+    RKPixelBuffer *buffer = rle.sprites.firstObject.pixelBuffer;
+    XCTAssertEqual(buffer.format, RKPixelFormat_RGBA8888);
+    
+    const uint8_t *row0 = [buffer rowAtIndex:0];
+    const uint8_t yellow[4] = { 0xFF, 0xFF, 0x00, 0xFF };
+    const uint8_t clear[4] = { 0x00, 0x00, 0x00, 0x00 };
+    XCTAssertEqual(memcmp(row0, yellow, 4), 0);
+    XCTAssertEqual(memcmp(row0 + 8, clear, 4), 0);
+}
+
+- (void)test_rle8_invalidFormatOption_decodesAsRGBA8888
+{
+    for (id format in @[ @99, @(-1), @"RGB565" ]) {
+        RKRLEObject *rle = [RKRLEResourceParser parseData:self.rle8Sample
+                                                  options:@{ RKResourceParserOptionPixelFormat : format }];
+        XCTAssertEqual(rle.sprites.count, 1, @"%@", format);
+        XCTAssertEqual(rle.sprites.firstObject.pixelBuffer.format, RKPixelFormat_RGBA8888, @"%@", format);
+    }
+}
+
+
+- (void)test_rle8_steppedWithSmallBudget_matchesParseData
+{
+    NSArray *optionSets = @[ @{},
+                             @{ RKResourceParserOptionPixelFormat : @(RKPixelFormat_RGB565),
+                                RKResourceParserOptionGenerateMipmaps : @YES } ];
+    for (NSDictionary *options in optionSets) {
+        RKRLEObject *expected = [RKRLEResourceParser parseData:self.largeRLE8Sample options:options];
+        NSUInteger steps = 0;
+        RKRLEObject *stepped = [self stepDecoderToCompletion:[RKRLEResourceParser incrementalDecoderForData:self.largeRLE8Sample options:options]
+                                                       steps:&steps];
+        XCTAssertGreaterThan(steps, 1);
+        
+        XCTAssertEqual(stepped.sprites.count, 16);
+        XCTAssertEqual(stepped.sprites.count, expected.sprites.count);
+        for (NSUInteger i = 0; i < MIN(stepped.sprites.count, expected.sprites.count); ++i) {
+            XCTAssertTrue([self pixelBuffer:stepped.sprites[i].pixelBuffer matchesPixelBuffer:expected.sprites[i].pixelBuffer],
+                          @"Frame %lu with options %@", (unsigned long)i, options);
+        }
+    }
+}
+
+
+#pragma mark - PICT Tests
+
+- (void)test_packBitsPict_decodesWithColorTable
+{
+    NSImage *image = [RKPictureResourceParser parseData:self.packBitsPictSample];
+    XCTAssertNotNil(image);
+    XCTAssertEqual(image.size.width, 8);
+    XCTAssertEqual(image.size.height, 2);
+    
+    NSData *render = [self renderImage:[image CGImageForProposedRect:NULL context:nil hints:nil]];
+    for (size_t x = 0; x < 8; ++x) {
+        XCTAssertEqual([self pixelAtX:x y:0 ofRender:render width:8], 0xFF0000FF);
+        XCTAssertEqual([self pixelAtX:x y:1 ofRender:render width:8], (x & 1) ? 0x0000FFFF : 0xFF0000FF);
+    }
+}
+
+- (void)test_packBitsPict_requestedDirectFormat_matchesIndexed
+{
+    NSImage *indexed = [RKPictureResourceParser parseData:self.packBitsPictSample];
+    NSImage *direct = [RKPictureResourceParser parseData:self.packBitsPictSample
+                                                 options:@{ RKResourceParserOptionPixelFormat : @(RKPixelFormat_BGRA8888) }];
+    
+    NSData *a = [self renderImage:[indexed CGImageForProposedRect:NULL context:nil hints:nil]];
+    NSData *b = [self renderImage:[direct CGImageForProposedRect:NULL context:nil hints:nil]];
+    XCTAssertEqualObjects(a, b);
+}
+
+- (void)test_packBitsPict_steppedWithSmallBudget_matchesParseData
+{
+    NSArray *optionSets = @[ @{},
+                             @{ RKResourceParserOptionPixelFormat : @(RKPixelFormat_BGRA8888),
+                                RKResourceParserOptionGenerateMipmaps : @YES } ];
+    for (NSDictionary *options in optionSets) {
+        NSImage *expected = [RKPictureResourceParser parseData:self.packBitsPictSample options:options];
+        NSUInteger steps = 0;
+        NSImage *stepped = [self stepDecoderToCompletion:[RKPictureResourceParser incrementalDecoderForData:self.packBitsPictSample options:options]
+                                                   steps:&steps];
+        
+        // Each scanline is a separate step once the budget has run out.
+        XCTAssertGreaterThan(steps, 1);
+        
+        NSData *a = [self renderImage:[expected CGImageForProposedRect:NULL context:nil hints:nil]];
+        NSData *b = [self renderImage:[stepped CGImageForProposedRect:NULL context:nil hints:nil]];
+        XCTAssertEqualObjects(a, b, @"%@", options);
+        XCTAssertEqual(stepped.representations.count, expected.representations.count);
+    }
+}
+
+- (void)test_packBitsPict_invalidFormatOption_matchesIndexed
+{
+    NSImage *indexed = [RKPictureResourceParser parseData:self.packBitsPictSample];
+    NSData *a = [self renderImage:[indexed CGImageForProposedRect:NULL context:nil hints:nil]];
+    
+    for (id format in @[ @99, @(-1), @"RGB565" ]) {
+        NSImage *direct = [RKPictureResourceParser parseData:self.packBitsPictSample
+                                                     options:@{ RKResourceParserOptionPixelFormat : format }];
+        XCTAssertNotNil(direct, @"%@", format);
+        NSData *b = [self renderImage:[direct CGImageForProposedRect:NULL context:nil hints:nil]];
+        XCTAssertEqualObjects(a, b, @"%@", format);
+    }
+}
+
+@end
@@ -0,0 +1,228 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKObjectCache.h"
+#import "RKResourceFork.h"
+#import "RKResource.h"
+#import "RKRezFixture.h"
+#import "RKResourceParserProtocol.h"
+#import <stdatomic.h>
+
+static atomic_int RKCountingParserParseCount = 0;
+
+// A parser that is slow enough for concurrent requests for an object to overlap, and
+// which counts how often it is asked to parse.
+@interface RKCountingParser : NSObject <RKResourceParserProtocol>
+@end
+
+@implementation RKCountingParser
+
++ (nullable id)parseData:(nonnull NSData *)data
+{
+    atomic_fetch_add(&RKCountingParserParseCount, 1);
+    [NSThread sleepForTimeInterval:0.05];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+@end
+
+
+// A parser registered at link time by the test bundle, which is neither ResourceKit nor
+// the main executable.
+@interface RKLinkedParser : NSObject <RKResourceParserProtocol>
+@end
+
+@implementation RKLinkedParser
+
+RK_REGISTER_PARSER(RKLinkedParser, "LNK#");
+
++ (nullable id)parseData:(nonnull NSData *)data
+{
+    return data;
+}
+
+@end
+
+
+@interface RKObjectCacheTests : XCTestCase
+@end
+
+@implementation RKObjectCacheTests
+
+- (void)test_objectCache_evictsLeastRecentlyUsed
+{
+    RKObjectCache *cache = [[RKObjectCache alloc] initWithByteBudget:300];
+    [cache setObject:@"a" forKey:1 cost:100];
+    [cache setObject:@"b" forKey:2 cost:100];
+    [cache setObject:@"c" forKey:3 cost:100];
+    
+    // Touching the oldest object makes the second the least recently used.
+    XCTAssertEqualObjects([cache objectForKey:1], @"a");
+    [cache setObject:@"d" forKey:4 cost:100];
+    
+    XCTAssertNil([cache objectForKey:2]);
+    XCTAssertEqualObjects([cache objectForKey:1], @"a");
+    XCTAssertEqualObjects([cache objectForKey:3], @"c");
+    XCTAssertEqualObjects([cache objectForKey:4], @"d");
+    XCTAssertEqual(cache.currentBytes, 300);
+    XCTAssertEqual(cache.hitCount, 4);
+    XCTAssertEqual(cache.missCount, 1);
+    XCTAssertEqual(cache.evictionCount, 1);
+}
+
+- (void)test_objectCache_loweringBudget_evicts
+{
+    RKObjectCache *cache = [[RKObjectCache alloc] initWithByteBudget:1000];
+    for (uint64_t key = 1; key <= 10; ++key) {
+        [cache setObject:@(key) forKey:key cost:100];
+    }
+    
+    cache.byteBudget = 250;
+    XCTAssertEqual(cache.count, 2);
+    XCTAssertEqual(cache.currentBytes, 200);
+    XCTAssertEqual(cache.evictionCount, 8);
+    XCTAssertNotNil([cache objectForKey:10]);
+    
+    // Objects bigger than the whole budget are never held.
+    [cache setObject:@"huge" forKey:11 cost:251];
+    XCTAssertNil([cache objectForKey:11]);
+    XCTAssertEqual(cache.count, 2);
+}
+
+- (void)test_objectCache_countersConsistentUnderConcurrency
+{
+    RKObjectCache *cache = [[RKObjectCache alloc] initWithByteBudget:1000];
+    for (uint64_t key = 0; key < 8; ++key) {
+        [cache setObject:@(key) forKey:key cost:100];
+    }
+    
+    // Keys 0 to 7 hit and 8 to 15 miss, while the counters are read from another thread.
+    const size_t lookups = 100000;
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (int i = 0; i < 10000; ++i) {
+            XCTAssertLessThanOrEqual(cache.hitCount + cache.missCount, lookups);
+            XCTAssertLessThanOrEqual(cache.currentBytes, 1000);
+        }
+    });
+    dispatch_apply(lookups, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+        [cache objectForKey:i % 16];
+    });
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    XCTAssertEqual(cache.hitCount, lookups / 2);
+    XCTAssertEqual(cache.missCount, lookups / 2);
+}
+
+- (void)test_resourceObject_isServedFromSharedCache
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"TEXT" id:128 name:@"Text" data:[@"text" dataUsingEncoding:NSUTF8StringEncoding]];
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKObjectCacheTests"]];
+    RKResource *resource = [resourceFork resourceOfType:@"TEXT" id:128];
+    
+    RKObjectCache *cache = RKObjectCache.sharedCache;
+    [resource flushCache];
+    [cache resetCounters];
+    
+    id first = resource.object;
+    id second = resource.object;
+    XCTAssertEqual(first, second);
+    XCTAssertEqual(cache.missCount, 1);
+    XCTAssertEqual(cache.hitCount, 1);
+    
+    [resource flushCache];
+    XCTAssertNotNil(resource.object);
+    XCTAssertEqual(cache.missCount, 2);
+}
+
+- (void)test_resourceObject_identicalPayloads_shareOneObject
+{
+    NSData *payload = [@"shared payload" dataUsingEncoding:NSUTF8StringEncoding];
+    RKRezFixture *base = [RKRezFixture new];
+    [base addResourceOfType:@"TEXT" id:128 name:@"Original" data:payload];
+    [base addResourceOfType:@"styl" id:128 name:@"Other type" data:payload];
+    RKRezFixture *plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"TEXT" id:1128 name:@"Copy" data:payload];
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[base writeToTemporaryFileNamed:@"RKObjectCacheDedupeBase"]];
+    [resourceFork addResourceFileAtPath:[plugIn writeToTemporaryFileNamed:@"RKObjectCacheDedupePlugIn"]];
+    RKResource *original = [resourceFork resourceOfType:@"TEXT" id:128];
+    RKResource *copy = [resourceFork resourceOfType:@"TEXT" id:1128];
+    RKResource *otherType = [resourceFork resourceOfType:@"styl" id:128];
+    XCTAssertEqual(original.contentHash, copy.contentHash);
+    XCTAssertEqual(original.contentHash, otherType.contentHash);
+    
+    RKObjectCache *cache = RKObjectCache.sharedCache;
+    [original flushCache];
+    [otherType flushCache];
+    [cache resetCounters];
+    
+    // The copy is served the object parsed for the original, but the same bytes as another
+    // type are parsed separately.
+    id object = original.object;
+    XCTAssertEqual(copy.object, object);
+    XCTAssertEqual(cache.missCount, 1);
+    XCTAssertEqual(cache.hitCount, 1);
+    XCTAssertNotNil(otherType.object);
+    XCTAssertEqual(cache.missCount, 2);
+}
+
+- (void)test_parserForType_findsParsersRegisteredByOtherImages
+{
+    XCTAssertEqual([RKResource parserForType:@"LNK#"], RKLinkedParser.class);
+}
+
+- (void)test_resourceObject_concurrentRequests_parseOnce
+{
+    [RKResource registerParser:RKCountingParser.class forType:@"CNT#"];
+    XCTAssertEqual([RKResource parserForType:@"CNT#"], RKCountingParser.class);
+    
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"CNT#" id:128 name:@"Count" data:[@"count" dataUsingEncoding:NSUTF8StringEncoding]];
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKObjectCacheConcurrencyTests"]];
+    RKResource *resource = [resourceFork resourceOfType:@"CNT#" id:128];
+    [resource flushCache];
+    atomic_store(&RKCountingParserParseCount, 0);
+    
+    const size_t requests = 32;
+    __strong id *objects = (__strong id *)calloc(requests, sizeof(id));
+    dispatch_apply(requests, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+        objects[i] = [resourceFork resourceOfType:@"CNT#" id:128].object;
+    });
+    
+    XCTAssertEqual(atomic_load(&RKCountingParserParseCount), 1);
+    for (size_t i = 0; i < requests; ++i) {
+        XCTAssertEqualObjects(objects[i], @"count");
+        XCTAssertEqual(objects[i], objects[0]);
+        objects[i] = nil;
+    }
+    free(objects);
+}
+
+@end
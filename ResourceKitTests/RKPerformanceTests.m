@@ -0,0 +1,840 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKResourceFork.h"
+#import "RKResource.h"
+#import "RKResourceParserProtocol.h"
+#import "RKPixelBuffer.h"
+#import "RKRezFixture.h"
+#import "RKResourceIndexCache.h"
+#import "RKResourceDiff.h"
+#import "RKRezWriter.h"
+#import <fcntl.h>
+#import <float.h>
+#import <unistd.h>
+#import <spawn.h>
+#import <sys/wait.h>
+#import <sys/mman.h>
+#import <mach/mach_time.h>
+#import <objc/runtime.h>
+#import <malloc/malloc.h>
+#import "RKFourCC.h"
+#import "RKIncrementalDecoderProtocol.h"
+
+/// The benchmarks run against real game data, which can not be shipped with the tests.
+/// Point OPENNOVA_DATA_PATH at an EV Nova data file, plug-in or a directory of them to run
+/// them. Without it they are skipped.
+static NSString * const RKPerformanceDataPathVariable = @"OPENNOVA_DATA_PATH";
+
+/// The number of synthetic plug-ins used by the loading benchmarks, and the shape of each.
+static const NSUInteger RKPerformancePlugInCount = 120;
+static const NSUInteger RKPerformancePlugInTypeCount = 24;
+static const NSUInteger RKPerformancePlugInResourceCount = 40;
+
+/// The number of synthetic plug-ins used by the merging benchmark, and the number of ids
+/// of the type that every one of them overrides.
+static const NSUInteger RKPerformanceOverridingPlugInCount = 50;
+static const NSUInteger RKPerformanceOverridingResourceCount = 2000;
+
+/// The number of synthetic plug-ins used by the presence filter benchmarks.
+static const NSUInteger RKPerformanceManyPlugInCount = 300;
+
+/// The number of resources in the single large type used by the listing benchmarks, and
+/// the size of each.
+static const NSUInteger RKPerformanceLargeTypeCount = 30000;
+static const NSUInteger RKPerformanceLargeTypeResourceSize = 64;
+
+@interface RKPerformanceTests : XCTestCase
+@end
+
+@implementation RKPerformanceTests
+
+#pragma mark - Game Data
+
+- (nullable NSArray <NSString *> *)benchmarkDataPaths
+{
+    NSString *path = NSProcessInfo.processInfo.environment[RKPerformanceDataPathVariable];
+    if (path.length == 0) {
+        NSLog(@"%@ is not set. Skipping benchmark.", RKPerformanceDataPathVariable);
+        return nil;
+    }
+    
+    BOOL isDirectory = NO;
+    if (![NSFileManager.defaultManager fileExistsAtPath:path isDirectory:&isDirectory] || !isDirectory) {
+        return @[path];
+    }
+    
+    NSMutableArray <NSString *> *paths = [NSMutableArray new];
+    NSArray <NSString *> *files = [[NSFileManager.defaultManager contentsOfDirectoryAtPath:path error:nil] sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString *file in files) {
+        [paths addObject:[path stringByAppendingPathComponent:file]];
+    }
+    return paths.copy;
+}
+
+- (nullable RKResourceFork *)benchmarkResourceFork
+{
+    NSArray <NSString *> *paths = self.benchmarkDataPaths;
+    if (!paths) {
+        return nil;
+    }
+    
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    if ([fork addResourceFilesAtPaths:paths].count == 0) {
+        XCTFail(@"Failed to open any benchmark data files: %@", paths);
+        return nil;
+    }
+    return fork;
+}
+
+
+#pragma mark - Mipmaps
+
+- (void)measureDecodingOfType:(NSString *)type options:(NSDictionary<NSString *, id> *)options
+{
+    NSArray<RKResource *> *resources = [self.benchmarkResourceFork resourcesOfType:type];
+    if (resources.count == 0) {
+        return;
+    }
+    
+    [self measureBlock:^{
+        for (RKResource *resource in resources) {
+            @autoreleasepool {
+                [resource objectWithOptions:options];
+            }
+        }
+    }];
+}
+
+- (void)test_performance_decodeEveryRleD
+{
+    [self measureDecodingOfType:@"rlëD" options:@{
+        RKResourceParserOptionPixelFormat : @(RKPixelFormat_RGBA8888),
+    }];
+}
+
+- (void)test_performance_decodeEveryRleD_withMipmaps
+{
+    [self measureDecodingOfType:@"rlëD" options:@{
+        RKResourceParserOptionPixelFormat : @(RKPixelFormat_RGBA8888),
+        RKResourceParserOptionGenerateMipmaps : @YES,
+    }];
+}
+
+
+
+#pragma mark - Plug-in Loading
+
+/// Writes a directory of synthetic plug-ins. Each plug-in shares most of its types with
+/// the others and overlaps half of its ids with the plug-in before it, so that merging
+/// has real overrides to resolve.
++ (NSArray <NSString *> *)plugInPaths
+{
+    static NSArray <NSString *> *paths = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray <NSString *> *plugInPaths = [NSMutableArray new];
+        NSMutableData *payload = [NSMutableData dataWithLength:512];
+        
+        for (NSUInteger plugIn = 0; plugIn < RKPerformancePlugInCount; ++plugIn) {
+            RKRezFixture *fixture = [RKRezFixture new];
+            for (NSUInteger type = 0; type < RKPerformancePlugInTypeCount; ++type) {
+                NSString *typeCode = [NSString stringWithFormat:@"t%03lu", (unsigned long)(type + plugIn % 4)];
+                for (NSUInteger i = 0; i < RKPerformancePlugInResourceCount; ++i) {
+                    int16_t resourceId = (int16_t)(128 + plugIn * RKPerformancePlugInResourceCount / 2 + i);
+                    [fixture addResourceOfType:typeCode
+                                            id:resourceId
+                                          name:[NSString stringWithFormat:@"Plug-in %lu resource %d", (unsigned long)plugIn, resourceId]
+                                          data:payload];
+                }
+            }
+            [plugInPaths addObject:[fixture writeToTemporaryFileNamed:[NSString stringWithFormat:@"RKPerformancePlugIn-%03lu", (unsigned long)plugIn]]];
+        }
+        paths = plugInPaths.copy;
+    });
+    return paths;
+}
+
+/// Purge the file cache, so that files are read from disk the next time they are loaded.
+/// macOS has no way for an unprivileged process to evict the pages of a single file, as
+/// msync with MS_INVALIDATE leaves clean pages cached, so this runs purge, which only
+/// succeeds when the tests are run as root. Returns whether the cache was purged.
+static BOOL RKPurgeFileCache(void)
+{
+    char *arguments[] = { "/usr/sbin/purge", NULL };
+    pid_t pid = 0;
+    int status = 0;
+    if (posix_spawn(&pid, arguments[0], NULL, NULL, arguments, NULL) != 0 || waitpid(pid, &status, 0) != pid) {
+        return NO;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double RKSecondsToLoadPlugIns(NSArray <NSString *> *paths, NSUInteger threads)
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    
+    uint64_t start = mach_absolute_time();
+    @autoreleasepool {
+        [[RKResourceFork emptyResourceFork] addResourceFilesAtPaths:paths maximumConcurrency:threads];
+    }
+    uint64_t elapsed = (mach_absolute_time() - start) * timebase.numer / timebase.denom;
+    return (double)elapsed / NSEC_PER_SEC;
+}
+
+- (void)test_performance_loadPlugIns_scalingWithThreadCount
+{
+    NSArray <NSString *> *paths = self.class.plugInPaths;
+    NSUInteger maximumThreads = NSProcessInfo.processInfo.activeProcessorCount;
+    const int samples = 5;
+    
+    // Without purging the cache every load is warm, so only the warm column is reported.
+    BOOL purged = RKPurgeFileCache();
+    NSLog(@"Loading %lu plug-ins:", (unsigned long)paths.count);
+    if (!purged) {
+        NSLog(@"Unable to purge the file cache without running as root. Cold loads are not measured.");
+    }
+    NSLog(@"%8s %12s %12s", "threads", "cold (ms)", "warm (ms)");
+    
+    for (NSUInteger threads = 1; threads <= maximumThreads; ++threads) {
+        double cold = DBL_MAX;
+        double warm = DBL_MAX;
+        for (int sample = 0; sample < samples; ++sample) {
+            if (purged && RKPurgeFileCache()) {
+                cold = MIN(cold, RKSecondsToLoadPlugIns(paths, threads));
+            }
+            warm = MIN(warm, RKSecondsToLoadPlugIns(paths, threads));
+        }
+        if (cold == DBL_MAX) {
+            NSLog(@"%8lu %12s %12.2f", (unsigned long)threads, "-", warm * 1000);
+        }
+        else {
+            NSLog(@"%8lu %12.2f %12.2f", (unsigned long)threads, cold * 1000, warm * 1000);
+        }
+    }
+}
+
+- (void)test_performance_loadPlugIns_serial
+{
+    NSArray <NSString *> *paths = self.class.plugInPaths;
+    [self measureBlock:^{
+        RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+        for (NSString *path in paths) {
+            [fork addResourceFileAtPath:path];
+        }
+    }];
+}
+
+- (void)test_performance_loadPlugIns_parallel
+{
+    NSArray <NSString *> *paths = self.class.plugInPaths;
+    [self measureBlock:^{
+        [[RKResourceFork emptyResourceFork] addResourceFilesAtPaths:paths];
+    }];
+}
+
+
+/// Writes plug-ins that all override the same ids of a single type, as plug-ins that
+/// rebalance the same ships do, each also adding a few ids of its own.
++ (NSArray <NSString *> *)overridingPlugInPaths
+{
+    static NSArray <NSString *> *paths = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray <NSString *> *plugInPaths = [NSMutableArray new];
+        NSMutableData *payload = [NSMutableData dataWithLength:64];
+        
+        for (NSUInteger plugIn = 0; plugIn < RKPerformanceOverridingPlugInCount; ++plugIn) {
+            RKRezFixture *fixture = [RKRezFixture new];
+            for (NSUInteger i = RKPerformanceOverridingResourceCount; i-- > 0;) {
+                [fixture addResourceOfType:@"shïp" id:(int16_t)(128 + i) name:nil data:payload];
+            }
+            for (NSUInteger i = 0; i < 8; ++i) {
+                int16_t resourceId = (int16_t)(128 + RKPerformanceOverridingResourceCount + plugIn * 8 + i);
+                [fixture addResourceOfType:@"shïp" id:resourceId name:nil data:payload];
+            }
+            [plugInPaths addObject:[fixture writeToTemporaryFileNamed:[NSString stringWithFormat:@"RKPerformanceOverridingPlugIn-%03lu", (unsigned long)plugIn]]];
+        }
+        paths = plugInPaths.copy;
+    });
+    return paths;
+}
+
+- (void)test_performance_mergeOverridingPlugIns
+{
+    NSArray <NSString *> *paths = self.class.overridingPlugInPaths;
+    NSUInteger expected = RKPerformanceOverridingResourceCount + RKPerformanceOverridingPlugInCount * 8;
+    [self measureBlock:^{
+        @autoreleasepool {
+            RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+            for (NSString *path in paths) {
+                [fork addResourceFileAtPath:path];
+            }
+            XCTAssertEqual([fork handlesOfTypeCode:RKFourCCFromString(@"shïp")].length / sizeof(RKResourceHandle), expected);
+        }
+    }];
+}
+
+
+
+#pragma mark - Presence Filters
+
+/// Writes many small plug-ins, each with a few types out of a larger set and ids that
+/// only some of the others share, as a large collection of plug-ins tends to be.
++ (NSArray <NSString *> *)manyPlugInPaths
+{
+    static NSArray <NSString *> *paths = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray <NSString *> *plugInPaths = [NSMutableArray new];
+        NSMutableData *payload = [NSMutableData dataWithLength:16];
+        
+        for (NSUInteger plugIn = 0; plugIn < RKPerformanceManyPlugInCount; ++plugIn) {
+            RKRezFixture *fixture = [RKRezFixture new];
+            for (NSUInteger type = 0; type < 3; ++type) {
+                NSString *typeCode = [NSString stringWithFormat:@"f%03lu", (unsigned long)((plugIn + type * 5) % 16)];
+                for (NSUInteger i = 0; i < 40; ++i) {
+                    [fixture addResourceOfType:typeCode id:(int16_t)(128 + (plugIn % 50) * 20 + i) name:nil data:payload];
+                }
+            }
+            [plugInPaths addObject:[fixture writeToTemporaryFileNamed:[NSString stringWithFormat:@"RKPerformanceManyPlugIn-%03lu", (unsigned long)plugIn]]];
+        }
+        paths = plugInPaths.copy;
+    });
+    return paths;
+}
+
+/// Looks up a fixed spread of keys, most of which only a handful of files have.
+static NSUInteger RKLookUpManyKeys(NSUInteger (^lookUp)(RKFourCC type, int16_t id))
+{
+    NSUInteger found = 0;
+    for (NSUInteger type = 0; type < 16; ++type) {
+        RKFourCC code = RKFourCCFromString([NSString stringWithFormat:@"f%03lu", (unsigned long)type]);
+        for (int16_t id = 128; id < 1128; id += 7) {
+            found += lookUp(code, id);
+        }
+    }
+    return found;
+}
+
+- (void)test_performance_lookUpInManyPlugIns_filtered
+{
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    [fork addResourceFilesAtPaths:self.class.manyPlugInPaths];
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            NSUInteger found = RKLookUpManyKeys(^NSUInteger(RKFourCC type, int16_t resourceId) {
+                return [fork resourceFilesContainingResourceOfTypeCode:type id:resourceId].count;
+            });
+            XCTAssertGreaterThan(found, 0);
+        }
+    }];
+}
+
+- (void)test_performance_lookUpInManyPlugIns_unfiltered
+{
+    // The same lookups, asking every file in turn as there would be without the filters.
+    NSArray <id<RKResourceFileProtocol>> *files = [[RKResourceFork emptyResourceFork] addResourceFilesAtPaths:self.class.manyPlugInPaths];
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            NSUInteger found = RKLookUpManyKeys(^NSUInteger(RKFourCC type, int16_t resourceId) {
+                NSUInteger count = 0;
+                for (id <RKResourceFileProtocol> file in files) {
+                    NSData *entries = [file resourceEntriesOfTypeCode:type];
+                    const RKResourceEntry *entry = entries.bytes;
+                    for (NSUInteger i = 0; i < entries.length / sizeof(*entry); ++i) {
+                        count += (entry[i].id == resourceId);
+                    }
+                }
+                return count;
+            });
+            XCTAssertGreaterThan(found, 0);
+        }
+    }];
+}
+
+
+#pragma mark - Index Cache
+
+- (void)measureStartupWithIndexCacheWarm:(BOOL)warm
+{
+    NSArray <NSString *> *paths = self.benchmarkDataPaths;
+    if (!paths) {
+        return;
+    }
+    
+    // Caches are kept out of the data directory so the benchmark never writes into it.
+    NSString *cacheDirectory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RKPerformanceIndexCache"];
+    [NSFileManager.defaultManager removeItemAtPath:cacheDirectory error:nil];
+    [NSFileManager.defaultManager createDirectoryAtPath:cacheDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    RKResourceIndexCache.enabled = YES;
+    RKResourceIndexCache.cacheDirectory = cacheDirectory;
+    
+    // Opening a file is only the start of the work, so the benchmark also lists every
+    // resource, just as the game does when it builds its object tables.
+    void (^startup)(void) = ^{
+        RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+        [fork addResourceFilesAtPaths:paths];
+        for (NSString *type in fork.allTypes) {
+            [fork resourcesOfType:type];
+        }
+    };
+    
+    if (warm) {
+        startup();
+    }
+    
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        if (!warm) {
+            [NSFileManager.defaultManager removeItemAtPath:cacheDirectory error:nil];
+            [NSFileManager.defaultManager createDirectoryAtPath:cacheDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+        }
+        
+        [self startMeasuring];
+        startup();
+        [self stopMeasuring];
+    }];
+    
+    RKResourceIndexCache.enabled = NO;
+    RKResourceIndexCache.cacheDirectory = nil;
+    [NSFileManager.defaultManager removeItemAtPath:cacheDirectory error:nil];
+}
+
+- (void)test_performance_startup_coldIndexCache
+{
+    [self measureStartupWithIndexCacheWarm:NO];
+}
+
+- (void)test_performance_startup_warmIndexCache
+{
+    [self measureStartupWithIndexCacheWarm:YES];
+}
+
+
+
+#pragma mark - Parser Registration
+
+// The work that the first resource created used to trigger: asking every class in the
+// process whether it implements +register.
+static NSUInteger RKScanClassesForRegistration(void)
+{
+    NSUInteger found = 0;
+    unsigned int classCount = 0;
+    Class *classes = objc_copyClassList(&classCount);
+    for (unsigned int i = 0; i < classCount; ++i) {
+        if (class_getClassMethod(classes[i], @selector(register))) {
+            found++;
+        }
+    }
+    free(classes);
+    return found;
+}
+
+- (void)test_performance_timeToFirstResource_parserRegistration
+{
+    // The registration section is read by the first parser lookup in the process, so this
+    // is only measured if no earlier test has looked up a parser. Run the test on its own
+    // to be sure of that.
+    RKFourCC code = RKFourCCFromString(@"rlëD");
+    uint64_t start = RKDecodeClock();
+    Class firstParser = [RKResource parserForTypeCode:code];
+    uint64_t firstLookup = RKDecodeClock() - start;
+    XCTAssertNotNil(firstParser);
+    
+    const int samples = 5;
+    uint64_t scan = UINT64_MAX;
+    NSUInteger scanned = 0;
+    for (int sample = 0; sample < samples; ++sample) {
+        start = RKDecodeClock();
+        scanned = RKScanClassesForRegistration();
+        scan = MIN(scan, RKDecodeClock() - start);
+    }
+    
+    unsigned int classCount = 0;
+    free(objc_copyClassList(&classCount));
+    NSLog(@"Class scan of %u classes: %.3fms (%lu found)", classCount, scan / 1e6, (unsigned long)scanned);
+    NSLog(@"First parser lookup, including loading the registrations: %.3fms", firstLookup / 1e6);
+    
+    const NSUInteger lookups = 1000000;
+    Class parser = nil;
+    start = RKDecodeClock();
+    for (NSUInteger i = 0; i < lookups; ++i) {
+        parser = [RKResource parserForTypeCode:code];
+    }
+    NSLog(@"Parser lookup by type code: %.1fns", (double)(RKDecodeClock() - start) / lookups);
+    XCTAssertEqual(parser, firstParser);
+    
+    start = RKDecodeClock();
+    for (NSUInteger i = 0; i < lookups; ++i) {
+        parser = [RKResource parserForType:@"rlëD"];
+    }
+    NSLog(@"Parser lookup by type string: %.1fns", (double)(RKDecodeClock() - start) / lookups);
+    XCTAssertEqual(parser, firstParser);
+}
+
+
+
+#pragma mark - Resource Handles
+
+- (NSString *)largeTypeFixturePath
+{
+    static NSString *path = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        RKRezFixture *fixture = [RKRezFixture new];
+        NSData *payload = [NSMutableData dataWithLength:RKPerformanceLargeTypeResourceSize];
+        for (NSUInteger i = 0; i < RKPerformanceLargeTypeCount; ++i) {
+            // Like the descriptions of a large plug-in, most have a short name and some none.
+            NSString *name = (i % 4) ? [NSString stringWithFormat:@"Description %lu", (unsigned long)i] : nil;
+            [fixture addResourceOfType:@"dësc" id:(int16_t)(128 + i) name:name data:payload];
+        }
+        path = [fixture writeToTemporaryFileNamed:@"RKPerformanceLargeType"];
+    });
+    return path;
+}
+
+- (void)measureListingOfLargeTypeUsingBlock:(uint64_t (^)(RKResourceFork *fork))block
+{
+    NSString *path = self.largeTypeFixturePath;
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        @autoreleasepool {
+            // Each pass opens the file again, so no resources are left over from the last.
+            RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+            [fork addResourceFileAtPath:path];
+            
+            [self startMeasuring];
+            uint64_t bytes = block(fork);
+            [self stopMeasuring];
+            XCTAssertEqual(bytes, RKPerformanceLargeTypeCount * RKPerformanceLargeTypeResourceSize);
+        }
+    }];
+}
+
+static uint64_t RKListResourceObjects(RKResourceFork *fork)
+{
+    uint64_t bytes = 0;
+    for (RKResource *resource in [fork resourcesOfType:@"dësc"]) {
+        bytes += resource.size;
+    }
+    return bytes;
+}
+
+static uint64_t RKListResourceHandles(RKResourceFork *fork)
+{
+    NSData *handles = [fork handlesOfTypeCode:RKFourCCFromString(@"dësc")];
+    const RKResourceHandle *handle = handles.bytes;
+    uint64_t bytes = 0;
+    for (NSUInteger i = 0; i < handles.length / sizeof(*handle); ++i) {
+        bytes += [fork sizeOfResource:handle[i]];
+    }
+    return bytes;
+}
+
+- (void)test_performance_listLargeType_resourceObjects
+{
+    [self measureListingOfLargeTypeUsingBlock:^uint64_t(RKResourceFork *fork) {
+        return RKListResourceObjects(fork);
+    }];
+}
+
+- (void)test_performance_listLargeType_handles
+{
+    [self measureListingOfLargeTypeUsingBlock:^uint64_t(RKResourceFork *fork) {
+        return RKListResourceHandles(fork);
+    }];
+}
+
+// Adds the heap block of the pointer to the total, unless it was already counted. Pointers
+// that are not heap blocks, such as tagged pointers and constant strings, have no size.
+static size_t RKCountHeapBlock(const void *pointer, NSMutableSet <NSValue *> *counted)
+{
+    NSValue *key = [NSValue valueWithPointer:pointer];
+    if (!pointer || [counted containsObject:key]) {
+        return 0;
+    }
+    [counted addObject:key];
+    return malloc_size(pointer);
+}
+
+// The bytes held by the structures that listing through resource objects produces: the
+// array, every resource and the type and name strings they keep. Process-wide malloc
+// statistics also pick up one-time and unrelated allocations, so only these are counted.
+// The slots of the dictionaries that keep the resources are not reachable from here, which
+// makes this a lower bound.
+static size_t RKBytesHeldByResourceObjects(RKResourceFork *fork)
+{
+    NSMutableSet <NSValue *> *counted = [NSMutableSet set];
+    NSArray <RKResource *> *resources = [fork resourcesOfType:@"dësc"];
+    size_t bytes = RKCountHeapBlock((__bridge const void *)resources, counted);
+    for (RKResource *resource in resources) {
+        bytes += RKCountHeapBlock((__bridge const void *)resource, counted);
+        bytes += RKCountHeapBlock((__bridge const void *)resource.type, counted);
+        bytes += RKCountHeapBlock((__bridge const void *)resource.name, counted);
+    }
+    return bytes;
+}
+
+// The bytes held by the handles of the type, which the fork builds as it loads its files.
+static size_t RKBytesHeldByResourceHandles(RKResourceFork *fork)
+{
+    NSMutableSet <NSValue *> *counted = [NSMutableSet set];
+    NSData *handles = [fork handlesOfTypeCode:RKFourCCFromString(@"dësc")];
+    return RKCountHeapBlock((__bridge const void *)handles, counted) + RKCountHeapBlock(handles.bytes, counted);
+}
+
+- (void)test_memory_listLargeType_bytesPerResource
+{
+    // Each is measured on a fork of its own, so neither sees resources the other created.
+    RKResourceFork *objectsFork = [RKResourceFork emptyResourceFork];
+    [objectsFork addResourceFileAtPath:self.largeTypeFixturePath];
+    RKResourceFork *handlesFork = [RKResourceFork emptyResourceFork];
+    [handlesFork addResourceFileAtPath:self.largeTypeFixturePath];
+    
+    size_t objects = RKBytesHeldByResourceObjects(objectsFork);
+    size_t handles = RKBytesHeldByResourceHandles(handlesFork);
+    
+    NSLog(@"Listed through resource objects: %.1f bytes per resource", (double)objects / RKPerformanceLargeTypeCount);
+    NSLog(@"Listed through handles: %.1f bytes per resource", (double)handles / RKPerformanceLargeTypeCount);
+    XCTAssertGreaterThan(handles, 0);
+    XCTAssertLessThan(handles, objects);
+}
+
+
+
+#pragma mark - Enumeration
+
+static uint64_t RKEnumerateResources(RKResourceFork *fork, RKFourCC type)
+{
+    __block uint64_t bytes = 0;
+    [fork enumerateResourcesOfTypeCode:type idRange:RKResourceIdRangeAll usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+        bytes += info->data.length;
+    }];
+    return bytes;
+}
+
+- (void)test_performance_enumerateLargeType
+{
+    RKFourCC type = RKFourCCFromString(@"dësc");
+    [self measureListingOfLargeTypeUsingBlock:^uint64_t(RKResourceFork *fork) {
+        return RKEnumerateResources(fork, type);
+    }];
+}
+
+- (void)test_memory_enumerateLargeType_allocatesNothing
+{
+    RKFourCC type = RKFourCCFromString(@"dësc");
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    id <RKResourceFileProtocol> file = [fork addResourceFileAtPath:self.largeTypeFixturePath];
+    
+    // The first pass lists the handles of the type and maps the file, after which a pass
+    // should not allocate at all.
+    XCTAssertEqual(RKEnumerateResources(fork, type), RKPerformanceLargeTypeCount * RKPerformanceLargeTypeResourceSize);
+    
+    // What enumeration could allocate for each resource is its resource object, so none
+    // may have been created.
+    for (NSUInteger i = 0; i < RKPerformanceLargeTypeCount; ++i) {
+        XCTAssertNil([file existingResourceOfTypeCode:type id:(int16_t)(128 + i)]);
+    }
+    
+    // Malloc statistics cover the whole process, so other threads may allocate meanwhile
+    // and the count is not expected to stay exactly the same. Over many passes, even one
+    // block for every hundred resources would still stand out from that.
+    const NSUInteger passes = 10;
+    malloc_statistics_t before, after;
+    malloc_zone_statistics(NULL, &before);
+    uint64_t bytes = 0;
+    for (NSUInteger pass = 0; pass < passes; ++pass) {
+        bytes += RKEnumerateResources(fork, type);
+    }
+    malloc_zone_statistics(NULL, &after);
+    
+    XCTAssertEqual(bytes, passes * RKPerformanceLargeTypeCount * RKPerformanceLargeTypeResourceSize);
+    size_t blocks = after.blocks_in_use > before.blocks_in_use ? after.blocks_in_use - before.blocks_in_use : 0;
+    XCTAssertLessThan(blocks, passes * RKPerformanceLargeTypeCount / 100);
+}
+
+
+#pragma mark - Snapshots
+
+- (void)test_performance_lookUpWhileLoadingPlugIns
+{
+    NSArray <NSString *> *paths = self.class.plugInPaths;
+    NSString *path = self.largeTypeFixturePath;
+    RKFourCC type = RKFourCCFromString(@"dësc");
+    
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+        [fork addResourceFileAtPath:path];
+        
+        // The plug-ins are merged on another thread the whole time the lookups are running.
+        dispatch_group_t group = dispatch_group_create();
+        dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            for (NSString *plugInPath in paths) {
+                [fork addResourceFileAtPath:plugInPath];
+            }
+        });
+        
+        [self startMeasuring];
+        NSUInteger found = 0;
+        for (NSUInteger i = 0; i < 1000000; ++i) {
+            found += [fork handleOfResourceOfTypeCode:type id:(int16_t)(128 + i % RKPerformanceLargeTypeCount)] != RKResourceHandleNotFound;
+        }
+        [self stopMeasuring];
+        
+        XCTAssertEqual(found, 1000000);
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    }];
+}
+
+
+
+#pragma mark - Diff
+
+static const NSUInteger RKPerformanceDiffIdsPerType = 50000;
+
+- (NSString *)diffFixturePathWithChangesEvery:(NSUInteger)stride named:(NSString *)name
+{
+    // Two types of 50,000 resources each, with every stride-th payload given a different
+    // byte but the same size, so only hashing can find them.
+    RKRezFixture *fixture = [RKRezFixture new];
+    for (NSString *type in @[@"dësc", @"mïsn"]) {
+        for (NSUInteger i = 0; i < RKPerformanceDiffIdsPerType; ++i) {
+            uint32_t payload[8] = { (uint32_t)i, 0, 0, 0, 0, 0, 0, (stride && i % stride == 0) ? 1 : 0 };
+            [fixture addResourceOfType:type id:(int16_t)(i - 25000) name:nil data:[NSData dataWithBytes:payload length:sizeof(payload)]];
+        }
+    }
+    return [fixture writeToTemporaryFileNamed:name];
+}
+
+- (void)test_performance_diffLargeFiles
+{
+    NSString *oldPath = [self diffFixturePathWithChangesEvery:0 named:@"RKPerformanceDiffOld"];
+    NSString *newPath = [self diffFixturePathWithChangesEvery:100 named:@"RKPerformanceDiffNew"];
+    
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        RKResourceFork *oldFork = [RKResourceFork emptyResourceFork];
+        RKResourceFork *newFork = [RKResourceFork emptyResourceFork];
+        [oldFork addResourceFileAtPath:oldPath];
+        [newFork addResourceFileAtPath:newPath];
+        
+        [self startMeasuring];
+        uint64_t start = RKDecodeClock();
+        RKResourceChangeSet *changes = [RKResourceDiff changesFromResourceFork:oldFork toResourceFork:newFork];
+        uint64_t elapsed = RKDecodeClock() - start;
+        [self stopMeasuring];
+        
+        XCTAssertEqual(changes.changedResources.length / sizeof(RKResourceKey), 2 * RKPerformanceDiffIdsPerType / 100);
+        XCTAssertEqual(changes.addedResources.length + changes.removedResources.length, 0);
+        XCTAssertLessThan(elapsed, NSEC_PER_SEC);
+    }];
+}
+
+
+
+#pragma mark - Rez Layout
+
+static const NSUInteger RKPerformanceLayoutIdsPerType = 4000;
+static const NSUInteger RKPerformanceLayoutResourceSize = 1024;
+
+// Both layouts use the same alignment, so that only the order of the data differs.
+static const uint32_t RKPerformanceLayoutAlignment = 16;
+
+- (NSString *)layoutFixturePathWithLayout:(RKRezLayout)layout named:(NSString *)name
+{
+    RKRezWriter *writer = [RKRezWriter new];
+    writer.layout = layout;
+    writer.alignment = RKPerformanceLayoutAlignment;
+    
+    // The resources of four types are added in a scattered but repeatable order, as a
+    // plug-in is left after many rounds of editing. 7919 is coprime with the total, so
+    // stepping by it visits every resource once.
+    NSArray <NSString *> *types = @[@"dësc", @"mïsn", @"shïp", @"wëap"];
+    NSUInteger total = types.count * RKPerformanceLayoutIdsPerType;
+    NSMutableData *payload = [NSMutableData dataWithLength:RKPerformanceLayoutResourceSize];
+    for (NSUInteger n = 0; n < total; ++n) {
+        NSUInteger i = (n * 7919) % total;
+        ((uint32_t *)payload.mutableBytes)[0] = (uint32_t)i;
+        [writer addResourceOfType:types[i % types.count] id:(int16_t)(128 + i / types.count) name:nil data:payload];
+    }
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"rez"]];
+    XCTAssertTrue([writer writeToFile:path]);
+    return path;
+}
+
+static uint64_t RKReadEveryResource(RKResourceFork *fork, RKFourCC type)
+{
+    // Every cache line of the data is read, as a batch load that parses each resource would.
+    __block uint64_t sum = 0;
+    [fork enumerateResourcesOfTypeCode:type idRange:RKResourceIdRangeAll usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+        const uint8_t *bytes = info->data.bytes;
+        for (NSUInteger i = 0; i < info->data.length; i += 64) {
+            sum += bytes[i];
+        }
+        sum += info->data.length;
+    }];
+    return sum;
+}
+
+- (void)measureBatchLoadOfRezFileAtPath:(NSString *)path
+{
+    // Each pass evicts the file first, so that the data of the type is read from disk,
+    // which is where its layout matters most. When the file cache can not be purged the
+    // data stays cached, and the passes only measure the locality of the page faults.
+    RKFourCC type = RKFourCCFromString(@"dësc");
+    __block BOOL cold = YES;
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        @autoreleasepool {
+            // Each pass maps the file again, so that every page the type touches is faulted in.
+            RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+            [fork addResourceFileAtPath:path];
+            cold = RKPurgeFileCache() && cold;
+            
+            [self startMeasuring];
+            uint64_t sum = RKReadEveryResource(fork, type);
+            [self stopMeasuring];
+            XCTAssertGreaterThanOrEqual(sum, RKPerformanceLayoutIdsPerType * RKPerformanceLayoutResourceSize);
+        }
+    }];
+    NSLog(@"Batch load of %@ read %@", path.lastPathComponent, cold ? @"from disk" : @"from the file cache, measuring only page fault locality");
+}
+
+- (void)test_performance_batchLoad_originalLayout
+{
+    [self measureBatchLoadOfRezFileAtPath:[self layoutFixturePathWithLayout:RKRezLayoutAsAdded named:@"RKPerformanceLayoutOriginal"]];
+}
+
+- (void)test_performance_batchLoad_reorderedLayout
+{
+    [self measureBatchLoadOfRezFileAtPath:[self layoutFixturePathWithLayout:RKRezLayoutByTypeAndId named:@"RKPerformanceLayoutReordered"]];
+}
+
+@end
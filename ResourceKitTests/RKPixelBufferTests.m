@@ -0,0 +1,145 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKPixelBuffer.h"
+#import "PixelStorage.h"
+
+@interface RKPixelBufferTests : XCTestCase
+@end
+
+@implementation RKPixelBufferTests
+
+#pragma mark - Pixel Storage
+
+- (void)test_pixelStorage_roundsUpToBucketAndAligns
+{
+    PixelStorage *storage = PixelStorageCreate(1500);
+    XCTAssertTrue(storage != NULL);
+    XCTAssertEqual(storage->capacity, 2048);
+    XCTAssertEqual((uintptr_t)storage->bytes % 64, 0);
+    XCTAssertEqual(atomic_load(&storage->retainCount), 1);
+    PixelStorageRelease(storage);
+}
+
+- (void)test_pixelStorage_releasedStorageIsRecycledZeroed
+{
+    PixelStoragePoolDrain();
+    PixelStorage *first = PixelStorageCreate(4000);
+    memset(first->bytes, 0xAB, 4000);
+    PixelStorageRelease(first);
+    
+    // A request for the same bucket is served by the block that was just released, with
+    // the requested bytes cleared again.
+    PixelStorage *second = PixelStorageCreate(3000);
+    XCTAssertEqual(second, first);
+    for (size_t i = 0; i < 3000; ++i) {
+        if (second->bytes[i] != 0) {
+            XCTFail(@"Byte %zu of recycled storage was not cleared", i);
+            break;
+        }
+    }
+    PixelStorageRelease(second);
+    PixelStoragePoolDrain();
+}
+
+- (void)test_pixelStorage_retainedStorageIsNotRecycled
+{
+    PixelStoragePoolDrain();
+    PixelStorage *storage = PixelStorageRetain(PixelStorageCreate(1024));
+    PixelStorageRelease(storage);
+    
+    PixelStorage *other = PixelStorageCreate(1024);
+    XCTAssertNotEqual(other, storage);
+    PixelStorageRelease(other);
+    PixelStorageRelease(storage);
+    PixelStoragePoolDrain();
+}
+
+
+#pragma mark - Pixel Buffers
+
+- (void)test_pixelBuffer_rowsArePaddedTo16Bytes
+{
+    RKPixelBuffer *rgba = [RKPixelBuffer pixelBufferWithWidth:5 height:3 format:RKPixelFormat_RGBA8888];
+    XCTAssertEqual(rgba.stride, 32);
+    XCTAssertEqual([rgba rowAtIndex:2] - [rgba rowAtIndex:0], 64);
+    XCTAssertEqual(rgba.byteLength, 96);
+    
+    RKPixelBuffer *rgb565 = [RKPixelBuffer pixelBufferWithWidth:3 height:1 format:RKPixelFormat_RGB565];
+    XCTAssertEqual(rgb565.stride, 16);
+}
+
+- (void)test_pixelBuffer_mipLevelsFollowOneAnother
+{
+    RKPixelBuffer *buffer = [RKPixelBuffer pixelBufferWithWidth:5 height:3 format:RKPixelFormat_RGBA8888 mipmapped:YES];
+    XCTAssertEqual(buffer.levelCount, 3);
+    
+    // 5x3, then 2x1, then 1x1, each level starting where the one before it ends.
+    XCTAssertEqual([buffer widthOfLevel:1], 2);
+    XCTAssertEqual([buffer heightOfLevel:1], 1);
+    XCTAssertEqual([buffer widthOfLevel:2], 1);
+    XCTAssertEqual([buffer heightOfLevel:2], 1);
+    XCTAssertEqual([buffer strideOfLevel:1], 16);
+    XCTAssertEqual([buffer bytesOfLevel:1] - buffer.bytes, 32 * 3);
+    XCTAssertEqual([buffer bytesOfLevel:2] - buffer.bytes, 32 * 3 + 16);
+    XCTAssertEqual(buffer.byteLength, 32 * 3 + 16 + 16);
+}
+
+- (void)test_pixelBuffer_indexedIsNeverMipmapped
+{
+    RKPixelBuffer *buffer = [RKPixelBuffer pixelBufferWithWidth:8 height:8 format:RKPixelFormat_Indexed8 mipmapped:YES];
+    XCTAssertEqual(buffer.levelCount, 1);
+}
+
+- (void)test_pixelBuffer_externalStorage_releasesOwnerAfterLastUser
+{
+    __weak NSData *weakOwner = nil;
+    CGImageRef image = NULL;
+    
+    @autoreleasepool {
+        void *bytes = NULL;
+        XCTAssertEqual(posix_memalign(&bytes, 64, 64 * 2), 0);
+        NSData *owner = [NSData dataWithBytesNoCopy:bytes length:64 * 2 freeWhenDone:YES];
+        weakOwner = owner;
+        
+        RKPixelBuffer *buffer = [RKPixelBuffer pixelBufferWithBytes:bytes width:4 height:2 stride:64 format:RKPixelFormat_RGBA8888 owner:owner];
+        XCTAssertEqual(buffer.bytes, bytes);
+        XCTAssertEqual([buffer rowAtIndex:1] - buffer.bytes, 64);
+        image = CGImageRetain(buffer.imageValue);
+    }
+    
+    // The image still refers to the pixels, so their owner must still be alive.
+    XCTAssertNotNil(weakOwner);
+    CGImageRelease(image);
+    XCTAssertNil(weakOwner);
+}
+
+- (void)test_pixelBuffer_externalStorage_rejectsShortStride
+{
+    uint8_t bytes[64] __attribute__((aligned(64)));
+    XCTAssertNil([RKPixelBuffer pixelBufferWithBytes:bytes width:4 height:1 stride:8 format:RKPixelFormat_RGBA8888 owner:NSNull.null]);
+}
+
+@end
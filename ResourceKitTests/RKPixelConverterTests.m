@@ -0,0 +1,335 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#import <XCTest/XCTest.h>
+#import "RKPixelBuffer.h"
+#import "RKPixelConverter.h"
+
+static const RKPixelFormat RKDirectPixelFormats[] = {
+    RKPixelFormat_RGBA8888, RKPixelFormat_BGRA8888, RKPixelFormat_RGB565, RKPixelFormat_RGBA5551
+};
+
+// A small deterministic generator, so that failures can be reproduced.
+static uint8_t RKNextTestByte(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (uint8_t)(*state >> 24);
+}
+
+// Fill a run of 8888 pixels with random premultiplied values, so no component exceeds
+// the alpha of its pixel.
+static void RKFillPremultiplied(uint8_t *pixels, uint32_t count, uint32_t *state)
+{
+    for (uint32_t i = 0; i < count; ++i, pixels += 4) {
+        uint8_t a = RKNextTestByte(state);
+        for (int c = 0; c < 3; ++c) {
+            pixels[c] = a ? RKNextTestByte(state) % (a + 1) : 0;
+        }
+        pixels[3] = a;
+    }
+}
+
+// A straightforward scalar reduction of an 8888 image, against which the vector loop and
+// mip generation are checked. The last row and column are repeated when the size is odd.
+static void RKReferenceReduce8888(uint8_t *dst, size_t dstStride, uint32_t dstWidth, uint32_t dstHeight,
+                                  const uint8_t *src, size_t srcStride, uint32_t srcWidth, uint32_t srcHeight)
+{
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        const uint8_t *row0 = src + MIN(y * 2, srcHeight - 1) * srcStride;
+        const uint8_t *row1 = src + MIN(y * 2 + 1, srcHeight - 1) * srcStride;
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            uint32_t x0 = MIN(x * 2, srcWidth - 1) * 4;
+            uint32_t x1 = MIN(x * 2 + 1, srcWidth - 1) * 4;
+            for (uint32_t c = 0; c < 4; ++c) {
+                uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                dst[y * dstStride + x * 4 + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+@interface RKPixelConverterTests : XCTestCase
+@end
+
+@implementation RKPixelConverterTests
+
+#pragma mark - Lookup
+
+- (void)test_converterForFormat_existsForEachDirectFormat
+{
+    for (size_t i = 0; i < sizeof(RKDirectPixelFormats) / sizeof(RKDirectPixelFormats[0]); ++i) {
+        RKPixelFormat format = RKDirectPixelFormats[i];
+        const RKPixelConverter *converter = RKPixelConverterForFormat(format);
+        XCTAssertTrue(converter != NULL, @"format %u", format);
+        XCTAssertEqual(converter->format, format);
+        XCTAssertEqual(converter->bytesPerPixel, RKPixelFormatBytesPerPixel(format));
+        XCTAssertTrue(RKPixelFormatIsValid(format));
+    }
+}
+
+- (void)test_converterForFormat_indexedHasNoConverter
+{
+    XCTAssertTrue(RKPixelConverterForFormat(RKPixelFormat_Indexed8) == NULL);
+    XCTAssertTrue(RKPixelFormatIsValid(RKPixelFormat_Indexed8));
+    XCTAssertEqual(RKPixelFormatBytesPerPixel(RKPixelFormat_Indexed8), 1);
+}
+
+- (void)test_invalidFormat_isRejected
+{
+    RKPixelFormat invalid = (RKPixelFormat)99;
+    XCTAssertFalse(RKPixelFormatIsValid(invalid));
+    XCTAssertTrue(RKPixelConverterForFormat(invalid) == NULL);
+    XCTAssertEqual(RKPixelFormatBytesPerPixel(invalid), 0);
+    XCTAssertNil([RKPixelBuffer pixelBufferWithWidth:4 height:4 format:invalid]);
+}
+
+- (void)test_parserOption_fallsBackToRGBA8888
+{
+    XCTAssertNil(RKPixelFormatFromParserOption(nil));
+    XCTAssertEqualObjects(RKPixelFormatFromParserOption(@(RKPixelFormat_RGB565)), @(RKPixelFormat_RGB565));
+    XCTAssertEqualObjects(RKPixelFormatFromParserOption(@(RKPixelFormat_Indexed8)), @(RKPixelFormat_Indexed8));
+    XCTAssertEqualObjects(RKPixelFormatFromParserOption(@99), @(RKPixelFormat_RGBA8888));
+    XCTAssertEqualObjects(RKPixelFormatFromParserOption(@(-1)), @(RKPixelFormat_RGBA8888));
+    XCTAssertEqualObjects(RKPixelFormatFromParserOption(@"RGB565"), @(RKPixelFormat_RGBA8888));
+}
+
+
+#pragma mark - 32-bit Formats
+
+// Big endian XRGB 1555 red, white and mid grey. A 5-bit 16 expands to 0x84.
+static const uint8_t RKSampleRGB555[] = { 0x7C, 0x00, 0x7F, 0xFF, 0x42, 0x10 };
+
+- (void)test_convertRGB555_RGBA8888
+{
+    uint8_t dst[12];
+    RKPixelConverterForFormat(RKPixelFormat_RGBA8888)->convertRGB555(dst, RKSampleRGB555, 3);
+    const uint8_t expected[12] = { 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x84, 0x84, 0x84, 0xFF };
+    XCTAssertEqual(memcmp(dst, expected, sizeof(expected)), 0);
+}
+
+- (void)test_convertRGB555_BGRA8888
+{
+    uint8_t dst[12];
+    RKPixelConverterForFormat(RKPixelFormat_BGRA8888)->convertRGB555(dst, RKSampleRGB555, 3);
+    const uint8_t expected[12] = { 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x84, 0x84, 0x84, 0xFF };
+    XCTAssertEqual(memcmp(dst, expected, sizeof(expected)), 0);
+}
+
+- (void)test_storeRGBA_premultipliesRGBA8888AndBGRA8888
+{
+    uint8_t rgba[4], bgra[4];
+    RKPixelConverterForFormat(RKPixelFormat_RGBA8888)->storeRGBA(rgba, 200, 100, 50, 128);
+    RKPixelConverterForFormat(RKPixelFormat_BGRA8888)->storeRGBA(bgra, 200, 100, 50, 128);
+    
+    const uint8_t expectedRGBA[4] = { 100, 50, 25, 128 };
+    const uint8_t expectedBGRA[4] = { 25, 50, 100, 128 };
+    XCTAssertEqual(memcmp(rgba, expectedRGBA, 4), 0);
+    XCTAssertEqual(memcmp(bgra, expectedBGRA, 4), 0);
+}
+
+- (void)test_expandToRGBA8888_BGRA8888SwapsRedAndBlue
+{
+    const uint8_t src[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t dst[8];
+    RKPixelConverterForFormat(RKPixelFormat_BGRA8888)->expandToRGBA8888(dst, src, 2);
+    const uint8_t expected[8] = { 3, 2, 1, 4, 7, 6, 5, 8 };
+    XCTAssertEqual(memcmp(dst, expected, sizeof(expected)), 0);
+}
+
+
+#pragma mark - 16-bit Formats
+
+- (void)test_convertRGB555_RGB565
+{
+    uint16_t dst[3];
+    RKPixelConverterForFormat(RKPixelFormat_RGB565)->convertRGB555((uint8_t *)dst, RKSampleRGB555, 3);
+    XCTAssertEqual(dst[0], 0xF800);
+    XCTAssertEqual(dst[1], 0xFFFF);
+    XCTAssertEqual(dst[2], 0x8430);
+}
+
+- (void)test_convertRGB555_RGBA5551
+{
+    uint16_t dst[3];
+    RKPixelConverterForFormat(RKPixelFormat_RGBA5551)->convertRGB555((uint8_t *)dst, RKSampleRGB555, 3);
+    XCTAssertEqual(dst[0], 0xF801);
+    XCTAssertEqual(dst[1], 0xFFFF);
+    XCTAssertEqual(dst[2], 0x8421);
+}
+
+- (void)test_storeRGBA_16BitFormats
+{
+    uint16_t rgb565, rgba5551, transparent5551;
+    RKPixelConverterForFormat(RKPixelFormat_RGB565)->storeRGBA((uint8_t *)&rgb565, 200, 100, 50, 128);
+    RKPixelConverterForFormat(RKPixelFormat_RGBA5551)->storeRGBA((uint8_t *)&rgba5551, 200, 100, 50, 128);
+    RKPixelConverterForFormat(RKPixelFormat_RGBA5551)->storeRGBA((uint8_t *)&transparent5551, 200, 100, 50, 127);
+    
+    // Premultiplied to (100, 50, 25), which RGBA 5551 divides back out to (199, 100, 50)
+    // as the pixel is stored opaque. A pixel less than half covered has no alpha bit.
+    XCTAssertEqual(rgb565, 0x6183);
+    XCTAssertEqual(rgba5551, 0xC30D);
+    XCTAssertEqual(transparent5551, 0);
+}
+
+- (void)test_storeRGBA_RGBA5551_halfAlphaKeepsItsColor
+{
+    const RKPixelConverter *converter = RKPixelConverterForFormat(RKPixelFormat_RGBA5551);
+    uint16_t half, opaque;
+    converter->storeRGBA((uint8_t *)&half, 252, 132, 68, 0x80);
+    converter->storeRGBA((uint8_t *)&opaque, 252, 132, 68, UINT8_MAX);
+    
+    // The alpha bit is set from 0x80, and the pixel is not darkened by its coverage.
+    XCTAssertEqual(half, opaque);
+    XCTAssertEqual(half & 1, 1);
+}
+
+- (void)test_expandToRGBA8888_16BitFormats
+{
+    const uint16_t rgb565[2] = { 0xF800, 0x8430 };
+    const uint16_t rgba5551[2] = { 0xF801, 0x8420 };
+    uint8_t dst565[8], dst5551[8];
+    RKPixelConverterForFormat(RKPixelFormat_RGB565)->expandToRGBA8888(dst565, (const uint8_t *)rgb565, 2);
+    RKPixelConverterForFormat(RKPixelFormat_RGBA5551)->expandToRGBA8888(dst5551, (const uint8_t *)rgba5551, 2);
+    
+    const uint8_t expected565[8] = { 0xFF, 0x00, 0x00, 0xFF, 0x84, 0x86, 0x84, 0xFF };
+    const uint8_t expected5551[8] = { 0xFF, 0x00, 0x00, 0xFF, 0x84, 0x84, 0x84, 0x00 };
+    XCTAssertEqual(memcmp(dst565, expected565, 8), 0);
+    XCTAssertEqual(memcmp(dst5551, expected5551, 8), 0);
+}
+
+
+#pragma mark - Shared Behaviour
+
+- (void)test_convertPlanar_matchesStoreRGBAForEachFormat
+{
+    const uint8_t r[3] = { 255, 200, 10 };
+    const uint8_t g[3] = { 0, 100, 20 };
+    const uint8_t b[3] = { 128, 50, 30 };
+    const uint8_t a[3] = { 255, 128, 0 };
+    
+    for (size_t i = 0; i < sizeof(RKDirectPixelFormats) / sizeof(RKDirectPixelFormats[0]); ++i) {
+        const RKPixelConverter *converter = RKPixelConverterForFormat(RKDirectPixelFormats[i]);
+        uint8_t planar[12] = { 0 }, stored[12] = { 0 };
+        converter->convertPlanar(planar, r, g, b, a, 3);
+        for (uint32_t p = 0; p < 3; ++p) {
+            converter->storeRGBA(stored + p * converter->bytesPerPixel, r[p], g[p], b[p], a[p]);
+        }
+        XCTAssertEqual(memcmp(planar, stored, sizeof(planar)), 0, @"format %u", converter->format);
+    }
+}
+
+- (void)test_fillRGB555_alternatesForEachFormat
+{
+    for (size_t i = 0; i < sizeof(RKDirectPixelFormats) / sizeof(RKDirectPixelFormats[0]); ++i) {
+        const RKPixelConverter *converter = RKPixelConverterForFormat(RKDirectPixelFormats[i]);
+        uint8_t filled[20], converted[20];
+        converter->fillRGB555(filled, 0x7C00, 0x001F, 5);
+        
+        const uint8_t source[10] = { 0x7C, 0x00, 0x00, 0x1F, 0x7C, 0x00, 0x00, 0x1F, 0x7C, 0x00 };
+        converter->convertRGB555(converted, source, 5);
+        XCTAssertEqual(memcmp(filled, converted, 5 * converter->bytesPerPixel), 0, @"format %u", converter->format);
+    }
+}
+
+
+
+#pragma mark - Reduction
+
+- (void)test_reduce2x2_8888_roundsHalfUp
+{
+    // Sums of 1, 2 and 3 average to 0.25, 0.5 and 0.75.
+    const uint8_t row0[8] = { 1, 1, 1, 255, 0, 1, 1, 255 };
+    const uint8_t row1[8] = { 0, 0, 1, 255, 0, 0, 0, 255 };
+    uint8_t dst[4];
+    RKPixelConverterForFormat(RKPixelFormat_RGBA8888)->reduce2x2(dst, row0, row1, 2, 1);
+    
+    const uint8_t expected[4] = { 0, 1, 1, 255 };
+    XCTAssertEqual(memcmp(dst, expected, sizeof(expected)), 0);
+}
+
+- (void)test_reduce2x2_8888_matchesScalarReference
+{
+    uint32_t state = 0x5EED;
+    
+    // Widths on either side of the four pixel vector step, including odd widths whose last
+    // column is repeated, and rows that are averaged with themselves.
+    for (uint32_t srcWidth = 1; srcWidth <= 19; ++srcWidth) {
+        uint32_t dstWidth = MAX(srcWidth / 2, 1);
+        uint8_t row0[19 * 4], row1[19 * 4], dst[10 * 4], expected[10 * 4];
+        RKFillPremultiplied(row0, srcWidth, &state);
+        RKFillPremultiplied(row1, srcWidth, &state);
+        
+        for (int pass = 0; pass < 2; ++pass) {
+            const uint8_t *bottom = pass ? row0 : row1;
+            uint8_t rows[2][19 * 4];
+            memcpy(rows[0], row0, srcWidth * 4);
+            memcpy(rows[1], bottom, srcWidth * 4);
+            
+            RKPixelConverterForFormat(RKPixelFormat_RGBA8888)->reduce2x2(dst, row0, bottom, srcWidth, dstWidth);
+            RKReferenceReduce8888(expected, 0, dstWidth, 1, rows[0], sizeof(rows[0]), srcWidth, 2);
+            XCTAssertEqual(memcmp(dst, expected, dstWidth * 4), 0, @"width %u, pass %d", srcWidth, pass);
+        }
+    }
+}
+
+- (void)test_generateMipmaps_8888_matchesScalarReference
+{
+    const uint32_t sizes[][2] = { { 5, 3 }, { 7, 1 }, { 1, 7 }, { 1, 1 }, { 2, 9 }, { 33, 17 }, { 64, 64 } };
+    uint32_t state = 0xC0FFEE;
+    
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        for (RKPixelFormat format = RKPixelFormat_RGBA8888; format <= RKPixelFormat_BGRA8888; ++format) {
+            RKPixelBuffer *buffer = [RKPixelBuffer pixelBufferWithWidth:sizes[i][0] height:sizes[i][1] format:format mipmapped:YES];
+            for (uint32_t row = 0; row < buffer.height; ++row) {
+                RKFillPremultiplied([buffer rowAtIndex:row], buffer.width, &state);
+            }
+            [buffer generateMipmaps];
+            
+            // Each level is checked against a reduction of the level above it, so that a
+            // mistake is reported at the level it was made.
+            for (uint32_t level = 1; level < buffer.levelCount; ++level) {
+                uint32_t width = [buffer widthOfLevel:level];
+                uint32_t height = [buffer heightOfLevel:level];
+                XCTAssertEqual(width, MAX([buffer widthOfLevel:level - 1] / 2, 1));
+                XCTAssertEqual(height, MAX([buffer heightOfLevel:level - 1] / 2, 1));
+                
+                NSMutableData *expected = [NSMutableData dataWithLength:width * height * 4];
+                RKReferenceReduce8888(expected.mutableBytes, width * 4, width, height,
+                                      [buffer bytesOfLevel:level - 1], [buffer strideOfLevel:level - 1],
+                                      [buffer widthOfLevel:level - 1], [buffer heightOfLevel:level - 1]);
+                for (uint32_t row = 0; row < height; ++row) {
+                    XCTAssertEqual(memcmp([buffer bytesOfLevel:level] + row * [buffer strideOfLevel:level],
+                                          (const uint8_t *)expected.bytes + row * width * 4, width * 4), 0,
+                                   @"%ux%u format %u, level %u row %u", sizes[i][0], sizes[i][1], format, level, row);
+                }
+            }
+            
+            // The chain continues until both dimensions have reached 1.
+            XCTAssertEqual(buffer.levelCount, 32 - __builtin_clz(MAX(sizes[i][0], sizes[i][1])));
+        }
+    }
+}
+
+@end
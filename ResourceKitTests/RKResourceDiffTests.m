@@ -0,0 +1,93 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKResourceDiff.h"
+#import "RKResourceFork.h"
+#import "RKRezResourceFile.h"
+#import "RKRezFixture.h"
+#import "RKFourCC.h"
+
+@interface RKResourceDiffTests : XCTestCase
+@end
+
+@implementation RKResourceDiffTests
+
+- (NSString *)writeOldVersion
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:nil data:[RKRezFixture dataWithString:@"alpha"]];
+    [fixture addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:@"bravo"]];
+    [fixture addResourceOfType:@"dsïg" id:128 name:nil data:[RKRezFixture dataWithString:@"short"]];
+    [fixture addResourceOfType:@"vers" id:1 name:nil data:[RKRezFixture dataWithString:@"1.0"]];
+    return [fixture writeToTemporaryFileNamed:@"RKResourceDiffTests-Old"];
+}
+
+- (NSString *)writeNewVersion
+{
+    // STR 128 is unchanged but renamed and moved, STR 129 changes without changing size,
+    // dsïg 128 grows, STR 130 is new and vers 1 is gone.
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"dsïg" id:128 name:nil data:[RKRezFixture dataWithString:@"longer"]];
+    [fixture addResourceOfType:@"STR " id:130 name:nil data:[RKRezFixture dataWithString:@"new"]];
+    [fixture addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:@"brave"]];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Renamed" data:[RKRezFixture dataWithString:@"alpha"]];
+    return [fixture writeToTemporaryFileNamed:@"RKResourceDiffTests-New"];
+}
+
+- (void)test_resourceDiff_files_findsAddedRemovedAndModified
+{
+    RKRezResourceFile *oldFile = [RKRezResourceFile resourceFileWithPath:[self writeOldVersion]];
+    RKRezResourceFile *newFile = [RKRezResourceFile resourceFileWithPath:[self writeNewVersion]];
+    
+    RKResourceChangeSet *changes = [RKResourceDiff changesFromResourceFile:oldFile toResourceFile:newFile];
+    XCTAssertEqualObjects(changes.filePath, newFile.filePath);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.addedResources], @[@"STR  130"]);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.removedResources], @[@"vers 1"]);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.changedResources], (@[@"STR  129", @"dsïg 128"]));
+    
+    XCTAssertTrue([RKResourceDiff changesFromResourceFile:oldFile toResourceFile:oldFile].empty);
+}
+
+- (void)test_resourceDiff_forks_compareMergedContents
+{
+    RKRezFixture *plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:@"brave"]];
+    NSString *plugInPath = [plugIn writeToTemporaryFileNamed:@"RKResourceDiffTests-PlugIn"];
+    
+    RKResourceFork *oldFork = [RKResourceFork emptyResourceFork];
+    [oldFork addResourceFileAtPath:[self writeOldVersion]];
+    RKResourceFork *newFork = [RKResourceFork emptyResourceFork];
+    [newFork addResourceFileAtPath:[self writeOldVersion]];
+    XCTAssertTrue([RKResourceDiff changesFromResourceFork:oldFork toResourceFork:newFork].empty);
+    
+    // A plug-in overriding a resource with different bytes modifies it.
+    [newFork addResourceFileAtPath:plugInPath];
+    RKResourceChangeSet *changes = [RKResourceDiff changesFromResourceFork:oldFork toResourceFork:newFork];
+    XCTAssertNil(changes.filePath);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.changedResources], @[@"STR  129"]);
+    XCTAssertEqual(changes.addedResources.length + changes.removedResources.length, 0);
+}
+
+@end
@@ -0,0 +1,518 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKResourceFork.h"
+#import "RKResource.h"
+#import "RKObjectCache.h"
+#import "RKFourCC.h"
+#import "RKRezFixture.h"
+#import "RKResourceParserProtocol.h"
+#import "ResourceFilter.h"
+#import "ResourceIndex.h"
+
+// A parser that fails on everything, for checking that failures are reported.
+@interface RKFailingParser : NSObject <RKResourceParserProtocol>
+@end
+
+@implementation RKFailingParser
+
++ (nullable id)parseData:(nonnull NSData *)data
+{
+    return nil;
+}
+
+@end
+
+
+@interface RKResourceForkTests : XCTestCase
+@end
+
+@implementation RKResourceForkTests
+
+#pragma mark - Sample Data
+
+- (RKResourceFork *)forkWithBaseAndPlugIn
+{
+    RKRezFixture *base = [RKRezFixture new];
+    [base addResourceOfType:@"STR " id:128 name:@"First" data:[RKRezFixture dataWithString:@"base 128"]];
+    [base addResourceOfType:@"STR " id:130 name:@"Third" data:[RKRezFixture dataWithString:@"base 130"]];
+    [base addResourceOfType:@"vers" id:1 name:nil data:[RKRezFixture dataWithString:@"1.0"]];
+    
+    RKRezFixture *plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"STR " id:130 name:@"Third" data:[RKRezFixture dataWithString:@"plug-in 130"]];
+    [plugIn addResourceOfType:@"STR " id:129 name:@"Second" data:[RKRezFixture dataWithString:@"plug-in 129"]];
+    [plugIn addResourceOfType:@"dsïg" id:128 name:nil data:[RKRezFixture dataWithString:@"description"]];
+    
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    XCTAssertNotNil([fork addResourceFileAtPath:[base writeToTemporaryFileNamed:@"RKResourceForkTests-Base"]]);
+    XCTAssertNotNil([fork addResourceFileAtPath:[plugIn writeToTemporaryFileNamed:@"RKResourceForkTests-PlugIn"]]);
+    return fork;
+}
+
+
+#pragma mark - Merging
+
+- (void)test_resourceFork_laterFileShadowsEarlierResource
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:130], [RKRezFixture dataWithString:@"plug-in 130"]);
+    XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:128], [RKRezFixture dataWithString:@"base 128"]);
+    XCTAssertNil([fork dataForResourceOfType:@"STR " id:131]);
+}
+
+- (void)test_resourceFork_resourcesOfType_mergedAndSortedById
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    NSArray <RKResource *> *resources = [fork resourcesOfType:@"STR "];
+    XCTAssertEqualObjects([resources valueForKey:@"id"], (@[@128, @129, @130]));
+    XCTAssertEqualObjects(resources.lastObject.data, [RKRezFixture dataWithString:@"plug-in 130"]);
+}
+
+- (void)test_resourceFork_resourcesOfType_mergesManyOverlappingFiles
+{
+    // Each file lists its ids in descending order, overrides every id of the file before
+    // it and adds one of its own, below all of the others.
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    for (int16_t file = 0; file < 5; ++file) {
+        RKRezFixture *fixture = [RKRezFixture new];
+        for (int16_t id = 200; id >= 200 - file; --id) {
+            [fixture addResourceOfType:@"STR " id:id name:nil data:[RKRezFixture dataWithString:[NSString stringWithFormat:@"%d", file]]];
+        }
+        [fork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:[NSString stringWithFormat:@"RKResourceForkTests-Overlap%d", file]]];
+        
+        // Listing between files merges what has been added so far.
+        XCTAssertEqual([fork resourcesOfType:@"STR "].count, file + 1);
+    }
+    
+    NSArray <RKResource *> *resources = [fork resourcesOfType:@"STR "];
+    XCTAssertEqualObjects([resources valueForKey:@"id"], (@[@196, @197, @198, @199, @200]));
+    for (RKResource *resource in resources) {
+        XCTAssertEqualObjects(resource.data, [RKRezFixture dataWithString:@"4"]);
+    }
+}
+
+- (void)test_resourceFork_addResourceFilesAtPaths_overridesInArgumentOrder
+{
+    // Every file provides id 128 and the even files provide 129. The earlier files are the
+    // largest, so when they are parsed concurrently they tend to finish after the later
+    // ones, which must still override them.
+    const NSUInteger fileCount = 12;
+    NSMutableArray <NSString *> *paths = [NSMutableArray new];
+    for (NSUInteger file = 0; file < fileCount; ++file) {
+        RKRezFixture *fixture = [RKRezFixture new];
+        NSString *contents = [NSString stringWithFormat:@"file %lu", (unsigned long)file];
+        [fixture addResourceOfType:@"STR " id:128 name:nil data:[RKRezFixture dataWithString:contents]];
+        if (file % 2 == 0) {
+            [fixture addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:contents]];
+        }
+        for (NSUInteger i = 0; i < (fileCount - file) * 200; ++i) {
+            [fixture addResourceOfType:@"DATA" id:(int16_t)(1000 + i) name:nil data:[RKRezFixture dataWithString:contents]];
+        }
+        [paths addObject:[fixture writeToTemporaryFileNamed:[NSString stringWithFormat:@"RKResourceForkTests-Order%lu", (unsigned long)file]]];
+    }
+    
+    for (NSUInteger concurrency = 1; concurrency <= 8; concurrency *= 2) {
+        for (int attempt = 0; attempt < 10; ++attempt) {
+            RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+            NSArray <id<RKResourceFileProtocol>> *files = [fork addResourceFilesAtPaths:paths maximumConcurrency:concurrency];
+            XCTAssertEqualObjects([files valueForKey:@"filePath"], paths);
+            XCTAssertEqualObjects(fork.allFilePaths, paths);
+            
+            XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:128], [RKRezFixture dataWithString:@"file 11"]);
+            XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:129], [RKRezFixture dataWithString:@"file 10"]);
+            XCTAssertEqualObjects([fork dataForResourceOfType:@"DATA" id:1000], [RKRezFixture dataWithString:@"file 11"]);
+            XCTAssertEqualObjects([fork dataForResourceOfType:@"DATA" id:(int16_t)(1000 + fileCount * 200 - 1)], [RKRezFixture dataWithString:@"file 0"]);
+            
+            NSArray *providers = [fork resourceFilesContainingResourceOfTypeCode:RKFourCCFromString(@"STR ") id:128];
+            XCTAssertEqualObjects([providers valueForKey:@"filePath"], paths);
+        }
+    }
+}
+
+- (void)test_resourceFork_allTypes_distinctAndSorted
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    XCTAssertEqualObjects(fork.allTypes, (@[@"STR ", @"dsïg", @"vers"]));
+}
+
+- (void)test_resourceFork_typeCodeLookup_matchesTypeStringLookup
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    RKFourCC code = RKFourCCFromString(@"dsïg");
+    XCTAssertEqual(code, RKFourCCMake("ds\x95g"));
+    
+    RKResource *resource = [fork resourceOfTypeCode:code id:128];
+    XCTAssertEqual(resource.typeCode, code);
+    XCTAssertEqualObjects(resource, [fork resourceOfType:@"dsïg" id:128]);
+    XCTAssertEqualObjects([fork dataForResourceOfTypeCode:code id:128], [RKRezFixture dataWithString:@"description"]);
+    XCTAssertNil([fork resourceOfTypeCode:RKFourCCFromString(@"STR#") id:128]);
+}
+
+- (void)test_resourceFork_handles_describeMergedResources
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    RKFourCC code = RKFourCCFromString(@"STR ");
+    NSData *handles = [fork handlesOfTypeCode:code];
+    const RKResourceHandle *handle = handles.bytes;
+    XCTAssertEqual(handles.length / sizeof(*handle), 3);
+    
+    XCTAssertEqual([fork idOfResource:handle[0]], 128);
+    XCTAssertEqual([fork typeCodeOfResource:handle[0]], code);
+    XCTAssertEqualObjects([fork nameOfResource:handle[1]], @"Second");
+    XCTAssertEqual([fork sizeOfResource:handle[2]], 11);
+    XCTAssertEqualObjects([fork dataOfResource:handle[2]], [RKRezFixture dataWithString:@"plug-in 130"]);
+    XCTAssertEqual([fork resourceForHandle:handle[1]], [fork resourceOfType:@"STR " id:129]);
+    XCTAssertEqual([fork resourceForHandle:handle[1]], [fork resourcesOfType:@"STR "][1]);
+    
+    XCTAssertEqual([fork handleOfResourceOfTypeCode:code id:130], handle[2]);
+    XCTAssertEqual([fork handleOfResourceOfTypeCode:code id:131], RKResourceHandleNotFound);
+    XCTAssertNil([fork resourceForHandle:RKResourceHandleNotFound]);
+    XCTAssertEqual([fork handlesOfTypeCode:RKFourCCFromString(@"none")].length, 0);
+}
+
+
+#pragma mark - Snapshots
+
+- (void)test_resourceFork_readersDuringLoading_seeConsistentState
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    RKResourceHandle handle = [fork handleOfResourceOfTypeCode:RKFourCCFromString(@"STR ") id:128];
+    
+    NSMutableArray <NSString *> *paths = [NSMutableArray new];
+    for (int16_t file = 0; file < 20; ++file) {
+        RKRezFixture *fixture = [RKRezFixture new];
+        [fixture addResourceOfType:@"STR " id:1000 + file name:nil data:[RKRezFixture dataWithString:@"added"]];
+        [paths addObject:[fixture writeToTemporaryFileNamed:[NSString stringWithFormat:@"RKResourceForkTests-Snapshot%d", file]]];
+    }
+    
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (NSString *path in paths) {
+            [fork addResourceFileAtPath:path];
+        }
+    });
+    
+    // Each reader sees a whole number of files, and never loses a resource it has seen.
+    NSUInteger lastCount = 0;
+    while (dispatch_group_wait(group, DISPATCH_TIME_NOW) != 0) {
+        NSUInteger count = [fork handlesOfTypeCode:RKFourCCFromString(@"STR ")].length / sizeof(RKResourceHandle);
+        XCTAssertGreaterThanOrEqual(count, lastCount);
+        XCTAssertEqual([fork handleOfResourceOfTypeCode:RKFourCCFromString(@"STR ") id:128], handle);
+        XCTAssertEqualObjects([fork dataOfResource:handle], [RKRezFixture dataWithString:@"base 128"]);
+        lastCount = count;
+    }
+    
+    XCTAssertEqual([fork resourcesOfType:@"STR "].count, 23);
+    XCTAssertEqual(fork.allFilePaths.count, 22);
+}
+
+
+#pragma mark - Reloading
+
+- (void)test_resourceFork_reloadResourceFile_updatesOnlyWhatChanged
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    RKFourCC code = RKFourCCFromString(@"STR ");
+    RKResourceHandle shadowed = [fork handleOfResourceOfTypeCode:code id:130];
+    RKResourceHandle untouched = [fork handleOfResourceOfTypeCode:code id:128];
+    
+    // The plug-in changes one resource, adds another and drops the rest, one of which the
+    // base still provides.
+    RKRezFixture *plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"STR " id:129 name:@"Second" data:[RKRezFixture dataWithString:@"plug-in 129, revised"]];
+    [plugIn addResourceOfType:@"STR " id:131 name:@"Fourth" data:[RKRezFixture dataWithString:@"plug-in 131"]];
+    NSString *path = [plugIn writeToTemporaryFileNamed:@"RKResourceForkTests-PlugIn"];
+    
+    RKResourceChangeSet *changes = [fork reloadResourceFileAtPath:path];
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.addedResources], @[@"STR  131"]);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.removedResources], @[@"dsïg 128"]);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.changedResources], (@[@"STR  129", @"STR  130"]));
+    XCTAssertEqualObjects(changes.affectedTypes, (@[@"STR ", @"dsïg"]));
+    
+    XCTAssertEqual([fork handleOfResourceOfTypeCode:code id:130], shadowed);
+    XCTAssertEqual([fork handleOfResourceOfTypeCode:code id:128], untouched);
+    XCTAssertEqualObjects([fork dataOfResource:shadowed], [RKRezFixture dataWithString:@"base 130"]);
+    XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:129], [RKRezFixture dataWithString:@"plug-in 129, revised"]);
+    XCTAssertEqual([fork handleOfResourceOfTypeCode:RKFourCCFromString(@"dsïg") id:128], RKResourceHandleNotFound);
+    XCTAssertEqualObjects([[fork resourcesOfType:@"STR "] valueForKey:@"id"], (@[@128, @129, @130, @131]));
+    XCTAssertEqualObjects(fork.allTypes, (@[@"STR ", @"vers"]));
+    
+    // Reloading again with nothing changed reports nothing.
+    XCTAssertTrue([fork reloadResourceFileAtPath:path].empty);
+}
+
+- (void)test_resourceFork_reloadResourceFile_evictsOnlyObjectsOfChangedResources
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Kept" data:[RKRezFixture dataWithString:@"kept"]];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Revised" data:[RKRezFixture dataWithString:@"before"]];
+    [fixture addResourceOfType:@"STR " id:130 name:@"Removed" data:[RKRezFixture dataWithString:@"removed"]];
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    [fork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKResourceForkTests-Objects"]];
+    XCTAssertNotNil([fork resourceOfType:@"STR " id:128].object);
+    XCTAssertNotNil([fork resourceOfType:@"STR " id:129].object);
+    XCTAssertNotNil([fork resourceOfType:@"STR " id:130].object);
+    uint64_t revisedKey = [RKResource cacheKeyForTypeCode:RKFourCCFromString(@"STR ") contentHash:[fork resourceOfType:@"STR " id:129].contentHash];
+    uint64_t removedKey = [RKResource cacheKeyForTypeCode:RKFourCCFromString(@"STR ") contentHash:[fork resourceOfType:@"STR " id:130].contentHash];
+    
+    fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Kept" data:[RKRezFixture dataWithString:@"kept"]];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Revised" data:[RKRezFixture dataWithString:@"after"]];
+    RKResourceChangeSet *changes = [fork reloadResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKResourceForkTests-Objects"]];
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.changedResources], @[@"STR  129"]);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.removedResources], @[@"STR  130"]);
+    
+    // The objects of the old versions are evicted as soon as the file is reloaded.
+    XCTAssertNil([RKObjectCache.sharedCache peekObjectForKey:revisedKey]);
+    XCTAssertNil([RKObjectCache.sharedCache peekObjectForKey:removedKey]);
+    
+    [RKObjectCache.sharedCache resetCounters];
+    XCTAssertNotNil([fork resourceOfType:@"STR " id:128].object);
+    XCTAssertEqual(RKObjectCache.sharedCache.hitCount, 1);
+    XCTAssertEqualObjects([fork resourceOfType:@"STR " id:129].data, [RKRezFixture dataWithString:@"after"]);
+    XCTAssertNotNil([fork resourceOfType:@"STR " id:129].object);
+    XCTAssertEqual(RKObjectCache.sharedCache.missCount, 1);
+}
+
+- (void)test_resourceFork_reloadResourceFile_keepsObjectsSharedWithOtherResources
+{
+    RKRezFixture *base = [RKRezFixture new];
+    [base addResourceOfType:@"STR " id:128 name:nil data:[RKRezFixture dataWithString:@"shared"]];
+    RKRezFixture *plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"STR " id:200 name:nil data:[RKRezFixture dataWithString:@"shared"]];
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    [fork addResourceFileAtPath:[base writeToTemporaryFileNamed:@"RKResourceForkTests-SharedBase"]];
+    [fork addResourceFileAtPath:[plugIn writeToTemporaryFileNamed:@"RKResourceForkTests-SharedPlugIn"]];
+    id object = [fork resourceOfType:@"STR " id:128].object;
+    XCTAssertEqual([fork resourceOfType:@"STR " id:200].object, object);
+    uint64_t sharedKey = [RKResource cacheKeyForTypeCode:RKFourCCFromString(@"STR ") contentHash:[fork resourceOfType:@"STR " id:200].contentHash];
+    
+    // The changed resource had the same data as one that did not change, so the object
+    // they shared stays cached.
+    plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"STR " id:200 name:nil data:[RKRezFixture dataWithString:@"revised"]];
+    RKResourceChangeSet *changes = [fork reloadResourceFileAtPath:[plugIn writeToTemporaryFileNamed:@"RKResourceForkTests-SharedPlugIn"]];
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.changedResources], @[@"STR  200"]);
+    XCTAssertEqual([RKObjectCache.sharedCache peekObjectForKey:sharedKey], object);
+    
+    [RKObjectCache.sharedCache resetCounters];
+    XCTAssertEqual([fork resourceOfType:@"STR " id:128].object, object);
+    XCTAssertEqual(RKObjectCache.sharedCache.hitCount, 1);
+}
+
+- (void)test_resourceFork_reloadResourceFile_rewrittenInPlace_reportsChanges
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Kept" data:[RKRezFixture dataWithString:@"kept"]];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Revised" data:[RKRezFixture dataWithString:@"before"]];
+    NSString *path = [fixture writeToTemporaryFileNamed:@"RKResourceForkTests-InPlace"];
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    [fork addResourceFileAtPath:path];
+    
+    // Writing over the file keeps its inode, so the old version can no longer be read to
+    // compare against, and every resource it still has is reported as changed. The revised
+    // data has the same size as before, so only its contents differ.
+    fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Kept" data:[RKRezFixture dataWithString:@"kept"]];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Revised" data:[RKRezFixture dataWithString:@"behind"]];
+    [fixture addResourceOfType:@"STR " id:130 name:@"Added" data:[RKRezFixture dataWithString:@"added"]];
+    XCTAssertTrue([fixture.rezData writeToFile:path atomically:NO]);
+    
+    RKResourceChangeSet *changes = [fork reloadResourceFileAtPath:path];
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.addedResources], @[@"STR  130"]);
+    XCTAssertEqualObjects([RKRezFixture descriptionsOfResourceKeys:changes.changedResources], (@[@"STR  128", @"STR  129"]));
+    XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:129], [RKRezFixture dataWithString:@"behind"]);
+    
+    // Once reloaded, the new version is compared against as usual.
+    XCTAssertTrue([fork reloadResourceFileAtPath:path].empty);
+}
+
+- (void)test_resourceFork_watchingResourceFiles_reloadsChangedFile
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    [fork startWatchingResourceFiles];
+    XCTAssertTrue(fork.watchingResourceFiles);
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"File reloaded"];
+    id observer = [NSNotificationCenter.defaultCenter addObserverForName:RKResourceForkDidReloadResourceFileNotification object:fork queue:nil usingBlock:^(NSNotification *notification) {
+        RKResourceChangeSet *changes = notification.userInfo[RKResourceForkChangeSetKey];
+        XCTAssertEqualObjects(changes.filePath, fork.allFilePaths[0]);
+        [expectation fulfill];
+    }];
+    
+    RKRezFixture *base = [RKRezFixture new];
+    [base addResourceOfType:@"STR " id:128 name:@"First" data:[RKRezFixture dataWithString:@"base 128, revised"]];
+    [base writeToTemporaryFileNamed:@"RKResourceForkTests-Base"];
+    
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    [NSNotificationCenter.defaultCenter removeObserver:observer];
+    [fork stopWatchingResourceFiles];
+    XCTAssertEqualObjects([fork dataForResourceOfType:@"STR " id:128], [RKRezFixture dataWithString:@"base 128, revised"]);
+}
+
+#pragma mark - Presence Filters
+
+- (void)test_resourceFilter_noFalseNegatives_lowFalsePositiveRate
+{
+    RKFourCC type = RKFourCCFromString(@"shïp");
+    ResourceFilter *filter = ResourceFilterCreate(1, 1000);
+    for (int16_t id = 128; id < 1128; ++id) {
+        XCTAssertTrue(ResourceFilterAddResource(filter, ResourceIndexKey(type, id)));
+    }
+    
+    NSUInteger falsePositives = 0;
+    for (int16_t id = 128; id < 1128; ++id) {
+        XCTAssertTrue(ResourceFilterMayContainResource(filter, ResourceIndexKey(type, id)));
+        falsePositives += ResourceFilterMayContainResource(filter, ResourceIndexKey(type, -id));
+        falsePositives += ResourceFilterMayContainResource(filter, ResourceIndexKey(type, id + 10000));
+    }
+    XCTAssertLessThan((double)falsePositives / 2000, 0.02);
+    
+    // Types are held exactly, so a type the file does not have is never a false positive.
+    XCTAssertTrue(ResourceFilterContainsType(filter, type));
+    XCTAssertFalse(ResourceFilterContainsType(filter, RKFourCCFromString(@"wëap")));
+    XCTAssertFalse(ResourceFilterMayContainResource(filter, ResourceIndexKey(RKFourCCFromString(@"wëap"), 128)));
+    ResourceFilterDestroy(filter);
+}
+
+- (void)test_resourceFork_resourceFilesContainingResource_listsEveryProvider
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    RKFourCC code = RKFourCCFromString(@"STR ");
+    
+    NSArray *shadowed = [[fork resourceFilesContainingResourceOfTypeCode:code id:130] valueForKey:@"filePath"];
+    XCTAssertEqual(shadowed.count, 2);
+    XCTAssertEqualObjects(shadowed, fork.allFilePaths);
+    XCTAssertEqualObjects([[fork resourceFilesContainingResourceOfTypeCode:code id:128] valueForKey:@"filePath"], @[fork.allFilePaths[0]]);
+    XCTAssertEqualObjects([[fork resourceFilesContainingResourceOfTypeCode:RKFourCCFromString(@"dsïg") id:128] valueForKey:@"filePath"], @[fork.allFilePaths[1]]);
+    XCTAssertEqual([fork resourceFilesContainingResourceOfTypeCode:code id:131].count, 0);
+}
+
+#pragma mark - Enumeration
+
+- (void)test_resourceFork_enumerate_yieldsViewsInIdRange
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    NSMutableArray *ids = [NSMutableArray new];
+    NSMutableArray *names = [NSMutableArray new];
+    NSMutableArray *data = [NSMutableArray new];
+    
+    [fork enumerateResourcesOfTypeCode:RKFourCCFromString(@"STR ") idRange:RKResourceIdRangeMake(129, 130) usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+        [ids addObject:@(info->id)];
+        [names addObject:[[NSString alloc] initWithBytes:info->name.bytes length:info->name.length encoding:NSMacOSRomanStringEncoding]];
+        [data addObject:[NSData dataWithBytes:info->data.bytes length:info->data.length]];
+        XCTAssertEqual(info->handle, [fork handleOfResourceOfTypeCode:RKFourCCFromString(@"STR ") id:info->id]);
+    }];
+    
+    XCTAssertEqualObjects(ids, (@[@129, @130]));
+    XCTAssertEqualObjects(names, (@[@"Second", @"Third"]));
+    XCTAssertEqualObjects(data, (@[[RKRezFixture dataWithString:@"plug-in 129"], [RKRezFixture dataWithString:@"plug-in 130"]]));
+}
+
+- (void)test_resourceFork_enumerate_stopsEarly
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    __block NSUInteger count = 0;
+    [fork enumerateResourcesOfTypeCode:RKFourCCFromString(@"STR ") idRange:RKResourceIdRangeAll usingBlock:^(const RKResourceInfo *info, BOOL *stop) {
+        XCTAssertEqual(info->id, 128);
+        XCTAssertEqual(info->name.length, 5);
+        ++count;
+        *stop = YES;
+    }];
+    XCTAssertEqual(count, 1);
+}
+
+
+#pragma mark - Duplication
+
+- (void)test_resourceFork_duplicationSummary_countsCopiesOfEachPayload
+{
+    RKRezFixture *base = [RKRezFixture new];
+    [base addResourceOfType:@"STR " id:128 name:nil data:[RKRezFixture dataWithString:@"shared"]];
+    [base addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:@"unique"]];
+    RKRezFixture *plugIn = [RKRezFixture new];
+    [plugIn addResourceOfType:@"STR " id:1128 name:nil data:[RKRezFixture dataWithString:@"shared"]];
+    [plugIn addResourceOfType:@"STR " id:1129 name:nil data:[RKRezFixture dataWithString:@"shared"]];
+    
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    [fork addResourceFileAtPath:[base writeToTemporaryFileNamed:@"RKResourceForkTests-DuplicateBase"]];
+    [fork addResourceFileAtPath:[plugIn writeToTemporaryFileNamed:@"RKResourceForkTests-DuplicatePlugIn"]];
+    
+    RKDuplicationSummary summary = [fork duplicationSummaryOfTypeCode:RKFourCCFromString(@"STR ")];
+    XCTAssertEqual(summary.count, 4);
+    XCTAssertEqual(summary.uniqueCount, 2);
+    XCTAssertEqual(summary.bytes, 24);
+    XCTAssertEqual(summary.duplicateBytes, 12);
+    
+    RKResourceHandle handle = [fork handleOfResourceOfTypeCode:RKFourCCFromString(@"STR ") id:1129];
+    XCTAssertEqual([fork contentHashOfResource:handle], [fork resourceForHandle:handle].contentHash);
+}
+
+
+#pragma mark - Bulk Decoding
+
+- (void)test_resourceFork_decodeResourcesOfType_decodesEachMergedResource
+{
+    RKResourceFork *fork = [self forkWithBaseAndPlugIn];
+    NSMutableDictionary <NSNumber *, id> *objects = [NSMutableDictionary new];
+    
+    RKBulkDecodeSummary summary = [fork decodeResourcesOfType:@"STR " handler:^(RKResource *resource, id object, uint64_t duration) {
+        @synchronized (objects) {
+            objects[@(resource.id)] = object;
+        }
+    }];
+    
+    XCTAssertEqual(summary.count, 3);
+    XCTAssertEqual(summary.failures, 0);
+    XCTAssertEqual(summary.bytes, 30);
+    XCTAssertEqualObjects(objects[@130], [RKRezFixture dataWithString:@"plug-in 130"]);
+    XCTAssertEqualObjects(objects[@128], [fork resourceOfType:@"STR " id:128].object);
+    XCTAssertEqual(objects.count, 3);
+    
+    summary = [fork decodeResourcesOfType:@"none" handler:nil];
+    XCTAssertEqual(summary.count, 0);
+}
+
+- (void)test_resourceFork_decodeResourcesOfType_reportsFailures
+{
+    [RKResource registerParser:RKFailingParser.class forType:@"FAL#"];
+    
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"FAL#" id:128 name:nil data:[RKRezFixture dataWithString:@"one"]];
+    [fixture addResourceOfType:@"FAL#" id:129 name:nil data:[RKRezFixture dataWithString:@"two"]];
+    RKResourceFork *fork = [RKResourceFork emptyResourceFork];
+    [fork addResourceFileAtPath:[fixture writeToTemporaryFileNamed:@"RKResourceForkTests-Failing"]];
+    
+    __block NSUInteger nilObjects = 0;
+    RKBulkDecodeSummary summary = [fork decodeResourcesOfType:@"FAL#" maximumConcurrency:1 handler:^(RKResource *resource, id object, uint64_t duration) {
+        nilObjects += (object == nil);
+    }];
+    
+    XCTAssertEqual(summary.count, 2);
+    XCTAssertEqual(summary.failures, 2);
+    XCTAssertEqual(nilObjects, 2);
+}
+
+@end
@@ -0,0 +1,52 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/// RKRezFixture assembles small Rez files in memory, so that tests and benchmarks can
+/// exercise the resource fork without needing real game data.
+@interface RKRezFixture : NSObject
+
+/// Add a resource to the fixture. Resources are written grouped by type, in the order
+/// their types were first added.
+- (void)addResourceOfType:(nonnull NSString *)type
+                       id:(int16_t)resourceId
+                     name:(nullable NSString *)name
+                     data:(nonnull NSData *)data;
+
+/// Returns the contents of a Rez file holding all of the resources added so far.
+- (nonnull NSData *)rezData;
+
+/// Write the Rez file to a new file in the temporary directory, returning its path.
+- (nonnull NSString *)writeToTemporaryFileNamed:(nonnull NSString *)name;
+
+
+/// Returns the UTF-8 bytes of a string, for use as resource data.
++ (nonnull NSData *)dataWithString:(nonnull NSString *)string;
+
+/// Describes each RKResourceKey packed into the data as its type and id, such as
+/// "STR  128", so that lists of keys can be compared against literals.
++ (nonnull NSArray <NSString *> *)descriptionsOfResourceKeys:(nonnull NSData *)keys;
+
+@end
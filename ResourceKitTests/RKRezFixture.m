@@ -0,0 +1,174 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "RKRezFixture.h"
+#import "RKResourceChangeSet.h"
+#import "RKFourCC.h"
+
+@implementation RKRezFixture {
+@private
+    __strong NSMutableArray <NSString *> *_types;
+    __strong NSMutableDictionary <NSString *, NSMutableArray <NSDictionary *> *> *_resources;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _types = [NSMutableArray new];
+        _resources = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void)addResourceOfType:(NSString *)type id:(int16_t)resourceId name:(NSString *)name data:(NSData *)data
+{
+    if (!_resources[type]) {
+        [_types addObject:type];
+        _resources[type] = [NSMutableArray new];
+    }
+    [_resources[type] addObject:@{ @"id": @(resourceId), @"name": name ?: @"", @"data": data }];
+}
+
+
+#pragma mark - Encoding
+
+static void RKAppendLittleLong(NSMutableData *data, uint32_t value)
+{
+    uint32_t le = OSSwapHostToLittleInt32(value);
+    [data appendBytes:&le length:sizeof(le)];
+}
+
+static void RKAppendBigLong(NSMutableData *data, uint32_t value)
+{
+    uint32_t be = OSSwapHostToBigInt32(value);
+    [data appendBytes:&be length:sizeof(be)];
+}
+
+static void RKAppendBigWord(NSMutableData *data, uint16_t value)
+{
+    uint16_t be = OSSwapHostToBigInt16(value);
+    [data appendBytes:&be length:sizeof(be)];
+}
+
+static void RKAppendMacRoman(NSMutableData *data, NSString *string, NSUInteger length)
+{
+    NSData *bytes = [string dataUsingEncoding:NSMacOSRomanStringEncoding allowLossyConversion:YES];
+    [data appendBytes:bytes.bytes length:MIN(bytes.length, length)];
+    if (bytes.length < length) {
+        [data increaseLengthBy:length - bytes.length];
+    }
+}
+
+- (NSData *)rezData
+{
+    NSMutableArray <NSDictionary *> *resources = [NSMutableArray new];
+    for (NSString *type in _types) {
+        [resources addObjectsFromArray:_resources[type]];
+    }
+    
+    // The resource map is counted as the final entry of the file.
+    uint32_t entryCount = (uint32_t)resources.count + 1;
+    uint32_t dataOffset = 24 + entryCount * 12 + 12;
+    
+    // The map is big endian, and follows all of the resource data.
+    NSMutableData *map = [NSMutableData new];
+    RKAppendBigLong(map, 8);
+    RKAppendBigLong(map, (uint32_t)_types.count);
+    uint32_t headerOffset = 8 + (uint32_t)_types.count * 12;
+    for (NSString *type in _types) {
+        RKAppendMacRoman(map, type, 4);
+        RKAppendBigLong(map, headerOffset);
+        RKAppendBigLong(map, (uint32_t)_resources[type].count);
+        headerOffset += (uint32_t)_resources[type].count * 266;
+    }
+    
+    uint32_t entryIndex = 1;
+    for (NSString *type in _types) {
+        for (NSDictionary *resource in _resources[type]) {
+            RKAppendBigLong(map, entryIndex++);
+            RKAppendMacRoman(map, type, 4);
+            RKAppendBigWord(map, (uint16_t)[resource[@"id"] shortValue]);
+            RKAppendMacRoman(map, resource[@"name"], 256);
+        }
+    }
+    
+    // The header and entry table are little endian.
+    NSMutableData *rez = [NSMutableData new];
+    [rez appendBytes:"BRGR" length:4];
+    RKAppendLittleLong(rez, 1);
+    RKAppendLittleLong(rez, 12);
+    RKAppendLittleLong(rez, 0);
+    RKAppendLittleLong(rez, 0);
+    RKAppendLittleLong(rez, entryCount);
+    
+    uint32_t offset = dataOffset;
+    for (NSDictionary *resource in resources) {
+        NSData *data = resource[@"data"];
+        RKAppendLittleLong(rez, offset);
+        RKAppendLittleLong(rez, (uint32_t)data.length);
+        RKAppendLittleLong(rez, 0);
+        offset += (uint32_t)data.length;
+    }
+    RKAppendLittleLong(rez, offset);
+    RKAppendLittleLong(rez, (uint32_t)map.length);
+    RKAppendLittleLong(rez, 0);
+    
+    [rez appendBytes:"resource.map" length:12];
+    for (NSDictionary *resource in resources) {
+        [rez appendData:resource[@"data"]];
+    }
+    [rez appendData:map];
+    return rez;
+}
+
+- (NSString *)writeToTemporaryFileNamed:(NSString *)name
+{
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RKRezFixture"];
+    [NSFileManager.defaultManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    NSString *path = [directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"rez"]];
+    [self.rezData writeToFile:path atomically:YES];
+    return path;
+}
+
+
+
+#pragma mark - Helpers
+
++ (NSData *)dataWithString:(NSString *)string
+{
+    return [string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
++ (NSArray <NSString *> *)descriptionsOfResourceKeys:(NSData *)keys
+{
+    NSMutableArray <NSString *> *descriptions = [NSMutableArray new];
+    const RKResourceKey *key = keys.bytes;
+    for (NSUInteger i = 0; i < keys.length / sizeof(*key); ++i) {
+        [descriptions addObject:[NSString stringWithFormat:@"%@ %d", NSStringFromFourCC(key[i].type), key[i].id]];
+    }
+    return descriptions;
+}
+
+@end
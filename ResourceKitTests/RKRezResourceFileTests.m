@@ -24,6 +24,12 @@
 
 #import <XCTest/XCTest.h>
 #import "RKRezResourceFile.h"
+#import "RKResourceIndexCache.h"
+#import "RKResource.h"
+#import "RKRezFixture.h"
+#import "RKResourceFork.h"
+#import "RKFourCC.h"
+#import <unistd.h>
 
 @interface RKRezResourceFileTests : XCTestCase
 @end
@@ -50,4 +56,160 @@
     XCTAssertEqualObjects(rez.allTypes, expectedTypes);
 }
 
+
+#pragma mark - Index Cache
+
+- (NSString *)writeIndexCacheSample
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Shared" data:[@"second" dataUsingEncoding:NSUTF8StringEncoding]];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Shared" data:[@"first" dataUsingEncoding:NSUTF8StringEncoding]];
+    [fixture addResourceOfType:@"rlëD" id:200 name:@"Sprite" data:[NSData dataWithBytes:"\x01\x02\x03" length:3]];
+    
+    NSString *path = [fixture writeToTemporaryFileNamed:@"RKRezResourceFileTests-IndexCache"];
+    [NSFileManager.defaultManager removeItemAtPath:[RKResourceIndexCache cachePathForResourceFileAtPath:path] error:nil];
+    return path;
+}
+
+- (void)test_rezResourceFile_indexCache_reopenMatchesParse
+{
+    NSString *path = [self writeIndexCacheSample];
+    RKResourceIndexCache.enabled = YES;
+    
+    RKRezResourceFile *parsed = [RKRezResourceFile resourceFileWithPath:path];
+    XCTAssertNotNil([RKResourceIndexCache indexCacheForResourceFileAtPath:path]);
+    RKRezResourceFile *cached = [RKRezResourceFile resourceFileWithPath:path];
+    
+    XCTAssertEqualObjects(cached.allTypes, parsed.allTypes);
+    NSArray <RKResource *> *resources = [cached resourcesOfType:@"STR "];
+    XCTAssertEqualObjects([resources valueForKey:@"id"], (@[@128, @129]));
+    XCTAssertEqualObjects([resources valueForKey:@"name"], (@[@"Shared", @"Shared"]));
+    XCTAssertEqualObjects([cached dataForResourceOfType:@"STR " id:129], [parsed dataForResourceOfType:@"STR " id:129]);
+    XCTAssertEqualObjects([cached dataForResourceOfType:@"rlëD" id:200], [NSData dataWithBytes:"\x01\x02\x03" length:3]);
+    
+    RKResourceIndexCache.enabled = NO;
+}
+
+- (void)test_rezResourceFile_indexCache_ignoredOnceFileChanges
+{
+    NSString *path = [self writeIndexCacheSample];
+    RKResourceIndexCache.enabled = YES;
+    
+    XCTAssertNotNil([RKRezResourceFile resourceFileWithPath:path]);
+    XCTAssertNotNil([RKResourceIndexCache indexCacheForResourceFileAtPath:path]);
+    
+    NSDate *later = [NSDate dateWithTimeIntervalSinceNow:60];
+    [NSFileManager.defaultManager setAttributes:@{ NSFileModificationDate: later } ofItemAtPath:path error:nil];
+    XCTAssertNil([RKResourceIndexCache indexCacheForResourceFileAtPath:path]);
+    
+    RKResourceIndexCache.enabled = NO;
+}
+
+- (void)test_rezResourceFile_indexCache_sharedDirectory_namesCachesByWholePath
+{
+    // The paths only differ in the middle, which a hash of the ends alone would miss.
+    NSString *padding = [@"" stringByPaddingToLength:64 withString:@"x" startingAtIndex:0];
+    NSString *a = [NSString stringWithFormat:@"/Plug-ins/%@/A/%@/Data.rez", padding, padding];
+    NSString *b = [NSString stringWithFormat:@"/Plug-ins/%@/B/%@/Data.rez", padding, padding];
+    
+    RKResourceIndexCache.cacheDirectory = NSTemporaryDirectory();
+    NSString *cacheA = [RKResourceIndexCache cachePathForResourceFileAtPath:a];
+    NSString *cacheB = [RKResourceIndexCache cachePathForResourceFileAtPath:b];
+    RKResourceIndexCache.cacheDirectory = nil;
+    
+    XCTAssertNotEqualObjects(cacheA, cacheB);
+    XCTAssertTrue([cacheA.lastPathComponent hasPrefix:@"Data.rez-"]);
+}
+
+
+#pragma mark - Resource Names
+
+- (void)test_rezResourceFile_names_pooledAndInterned
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Shared" data:[NSData data]];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Shared" data:[NSData data]];
+    [fixture addResourceOfType:@"STR " id:130 name:@"Lone" data:[NSData data]];
+    [fixture addResourceOfType:@"vers" id:1 name:nil data:[NSData data]];
+    RKRezResourceFile *rez = [RKRezResourceFile resourceFileWithPath:[fixture writeToTemporaryFileNamed:@"RKRezResourceFileTests-Names"]];
+    
+    RKResourceMapUsage usage = rez.resourceMapUsage;
+    XCTAssertEqual(usage.resourceCount, 4);
+    XCTAssertEqual(usage.nameCount, 2);
+    XCTAssertEqual(usage.internedStringCount, 0);
+    XCTAssertLessThan(usage.bytes, usage.inlineNameBytes);
+    
+    NSArray <RKResource *> *resources = [rez resourcesOfType:@"STR "];
+    XCTAssertEqualObjects([resources valueForKey:@"name"], (@[@"Shared", @"Shared", @"Lone"]));
+    XCTAssertEqual(resources[0].name, resources[1].name);
+    XCTAssertEqualObjects([rez resourcesOfType:@"vers"].firstObject.name, @"");
+    XCTAssertEqual(rez.resourceMapUsage.internedStringCount, 2);
+}
+
+
+
+#pragma mark - Mapping
+
+- (void)test_rezResourceFile_truncatedInPlace_viewsNothingPastTheEnd
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"DATA" id:128 name:nil data:[NSMutableData dataWithLength:4096]];
+    NSString *path = [fixture writeToTemporaryFileNamed:@"RKRezResourceFileTests-Truncated"];
+    RKRezResourceFile *rez = [RKRezResourceFile resourceFileWithPath:path];
+    
+    NSData *entries = [rez resourceEntriesOfTypeCode:RKFourCCFromString(@"DATA")];
+    XCTAssertEqual(entries.length, sizeof(RKResourceEntry));
+    RKResourceEntry entry = *(const RKResourceEntry *)entries.bytes;
+    XCTAssertEqual([rez dataViewOfResourceEntry:entry].length, 4096);
+    
+    // Reading the mapped pages past the new end of the file would raise SIGBUS.
+    XCTAssertEqual(truncate(path.fileSystemRepresentation, entry.dataOffset + 1), 0);
+    RKBytesView view = [rez dataViewOfResourceEntry:entry];
+    XCTAssertTrue(view.bytes == NULL);
+    XCTAssertEqual(view.length, 0);
+}
+
+
+#pragma mark - Invalid Types
+
+- (void)test_rezResourceFile_invalidTypes_findNothing
+{
+    // A type of four zero bytes has the same code that every invalid type string converts
+    // to, so it must not be found by them.
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"" id:128 name:nil data:[@"zero" dataUsingEncoding:NSUTF8StringEncoding]];
+    [fixture addResourceOfType:@"STR " id:128 name:nil data:[@"text" dataUsingEncoding:NSUTF8StringEncoding]];
+    NSString *path = [fixture writeToTemporaryFileNamed:@"RKRezResourceFileTests-InvalidTypes"];
+    RKRezResourceFile *rez = [RKRezResourceFile resourceFileWithPath:path];
+    
+    for (NSString *type in @[ @"", @"ab", @"TooLong", @"日本語!" ]) {
+        XCTAssertEqual([rez resourcesOfType:type].count, 0, @"'%@'", type);
+        XCTAssertNil([rez dataForResourceOfType:type id:128], @"'%@'", type);
+    }
+    XCTAssertEqual([rez resourceEntriesOfTypeCode:0].length, 0);
+    XCTAssertNil([rez dataForResourceOfTypeCode:0 id:128]);
+    XCTAssertEqual([rez resourcesOfType:@"STR "].count, 1);
+    
+    RKResourceFork *resourceFork = [RKResourceFork emptyResourceFork];
+    [resourceFork addResourceFileAtPath:path];
+    XCTAssertNil([resourceFork resourceOfType:@"ab" id:128]);
+    XCTAssertNil([resourceFork dataForResourceOfType:@"TooLong" id:128]);
+    XCTAssertEqual([resourceFork resourcesOfTypeCode:0].count, 0);
+    XCTAssertNotNil([resourceFork resourceOfType:@"STR " id:128]);
+}
+
+- (void)test_resource_invalidTypes_notEqual
+{
+    // Invalid types all share the code 0, so equality has to fall back to the type string.
+    RKResource *first = [[RKResource alloc] initWithType:@"ab" id:128 name:nil size:0 owner:nil];
+    RKResource *second = [[RKResource alloc] initWithType:@"TooLong" id:128 name:nil size:0 owner:nil];
+    RKResource *same = [[RKResource alloc] initWithType:@"ab" id:128 name:nil size:0 owner:nil];
+    
+    XCTAssertNotEqualObjects(first, second);
+    XCTAssertEqualObjects(first, same);
+    XCTAssertEqual(first.hash, same.hash);
+    NSSet *resources = [NSSet setWithObjects:first, second, same, nil];
+    XCTAssertEqual(resources.count, 2);
+}
+
 @end
@@ -0,0 +1,142 @@
+//
+// MIT License
+//
+// Copyright (c) 2017 Tom Hancocks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RKRezWriter.h"
+#import "RKRezResourceFile.h"
+#import "RKResourceDiff.h"
+#import "RKRezFixture.h"
+#import "Rez.h"
+
+@interface RKRezWriterTests : XCTestCase
+@end
+
+@implementation RKRezWriterTests
+
+- (RKRezWriter *)sampleWriter
+{
+    // Added out of order, as an editor appends resources as they are changed.
+    RKRezWriter *writer = [RKRezWriter new];
+    [writer addResourceOfType:@"vers" id:1 name:@"Version" data:[RKRezFixture dataWithString:@"1.0"]];
+    [writer addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:@"second"]];
+    [writer addResourceOfType:@"dsïg" id:128 name:@"Sprite" data:[NSData dataWithBytes:"\x01\x02\x03" length:3]];
+    [writer addResourceOfType:@"STR " id:128 name:@"First" data:[RKRezFixture dataWithString:@"first"]];
+    [writer addResourceOfType:@"vers" id:2 name:nil data:[NSData data]];
+    return writer;
+}
+
+- (NSString *)writeWithWriter:(RKRezWriter *)writer named:(NSString *)name
+{
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RKRezWriterTests"];
+    [NSFileManager.defaultManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    NSString *path = [directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"rez"]];
+    XCTAssertTrue([writer writeToFile:path]);
+    return path;
+}
+
+- (void)assertRezFileAtPath:(NSString *)path holdsSampleResourcesWithOffsets:(fpos_t *)offsets
+{
+    RezResourceFile *file = RezOpenFile(path.fileSystemRepresentation);
+    XCTAssertTrue(file != NULL);
+    XCTAssertEqual(file->header->resourceCount, 6);
+    XCTAssertEqual(file->header->typeCount, 3);
+    
+    struct { const char *type; int16_t id; const char *name; NSData *data; } expected[] = {
+        { "STR ", 128, "First", [RKRezFixture dataWithString:@"first"] },
+        { "STR ", 129, "", [RKRezFixture dataWithString:@"second"] },
+        { "dsïg", 128, "Sprite", [NSData dataWithBytes:"\x01\x02\x03" length:3] },
+        { "vers", 1, "Version", [RKRezFixture dataWithString:@"1.0"] },
+        { "vers", 2, "", [NSData data] },
+    };
+    for (NSUInteger i = 0; i < sizeof(expected) / sizeof(*expected); ++i) {
+        NSData *macRoman = [@(expected[i].type) dataUsingEncoding:NSMacOSRomanStringEncoding];
+        RKFourCC type = RKFourCCMake(macRoman.bytes);
+        RezResourceHeader *resource = RezGetResourceHeaderOfTypeAtId(file, type, expected[i].id);
+        XCTAssertTrue(resource != NULL);
+        XCTAssertEqual(strcmp(RezGetResourceName(file, resource), expected[i].name), 0);
+        
+        uint8_t *bytes = NULL;
+        size_t size = 0;
+        RezGetResourceDataOfTypeAndId(file, type, expected[i].id, &bytes, &size);
+        XCTAssertEqualObjects([NSData dataWithBytesNoCopy:bytes length:size freeWhenDone:YES], expected[i].data);
+        offsets[i] = resource->offset;
+    }
+    RezClosefile(file);
+}
+
+- (void)test_rezWriter_asAdded_roundTripsThroughRezOpenFile
+{
+    fpos_t offsets[5];
+    [self assertRezFileAtPath:[self writeWithWriter:self.sampleWriter named:@"AsAdded"] holdsSampleResourcesWithOffsets:offsets];
+    
+    // The data stays in the order it was added: vers 1, STR 129, dsïg 128, STR 128.
+    XCTAssertLessThan(offsets[3], offsets[1]);
+    XCTAssertLessThan(offsets[1], offsets[2]);
+    XCTAssertLessThan(offsets[2], offsets[0]);
+}
+
+- (void)test_rezWriter_byTypeAndId_roundTripsSortedAndAligned
+{
+    RKRezWriter *writer = self.sampleWriter;
+    writer.layout = RKRezLayoutByTypeAndId;
+    writer.alignment = 16;
+    
+    // The expected resources are listed in type and id order, so their data should be too.
+    fpos_t offsets[5];
+    [self assertRezFileAtPath:[self writeWithWriter:writer named:@"ByTypeAndId"] holdsSampleResourcesWithOffsets:offsets];
+    for (NSUInteger i = 0; i < 5; ++i) {
+        XCTAssertEqual(offsets[i] % 16, 0);
+        XCTAssertTrue(i == 0 || offsets[i - 1] < offsets[i]);
+    }
+}
+
+- (void)test_rezWriter_duplicateResource_failsToWrite
+{
+    RKRezWriter *writer = self.sampleWriter;
+    [writer addResourceOfType:@"STR " id:129 name:nil data:[RKRezFixture dataWithString:@"again"]];
+    XCTAssertNil(writer.rezData);
+}
+
+- (void)test_rezWriter_repackagedFile_keepsLayoutOrReordersIt
+{
+    RKRezFixture *fixture = [RKRezFixture new];
+    [fixture addResourceOfType:@"STR " id:129 name:@"Shared" data:[RKRezFixture dataWithString:@"second"]];
+    [fixture addResourceOfType:@"STR " id:128 name:@"Shared" data:[RKRezFixture dataWithString:@"first"]];
+    [fixture addResourceOfType:@"rlëD" id:200 name:@"Sprite" data:[NSData dataWithBytes:"\x01\x02\x03" length:3]];
+    RKRezResourceFile *original = [RKRezResourceFile resourceFileWithPath:[fixture writeToTemporaryFileNamed:@"RKRezWriterTests-Original"]];
+    
+    // Written as it was read, the file comes out byte for byte the same.
+    RKRezWriter *writer = [RKRezWriter new];
+    [writer addResourcesFromResourceFile:original];
+    XCTAssertEqualObjects(writer.rezData, fixture.rezData);
+    
+    writer.layout = RKRezLayoutByTypeAndId;
+    writer.alignment = 8;
+    RKRezResourceFile *reordered = [RKRezResourceFile resourceFileWithPath:[self writeWithWriter:writer named:@"Reordered"]];
+    XCTAssertNotEqualObjects(writer.rezData, fixture.rezData);
+    XCTAssertTrue([RKResourceDiff changesFromResourceFile:original toResourceFile:reordered].empty);
+    XCTAssertEqualObjects([[reordered resourcesOfType:@"STR "] valueForKey:@"name"], (@[@"Shared", @"Shared"]));
+}
+
+@end